@@ -0,0 +1,73 @@
+#include "fake_radio.h"
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <time.h>
+
+static uint64_t steadyMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HostClock::HostClock()
+{
+    start = steadyMicros();
+    epoch = (unsigned long)time(NULL);
+}
+
+uint64_t HostClock::micros()
+{
+    return steadyMicros() - start;
+}
+
+void HostClock::reset()
+{
+    start = steadyMicros();
+    epoch = (unsigned long)time(NULL);
+}
+
+unsigned long HostClock::unixTime()
+{
+    return epoch + (unsigned long)(micros() / 1000000);
+}
+
+void HostClock::delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void FakeRadio::push(uint64_t due, int rssi, float snr, const std::string &payload)
+{
+    FakePacket packet;
+    packet.due = due;
+    packet.rssi = rssi;
+    packet.snr = snr;
+    packet.length = (uint16_t)(payload.length() < GATEWAY_MAX_FRAME ? payload.length() : GATEWAY_MAX_FRAME);
+    memcpy(packet.payload, payload.data(), packet.length);
+    // usually in order already
+    std::deque<FakePacket>::iterator it = packets.end();
+    while (it != packets.begin() && (it - 1)->due > due) {
+        --it;
+    }
+    packets.insert(it, packet);
+    handedOut.reserve(handedOut.size() + packets.size());
+}
+
+int FakeRadio::parsePacket()
+{
+    if (packets.empty() || packets.front().due > clock.micros()) {
+        return 0;
+    }
+    current = packets.front();
+    packets.pop_front();
+    handedOut.push_back(current.due);
+    return current.length;
+}
+
+size_t FakeRadio::readPacket(uint8_t *buf, size_t size)
+{
+    size_t n = current.length < size ? current.length : size;
+    memcpy(buf, current.payload, n);
+    return n;
+}
@@ -0,0 +1,68 @@
+#ifndef FAKE_RADIO_H
+#define FAKE_RADIO_H
+
+// Host side of the gateway interfaces: a clock, a WiFi switch
+// and a radio that hands out scripted packets when they are due.
+
+#include "hal.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+// real time since construction
+class HostClock : public SystemClock {
+public:
+    HostClock();
+    unsigned long millis() { return micros() / 1000; }
+    unsigned long unixTime();
+    void delay(unsigned long ms);
+    uint64_t micros();
+    // starts counting from 0 again
+    void reset();
+
+private:
+    uint64_t start;
+    unsigned long epoch;
+};
+
+class FakeUplink : public Uplink {
+public:
+    FakeUplink() : up(false) {}
+    void begin(const char *ssid, const char *password) { up = true; }
+    bool connected() { return up; }
+    bool up;
+};
+
+typedef struct {
+    uint64_t due;          // micros of the clock
+    int rssi;
+    float snr;
+    // fixed size so handing out a packet doesn't allocate
+    uint16_t length;
+    uint8_t payload[GATEWAY_MAX_FRAME];
+} FakePacket;
+
+class FakeRadio : public RadioLink {
+public:
+    explicit FakeRadio(HostClock &clock) : clock(clock) { current.length = 0; }
+
+    // packets are handed out in order of due time, longer payloads are cut
+    void push(uint64_t due, int rssi, float snr, const std::string &payload);
+    // packets not handed out yet
+    size_t pending() const { return packets.size(); }
+    // when the packets handed out so far were due, in order
+    const std::vector<uint64_t> &dueTimes() const { return handedOut; }
+
+    int parsePacket();
+    size_t readPacket(uint8_t *buf, size_t size);
+    int packetRssi() { return current.rssi; }
+    float packetSnr() { return current.snr; }
+
+private:
+    HostClock &clock;
+    std::deque<FakePacket> packets;
+    FakePacket current;
+    std::vector<uint64_t> handedOut;
+};
+
+#endif
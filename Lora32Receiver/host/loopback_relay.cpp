@@ -0,0 +1,391 @@
+#include "loopback_relay.h"
+#include <string.h>
+#include "Bitcoin.h"
+#include "Hash.h"
+#include "Conversion.h"
+
+// p at the opening quote, returns the character after the closing one
+static const char *skipString(const char *p)
+{
+    for (p++; *p; p++) {
+        if (*p == '\\') {
+            if (!*++p) {
+                return NULL;
+            }
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+// string, array, object, number or literal
+static const char *skipValue(const char *p)
+{
+    if (*p == '"') {
+        return skipString(p);
+    }
+    if (*p == '[' || *p == '{') {
+        int depth = 0;
+        while (*p) {
+            if (*p == '"') {
+                p = skipString(p);
+                if (p == NULL) {
+                    return NULL;
+                }
+                continue;
+            }
+            if (*p == '[' || *p == '{') {
+                depth++;
+            } else if (*p == ']' || *p == '}') {
+                if (--depth == 0) {
+                    return p + 1;
+                }
+            }
+            p++;
+        }
+        return NULL;
+    }
+    while (*p && *p != ',' && *p != '}' && *p != ']') {
+        p++;
+    }
+    return p;
+}
+
+static const char *skipSpaces(const char *p)
+{
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+// raw text of the values of the event object
+typedef struct {
+    std::string id, pubkey, createdAt, kind, tags, content, sig;
+} EventFields;
+
+static bool parseEvent(const char *message, EventFields &event)
+{
+    const char *p = strchr(message, '{');
+    if (p == NULL) {
+        return false;
+    }
+    p = skipSpaces(p + 1);
+    while (*p == '"') {
+        const char *keyEnd = skipString(p);
+        if (keyEnd == NULL) {
+            return false;
+        }
+        std::string key(p + 1, keyEnd - p - 2);
+        p = skipSpaces(keyEnd);
+        if (*p != ':') {
+            return false;
+        }
+        p = skipSpaces(p + 1);
+        const char *end = skipValue(p);
+        if (end == NULL) {
+            return false;
+        }
+        std::string value(p, end - p);
+        if (key == "id") {
+            event.id = value;
+        } else if (key == "pubkey") {
+            event.pubkey = value;
+        } else if (key == "created_at") {
+            event.createdAt = value;
+        } else if (key == "kind") {
+            event.kind = value;
+        } else if (key == "tags") {
+            event.tags = value;
+        } else if (key == "content") {
+            event.content = value;
+        } else if (key == "sig") {
+            event.sig = value;
+        }
+        p = skipSpaces(end);
+        if (*p == ',') {
+            p = skipSpaces(p + 1);
+        }
+    }
+    return *p == '}';
+}
+
+// "abc" -> abc
+static std::string unquote(const std::string &value)
+{
+    if (value.length() < 2) {
+        return "";
+    }
+    return value.substr(1, value.length() - 2);
+}
+
+// code point as UTF-8
+static void appendUtf8(std::string &out, unsigned long cp)
+{
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | cp >> 6);
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | cp >> 12);
+        out += (char)(0x80 | (cp >> 6 & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | cp >> 18);
+        out += (char)(0x80 | (cp >> 12 & 0x3F));
+        out += (char)(0x80 | (cp >> 6 & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+// four hex digits at i
+static bool readHex4(const std::string &s, size_t i, unsigned long &value)
+{
+    if (i + 4 > s.length()) {
+        return false;
+    }
+    value = 0;
+    for (size_t k = i; k < i + 4; k++) {
+        char c = s[k];
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (d < 0) {
+            return false;
+        }
+        value = value << 4 | d;
+    }
+    return true;
+}
+
+// the text of a JSON string value the way a relay parses it
+static bool jsonUnescape(const std::string &value, std::string &text)
+{
+    if (value.length() < 2 || value[0] != '"' || value[value.length() - 1] != '"') {
+        return false;
+    }
+    text.clear();
+    for (size_t i = 1; i + 1 < value.length(); i++) {
+        char c = value[i];
+        if ((uint8_t)c < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            text += c;
+            continue;
+        }
+        c = value[++i];
+        switch (c) {
+        case '"': case '\\': case '/': text += c; break;
+        case 'b': text += '\b'; break;
+        case 'f': text += '\f'; break;
+        case 'n': text += '\n'; break;
+        case 'r': text += '\r'; break;
+        case 't': text += '\t'; break;
+        case 'u': {
+            unsigned long cp, low;
+            if (!readHex4(value, i + 1, cp)) {
+                return false;
+            }
+            i += 4;
+            // surrogate pair
+            if (cp >= 0xD800 && cp < 0xDC00 && value.compare(i + 1, 2, "\\u") == 0 &&
+                readHex4(value, i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+            appendUtf8(text, cp);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+// NIP-01 serialization of a string: these seven escaped, the rest verbatim
+static std::string nip01String(const std::string &text)
+{
+    std::string out = "\"";
+    for (size_t i = 0; i < text.length(); i++) {
+        switch (text[i]) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:   out += text[i]; break;
+        }
+    }
+    return out + "\"";
+}
+
+std::string checkEvent(const char *message, std::string &id)
+{
+    EventFields event;
+    if (strncmp(message, "[\"EVENT\"", 8) != 0 || !parseEvent(message, event)) {
+        return "invalid: bad message";
+    }
+    id = unquote(event.id);
+    uint8_t idBytes[32], pub[33], rs[64];
+    std::string pubkey = unquote(event.pubkey);
+    std::string sig = unquote(event.sig);
+    if (fromHex(id.c_str(), id.length(), idBytes, sizeof(idBytes)) != 32 ||
+        fromHex(pubkey.c_str(), pubkey.length(), pub + 1, 32) != 32 ||
+        fromHex(sig.c_str(), sig.length(), rs, sizeof(rs)) != 64 ||
+        event.createdAt.empty() || event.kind.empty() || event.tags.empty() || event.content.empty()) {
+        return "invalid: missing fields";
+    }
+
+    // parsed and serialized again like a relay does, not the bytes the
+    // gateway wrote. Tags are taken as written, the gateway sends none
+    std::string content;
+    if (!jsonUnescape(event.content, content)) {
+        return "invalid: bad content";
+    }
+    std::string serialized = "[0," + event.pubkey + "," + event.createdAt + "," + event.kind + "," +
+                             event.tags + "," + nip01String(content) + "]";
+    uint8_t hash[32];
+    sha256(serialized.c_str(), serialized.length(), hash);
+    if (memcmp(hash, idBytes, 32) != 0) {
+        return "invalid: event id does not match";
+    }
+    pub[0] = 0x02;
+    PublicKey key(pub);
+    if (!key.isValid() || !key.schnorr_verify(SchnorrSignature(rs), hash)) {
+        return "invalid: bad signature";
+    }
+    return "";
+}
+
+LoopbackRelays::LoopbackRelays(HostClock &clock, RelayResponseCallback callback)
+    : clock(clock), callback(callback), firstMessage(0), busy(0), checking(true), uplinkRate(0), uplinkFree(0)
+{
+}
+
+size_t LoopbackRelays::addRelay(const char *name, unsigned long latencyMs)
+{
+    int i = find(name);
+    if (i >= 0) {
+        relays[i].latency = (uint64_t)latencyMs * 1000;
+        return i;
+    }
+    Relay relay;
+    relay.name = name;
+    relay.latency = (uint64_t)latencyMs * 1000;
+    relay.up = true;
+    memset(&relay.stats, 0, sizeof(relay.stats));
+    relays.push_back(relay);
+    return relays.size() - 1;
+}
+
+int LoopbackRelays::find(const char *name) const
+{
+    for (size_t i = 0; i < relays.size(); i++) {
+        if (relays[i].name == name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void LoopbackRelays::setUp(size_t relay, bool up)
+{
+    relays[relay].up = up;
+}
+
+size_t LoopbackRelays::inFlight() const
+{
+    size_t n = 0;
+    for (size_t i = 0; i < relays.size(); i++) {
+        if (relays[i].queue.size() > n) {
+            n = relays[i].queue.size();
+        }
+    }
+    return n;
+}
+
+bool LoopbackRelays::send(size_t relay, const char *message)
+{
+    if (!connected(relay)) {
+        return false;
+    }
+    unsigned long index = firstMessage + messages.size();
+    messages.push_back(message);
+    responses.push_back("");
+    ids.push_back("");
+    // messages leave one after the other over a slow uplink
+    uint64_t now = clock.micros();
+    if (uplinkRate) {
+        uplinkFree = (uplinkFree > now ? uplinkFree : now) + strlen(message) * 1000000ULL / uplinkRate;
+        now = uplinkFree;
+    }
+    Delivery d;
+    d.due = now + relays[relay].latency;
+    d.message = index;
+    relays[relay].queue.push_back(d);
+    return true;
+}
+
+const std::string &LoopbackRelays::response(unsigned long message, std::string &id)
+{
+    size_t i = message - firstMessage;
+    if (responses[i].empty()) {
+        uint64_t start = clock.micros();
+        std::string reason;
+        if (checking) {
+            reason = checkEvent(messages[i].c_str(), ids[i]);
+        } else {
+            // "id":"<64 hex>"
+            size_t pos = messages[i].find("\"id\":\"");
+            ids[i] = pos == std::string::npos ? "" : messages[i].substr(pos + 6, 64);
+        }
+        responses[i] = "[\"OK\",\"" + ids[i] + "\"," + (reason.empty() ? "true" : "false") + ",\"" + reason + "\"]";
+        busy += clock.micros() - start;
+    }
+    id = ids[i];
+    return responses[i];
+}
+
+void LoopbackRelays::loop()
+{
+    uint64_t now = clock.micros();
+    for (size_t r = 0; r < relays.size(); r++) {
+        Relay &relay = relays[r];
+        while (relay.up && !relay.queue.empty() && relay.queue.front().due <= now) {
+            unsigned long message = relay.queue.front().message;
+            relay.queue.pop_front();
+            std::string id;
+            std::string payload = response(message, id);
+            if (payload.find(",true,") != std::string::npos) {
+                if (!relay.seen.insert(id).second) {
+                    relay.stats.duplicates++;
+                    payload = "[\"OK\",\"" + id + "\",true,\"duplicate: already have this event\"]";
+                }
+                relay.stats.accepted++;
+            } else {
+                relay.stats.rejected++;
+            }
+            if (callback) {
+                callback(r, message, payload.c_str());
+            }
+        }
+    }
+
+    // forget messages every relay has answered
+    unsigned long oldest = firstMessage + messages.size();
+    for (size_t r = 0; r < relays.size(); r++) {
+        if (!relays[r].queue.empty() && relays[r].queue.front().message < oldest) {
+            oldest = relays[r].queue.front().message;
+        }
+    }
+    while (firstMessage < oldest) {
+        messages.pop_front();
+        responses.pop_front();
+        ids.pop_front();
+        firstMessage++;
+    }
+}
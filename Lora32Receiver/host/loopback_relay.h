@@ -0,0 +1,81 @@
+#ifndef LOOPBACK_RELAY_H
+#define LOOPBACK_RELAY_H
+
+// In-process stand-in for the relay connections of the board.
+// A relay gets each message sent to it after its latency, checks the event
+// id and signature like a real relay and answers ["OK",<id>,<accepted>,<reason>].
+// A relay that is down takes no messages, the ones on the way wait for it.
+
+#include "fake_radio.h"
+#include <set>
+#include <string>
+
+// relay is the index passed to addRelay, message counts send calls from 0
+typedef void (*RelayResponseCallback)(size_t relay, unsigned long message, const char *payload);
+
+typedef struct {
+    unsigned long accepted;
+    unsigned long rejected;
+    unsigned long duplicates;
+} LoopbackStats;
+
+class LoopbackRelays : public RelayLink {
+public:
+    LoopbackRelays(HostClock &clock, RelayResponseCallback callback);
+
+    // returns the index of the relay, an existing relay gets the new latency
+    size_t addRelay(const char *name, unsigned long latencyMs);
+    // index of the relay or -1
+    int find(const char *name) const;
+    void setUp(size_t relay, bool up);
+    const char *name(size_t relay) const { return relays[relay].name.c_str(); }
+    const LoopbackStats &stats(size_t relay) const { return relays[relay].stats; }
+    // messages some relay has not answered yet
+    size_t inFlight() const;
+    // time spent checking events, it is not gateway time
+    uint64_t busyMicros() const { return busy; }
+    // accept events without checking them, for load tests
+    void setChecking(bool check) { checking = check; }
+    // bytes per second all relays share on the way out, 0 = no limit
+    void setUplinkRate(unsigned long bytesPerSecond) { uplinkRate = bytesPerSecond; }
+
+    size_t count() { return relays.size(); }
+    bool connected(size_t relay) { return relay < relays.size() && relays[relay].up; }
+    bool send(size_t relay, const char *message);
+    void loop();
+
+private:
+    typedef struct {
+        uint64_t due;
+        unsigned long message;
+    } Delivery;
+    typedef struct {
+        std::string name;
+        uint64_t latency;
+        bool up;
+        std::deque<Delivery> queue;
+        std::set<std::string> seen;
+        LoopbackStats stats;
+    } Relay;
+
+    // the relay answer, checked once
+    const std::string &response(unsigned long message, std::string &id);
+
+    HostClock &clock;
+    RelayResponseCallback callback;
+    std::vector<Relay> relays;
+    std::deque<std::string> messages;     // not yet answered by every relay
+    std::deque<std::string> responses;    // "" until checked
+    std::deque<std::string> ids;
+    unsigned long firstMessage;           // index of messages.front()
+    uint64_t busy;
+    bool checking;
+    unsigned long uplinkRate;
+    uint64_t uplinkFree;                  // the uplink is busy sending until then
+};
+
+// checks the id and signature of ["EVENT",{...}], fills id (hex) if found.
+// Returns "" if the event is valid, the reason otherwise.
+std::string checkEvent(const char *message, std::string &id);
+
+#endif
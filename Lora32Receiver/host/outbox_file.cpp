@@ -0,0 +1,54 @@
+#include "outbox_file.h"
+
+bool FileOutboxStore::open(const char *name)
+{
+    close();
+    path = name;
+    f = fopen(name, "r+b");
+    if (f == NULL) {
+        f = fopen(name, "w+b");
+    }
+    return f != NULL;
+}
+
+void FileOutboxStore::close()
+{
+    if (f != NULL) {
+        fclose(f);
+        f = NULL;
+    }
+}
+
+size_t FileOutboxStore::size()
+{
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    long n = ftell(f);
+    return n < 0 ? 0 : (size_t)n;
+}
+
+size_t FileOutboxStore::read(size_t offset, uint8_t *data, size_t len)
+{
+    if (f == NULL || fseek(f, (long)offset, SEEK_SET) != 0) {
+        return 0;
+    }
+    return fread(data, 1, len, f);
+}
+
+size_t FileOutboxStore::append(const uint8_t *data, size_t len)
+{
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    size_t n = fwrite(data, 1, len, f);
+    fflush(f);
+    return n;
+}
+
+bool FileOutboxStore::clear()
+{
+    close();
+    f = fopen(path.c_str(), "w+b");
+    return f != NULL;
+}
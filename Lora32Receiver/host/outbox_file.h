@@ -0,0 +1,26 @@
+#ifndef HOST_OUTBOX_FILE_H
+#define HOST_OUTBOX_FILE_H
+
+#include <stdio.h>
+#include <string>
+#include "outbox.h"
+
+// outbox log on the host, same format as LittleFS or the SD card
+class FileOutboxStore : public OutboxStore {
+public:
+    FileOutboxStore() : f(NULL) {}
+    ~FileOutboxStore() { close(); }
+    // keeps what the file holds
+    bool open(const char *path);
+    void close();
+    size_t size();
+    size_t read(size_t offset, uint8_t *data, size_t len);
+    size_t append(const uint8_t *data, size_t len);
+    bool clear();
+
+private:
+    FILE *f;
+    std::string path;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#include "script.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+std::string scriptEscape(const uint8_t *payload, size_t len)
+{
+    std::string text;
+    for (size_t i = 0; i < len; i++) {
+        if (payload[i] < 0x20 || payload[i] >= 0x7F || payload[i] == '\\' ||
+            (payload[i] == ' ' && (i == 0 || i == len - 1))) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\x%02x", payload[i]);
+            text += buf;
+        } else {
+            text += (char)payload[i];
+        }
+    }
+    return text;
+}
+
+static int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::string scriptUnescape(const char *text)
+{
+    std::string payload;
+    for (const char *c = text; *c; c++) {
+        if (c[0] == '\\' && c[1] == 'x' && hexDigit(c[2]) >= 0 && hexDigit(c[3]) >= 0) {
+            payload += (char)(hexDigit(c[2]) * 16 + hexDigit(c[3]));
+            c += 3;
+        } else {
+            payload += *c;
+        }
+    }
+    return payload;
+}
+
+bool readScript(const char *path, std::vector<ScriptLine> &lines)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+    char line[2048];
+    int lineno = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '#') {
+            continue;
+        }
+        unsigned long ms;
+        char command[16];
+        int offset = 0;
+        if (sscanf(line, "%lu %15s %n", &ms, command, &offset) < 2) {
+            continue; // empty line
+        }
+        const char *rest = line + offset;
+        ScriptLine l;
+        l.at = (uint64_t)ms * 1000;
+        l.command = command;
+        l.rssi = 0;
+        l.snr = 0;
+        if (l.command == "packet") {
+            int n = 0;
+            if (sscanf(rest, "%d %f %n", &l.rssi, &l.snr, &n) < 2 || rest[n] == 0) {
+                fprintf(stderr, "%s:%d: expected packet <rssi> <snr> <text>\n", path, lineno);
+                ok = false;
+            }
+            l.payload = scriptUnescape(rest + n);
+        } else {
+            char name[128] = "", arg[128] = "";
+            sscanf(rest, "%127s %127s", name, arg);
+            l.name = name;
+            l.arg = arg;
+            if ((l.command == "wifi" && l.name != "up" && l.name != "down") ||
+                (l.command == "relay" && l.arg.empty()) ||
+                (l.command != "wifi" && l.command != "relay")) {
+                fprintf(stderr, "%s:%d: unknown command\n", path, lineno);
+                ok = false;
+            }
+        }
+        lines.push_back(l);
+    }
+    fclose(f);
+    return ok;
+}
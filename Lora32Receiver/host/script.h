@@ -0,0 +1,31 @@
+#ifndef HOST_SCRIPT_H
+#define HOST_SCRIPT_H
+
+// Simulator scripts, one timed command per line, lines starting with # are comments:
+//   <ms> packet <rssi> <snr> <text...>   \xNN in the text is a raw byte
+//   <ms> wifi up|down
+//   <ms> relay <name> <latency ms>       adds a relay or changes its latency
+//   <ms> relay <name> up|down
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+typedef struct {
+    uint64_t at;           // micros from the start
+    std::string command;   // packet, wifi or relay
+    std::string name;      // wifi: up/down, relay: its name
+    std::string arg;       // relay: latency or up/down
+    int rssi;
+    float snr;
+    std::string payload;
+} ScriptLine;
+
+// prints the problem to stderr and returns false on a bad line
+bool readScript(const char *path, std::vector<ScriptLine> &lines);
+
+// payload as script text, backslash and unprintable bytes become \xNN
+std::string scriptEscape(const uint8_t *payload, size_t len);
+std::string scriptUnescape(const char *text);
+
+#endif
@@ -0,0 +1,439 @@
+// Host simulation of the receiver gateway.
+// Feeds scripted or generated LoRa packets through Gateway (the code main.cpp
+// runs on the board) with real signing, sends the notes to loopback relays
+// and reports throughput and latency percentiles.
+//
+//   gateway_sim [options] [script]
+//     -n N     generate N packets (default 1000 without a script)
+//     -r RATE  generated packets per second, 0 = all at once (default 0)
+//     -s SIZE  generated payload size (default 45, the sender hello)
+//     -l MS    latency of the default relays (default 50)
+//     -q N     relays needed for a note to count as delivered (default 2)
+//     -t MS    give up waiting for relays after the last event (default 10000)
+//     -u       relays accept events without checking them (pure load test)
+//     -v       print the gateway log
+//     -T FILE  replay a packet trace recorded on the board
+//     -x SPEED replay speed, 1 keeps the recorded timing, 0 = all at once (default 1)
+//     -R FILE  record the received packets as a trace
+//     -O FILE  persistent outbox log, events left in it are sent first
+//     -b RATE  outbox sends per second (default 2, like the board)
+//     -A       outbox sends every event to every relay, no scheduler
+//     -H FILE  relay health file of the scheduler, kept between runs
+//     -w KBPS  uplink rate shared by the relays, 0 = no limit (default 0)
+//     -e N     each generated packet is heard N more times through repeaters
+//     -D       no duplicate filter, repeats are signed and sent again
+//     -F N     generated packets are air frames of N senders like the new sender,
+//              the text is the short hello, a SIZE above 45 pads it
+//     -z       with -F, compress the text when that makes the frame shorter
+//
+// See script.h for the script format. Without relay lines the script
+// runs against three relays like main.cpp.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include "gateway.h"
+#include "fake_radio.h"
+#include "loopback_relay.h"
+#include "nip01.h"
+#include "script.h"
+#include "trace_file.h"
+#include "outbox_file.h"
+#include "scheduler.h"
+
+// same keys as main.cpp
+static const char *nsecHex = "bdd19cecd942ed8964c2e0ddc92d5e09838d3a09ebb230d974868be00886704b";
+
+static HostClock hostClock;
+static FakeRadio radio(hostClock);
+static FakeUplink uplink;
+static Nip01Signer *signer;
+static LoopbackRelays *relays;
+static Gateway *gateway;
+
+static size_t quorum = 2;
+// per event, in order of signing or of the first send. The outbox sends events again
+static const uint64_t notSent = ~(uint64_t)0;
+static std::vector<long> eventPacket;      // -1 for events left in the outbox log
+static std::vector<uint64_t> enqueuedAt;   // notSent until the first send
+static std::vector<uint64_t> quorumAt;     // 0 until quorum relays accepted
+static std::vector<uint32_t> acceptedBy;   // bit per relay
+static std::map<std::string, size_t> eventIndex;
+static std::vector<size_t> messageEvent;   // per send call
+static unsigned long uplinkMessages, uplinkBytes;
+
+static void printLine(const char *line)
+{
+    printf("%s\n", line);
+}
+
+// number of the event in message, a new one is added for packet
+static size_t eventFor(const char *message, long packet)
+{
+    const char *id = strstr(message, "\"id\":\"");
+    std::string key = id ? std::string(id + 6, 64) : std::string(message);
+    std::map<std::string, size_t>::iterator it = eventIndex.find(key);
+    if (it == eventIndex.end()) {
+        it = eventIndex.insert(std::make_pair(key, enqueuedAt.size())).first;
+        eventPacket.push_back(packet);
+        enqueuedAt.push_back(notSent);
+        quorumAt.push_back(0);
+        acceptedBy.push_back(0);
+    }
+    return it->second;
+}
+
+// ties each note to the packet it was signed for
+class TimedSigner : public NoteSigner {
+public:
+    size_t note(unsigned long createdAt, const uint8_t *content, size_t len, char *out, size_t size)
+    {
+        size_t n = signer->note(createdAt, content, len, out, size);
+        if (n) {
+            eventFor(out, (long)gateway->stats().received - 1);
+        }
+        return n;
+    }
+};
+
+class TimedRelays : public RelayLink {
+public:
+    size_t count() { return relays->count(); }
+    // the sockets go down with the WiFi
+    bool connected(size_t relay) { return uplink.up && relays->connected(relay); }
+    bool send(size_t relay, const char *message)
+    {
+        if (!relays->send(relay, message)) {
+            return false;
+        }
+        size_t event = eventFor(message, -1);
+        if (enqueuedAt[event] == notSent) {
+            enqueuedAt[event] = hostClock.micros();
+        }
+        messageEvent.push_back(event);
+        uplinkMessages++;
+        uplinkBytes += strlen(message);
+        return true;
+    }
+    void loop() { relays->loop(); }
+};
+
+static void onResponse(size_t relay, unsigned long message, const char *payload)
+{
+    gateway->onOk(payload, (int)relay);
+    size_t event = messageEvent[message];
+    if (strstr(payload, ",true,") == NULL || (acceptedBy[event] & (1u << relay))) {
+        return;
+    }
+    acceptedBy[event] |= 1u << relay;
+    if ((size_t)__builtin_popcount(acceptedBy[event]) == quorum) {
+        quorumAt[event] = hostClock.micros();
+    }
+}
+
+static void runEvent(const ScriptLine &e)
+{
+    if (e.command == "wifi") {
+        uplink.up = (e.name == "up");
+        return;
+    }
+    if (e.arg == "up" || e.arg == "down") {
+        int i = relays->find(e.name.c_str());
+        if (i >= 0) {
+            relays->setUp(i, e.arg == "up");
+        }
+        return;
+    }
+    relays->addRelay(e.name.c_str(), strtoul(e.arg.c_str(), NULL, 10));
+}
+
+static double percentile(std::vector<double> &v, double p)
+{
+    if (v.empty()) {
+        return 0;
+    }
+    size_t i = (size_t)(p * (v.size() - 1) + 0.5);
+    return v[i];
+}
+
+static void report(const char *name, std::vector<double> &v, const char *unit)
+{
+    std::sort(v.begin(), v.end());
+    printf("%-20s p50 %9.1f  p90 %9.1f  p99 %9.1f  max %9.1f %s  (%u samples)\n", name,
+           percentile(v, 0.5), percentile(v, 0.9), percentile(v, 0.99),
+           v.empty() ? 0 : v.back(), unit, (unsigned)v.size());
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count = 0, size = 45, latency = 50, timeout = 10000;
+    double rate = 0;
+    bool verbose = false, checking = true;
+    const char *replay = NULL, *record = NULL, *outboxPath = NULL, *healthPath = NULL;
+    bool scheduled = true, filtered = true, compressed = false;
+    unsigned long echoes = 0, senders = 0;
+    float speed = 1, sendRate = OUTBOX_SEND_RATE, uplinkRate = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:s:l:q:t:uvT:x:R:O:b:AH:w:e:DF:z")) != -1) {
+        switch (opt) {
+        case 'n': count = strtoul(optarg, NULL, 10); break;
+        case 'r': rate = atof(optarg); break;
+        case 's': size = strtoul(optarg, NULL, 10); break;
+        case 'l': latency = strtoul(optarg, NULL, 10); break;
+        case 'q': quorum = strtoul(optarg, NULL, 10); break;
+        case 't': timeout = strtoul(optarg, NULL, 10); break;
+        case 'u': checking = false; break;
+        case 'v': verbose = true; break;
+        case 'T': replay = optarg; break;
+        case 'x': speed = atof(optarg); break;
+        case 'R': record = optarg; break;
+        case 'O': outboxPath = optarg; break;
+        case 'b': sendRate = atof(optarg); break;
+        case 'A': scheduled = false; break;
+        case 'H': healthPath = optarg; break;
+        case 'w': uplinkRate = atof(optarg); break;
+        case 'e': echoes = strtoul(optarg, NULL, 10); break;
+        case 'D': filtered = false; break;
+        case 'F': senders = strtoul(optarg, NULL, 10); break;
+        case 'z': compressed = true; break;
+        default:
+            fprintf(stderr, "usage: %s [-n packets] [-r rate] [-s size] [-l latency] [-q quorum] [-t timeout] [-u] [-v] [-T trace] [-x speed] [-R trace] [-O outbox] [-b rate] [-A] [-H health] [-w kbps] [-e echoes] [-D] [-F senders] [-z] [script]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<ScriptLine> events;
+    if (optind < argc) {
+        std::vector<ScriptLine> lines;
+        if (!readScript(argv[optind], lines)) {
+            return 1;
+        }
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (lines[i].command == "packet") {
+                radio.push(lines[i].at, lines[i].rssi, lines[i].snr, lines[i].payload);
+            } else {
+                events.push_back(lines[i]);
+            }
+        }
+    } else if (count == 0 && replay == NULL) {
+        count = 1000;
+    }
+    if (replay != NULL) {
+        FileTrace file;
+        TraceReader reader(file);
+        if (!file.open(replay, "rb") || !reader.begin()) {
+            fprintf(stderr, "%s is not a packet trace\n", replay);
+            return 1;
+        }
+        TraceRecord r;
+        while (reader.next(r)) {
+            if (r.length == 0) {
+                continue; // the radio never hands out empty packets
+            }
+            uint64_t due = speed > 0 ? (uint64_t)(r.time * 1000.0 / speed) : 0;
+            radio.push(due, r.rssi, r.snr, std::string((const char *)r.payload, r.length));
+        }
+    }
+    // generated traffic, numbered like the sender hello or in the air frame
+    uint64_t airtime[2] = { 0, 0 };
+    for (unsigned long i = 0; i < count; i++) {
+        char text[48];
+        snprintf(text, sizeof(text), "Hello NostrLoraMesh! #%lu ", i);
+        std::string payload(text);
+        while (payload.length() < size) {
+            payload += 'x';
+        }
+        payload.resize(size ? size : 1);
+        if (senders) {
+            // the new sender leaves " This is message number N" to the header. The short
+            // number stays so that notes signed in the same second are different events
+            snprintf(text, sizeof(text), "Hello NostrLoraMesh! #%lu", i);
+            payload = text + std::string(size > 45 ? size - 45 : 0, 'x');
+            uint8_t flags = 0;
+            uint8_t packed[GATEWAY_MAX_FRAME - AIRFRAME_MAX_HEADER];
+            size_t n = compressed ? textCompress((const uint8_t *)payload.data(), payload.length(),
+                                                 packed, sizeof(packed)) : 0;
+            if (n > 0 && n < payload.length()) {
+                payload.assign((const char *)packed, n);
+                flags = AIRFRAME_COMPRESSED;
+            }
+            uint8_t air[GATEWAY_MAX_FRAME];
+            n = airFrameEncode(AIRFRAME_TEXT, flags, 0x1000 + i % senders, i / senders,
+                               (const uint8_t *)payload.data(), payload.length(), air, sizeof(air));
+            payload.assign((const char *)air, n);
+        }
+        airtime[0] += loraAirtimeMicros(payload.length(), 7) * (1 + echoes);
+        airtime[1] += loraAirtimeMicros(payload.length(), 12) * (1 + echoes);
+        uint64_t due = rate > 0 ? (uint64_t)(i * 1e6 / rate) : 0;
+        radio.push(due, -60, 9.5f, payload);
+        // repeaters a hop further, each a little later and weaker
+        for (unsigned long e = 1; e <= echoes; e++) {
+            radio.push(due + e * 150000, -60 - 10 * (int)e, 9.5f - 3 * e, payload);
+        }
+    }
+
+    signer = new Nip01Signer(nsecHex);
+    relays = new LoopbackRelays(hostClock, onResponse);
+    relays->setChecking(checking);
+    relays->setUplinkRate((unsigned long)(uplinkRate * 1000));
+    bool scriptedRelays = false;
+    for (size_t i = 0; i < events.size(); i++) {
+        scriptedRelays |= (events[i].command == "relay" && events[i].arg != "up" && events[i].arg != "down");
+    }
+    if (!scriptedRelays) {
+        relays->addRelay("relay.damus.io", latency);
+        relays->addRelay("nostr.mom", latency);
+        relays->addRelay("relay.nostr.bg", latency);
+    }
+    // relays of time 0 now, the scheduler wants their names
+    std::vector<const char *> relayNames;
+    for (size_t i = 0; i < events.size() && events[i].at == 0; i++) {
+        if (events[i].command == "relay" && events[i].arg != "up" && events[i].arg != "down") {
+            runEvent(events[i]);
+        }
+    }
+    for (size_t i = 0; i < relays->count(); i++) {
+        relayNames.push_back(relays->name(i));
+    }
+    TimedRelays timedRelays;
+    TimedSigner timedSigner;
+    gateway = new Gateway(radio, uplink, hostClock, timedSigner, timedRelays);
+    if (verbose) {
+        gateway->setLogger(printLine);
+    }
+    DuplicateFilter dedup(hostClock);
+    if (filtered) {
+        gateway->setDuplicateFilter(&dedup);
+    }
+    FileTrace recordFile;
+    TraceWriter recorder(recordFile);
+    if (record != NULL) {
+        if (!recordFile.open(record, "wb") || !recorder.begin()) {
+            fprintf(stderr, "can't write %s\n", record);
+            return 1;
+        }
+        gateway->setRecorder(&recorder);
+    }
+    FileOutboxStore outboxFile, healthFile;
+    Outbox outbox(outboxFile, timedRelays, hostClock);
+    RelayScheduler scheduler(timedRelays, hostClock);
+    if (outboxPath != NULL) {
+        if (!outboxFile.open(outboxPath)) {
+            fprintf(stderr, "can't open %s\n", outboxPath);
+            return 1;
+        }
+        outbox.setQuorum(quorum);
+        outbox.setSendRate(sendRate, OUTBOX_SEND_BURST);
+        if (!outbox.begin()) {
+            fprintf(stderr, "%s is not an outbox log, starting a new one\n", outboxPath);
+            outbox.reset();
+        }
+        size_t leftover = outbox.pending();
+        if (leftover) {
+            printf("%u events left in %s\n", (unsigned)leftover, outboxPath);
+        }
+        gateway->setOutbox(&outbox);
+        if (scheduled) {
+            scheduler.setNames(relayNames.data(), relayNames.size());
+            if (healthPath != NULL && !healthFile.open(healthPath)) {
+                fprintf(stderr, "can't open %s\n", healthPath);
+                return 1;
+            }
+            if (scheduler.begin(healthPath ? &healthFile : NULL)) {
+                printf("relay health read from %s\n", healthPath);
+            }
+            outbox.setScheduler(&scheduler);
+        }
+    }
+    gateway->begin("sim", "");
+
+    // events at time 0 (relays, wifi) apply before the first packet
+    size_t next = 0;
+    uint64_t doneAt = 0;
+    uint64_t gatewayBusy = 0;
+    hostClock.reset(); // script times count from here
+    while (true) {
+        uint64_t now = hostClock.micros();
+        while (next < events.size() && events[next].at <= now) {
+            runEvent(events[next]);
+            next++;
+        }
+        // only loops that handled a packet, minus the relays checking events
+        uint64_t t0 = hostClock.micros();
+        uint64_t busyBefore = relays->busyMicros();
+        if (gateway->loop()) {
+            gatewayBusy += hostClock.micros() - t0 - (relays->busyMicros() - busyBefore);
+        }
+
+        if (next == events.size() && radio.pending() == 0) {
+            if (relays->inFlight() == 0 && (outboxPath == NULL || outbox.pending() == 0)) {
+                break;
+            }
+            if (doneAt == 0) {
+                doneAt = now;
+            } else if (now - doneAt > (uint64_t)timeout * 1000) {
+                printf("timeout: %u messages still in flight\n", (unsigned)relays->inFlight());
+                break;
+            }
+        }
+    }
+    double wall = hostClock.micros() / 1e6;
+
+    const std::vector<uint64_t> &due = radio.dueTimes();
+    std::vector<double> toEnqueue, toQuorum;
+    // events left in the outbox have no packet
+    size_t signedEvents = 0;
+    for (size_t i = 0; i < enqueuedAt.size(); i++) {
+        if (eventPacket[i] < 0) {
+            continue;
+        }
+        signedEvents++;
+        uint64_t at = due[eventPacket[i]];
+        if (enqueuedAt[i] != notSent) {
+            toEnqueue.push_back((enqueuedAt[i] - at) / 1e3);
+        }
+        if (quorumAt[i]) {
+            toQuorum.push_back((quorumAt[i] - at) / 1e3);
+        }
+    }
+    const GatewayStats &s = gateway->stats();
+    printf("packets %lu, duplicates %lu, invalid %lu, published %lu, dropped %lu, failed %lu, relay oks %lu, "
+           "rejected %lu\n", s.received, s.duplicates, s.invalid, s.published, s.dropped, s.failed, s.oks, s.rejected);
+    if (count) {
+        printf("generated packets on air %.1f s at SF7, %.1f s at SF12\n", airtime[0] / 1e6, airtime[1] / 1e6);
+    }
+    for (size_t i = 0; i < relays->count(); i++) {
+        const LoopbackStats &r = relays->stats(i);
+        printf("  %-20s accepted %lu, rejected %lu, duplicates %lu\n", relays->name(i), r.accepted, r.rejected, r.duplicates);
+    }
+    printf("wall time %.3f s, gateway time %.3f s, %.0f packets/s of gateway time\n",
+           wall, gatewayBusy / 1e6, gatewayBusy ? s.received * 1e6 / gatewayBusy : 0);
+    report("receive -> enqueue", toEnqueue, "ms");
+    report("receive -> quorum", toQuorum, "ms");
+    printf("delivered to quorum %u/%u\n", (unsigned)toQuorum.size(), (unsigned)signedEvents);
+    printf("uplink %lu messages, %lu bytes\n", uplinkMessages, uplinkBytes);
+    if (filtered) {
+        printf("duplicate filter: %lu checked, %lu dropped, %lu rotations, false positives %.4f%% now, "
+               "%.4f%% when full\n", dedup.stats().checked, dedup.stats().suppressed, dedup.stats().rotations,
+               dedup.falsePositiveRate() * 100, DuplicateFilter::configuredFalsePositiveRate() * 100);
+    }
+    if (outboxPath != NULL) {
+        const OutboxStats &o = outbox.stats();
+        outbox.flush();
+        printf("outbox: added %lu, sent %lu, retransmitted %lu, delivered %lu, dropped %lu, abandoned %lu, "
+               "%lu blocks written, %u bytes left\n", o.added, o.sent, o.retransmitted, o.delivered, o.dropped,
+               o.abandoned, o.blocks, (unsigned)outbox.logSize());
+        for (size_t i = 0; scheduled && i < relays->count() && i < ACK_MAX_RELAYS; i++) {
+            const RelayHealth &h = scheduler.health(i);
+            printf("  %-20s ewma %6.1f ms, p99 %5lu ms, errors %4.1f%%, sent %lu, acked %lu, failed %lu, backlog %u\n",
+                   relays->name(i), h.latency, scheduler.p99(i), h.errors * 100, (unsigned long)h.sent,
+                   (unsigned long)h.acked, (unsigned long)h.failed, (unsigned)scheduler.backlog(i));
+        }
+        if (scheduled && healthPath != NULL) {
+            scheduler.save();
+        }
+    }
+    return (s.rejected == 0 && s.failed == 0) ? 0 : 2;
+}
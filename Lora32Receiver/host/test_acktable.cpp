@@ -0,0 +1,134 @@
+// AckTable: probing, removal without tombstones, deadlines and acks.
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include "minunit.h"
+#include "acktable.h"
+
+// the first bytes pick the home slot, the rest tells ids apart
+static void makeId(uint8_t id[32], uint32_t home, uint32_t tag)
+{
+    memset(id, 0, 32);
+    for (int i = 0; i < 4; i++) {
+        id[i] = (uint8_t)(home >> (8 * i));
+        id[28 + i] = (uint8_t)(tag >> (8 * i));
+    }
+}
+
+MU_TEST(test_insert_find_remove)
+{
+    static AckTable table;
+    table.clear();
+    uint8_t a[32], b[32], c[32];
+    makeId(a, 5, 1);
+    makeId(b, 5, 2);
+    makeId(c, 6, 3);
+    mu_check(table.insert(a, 1) != NULL);
+    mu_check(table.insert(b, 2) != NULL);
+    // c wants the slot b took
+    mu_check(table.insert(c, 3) != NULL);
+    mu_check(table.insert(a, 4) == NULL);
+    mu_assert_int_eq(3, (int)table.size());
+
+    // removing a moves b and c back, both stay reachable
+    table.remove(table.find(a));
+    mu_check(table.find(a) == NULL);
+    mu_assert_int_eq(2, (int)table.find(b)->event);
+    mu_assert_int_eq(3, (int)table.find(c)->event);
+    mu_check(table.at(5)->used && table.at(6)->used && !table.at(7)->used);
+    mu_assert_int_eq(2, (int)table.size());
+}
+
+MU_TEST(test_runs_wrap_around)
+{
+    static AckTable table;
+    table.clear();
+    uint8_t id[32];
+    for (uint32_t i = 0; i < 4; i++) {
+        makeId(id, ACK_TABLE_SIZE - 2, i);
+        mu_check(table.insert(id, (uint16_t)i) != NULL);
+    }
+    mu_check(table.at(0)->used && table.at(1)->used);
+    makeId(id, ACK_TABLE_SIZE - 2, 1);
+    table.remove(table.find(id));
+    for (uint32_t i = 0; i < 4; i++) {
+        makeId(id, ACK_TABLE_SIZE - 2, i);
+        mu_check((table.find(id) != NULL) == (i != 1));
+    }
+    mu_check(!table.at(1)->used);
+}
+
+MU_TEST(test_churn_matches_a_map)
+{
+    static AckTable table;
+    table.clear();
+    std::map<uint32_t, uint16_t> expected;
+    uint32_t seed = 1;
+    uint8_t id[32];
+    for (int step = 0; step < 20000; step++) {
+        seed = seed * 1103515245 + 12345;
+        // few home slots so the runs get long
+        uint32_t tag = (seed >> 8) % 200;
+        makeId(id, tag % 13 * 5, tag);
+        AckSlot *slot = table.find(id);
+        mu_check((slot != NULL) == (expected.count(tag) > 0));
+        if (slot != NULL && (seed & 1)) {
+            mu_assert_int_eq(expected[tag], slot->event);
+            table.remove(slot);
+            expected.erase(tag);
+        } else if (slot == NULL) {
+            slot = table.insert(id, (uint16_t)step);
+            mu_check((slot == NULL) == (expected.size() >= ACK_TABLE_LOAD));
+            if (slot != NULL) {
+                expected[tag] = (uint16_t)step;
+            }
+        }
+        mu_assert_int_eq((int)expected.size(), (int)table.size());
+    }
+    for (std::map<uint32_t, uint16_t>::iterator it = expected.begin(); it != expected.end(); ++it) {
+        makeId(id, it->first % 13 * 5, it->first);
+        AckSlot *slot = table.find(id);
+        mu_check(slot != NULL && slot->event == it->second);
+    }
+}
+
+MU_TEST(test_deadline_and_acks)
+{
+    static AckTable table;
+    table.clear();
+    uint8_t id[32];
+    makeId(id, 9, 9);
+    AckSlot *slot = table.insert(id, 0);
+    mu_check(table.due(slot, 0, 1000));
+    table.sent(slot, 0, 1000);
+    table.sent(slot, 1, 1000);
+    mu_check(!table.due(slot, 0, 1000 + ACK_DEADLINE_MS - 1));
+    mu_check(table.due(slot, 0, 1000 + ACK_DEADLINE_MS));
+
+    mu_assert_int_eq(250, (int)table.ack(slot, 1, 1250));
+    mu_assert_int_eq(-1, (int)table.ack(slot, 1, 1300));
+    mu_check(!table.due(slot, 1, 1000 + ACK_DEADLINE_MS));
+    mu_assert_int_eq(1, AckTable::acks(slot));
+    mu_check(!table.due(slot, ACK_MAX_RELAYS, 0));
+
+    for (int i = 1; i < ACK_MAX_TRIES; i++) {
+        table.sent(slot, 0, 1000);
+    }
+    mu_check(!table.due(slot, 0, 1000 + ACK_DEADLINE_MS));
+}
+
+MU_TEST_SUITE(test_acktable)
+{
+    MU_RUN_TEST(test_insert_find_remove);
+    MU_RUN_TEST(test_runs_wrap_around);
+    MU_RUN_TEST(test_churn_matches_a_map);
+    MU_RUN_TEST(test_deadline_and_acks);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_acktable);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,173 @@
+// Air frames: header encoding, what the decoder refuses, time on air and the gateway side.
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "minunit.h"
+#include "gateway.h"
+#include "fake_radio.h"
+#include "textcodec.h"
+#include "test_doubles.h"
+
+// what the new sender sends, the old one spelled the number out in text
+static const char *hello = "Hello NostrLoraMesh!";
+
+static std::string frame(uint8_t type, uint8_t flags, uint32_t sender, uint32_t seq, const std::string &text)
+{
+    uint8_t out[GATEWAY_MAX_FRAME];
+    size_t n = airFrameEncode(type, flags, sender, seq, (const uint8_t *)text.data(), text.length(), out, sizeof(out));
+    return std::string((const char *)out, n);
+}
+
+static bool decode(const std::string &data, AirFrame &air)
+{
+    return airFrameDecode((const uint8_t *)data.data(), data.length(), air);
+}
+
+MU_TEST(test_round_trip)
+{
+    const uint32_t values[] = { 0, 1, 127, 128, 16383, 16384, 0x1FFFFF, 0x200000, 0xFFFFFFFF };
+    const size_t sizes[] = { 1, 1, 1, 2, 2, 3, 3, 4, 5 };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        std::string f = frame(AIRFRAME_TEXT, 0x0A, values[i], values[8 - i], hello);
+        mu_assert_int_eq((int)(2 + sizes[i] + sizes[8 - i] + strlen(hello)), (int)f.length());
+        AirFrame air;
+        mu_check(isAirFrame((const uint8_t *)f.data(), f.length()));
+        mu_check(decode(f, air));
+        mu_assert_int_eq(AIRFRAME_VERSION, air.version);
+        mu_assert_int_eq(AIRFRAME_TEXT, air.type);
+        mu_assert_int_eq(0x0A, air.flags);
+        mu_check(air.sender == values[i]);
+        mu_check(air.seq == values[8 - i]);
+        mu_assert_int_eq((int)strlen(hello), (int)air.length);
+        mu_check(memcmp(air.payload, hello, air.length) == 0);
+    }
+
+    // the sender hello, 5 header bytes instead of " This is message number 5"
+    std::string f = frame(AIRFRAME_TEXT, 0, 0x1234, 5, hello);
+    mu_assert_int_eq(5 + (int)strlen(hello), (int)f.length());
+    // an empty payload is fine, a frame that doesn't fit is not written
+    AirFrame air;
+    mu_check(decode(frame(AIRFRAME_TEXT, 0, 1, 2, ""), air));
+    mu_assert_int_eq(0, (int)air.length);
+    uint8_t small[8];
+    mu_assert_int_eq(0, (int)airFrameEncode(AIRFRAME_TEXT, 0, 1, 2, (const uint8_t *)hello, strlen(hello),
+                                            small, sizeof(small)));
+}
+
+MU_TEST(test_refused_frames)
+{
+    AirFrame air;
+    // plain text of old senders
+    std::string text = "Hello NostrLoraMesh! This is message number 5";
+    mu_check(!isAirFrame((const uint8_t *)text.data(), text.length()));
+    mu_check(!decode(text, air));
+    mu_check(!decode("", air));
+
+    std::string f = frame(AIRFRAME_TEXT, 0, 300, 70000, hello);
+    // cut inside the sequence number
+    mu_check(!decode(f.substr(0, 5), air));
+    mu_check(decode(f.substr(0, 7), air));
+    // a version this code doesn't know
+    std::string v2 = f;
+    v2[0] = (char)(AIRFRAME_MAGIC | 2);
+    mu_check(isAirFrame((const uint8_t *)v2.data(), v2.length()));
+    mu_check(!decode(v2, air));
+    // 300 spelled with an extra byte
+    std::string longer = f.substr(0, 2) + std::string("\xAC\x82\x00", 3) + f.substr(4);
+    mu_check(!decode(longer, air));
+    // past 32 bits
+    std::string wide = f.substr(0, 2) + "\xFF\xFF\xFF\xFF\x1F\x01";
+    mu_check(!decode(wide, air));
+}
+
+MU_TEST(test_airtime)
+{
+    // the Semtech calculator: 20 bytes at SF7 and 23 at SF12, 125 kHz 4/5
+    mu_assert_int_eq(56576, (int)loraAirtimeMicros(20, 7));
+    mu_assert_int_eq(1482752, (int)loraAirtimeMicros(23, 12));
+
+    std::string text = "Hello NostrLoraMesh! This is message number 123";
+    std::string f = frame(AIRFRAME_TEXT, 0, 0x1234, 123, hello);
+    printf("\n%u byte text, %u byte frame: SF7 %lu -> %lu us, SF10 %lu -> %lu us, SF12 %lu -> %lu us\n",
+           (unsigned)text.length(), (unsigned)f.length(),
+           loraAirtimeMicros(text.length(), 7), loraAirtimeMicros(f.length(), 7),
+           loraAirtimeMicros(text.length(), 10), loraAirtimeMicros(f.length(), 10),
+           loraAirtimeMicros(text.length(), 12), loraAirtimeMicros(f.length(), 12));
+    for (int sf = 7; sf <= 12; sf++) {
+        mu_check(loraAirtimeMicros(f.length(), sf) < loraAirtimeMicros(text.length(), sf));
+    }
+}
+
+MU_TEST(test_gateway_reads_frames)
+{
+    HostClock clock;
+    FakeRadio radio(clock);
+    FakeUplink uplink;
+    LastSigner signer;
+    NoRelays relays;
+    DuplicateFilter filter(clock);
+    Gateway gateway(radio, uplink, clock, signer, relays);
+    gateway.setDuplicateFilter(&filter);
+    gateway.begin("test", "");
+
+    // the note is the text without the header
+    radio.push(0, -70, 5.0f, frame(AIRFRAME_TEXT, 0, 0x1234, 5, hello));
+    mu_check(gateway.poll());
+    mu_assert_string_eq(hello, signer.last.c_str());
+    mu_assert_string_eq(hello, gateway.lastPayload());
+    mu_assert_int_eq((int)strlen(hello), (int)gateway.lastLength());
+    mu_assert_int_eq(0x1234, (int)gateway.lastSender());
+    mu_assert_int_eq(5, (int)gateway.lastSeq());
+
+    // same text: another sender or the next message is new, the same message is not
+    radio.push(0, -70, 5.0f, frame(AIRFRAME_TEXT, 0, 0x1235, 5, hello));
+    radio.push(0, -70, 5.0f, frame(AIRFRAME_TEXT, 0, 0x1234, 6, hello));
+    radio.push(0, -90, 1.0f, frame(AIRFRAME_TEXT, 0, 0x1234, 5, hello));
+    // the sender rebooted and counts from 5 again, other text is new
+    radio.push(0, -70, 5.0f, frame(AIRFRAME_TEXT, 0, 0x1234, 5, "Back again"));
+    // an old sender in plain text
+    radio.push(0, -70, 5.0f, "Hello NostrLoraMesh! This is message number 5");
+    // types and flags this gateway doesn't know
+    radio.push(0, -70, 5.0f, frame(2, 0, 0x1234, 7, hello));
+    radio.push(0, -70, 5.0f, frame(AIRFRAME_TEXT, 8, 0x1234, 8, hello));
+    while (gateway.poll()) {
+    }
+    mu_assert_string_eq("Hello NostrLoraMesh! This is message number 5", signer.last.c_str());
+    mu_assert_int_eq(0, (int)gateway.lastSender());
+    mu_assert_int_eq(8, (int)gateway.stats().received);
+    mu_assert_int_eq(1, (int)gateway.stats().duplicates);
+    mu_assert_int_eq(2, (int)gateway.stats().invalid);
+    mu_assert_int_eq(5, (int)signer.notes);
+
+    // compressed text is signed unpacked
+    std::string text = "Temperature 21.4 C, humidity 48%, pressure 1013 hPa";
+    uint8_t packed[GATEWAY_MAX_FRAME];
+    size_t n = textCompress((const uint8_t *)text.data(), text.length(), packed, sizeof(packed));
+    mu_check(n > 0 && n < text.length());
+    std::string compressed((const char *)packed, n);
+    radio.push(0, -70, 5.0f, frame(AIRFRAME_TEXT, AIRFRAME_COMPRESSED, 0x1234, 9, compressed));
+    mu_check(gateway.poll());
+    mu_assert_string_eq(text.c_str(), signer.last.c_str());
+    mu_assert_string_eq(text.c_str(), gateway.lastPayload());
+    mu_assert_int_eq((int)text.length(), (int)gateway.lastLength());
+    // and dropped if it doesn't unpack
+    radio.push(0, -70, 5.0f, frame(AIRFRAME_TEXT, AIRFRAME_COMPRESSED, 0x1234, 10, compressed.substr(0, n - 1) + "\xFF"));
+    mu_check(gateway.poll());
+    mu_assert_int_eq(3, (int)gateway.stats().invalid);
+    mu_assert_int_eq(6, (int)signer.notes);
+}
+
+MU_TEST_SUITE(test_airframe)
+{
+    MU_RUN_TEST(test_round_trip);
+    MU_RUN_TEST(test_refused_frames);
+    MU_RUN_TEST(test_airtime);
+    MU_RUN_TEST(test_gateway_reads_frames);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_airframe);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,133 @@
+// DuplicateFilter: suppression, the time window, the false-positive rate and the gateway hook.
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "minunit.h"
+#include "gateway.h"
+#include "fake_radio.h"
+#include "test_doubles.h"
+
+static bool seen(DuplicateFilter &filter, const std::string &frame)
+{
+    return filter.seen((const uint8_t *)frame.data(), frame.length());
+}
+
+static std::string hello(unsigned long n)
+{
+    char text[64];
+    snprintf(text, sizeof(text), "Hello NostrLoraMesh! This is message number %lu", n);
+    return text;
+}
+
+MU_TEST(test_repeats_are_suppressed)
+{
+    ManualClock clock;
+    static DuplicateFilter filter(clock);
+    filter.clear();
+    mu_check(!seen(filter, hello(1)));
+    mu_check(seen(filter, hello(1)));
+    mu_check(!seen(filter, hello(2)));
+    mu_check(!seen(filter, hello(1) + " "));
+    mu_assert_int_eq(4, (int)filter.stats().checked);
+    mu_assert_int_eq(1, (int)filter.stats().suppressed);
+
+    // the same payload from two senders is two frames
+    const uint8_t a[] = { 1 }, b[] = { 2 };
+    std::string text = hello(3);
+    mu_check(!filter.seen(a, 1, (const uint8_t *)text.data(), text.length()));
+    mu_check(!filter.seen(b, 1, (const uint8_t *)text.data(), text.length()));
+    mu_check(filter.seen(a, 1, (const uint8_t *)text.data(), text.length()));
+}
+
+MU_TEST(test_window)
+{
+    ManualClock clock;
+    static DuplicateFilter filter(clock);
+    filter.clear();
+    mu_check(!seen(filter, hello(1)));
+    clock.now += DEDUP_WINDOW_MS / 2 - 1;
+    mu_check(!seen(filter, hello(2)));
+    mu_assert_int_eq(0, (int)filter.stats().rotations);
+    // hello 1 and 2 move to the old generation, 3 starts the new one
+    clock.now += 1;
+    mu_check(!seen(filter, hello(3)));
+    mu_assert_int_eq(1, (int)filter.stats().rotations);
+    mu_check(seen(filter, hello(1)));
+    // the old generation goes, what was only in it is forgotten
+    clock.now += DEDUP_WINDOW_MS / 2;
+    mu_check(!seen(filter, hello(2)));
+    mu_check(seen(filter, hello(3)));
+    // a repeat is remembered again from when it was last heard
+    mu_check(seen(filter, hello(1)));
+    // a quiet window forgets everything
+    clock.now += DEDUP_WINDOW_MS;
+    mu_check(!seen(filter, hello(3)));
+}
+
+MU_TEST(test_false_positive_rate)
+{
+    ManualClock clock;
+    static DuplicateFilter filter(clock);
+    filter.clear();
+    float configured = DuplicateFilter::configuredFalsePositiveRate();
+    mu_check(configured > 0 && configured < 0.01f);
+    mu_check(filter.falsePositiveRate() == 0);
+
+    // both generations full, then count new frames taken for repeats
+    for (unsigned long i = 0; i < 2 * DEDUP_CAPACITY; i++) {
+        seen(filter, hello(i));
+    }
+    mu_assert_int_eq(1, (int)filter.stats().rotations);
+    float estimate = filter.falsePositiveRate();
+    mu_check(estimate > configured / 2 && estimate < configured * 2);
+
+    unsigned long before = filter.stats().suppressed, tries = 20000, hits = 0;
+    for (unsigned long i = 0; i < tries; i++) {
+        // new frames that don't fill the filter further
+        DuplicateFilter probe = filter;
+        hits += seen(probe, hello(1000000 + i));
+    }
+    mu_assert_int_eq((int)before, (int)filter.stats().suppressed);
+    float measured = (float)hits / tries;
+    printf("\nfalse positives: configured %.5f, estimated %.5f, measured %.5f\n", configured, estimate, measured);
+    mu_check(measured < configured * 3 + 0.001f);
+}
+
+MU_TEST(test_gateway_signs_a_frame_once)
+{
+    HostClock clock;
+    FakeRadio radio(clock);
+    FakeUplink uplink;
+    LastSigner signer;
+    NoRelays relays;
+    DuplicateFilter filter(clock);
+    Gateway gateway(radio, uplink, clock, signer, relays);
+    gateway.setDuplicateFilter(&filter);
+    gateway.begin("test", "");
+
+    // the sender and two repeaters
+    for (int copy = 0; copy < 3; copy++) {
+        radio.push(0, -70 - copy * 10, 5.0f, hello(7));
+    }
+    radio.push(0, -70, 5.0f, hello(8));
+    while (gateway.poll()) {
+    }
+    mu_assert_int_eq(4, (int)gateway.stats().received);
+    mu_assert_int_eq(2, (int)gateway.stats().duplicates);
+    mu_assert_int_eq(2, (int)signer.notes);
+}
+
+MU_TEST_SUITE(test_dedup)
+{
+    MU_RUN_TEST(test_repeats_are_suppressed);
+    MU_RUN_TEST(test_window);
+    MU_RUN_TEST(test_false_positive_rate);
+    MU_RUN_TEST(test_gateway_signs_a_frame_once);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_dedup);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
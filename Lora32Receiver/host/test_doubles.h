@@ -0,0 +1,117 @@
+#ifndef TEST_DOUBLES_H
+#define TEST_DOUBLES_H
+
+// Stand-ins the host tests share: a clock moved by hand, an outbox file in
+// memory, relays that record or refuse every send, a signer that
+// only looks at the content, and events with the id
+// the outbox looks for.
+
+#include "hal.h"
+#include "outbox.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+class ManualClock : public SystemClock {
+public:
+    ManualClock() : now(1000) {}
+    unsigned long millis() { return now; }
+    unsigned long unixTime() { return 1700000000UL + now / 1000; }
+    void delay(unsigned long ms) { now += ms; }
+    unsigned long now;
+};
+
+class MemoryStore : public OutboxStore {
+public:
+    MemoryStore() : appends(0) {}
+    size_t size() { return data.size(); }
+    size_t read(size_t offset, uint8_t *out, size_t len)
+    {
+        if (offset >= data.size()) {
+            return 0;
+        }
+        if (len > data.size() - offset) {
+            len = data.size() - offset;
+        }
+        memcpy(out, data.data() + offset, len);
+        return len;
+    }
+    size_t append(const uint8_t *in, size_t len)
+    {
+        appends++;
+        data.insert(data.end(), in, in + len);
+        return len;
+    }
+    bool clear()
+    {
+        data.clear();
+        return true;
+    }
+    std::vector<uint8_t> data;
+    unsigned long appends;
+};
+
+// all connected, every send succeeds and is kept
+class SentRelays : public RelayLink {
+public:
+    SentRelays(size_t n = 1) : up(n, true) {}
+    size_t count() { return up.size(); }
+    bool connected(size_t relay) { return up[relay]; }
+    bool send(size_t relay, const char *message)
+    {
+        sent.push_back(message);
+        to.push_back(relay);
+        return true;
+    }
+    void loop() {}
+    std::vector<bool> up;
+    std::vector<std::string> sent;
+    std::vector<size_t> to;     // relay of each sent message
+};
+
+class NoRelays : public RelayLink {
+public:
+    size_t count() { return 0; }
+    bool connected(size_t relay) { return false; }
+    bool send(size_t relay, const char *message) { return false; }
+    void loop() {}
+};
+
+// signs nothing, keeps the content it was asked to sign
+class LastSigner : public NoteSigner {
+public:
+    LastSigner() : notes(0) {}
+    size_t note(unsigned long createdAt, const uint8_t *content, size_t len, char *out, size_t size)
+    {
+        last.assign((const char *)content, len);
+        notes++;
+        return 0;
+    }
+    std::string last;
+    unsigned long notes;
+};
+
+// a message with the id the outbox looks for, n in the first byte
+static inline std::string event(int n)
+{
+    char id[65];
+    for (int i = 0; i < 64; i++) {
+        id[i] = "0123456789abcdef"[(n + i) & 0x0F];
+    }
+    id[0] = "0123456789abcdef"[n >> 4 & 0x0F];
+    id[1] = "0123456789abcdef"[n & 0x0F];
+    id[64] = 0;
+    char buf[160];
+    snprintf(buf, sizeof(buf), "[\"EVENT\",{\"content\":\"note %d\",\"id\":\"%s\"}]", n, id);
+    return buf;
+}
+
+static inline std::string ok(int n, bool accepted)
+{
+    std::string e = event(n);
+    size_t p = e.find("\"id\":\"") + 6;
+    return "[\"OK\",\"" + e.substr(p, 64) + "\"," + (accepted ? "true" : "false") + ",\"\"]";
+}
+
+#endif
@@ -0,0 +1,260 @@
+// Heap watermark test of the packet path: after a warm up, receiving,
+// recording, decoding, filtering, logging, signing and enqueueing a packet must not allocate.
+//
+// Allocations are counted in operator new and, when linked with
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free (the Makefile
+// does this on Linux), in every malloc of the gateway, host and uBitcoin code.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+#include "minunit.h"
+#include "gateway.h"
+#include "fake_radio.h"
+#include "nip01.h"
+#include "loopback_relay.h"
+
+#ifdef __linux__
+#include <malloc.h>
+#endif
+
+// volatile, the compiler assumes malloc doesn't touch them
+static volatile size_t allocs = 0;
+static volatile size_t liveBytes = 0;
+static volatile size_t peakBytes = 0;
+
+static void counted(void *ptr)
+{
+    allocs++;
+#ifdef __linux__
+    if (ptr != NULL) {
+        liveBytes += malloc_usable_size(ptr);
+        if (liveBytes > peakBytes) {
+            peakBytes = liveBytes;
+        }
+    }
+#endif
+}
+
+#ifdef HOST_WRAP_MALLOC
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    counted(ptr);
+    return ptr;
+}
+void *__wrap_calloc(size_t num, size_t size)
+{
+    void *ptr = __real_calloc(num, size);
+    counted(ptr);
+    return ptr;
+}
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    if (ptr != NULL) {
+        liveBytes -= malloc_usable_size(ptr);
+    }
+    ptr = __real_realloc(ptr, size);
+    counted(ptr);
+    return ptr;
+}
+void __wrap_free(void *ptr)
+{
+    if (ptr != NULL) {
+        liveBytes -= malloc_usable_size(ptr);
+    }
+    __real_free(ptr);
+}
+}
+#endif
+
+static void *countedNew(size_t size)
+{
+    // malloc is counted when it is wrapped
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == NULL) {
+        throw std::bad_alloc();
+    }
+#ifndef HOST_WRAP_MALLOC
+    allocs++;
+#endif
+    return ptr;
+}
+
+void *operator new(size_t size) { return countedNew(size); }
+void *operator new[](size_t size) { return countedNew(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+// same keys as main.cpp
+static const char *nsecHex = "bdd19cecd942ed8964c2e0ddc92d5e09838d3a09ebb230d974868be00886704b";
+
+// keeps the last message in a fixed buffer
+class LastRelay : public RelayLink {
+public:
+    LastRelay() : sends(0) { last[0] = 0; }
+    size_t count() { return 1; }
+    bool connected(size_t relay) { return true; }
+    bool send(size_t relay, const char *message)
+    {
+        strncpy(last, message, sizeof(last) - 1);
+        last[sizeof(last) - 1] = 0;
+        sends++;
+        return true;
+    }
+    void loop() {}
+    char last[GATEWAY_MAX_NOTE];
+    unsigned long sends;
+};
+
+class MemorySink : public TraceSink {
+public:
+    MemorySink() : used(0) {}
+    size_t write(const uint8_t *data, size_t len)
+    {
+        if (len > sizeof(buf) - used) {
+            used = 0; // the test only cares that it never allocates
+        }
+        memcpy(buf + used, data, len);
+        used += len;
+        return len;
+    }
+    uint8_t buf[16 * TRACE_MAX_RECORD];
+    size_t used;
+};
+
+static unsigned long logLines = 0;
+static void countLine(const char *line)
+{
+    logLines++;
+}
+
+// a payload of size bytes with quotes and control characters to escape
+static std::string testPayload(unsigned long i, size_t size)
+{
+    char text[48];
+    snprintf(text, sizeof(text), "\"Hello\"\tNostrLoraMesh!\n#%lu\\", i);
+    std::string payload(text);
+    while (payload.length() < size) {
+        payload += ((i + payload.length()) % 32) ? 'x' : '\x01';
+    }
+    payload.resize(size);
+    return payload;
+}
+
+// every other packet in an air frame like the new sender sends, every fourth compressed
+static std::string testFrame(unsigned long i)
+{
+    std::string payload = testPayload(i, 1 + (i * 37) % GATEWAY_MAX_FRAME);
+    if (i % 2 == 0) {
+        return payload;
+    }
+    payload.resize(payload.length() > GATEWAY_MAX_FRAME - AIRFRAME_MAX_HEADER ?
+                   GATEWAY_MAX_FRAME - AIRFRAME_MAX_HEADER : payload.length());
+    uint8_t flags = 0;
+    if (i % 4 == 3) {
+        uint8_t packed[GATEWAY_MAX_FRAME - AIRFRAME_MAX_HEADER];
+        size_t n = textCompress((const uint8_t *)payload.data(), payload.length(), packed, sizeof(packed));
+        if (n > 0) {
+            payload.assign((const char *)packed, n);
+            flags = AIRFRAME_COMPRESSED;
+        }
+    }
+    uint8_t frame[GATEWAY_MAX_FRAME];
+    size_t n = airFrameEncode(AIRFRAME_TEXT, flags, (uint32_t)(i % 3) << 20, (uint32_t)i,
+                              (const uint8_t *)payload.data(), payload.length(), frame, sizeof(frame));
+    return std::string((const char *)frame, n);
+}
+
+#define WARM_UP 8
+#define PACKETS 200
+
+MU_TEST(test_packet_path_does_not_allocate)
+{
+    HostClock clock;
+    FakeRadio radio(clock);
+    FakeUplink uplink;
+    Nip01Signer signer(nsecHex);
+    LastRelay relay;
+    MemorySink sink;
+    TraceWriter recorder(sink);
+    DuplicateFilter dedup(clock);
+    Gateway gateway(radio, uplink, clock, signer, relay);
+    gateway.setLogger(countLine);
+    gateway.setRecorder(&recorder);
+    gateway.setDuplicateFilter(&dedup);
+    gateway.begin("test", "");
+
+    for (unsigned long i = 0; i < WARM_UP + PACKETS; i++) {
+        radio.push(0, -60 - (int)(i % 40), 9.5f, testFrame(i));
+    }
+    for (int i = 0; i < WARM_UP; i++) {
+        mu_check(gateway.loop());
+    }
+
+    // the counter sees heap use at all
+    size_t allocsBefore = allocs;
+    void *volatile probe = malloc(64);
+    free(probe);
+    mu_check(allocs > allocsBefore);
+
+    allocsBefore = allocs;
+    size_t watermark = liveBytes;
+    peakBytes = liveBytes;
+    for (int i = 0; i < PACKETS; i++) {
+        gateway.loop();
+    }
+    mu_assert_int_eq(0, (int)(allocs - allocsBefore));
+    mu_assert_int_eq(0, (int)(peakBytes - watermark));
+    mu_assert_int_eq(WARM_UP + PACKETS, (int)gateway.stats().published);
+    mu_assert_int_eq(0, (int)gateway.stats().failed);
+    mu_assert_int_eq(0, (int)gateway.stats().duplicates);
+    mu_assert_int_eq(0, (int)gateway.stats().invalid);
+    mu_check(logLines > 0);
+
+    // the last note is still a valid event
+    std::string id, reason = checkEvent(relay.last, id);
+    mu_assert_string_eq("", reason.c_str());
+}
+
+MU_TEST(test_frame_fits_the_fifo)
+{
+    HostClock clock;
+    FakeRadio radio(clock);
+    FakeUplink uplink;
+    Nip01Signer signer(nsecHex);
+    LastRelay relay;
+    Gateway gateway(radio, uplink, clock, signer, relay);
+    gateway.begin("test", "");
+
+    std::string payload(GATEWAY_MAX_FRAME, '"');
+    radio.push(0, -70, 1.0f, payload + "cut");
+    mu_check(gateway.poll());
+    mu_assert_int_eq(GATEWAY_MAX_FRAME, (int)gateway.lastLength());
+    mu_assert_string_eq(payload.c_str(), gateway.lastPayload());
+    // every quote escaped still fits the note buffer
+    mu_assert_int_eq(1, (int)gateway.stats().published);
+    std::string id, reason = checkEvent(relay.last, id);
+    mu_assert_string_eq("", reason.c_str());
+}
+
+MU_TEST_SUITE(test_ingest)
+{
+    MU_RUN_TEST(test_packet_path_does_not_allocate);
+    MU_RUN_TEST(test_frame_fits_the_fifo);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_ingest);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,128 @@
+// NIP-01 serializer: escaping, the event id and the fixed size frame.
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "minunit.h"
+#include "nip01.h"
+#include "loopback_relay.h"
+#include "Hash.h"
+#include "Conversion.h"
+
+// same keys as main.cpp
+static const char *nsecHex = "bdd19cecd942ed8964c2e0ddc92d5e09838d3a09ebb230d974868be00886704b";
+static const char *npubHex = "d0bfc94bd4324f7df2a7601c4177209828047c4d3904d64009a3c67fb5d5e7ca";
+
+MU_TEST(test_escape)
+{
+    const uint8_t content[] = { 'a', '"', 'b', '\\', '\n', '\r', '\t', '\b', '\f', 0x01, 0x1f, ' ', 0xc3, 0xa9 };
+    char buf[64], id[64];
+    FrameStream out(buf, sizeof(buf));
+    FrameStream canonical(id, sizeof(id));
+    size_t n = jsonEscape(out, content, sizeof(content), &canonical);
+    mu_assert_int_eq((int)out.finish(), (int)n);
+    mu_assert_string_eq("a\\\"b\\\\\\n\\r\\t\\b\\f\\u0001\\u001f \xc3\xa9", buf);
+    // the id keeps other control bytes raw
+    mu_assert_int_eq((int)n - 10, (int)canonical.finish());
+    mu_assert_string_eq("a\\\"b\\\\\\n\\r\\t\\b\\f\x01\x1f \xc3\xa9", id);
+
+    // nothing to escape is a single write
+    FrameStream plain(buf, sizeof(buf));
+    mu_assert_int_eq(5, (int)jsonEscape(plain, (const uint8_t *)"hello", 5));
+    mu_assert_int_eq(0, (int)jsonEscape(plain, (const uint8_t *)"", 0));
+    mu_assert_int_eq(5, (int)plain.finish());
+}
+
+MU_TEST(test_frame_stream)
+{
+    char buf[8];
+    FrameStream out(buf, sizeof(buf));
+    out.printNumber(0);
+    out.print(",");
+    const uint8_t bytes[] = { 0xab, 0x01 };
+    out.printHex(bytes, sizeof(bytes));
+    mu_assert_int_eq(6, (int)out.finish());
+    mu_assert_string_eq("0,ab01", buf);
+
+    // the NUL needs a byte too
+    out.print("x");
+    mu_check(!out.overflow());
+    out.print("y");
+    mu_check(out.overflow());
+    mu_assert_int_eq(0, (int)out.finish());
+    mu_assert_string_eq("", buf);
+
+    char number[24];
+    FrameStream big(number, sizeof(number));
+    big.printNumber(4294967295UL);
+    big.finish();
+    mu_assert_string_eq("4294967295", number);
+}
+
+MU_TEST(test_note_is_a_valid_event)
+{
+    Nip01Signer signer(nsecHex);
+    mu_assert_string_eq(npubHex, signer.pubkey());
+
+    const uint8_t content[] = "Hello \"NostrLoraMesh\"!\n\x01";
+    char out[GATEWAY_MAX_FRAME * 8];
+    size_t n = signer.note(1700000000UL, content, sizeof(content) - 1, out, sizeof(out));
+    mu_check(n > 0);
+    mu_assert_int_eq((int)strlen(out), (int)n);
+    mu_check(strstr(out, "\"content\":\"Hello \\\"NostrLoraMesh\\\"!\\n\\u0001\"") != NULL);
+
+    std::string id, reason = checkEvent(out, id);
+    mu_assert_string_eq("", reason.c_str());
+
+    // the id commits to the canonical serialization, 0x01 as it is
+    std::string canonical = std::string("[0,\"") + npubHex +
+                            "\",1700000000,1,[],\"Hello \\\"NostrLoraMesh\\\"!\\n\x01\"]";
+    uint8_t hash[32];
+    sha256(canonical.c_str(), canonical.length(), hash);
+    std::string expected = toHex(hash, sizeof(hash));
+    mu_assert_string_eq(expected.c_str(), id.c_str());
+
+    // the relay parses the content, so other spellings of it keep the id
+    std::string spelled = out;
+    size_t at = spelled.find("\\n");
+    spelled.replace(at, 2, "\\u000A");
+    at = spelled.find("Hello");
+    spelled.replace(at, 1, "\\u0048");
+    reason = checkEvent(spelled.c_str(), id);
+    mu_assert_string_eq("", reason.c_str());
+    // and a frame with the id of the escaped text is refused
+    std::string escaped = std::string("[0,\"") + npubHex +
+                          "\",1700000000,1,[],\"Hello \\\"NostrLoraMesh\\\"!\\n\\u0001\"]";
+    sha256(escaped.c_str(), escaped.length(), hash);
+    std::string wrongId = toHex(hash, sizeof(hash));
+    std::string wrong = out;
+    wrong.replace(wrong.find(expected), 64, wrongId);
+    reason = checkEvent(wrong.c_str(), id);
+    mu_assert_string_eq("invalid: event id does not match", reason.c_str());
+}
+
+MU_TEST(test_note_does_not_fit)
+{
+    Nip01Signer signer(nsecHex);
+    const uint8_t content[] = "hello";
+    char out[200];
+    // fails in the content and in the fields after it
+    mu_assert_int_eq(0, (int)signer.note(1, content, 5, out, 20));
+    mu_assert_string_eq("", out);
+    mu_assert_int_eq(0, (int)signer.note(1, content, 5, out, sizeof(out)));
+    mu_assert_string_eq("", out);
+}
+
+MU_TEST_SUITE(test_nip01)
+{
+    MU_RUN_TEST(test_escape);
+    MU_RUN_TEST(test_frame_stream);
+    MU_RUN_TEST(test_note_is_a_valid_event);
+    MU_RUN_TEST(test_note_does_not_fit);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_nip01);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,439 @@
+// Outbox: ordering, rate, batching, acks, retransmits, persistence and torn blocks.
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "minunit.h"
+#include "outbox.h"
+#include "gateway.h"
+#include "fake_radio.h"
+#include "test_doubles.h"
+
+static void add(Outbox &outbox, int n, bool online)
+{
+    std::string e = event(n);
+    outbox.add(e.c_str(), e.length(), online);
+}
+
+MU_TEST(test_offline_events_wait_and_go_in_order)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays;
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(2);
+    outbox.setSendRate(1, 2);
+    mu_check(outbox.begin());
+
+    for (int i = 0; i < 5; i++) {
+        add(outbox, i, false);
+        outbox.loop(false);
+    }
+    mu_assert_int_eq(0, (int)relays.sent.size());
+    mu_assert_int_eq(5, (int)outbox.pending());
+
+    // the burst, then one per second
+    outbox.loop(true);
+    mu_assert_int_eq(2, (int)relays.sent.size());
+    clock.now += 500;
+    outbox.loop(true);
+    mu_assert_int_eq(2, (int)relays.sent.size());
+    clock.now += 500;
+    outbox.loop(true);
+    mu_assert_int_eq(3, (int)relays.sent.size());
+    clock.now += 2000;
+    outbox.loop(true);
+    mu_assert_int_eq(5, (int)relays.sent.size());
+    for (int i = 0; i < 5; i++) {
+        std::string expected = event(i);
+        mu_assert_string_eq(expected.c_str(), relays.sent[i].c_str());
+    }
+
+    // a new event queues behind the others
+    add(outbox, 5, true);
+    mu_assert_int_eq(5, (int)relays.sent.size());
+}
+
+MU_TEST(test_quorum_empties_the_log)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(2);
+    mu_check(outbox.begin());
+
+    add(outbox, 1, true);
+    add(outbox, 2, true);
+    mu_assert_int_eq(6, (int)relays.sent.size());
+    mu_assert_int_eq(2, (int)outbox.inFlight());
+    // file header and one block per event
+    mu_assert_int_eq(3, (int)store.appends);
+    outbox.onOk(ok(1, true).c_str(), 0);
+    // the same relay again and a refusal don't count
+    outbox.onOk(ok(1, true).c_str(), 0);
+    outbox.onOk(ok(1, false).c_str(), 1);
+    mu_assert_int_eq(2, (int)outbox.pending());
+    outbox.onOk(ok(1, true).c_str(), 2);
+    mu_assert_int_eq(1, (int)outbox.pending());
+    // relay not known, every OK counts
+    outbox.onOk(ok(2, true).c_str(), -1);
+    outbox.onOk(ok(2, true).c_str(), -1);
+    mu_assert_int_eq(0, (int)outbox.pending());
+    mu_assert_int_eq(0, (int)outbox.inFlight());
+    mu_assert_int_eq(2, (int)outbox.stats().delivered);
+
+    // the OKs never reach the store, the log starts over
+    outbox.loop(true);
+    mu_assert_int_eq(3, (int)store.appends);
+    mu_assert_int_eq(0, (int)store.size());
+    mu_assert_int_eq(0, (int)outbox.logSize());
+}
+
+MU_TEST(test_writes_are_batched)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(3);
+    mu_check(outbox.begin());
+
+    // an event is written before it goes out
+    for (int i = 0; i < 4; i++) {
+        add(outbox, i, true);
+        mu_assert_int_eq(2 + i, (int)store.appends);
+    }
+    // OKs wait for one block
+    for (int i = 0; i < 4; i++) {
+        outbox.onOk(ok(i, true).c_str(), 0);
+        outbox.onOk(ok(i, true).c_str(), 1);
+        clock.now += 100;
+        outbox.loop(true);
+    }
+    mu_assert_int_eq(5, (int)store.appends);
+    clock.now += OUTBOX_FLUSH_MS;
+    outbox.loop(true);
+    mu_assert_int_eq(6, (int)store.appends);
+    mu_assert_int_eq(5, (int)outbox.stats().blocks);
+    mu_assert_int_eq((int)store.size(), (int)outbox.logSize());
+}
+
+MU_TEST(test_sent_events_survive_a_power_cut)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    {
+        Outbox outbox(store, relays, clock);
+        outbox.setQuorum(2);
+        mu_check(outbox.begin());
+        add(outbox, 1, true);
+        mu_assert_int_eq(3, (int)relays.sent.size());
+        // power lost before any flush from loop()
+    }
+    relays.sent.clear();
+    relays.to.clear();
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(2);
+    mu_check(outbox.begin());
+    mu_assert_int_eq(1, (int)outbox.pending());
+    outbox.loop(true);
+    mu_assert_int_eq(3, (int)relays.sent.size());
+    std::string e = event(1);
+    mu_assert_string_eq(e.c_str(), relays.sent[0].c_str());
+}
+
+MU_TEST(test_events_survive_a_reboot)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays;
+    {
+        Outbox outbox(store, relays, clock);
+        outbox.setQuorum(1);
+        mu_check(outbox.begin());
+        for (int i = 0; i < 4; i++) {
+            add(outbox, i, true);
+        }
+        outbox.onOk(ok(0, true).c_str(), 0);
+        outbox.onOk(ok(2, true).c_str(), 0);
+        mu_check(outbox.flush());
+        // lost with the power
+        outbox.onOk(ok(3, true).c_str(), 0);
+    }
+
+    relays.sent.clear();
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(1);
+    mu_check(outbox.begin());
+    mu_assert_int_eq(2, (int)outbox.pending());
+    outbox.loop(true);
+    mu_assert_int_eq(2, (int)relays.sent.size());
+    std::string first = event(1), second = event(3);
+    mu_assert_string_eq(first.c_str(), relays.sent[0].c_str());
+    mu_assert_string_eq(second.c_str(), relays.sent[1].c_str());
+
+    // acks for the replays keep using the same numbers
+    outbox.onOk(ok(3, true).c_str(), 0);
+    mu_check(outbox.flush());
+    Outbox again(store, relays, clock);
+    again.setQuorum(1);
+    mu_check(again.begin());
+    mu_assert_int_eq(1, (int)again.pending());
+}
+
+MU_TEST(test_logged_acks_are_not_resent)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    {
+        Outbox outbox(store, relays, clock);
+        outbox.setQuorum(2);
+        mu_check(outbox.begin());
+        add(outbox, 5, true);
+        outbox.onOk(ok(5, true).c_str(), 1);
+        mu_check(outbox.flush());
+    }
+    relays.sent.clear();
+    relays.to.clear();
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(2);
+    mu_check(outbox.begin());
+    outbox.loop(true);
+    mu_assert_int_eq(2, (int)relays.sent.size());
+    mu_assert_int_eq(0, (int)relays.to[0]);
+    mu_assert_int_eq(2, (int)relays.to[1]);
+    outbox.onOk(ok(5, true).c_str(), 0);
+    mu_assert_int_eq(0, (int)outbox.pending());
+}
+
+MU_TEST(test_torn_block_is_skipped)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays;
+    {
+        Outbox outbox(store, relays, clock);
+        mu_check(outbox.begin());
+        add(outbox, 1, false);
+        mu_check(outbox.flush());
+        add(outbox, 2, false);
+        mu_check(outbox.flush());
+    }
+    // power lost in the middle of the second block
+    store.data.resize(store.data.size() - 20);
+    {
+        Outbox outbox(store, relays, clock);
+        mu_check(outbox.begin());
+        mu_assert_int_eq(1, (int)outbox.stats().skipped);
+        mu_assert_int_eq(1, (int)outbox.pending());
+        add(outbox, 3, false);
+        mu_check(outbox.flush());
+    }
+    Outbox outbox(store, relays, clock);
+    mu_check(outbox.begin());
+    mu_assert_int_eq(1, (int)outbox.stats().skipped);
+    mu_assert_int_eq(2, (int)outbox.pending());
+    outbox.loop(true);
+    mu_assert_int_eq(2, (int)relays.sent.size());
+    std::string first = event(1), second = event(3);
+    mu_assert_string_eq(first.c_str(), relays.sent[0].c_str());
+    mu_assert_string_eq(second.c_str(), relays.sent[1].c_str());
+
+    // not an outbox at all
+    MemoryStore other;
+    const uint8_t junk[] = "LTRC\x01\0\0\0";
+    other.append(junk, 8);
+    Outbox wrong(other, relays, clock);
+    mu_check(!wrong.begin());
+}
+
+MU_TEST(test_retransmit_only_to_silent_relays)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(3);
+    outbox.setSendRate(100, 10);
+    mu_check(outbox.begin());
+
+    add(outbox, 7, true);
+    mu_assert_int_eq(3, (int)relays.sent.size());
+    outbox.onOk(ok(7, true).c_str(), 0);
+    outbox.onOk(ok(7, false).c_str(), 1);
+    clock.now += ACK_DEADLINE_MS - 1;
+    outbox.loop(true);
+    mu_assert_int_eq(3, (int)relays.sent.size());
+
+    // relay 0 has it, 1 refused and 2 said nothing
+    clock.now += 1;
+    outbox.loop(true);
+    mu_assert_int_eq(5, (int)relays.sent.size());
+    mu_assert_int_eq(1, (int)relays.to[3]);
+    mu_assert_int_eq(2, (int)relays.to[4]);
+    mu_assert_int_eq(2, (int)outbox.stats().retransmitted);
+
+    // a relay that is down waits for its connection
+    outbox.onOk(ok(7, true).c_str(), 1);
+    relays.up[2] = false;
+    clock.now += ACK_DEADLINE_MS;
+    outbox.loop(true);
+    mu_assert_int_eq(5, (int)relays.sent.size());
+    relays.up[2] = true;
+    outbox.loop(true);
+    mu_assert_int_eq(6, (int)relays.sent.size());
+    mu_assert_int_eq(2, (int)relays.to[5]);
+
+    outbox.onOk(ok(7, true).c_str(), 2);
+    mu_assert_int_eq(1, (int)outbox.stats().delivered);
+    clock.now += ACK_DEADLINE_MS;
+    outbox.loop(true);
+    mu_assert_int_eq(6, (int)relays.sent.size());
+    mu_assert_int_eq(6, (int)outbox.stats().sent);
+}
+
+MU_TEST(test_quorum_stops_the_slow_relay)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(2);
+    mu_check(outbox.begin());
+
+    add(outbox, 3, true);
+    outbox.onOk(ok(3, true).c_str(), 2);
+    outbox.onOk(ok(3, true).c_str(), 0);
+    mu_assert_int_eq(0, (int)outbox.pending());
+    // relay 1 never answers and doesn't get it again
+    for (int i = 0; i < 3; i++) {
+        clock.now += ACK_DEADLINE_MS;
+        outbox.loop(true);
+    }
+    mu_assert_int_eq(3, (int)relays.sent.size());
+    // late answers for an event that left the table
+    outbox.onOk(ok(3, true).c_str(), 1);
+    mu_assert_int_eq(1, (int)outbox.stats().delivered);
+}
+
+MU_TEST(test_retry_then_give_up)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays;
+    Outbox outbox(store, relays, clock);
+    outbox.setSendRate(100, 10);
+    mu_check(outbox.begin());
+
+    add(outbox, 7, true);
+    mu_assert_int_eq(1, (int)relays.sent.size());
+    outbox.loop(true);
+    mu_assert_int_eq(1, (int)relays.sent.size());
+    for (int i = 1; i < ACK_MAX_TRIES; i++) {
+        clock.now += ACK_DEADLINE_MS;
+        outbox.loop(true);
+    }
+    mu_assert_int_eq(ACK_MAX_TRIES, (int)relays.sent.size());
+    mu_assert_int_eq(ACK_MAX_TRIES - 1, (int)outbox.stats().retransmitted);
+    clock.now += ACK_DEADLINE_MS;
+    outbox.loop(true);
+    mu_assert_int_eq(ACK_MAX_TRIES, (int)relays.sent.size());
+    mu_assert_int_eq(1, (int)outbox.stats().abandoned);
+    mu_assert_int_eq(0, (int)outbox.pending());
+    mu_assert_int_eq(0, (int)outbox.inFlight());
+}
+
+MU_TEST(test_full_log_drops_new_events)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays;
+    Outbox outbox(store, relays, clock);
+    mu_check(outbox.begin());
+    for (int i = 0; i < OUTBOX_MAX_EVENTS; i++) {
+        add(outbox, i, false);
+    }
+    std::string e = event(1);
+    mu_check(!outbox.add(e.c_str(), e.length(), false));
+    mu_check(!outbox.add("no id", 5, false));
+    mu_assert_int_eq(1, (int)outbox.stats().dropped);
+    mu_assert_int_eq(OUTBOX_MAX_EVENTS, (int)outbox.pending());
+    mu_check(outbox.flush());
+
+    Outbox reread(store, relays, clock);
+    mu_check(reread.begin());
+    mu_assert_int_eq(OUTBOX_MAX_EVENTS, (int)reread.pending());
+}
+
+// hands out event(0), event(1), ... as signed notes
+class EventSigner : public NoteSigner {
+public:
+    EventSigner() : notes(0) {}
+    size_t note(unsigned long createdAt, const uint8_t *content, size_t len, char *out, size_t size)
+    {
+        std::string e = event(notes++);
+        snprintf(out, size, "%s", e.c_str());
+        return e.length();
+    }
+    int notes;
+};
+
+MU_TEST(test_gateway_counts_dropped_notes)
+{
+    HostClock hostClock;
+    FakeRadio radio(hostClock);
+    FakeUplink uplink;
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays;
+    EventSigner signer;
+    Outbox outbox(store, relays, clock);
+    mu_check(outbox.begin());
+    Gateway gateway(radio, uplink, clock, signer, relays);
+    gateway.setOutbox(&outbox);
+    for (int i = 0; i < OUTBOX_MAX_EVENTS; i++) {
+        add(outbox, 100 + i, false);
+    }
+    signer.notes = 1;
+
+    // offline with a full log the note goes nowhere
+    radio.push(0, -70, 5.0f, "one");
+    mu_check(gateway.poll());
+    mu_assert_int_eq(0, (int)gateway.stats().published);
+    mu_assert_int_eq(1, (int)gateway.stats().dropped);
+    mu_assert_int_eq(0, (int)relays.sent.size());
+
+    // online it goes straight to the relays
+    uplink.up = true;
+    radio.push(0, -70, 5.0f, "two");
+    mu_check(gateway.poll());
+    mu_assert_int_eq(1, (int)gateway.stats().published);
+    mu_assert_int_eq(1, (int)gateway.stats().dropped);
+    mu_assert_int_eq(1, (int)relays.sent.size());
+}
+
+MU_TEST_SUITE(test_outbox)
+{
+    MU_RUN_TEST(test_offline_events_wait_and_go_in_order);
+    MU_RUN_TEST(test_quorum_empties_the_log);
+    MU_RUN_TEST(test_writes_are_batched);
+    MU_RUN_TEST(test_sent_events_survive_a_power_cut);
+    MU_RUN_TEST(test_events_survive_a_reboot);
+    MU_RUN_TEST(test_logged_acks_are_not_resent);
+    MU_RUN_TEST(test_torn_block_is_skipped);
+    MU_RUN_TEST(test_retransmit_only_to_silent_relays);
+    MU_RUN_TEST(test_quorum_stops_the_slow_relay);
+    MU_RUN_TEST(test_retry_then_give_up);
+    MU_RUN_TEST(test_full_log_drops_new_events);
+    MU_RUN_TEST(test_gateway_counts_dropped_notes);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_outbox);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
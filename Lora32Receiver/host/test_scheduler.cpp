@@ -0,0 +1,271 @@
+// RelayScheduler: ranking, p99, quorum-first sends, hedges, probes and the health file.
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "minunit.h"
+#include "scheduler.h"
+#include "test_doubles.h"
+
+static const char *const names[] = { "relay.damus.io", "nostr.mom", "relay.nostr.bg" };
+
+// latencies of a few answers per relay
+static void train(RelayScheduler &scheduler, const unsigned long *ms, size_t n, int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+        for (size_t r = 0; r < n; r++) {
+            scheduler.sent(r);
+            scheduler.acked(r, ms[r]);
+        }
+    }
+}
+
+MU_TEST(test_rank_by_latency_errors_and_backlog)
+{
+    ManualClock clock;
+    SentRelays relays(3);
+    RelayScheduler scheduler(relays, clock);
+    scheduler.begin(NULL);
+    const unsigned long ms[] = { 300, 40, 120 };
+    train(scheduler, ms, 3, 20);
+
+    uint8_t order[ACK_MAX_RELAYS];
+    mu_assert_int_eq(3, (int)scheduler.rank(order));
+    mu_assert_int_eq(1, order[0]);
+    mu_assert_int_eq(2, order[1]);
+    mu_assert_int_eq(0, order[2]);
+    mu_assert_int_eq(0, scheduler.backlog(1));
+
+    // unanswered sends pile up on the fast one
+    for (int i = 0; i < 3; i++) {
+        scheduler.sent(1);
+    }
+    scheduler.rank(order);
+    mu_assert_int_eq(2, order[0]);
+    for (int i = 0; i < 3; i++) {
+        scheduler.dropped(1);
+    }
+    // refusals make a relay slow too
+    for (int i = 0; i < 20; i++) {
+        scheduler.sent(1);
+        scheduler.failed(1);
+    }
+    scheduler.rank(order);
+    mu_assert_int_eq(2, order[0]);
+    mu_check(scheduler.health(1).errors > 0.5f);
+
+    relays.up[2] = false;
+    mu_assert_int_eq(2, (int)scheduler.rank(order));
+    mu_check(order[0] != 2 && order[1] != 2);
+}
+
+MU_TEST(test_p99_and_hedge_time)
+{
+    ManualClock clock;
+    SentRelays relays(1);
+    RelayScheduler scheduler(relays, clock);
+    scheduler.begin(NULL);
+    mu_assert_int_eq(0, (int)scheduler.p99(0));
+    mu_assert_int_eq(3 * SCHED_DEFAULT_MS, (int)scheduler.hedgeAfter(0));
+
+    const unsigned long fast = 50, slow = 2000;
+    train(scheduler, &fast, 1, 200);
+    unsigned long p = scheduler.p99(0);
+    mu_check(p > 50 && p <= 64);
+    train(scheduler, &slow, 1, 4);
+    p = scheduler.p99(0);
+    mu_check(p > 2000 && p <= 2048);
+    mu_assert_int_eq((int)(p + p / 2), (int)scheduler.hedgeAfter(0));
+    mu_check(scheduler.health(0).latency > 50 && scheduler.health(0).latency < 2000);
+
+    // old samples fade, the histogram stays bounded
+    train(scheduler, &fast, 1, 2000);
+    p = scheduler.p99(0);
+    mu_check(p <= 64);
+    mu_assert_int_eq(SCHED_HEDGE_MIN_MS, (int)scheduler.hedgeAfter(0));
+}
+
+MU_TEST(test_quorum_first_then_hedge)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    RelayScheduler scheduler(relays, clock);
+    scheduler.begin(NULL);
+    const unsigned long ms[] = { 300, 40, 120 };
+    train(scheduler, ms, 3, 20);
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(2);
+    outbox.setSendRate(100, 10);
+    outbox.setScheduler(&scheduler);
+    mu_check(outbox.begin());
+
+    std::string e = event(1);
+    outbox.add(e.c_str(), e.length(), true);
+    mu_assert_int_eq(2, (int)relays.to.size());
+    mu_assert_int_eq(1, (int)relays.to[0]);
+    mu_assert_int_eq(2, (int)relays.to[1]);
+    outbox.onOk(ok(1, true).c_str(), 1);
+
+    // relay 2 is late, the slow one makes the quorum instead
+    clock.now += scheduler.hedgeAfter(2) - 1;
+    outbox.loop(true);
+    mu_assert_int_eq(2, (int)relays.to.size());
+    clock.now += 1;
+    outbox.loop(true);
+    mu_assert_int_eq(3, (int)relays.to.size());
+    mu_assert_int_eq(0, (int)relays.to[2]);
+    outbox.onOk(ok(1, true).c_str(), 0);
+    mu_assert_int_eq(0, (int)outbox.pending());
+    mu_assert_int_eq(0, (int)scheduler.backlog(2));
+
+    // a refusal hands the event on at once
+    e = event(2);
+    outbox.add(e.c_str(), e.length(), true);
+    mu_assert_int_eq(5, (int)relays.to.size());
+    size_t refused = relays.to[3];
+    size_t other = relays.to[4];
+    outbox.onOk(ok(2, false).c_str(), (int)refused);
+    outbox.loop(true);
+    mu_assert_int_eq(6, (int)relays.to.size());
+    mu_check(relays.to[5] != refused && relays.to[5] != other);
+    mu_assert_int_eq(1, (int)outbox.stats().delivered);
+}
+
+static unsigned long histogramSamples(const RelayHealth &h)
+{
+    unsigned long n = 0;
+    for (size_t b = 0; b < SCHED_BUCKETS; b++) {
+        n += h.histogram[b];
+    }
+    return n;
+}
+
+MU_TEST(test_late_send_is_sampled_once)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(1);
+    RelayScheduler scheduler(relays, clock);
+    scheduler.begin(NULL);
+    const unsigned long fast = 100;
+    train(scheduler, &fast, 1, 10);
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(1);
+    outbox.setScheduler(&scheduler);
+    mu_check(outbox.begin());
+
+    // the hedge deadline gives a sample, the OK that comes after doesn't
+    std::string e = event(1);
+    outbox.add(e.c_str(), e.length(), true);
+    clock.now += scheduler.hedgeAfter(0);
+    outbox.loop(true);
+    mu_assert_int_eq(11, (int)histogramSamples(scheduler.health(0)));
+    float latency = scheduler.health(0).latency;
+    clock.now += 5000;
+    outbox.onOk(ok(1, true).c_str(), 0);
+    mu_assert_int_eq(11, (int)histogramSamples(scheduler.health(0)));
+    mu_check(scheduler.health(0).latency == latency);
+    mu_assert_int_eq(11, (int)scheduler.health(0).acked);
+    mu_assert_int_eq(0, (int)scheduler.backlog(0));
+
+    // an OK in time is a sample of its own
+    e = event(2);
+    outbox.add(e.c_str(), e.length(), true);
+    clock.now += 100;
+    outbox.onOk(ok(2, true).c_str(), 0);
+    mu_assert_int_eq(12, (int)histogramSamples(scheduler.health(0)));
+}
+
+MU_TEST(test_stale_relay_is_probed)
+{
+    ManualClock clock;
+    MemoryStore store;
+    SentRelays relays(3);
+    RelayScheduler scheduler(relays, clock);
+    scheduler.begin(NULL);
+    const unsigned long ms[] = { 300, 40, 120 };
+    train(scheduler, ms, 3, 20);
+    Outbox outbox(store, relays, clock);
+    outbox.setQuorum(1);
+    outbox.setSendRate(100, 10);
+    outbox.setScheduler(&scheduler);
+    mu_check(outbox.begin());
+
+    clock.now += SCHED_PROBE_MS;
+    const unsigned long fast = 40;
+    scheduler.sent(1);
+    scheduler.acked(1, fast);
+    std::string e = event(3);
+    outbox.add(e.c_str(), e.length(), true);
+    // the best one and the two nobody heard from in a while
+    mu_assert_int_eq(3, (int)relays.to.size());
+    mu_assert_int_eq(3, (int)(relays.to[0] + relays.to[1] + relays.to[2]));
+
+    // they were asked, the next event goes to one relay
+    e = event(4);
+    outbox.add(e.c_str(), e.length(), true);
+    mu_assert_int_eq(4, (int)relays.to.size());
+}
+
+MU_TEST(test_health_survives_a_reboot)
+{
+    ManualClock clock;
+    MemoryStore file;
+    SentRelays relays(3);
+    {
+        RelayScheduler scheduler(relays, clock);
+        scheduler.setNames(names, 3);
+        mu_check(!scheduler.begin(&file));
+        const unsigned long ms[] = { 300, 40, 120 };
+        train(scheduler, ms, 3, 20);
+        // connection came back after 800 ms
+        relays.up[0] = false;
+        scheduler.loop();
+        clock.now += 800;
+        relays.up[0] = true;
+        scheduler.loop();
+        mu_check(scheduler.health(0).connectMs > 799);
+        clock.now += SCHED_SAVE_MS;
+        scheduler.loop();
+        mu_check(file.size() > 0);
+    }
+
+    // same relays in another order
+    const char *const reordered[] = { "relay.nostr.bg", "relay.damus.io", "nostr.mom" };
+    RelayScheduler scheduler(relays, clock);
+    scheduler.setNames(reordered, 3);
+    mu_check(scheduler.begin(&file));
+    mu_assert_int_eq(300, (int)(scheduler.health(1).latency + 0.5f));
+    mu_assert_int_eq(40, (int)(scheduler.health(2).latency + 0.5f));
+    mu_assert_int_eq(20, (int)scheduler.health(0).acked);
+    mu_check(scheduler.p99(2) > 0);
+    uint8_t order[ACK_MAX_RELAYS];
+    scheduler.rank(order);
+    mu_assert_int_eq(2, order[0]);
+    mu_assert_int_eq(0, order[1]);
+
+    // a flipped bit and the file is ignored
+    file.data[20] ^= 1;
+    RelayScheduler fresh(relays, clock);
+    fresh.setNames(names, 3);
+    mu_check(!fresh.begin(&file));
+    mu_assert_int_eq(0, (int)fresh.health(0).acked);
+}
+
+MU_TEST_SUITE(test_scheduler)
+{
+    MU_RUN_TEST(test_rank_by_latency_errors_and_backlog);
+    MU_RUN_TEST(test_p99_and_hedge_time);
+    MU_RUN_TEST(test_quorum_first_then_hedge);
+    MU_RUN_TEST(test_late_send_is_sampled_once);
+    MU_RUN_TEST(test_stale_relay_is_probed);
+    MU_RUN_TEST(test_health_survives_a_reboot);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_scheduler);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
@@ -0,0 +1,120 @@
+// Text compression: round trips, the dictionary, bounds and malformed input.
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "minunit.h"
+#include "textcodec.h"
+
+static std::string pack(const std::string &text, size_t size = 255)
+{
+    uint8_t out[512];
+    size_t n = textCompress((const uint8_t *)text.data(), text.length(), out, size);
+    return std::string((const char *)out, n);
+}
+
+// "" if it doesn't unpack
+static std::string unpack(const std::string &data, size_t size = 255)
+{
+    uint8_t out[512];
+    size_t n = textDecompress((const uint8_t *)data.data(), data.length(), out, size);
+    return std::string((const char *)out, n);
+}
+
+static const char *const notes[] = {
+    "Hello NostrLoraMesh! This is message number 5",
+    "GM nostr!",
+    "Temperature 22.1 C, humidity 55%, pressure 1011 hPa",
+    "nostr:npub1sg6plzptd64u62a878hep2kev88swjh3tw00gjsfl8f237lmu63q0uf63m",
+    "¿Alguien recibe este mensaje? 🤙⚡ Saludos desde la montaña",
+    "\"quotes\", \\backslashes\\, tabs\tand\nnewlines",
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+    "x",
+};
+
+MU_TEST(test_round_trip)
+{
+    for (size_t i = 0; i < sizeof(notes) / sizeof(notes[0]); i++) {
+        std::string packed = pack(notes[i]);
+        mu_check(packed.length() > 0);
+        std::string text = unpack(packed);
+        mu_assert_string_eq(notes[i], text.c_str());
+    }
+    // the old sender hello is mostly dictionary
+    std::string hello = notes[0];
+    mu_check(pack(hello).length() < hello.length() / 2);
+
+    // every byte value, runs of high bytes longer than one token
+    std::string all;
+    for (int b = 0; b < 256; b++) {
+        all += (char)b;
+    }
+    // the 128 high bytes take two run tokens, more than a frame
+    std::string packed = pack(all, 512);
+    mu_check(packed.length() > 255 && packed.length() <= 128 + 2 + 128);
+    mu_check(unpack(packed, 512) == all);
+    std::string high(200, '\xE2');
+    mu_check(unpack(pack(high)) == high);
+}
+
+MU_TEST(test_other_dictionaries)
+{
+    const std::string text = "relay relay relay, the same relay again";
+    const uint8_t dict[] = "the same relay";
+    uint8_t packed[255], out[255];
+    size_t n = textCompress((const uint8_t *)text.data(), text.length(), packed, sizeof(packed), dict, sizeof(dict) - 1);
+    mu_check(n > 0 && n < text.length());
+    mu_assert_int_eq((int)text.length(), (int)textDecompress(packed, n, out, sizeof(out), dict, sizeof(dict) - 1));
+    mu_check(memcmp(out, text.data(), text.length()) == 0);
+    // no dictionary: repeats within the text still match
+    n = textCompress((const uint8_t *)text.data(), text.length(), packed, sizeof(packed), NULL, 0);
+    mu_check(n > 0 && n < text.length());
+    mu_assert_int_eq((int)text.length(), (int)textDecompress(packed, n, out, sizeof(out), NULL, 0));
+    mu_check(memcmp(out, text.data(), text.length()) == 0);
+
+    size_t len;
+    mu_check(textDictionary(len) != NULL);
+    mu_check(len > 0 && len <= TEXT_MAX_DICTIONARY);
+}
+
+MU_TEST(test_bounds)
+{
+    std::string text = "Hello NostrLoraMesh! This is message number 5";
+    std::string packed = pack(text);
+    // too small for the packed text, or for the unpacked one
+    mu_assert_int_eq(0, (int)pack(text, packed.length() - 1).length());
+    mu_assert_int_eq((int)packed.length(), (int)pack(text, packed.length()).length());
+    mu_assert_int_eq(0, (int)unpack(packed, text.length() - 1).length());
+    mu_check(unpack(packed, text.length()) == text);
+}
+
+MU_TEST(test_malformed)
+{
+    // a match token cut after its first byte
+    mu_assert_int_eq(0, (int)unpack("ab\x80").length());
+    // a run announced longer than the data
+    mu_assert_int_eq(0, (int)unpack("\xC3\xA1").length());
+    // a match farther back than the dictionary and the text
+    std::string far = std::string("ab") + "\x83\xFF";
+    mu_assert_int_eq(0, (int)unpack(far).length());
+    // one back from the start is the last dictionary byte
+    size_t len;
+    const uint8_t *dict = textDictionary(len);
+    std::string near("\x80\x00", 2);
+    mu_assert_int_eq(3, (int)unpack(near).length());
+    mu_check(unpack(near)[0] == (char)dict[len - 1]);
+}
+
+MU_TEST_SUITE(test_textcodec)
+{
+    MU_RUN_TEST(test_round_trip);
+    MU_RUN_TEST(test_other_dictionaries);
+    MU_RUN_TEST(test_bounds);
+    MU_RUN_TEST(test_malformed);
+}
+
+int main(int argc, char *argv[])
+{
+    MU_RUN_SUITE(test_textcodec);
+    MU_REPORT();
+    return MU_EXIT_CODE;
+}
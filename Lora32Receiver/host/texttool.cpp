@@ -0,0 +1,253 @@
+// Dictionary and benchmark of the air frame text compression (src/textcodec.h).
+//
+//   texttool train <corpus>   prints src/textdict.h made from every other line
+//   texttool bench <corpus>   ratio, time on air, speed and memory on the corpus
+//
+// A corpus has one note per line. The benchmark keeps the lines the
+// dictionary was not made from apart, those show what new notes get.
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "airframe.h"
+#include "textcodec.h"
+
+static int usage()
+{
+    fprintf(stderr, "usage: texttool train <corpus>\n"
+                    "       texttool bench <corpus>\n");
+    return 1;
+}
+
+static bool readCorpus(const char *path, std::vector<std::string> &lines)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "can't read %s\n", path);
+        return false;
+    }
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+        std::string line(buf);
+        while (!line.empty() && (line[line.length() - 1] == '\n' || line[line.length() - 1] == '\r')) {
+            line.erase(line.length() - 1);
+        }
+        // one frame of text each
+        if (!line.empty() && line.length() <= 255) {
+            lines.push_back(line);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+typedef struct {
+    std::string text;
+    long score;
+} Candidate;
+
+static bool better(const Candidate &a, const Candidate &b)
+{
+    return a.score != b.score ? a.score > b.score : a.text < b.text;
+}
+
+// strings seen at least twice, by bytes they would save, while they fit
+static int train(const char *path)
+{
+    std::vector<std::string> lines;
+    if (!readCorpus(path, lines)) {
+        return 1;
+    }
+    std::map<std::string, long> counts;
+    size_t trained = 0;
+    for (size_t i = 0; i < lines.size(); i += 2) {
+        const std::string &l = lines[i];
+        for (size_t start = 0; start < l.length(); start++) {
+            for (size_t n = TEXT_MIN_MATCH; n <= TEXT_MAX_MATCH && start + n <= l.length(); n++) {
+                counts[l.substr(start, n)]++;
+            }
+        }
+        trained++;
+    }
+    std::vector<Candidate> candidates;
+    for (std::map<std::string, long>::iterator it = counts.begin(); it != counts.end(); ++it) {
+        if (it->second >= 2) {
+            // a match costs 2 bytes
+            Candidate c = { it->first, it->second * (long)(it->first.length() - 2) };
+            candidates.push_back(c);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), better);
+
+    std::vector<std::string> chosen;
+    size_t used = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const std::string &s = candidates[i].text;
+        bool covered = false;
+        for (size_t k = 0; k < chosen.size() && !covered; k++) {
+            covered = chosen[k].find(s) != std::string::npos;
+        }
+        if (covered) {
+            continue;
+        }
+        // a longer string takes the place of the ones inside it
+        size_t freed = 0;
+        for (size_t k = 0; k < chosen.size(); k++) {
+            if (s.find(chosen[k]) != std::string::npos) {
+                freed += chosen[k].length();
+            }
+        }
+        if (used - freed + s.length() > TEXT_MAX_DICTIONARY) {
+            continue;
+        }
+        for (size_t k = chosen.size(); k-- > 0;) {
+            if (s.find(chosen[k]) != std::string::npos) {
+                chosen.erase(chosen.begin() + k);
+            }
+        }
+        chosen.push_back(s);
+        used = used - freed + s.length();
+    }
+
+    printf("#ifndef GATEWAY_TEXTDICT_H\n#define GATEWAY_TEXTDICT_H\n\n");
+    printf("// Preset dictionary of textcodec.cpp, made from every other line of\n"
+           "// host/corpus/notes.txt (%u notes) with\n"
+           "//   host/build/texttool train host/corpus/notes.txt > src/textdict.h\n"
+           "// Senders and receivers need the same one, a new dictionary needs a\n"
+           "// new air frame version.\n\n", (unsigned)trained);
+    printf("#define TEXT_DICTIONARY_SIZE %u\n\n", (unsigned)used);
+    printf("static const uint8_t textDict[TEXT_DICTIONARY_SIZE] = {\n");
+    // least useful first, the nearest offsets go to the best strings
+    for (size_t k = chosen.size(); k-- > 0;) {
+        const std::string &s = chosen[k];
+        printf("    // \"");
+        for (size_t j = 0; j < s.length(); j++) {
+            printf(s[j] == '"' || s[j] == '\\' ? "\\%c" : "%c", s[j]);
+        }
+        printf("\"\n   ");
+        for (size_t j = 0; j < s.length(); j++) {
+            printf(" 0x%02x,", (uint8_t)s[j]);
+        }
+        printf("\n");
+    }
+    printf("};\n\n#endif\n");
+    return 0;
+}
+
+typedef struct {
+    unsigned long notes, raw, packed, smaller, failed;
+    unsigned long long airRaw[2], airPacked[2];
+} Totals;
+
+// the sizes on air of each line with and without compression
+static void measure(const std::vector<std::string> &lines, size_t first, size_t step,
+                    const uint8_t *dict, size_t dictLen, Totals &t)
+{
+    memset(&t, 0, sizeof(t));
+    for (size_t i = first; i < lines.size(); i += step) {
+        const std::string &l = lines[i];
+        uint8_t packed[255], text[255], frame[255 + AIRFRAME_MAX_HEADER];
+        size_t n = textCompress((const uint8_t *)l.data(), l.length(), packed, sizeof(packed), dict, dictLen);
+        if (n == 0 || textDecompress(packed, n, text, sizeof(text), dict, dictLen) != l.length() ||
+            memcmp(text, l.data(), l.length()) != 0) {
+            fprintf(stderr, "round trip failed: %s\n", l.c_str());
+            t.failed++;
+            n = l.length();
+        }
+        size_t plain = airFrameEncode(AIRFRAME_TEXT, 0, 0x1234, (uint32_t)i, (const uint8_t *)l.data(),
+                                      l.length(), frame, sizeof(frame));
+        size_t air = plain;
+        if (n < l.length()) {
+            air = airFrameEncode(AIRFRAME_TEXT, AIRFRAME_COMPRESSED, 0x1234, (uint32_t)i, packed, n, frame,
+                                 sizeof(frame));
+            t.smaller++;
+        } else {
+            n = l.length();
+        }
+        t.notes++;
+        t.raw += l.length();
+        t.packed += n;
+        t.airRaw[0] += loraAirtimeMicros(plain, 7);
+        t.airRaw[1] += loraAirtimeMicros(plain, 12);
+        t.airPacked[0] += loraAirtimeMicros(air, 7);
+        t.airPacked[1] += loraAirtimeMicros(air, 12);
+    }
+}
+
+static void printTotals(const char *name, const Totals &t)
+{
+    printf("%-28s %3lu notes, %5lu -> %5lu bytes (%.1f%%), %lu smaller, on air SF7 %.2f -> %.2f s, "
+           "SF12 %.1f -> %.1f s\n", name, t.notes, t.raw, t.packed, t.raw ? 100.0 * t.packed / t.raw : 0,
+           t.smaller, t.airRaw[0] / 1e6, t.airPacked[0] / 1e6, t.airRaw[1] / 1e6, t.airPacked[1] / 1e6);
+}
+
+static double seconds(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+static int bench(const char *path)
+{
+    std::vector<std::string> lines;
+    if (!readCorpus(path, lines)) {
+        return 1;
+    }
+    size_t dictLen;
+    const uint8_t *dict = textDictionary(dictLen);
+    Totals t;
+    unsigned long failed = 0;
+    measure(lines, 1, 2, dict, dictLen, t);
+    printTotals("not in the dictionary", t);
+    failed += t.failed;
+    measure(lines, 0, 2, dict, dictLen, t);
+    printTotals("dictionary lines", t);
+    failed += t.failed;
+    measure(lines, 1, 2, NULL, 0, t);
+    printTotals("not in it, no dictionary", t);
+    failed += t.failed;
+
+    // whole corpus over and over for a while
+    std::vector<std::vector<uint8_t> > packed(lines.size());
+    unsigned long rounds = 0, bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double took;
+    do {
+        for (size_t i = 0; i < lines.size(); i++) {
+            uint8_t out[255];
+            size_t n = textCompress((const uint8_t *)lines[i].data(), lines[i].length(), out, sizeof(out));
+            packed[i].assign(out, out + n);
+            bytes += lines[i].length();
+        }
+        rounds++;
+    } while ((took = seconds(start)) < 0.5);
+    double notes = (double)rounds * lines.size();
+    printf("compress   %7.2f us per note, %6.2f MB/s\n", took * 1e6 / notes, bytes / took / 1e6);
+    rounds = bytes = 0;
+    start = std::chrono::steady_clock::now();
+    do {
+        for (size_t i = 0; i < lines.size(); i++) {
+            uint8_t out[255];
+            bytes += textDecompress(packed[i].data(), packed[i].size(), out, sizeof(out));
+        }
+        rounds++;
+    } while ((took = seconds(start)) < 0.5);
+    notes = (double)rounds * lines.size();
+    printf("decompress %7.2f us per note, %6.2f MB/s\n", took * 1e6 / notes, bytes / took / 1e6);
+    printf("memory: %u byte dictionary in flash, no heap and no tables, the output buffer "
+           "(up to 255 bytes) and a few locals on the stack\n", (unsigned)dictLen);
+    return failed ? 2 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && strcmp(argv[1], "train") == 0) {
+        return train(argv[2]);
+    }
+    if (argc == 3 && strcmp(argv[1], "bench") == 0) {
+        return bench(argv[2]);
+    }
+    return usage();
+}
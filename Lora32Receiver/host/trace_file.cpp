@@ -0,0 +1,16 @@
+#include "trace_file.h"
+
+bool FileTrace::open(const char *path, const char *mode)
+{
+    close();
+    f = fopen(path, mode);
+    return f != NULL;
+}
+
+void FileTrace::close()
+{
+    if (f != NULL) {
+        fclose(f);
+        f = NULL;
+    }
+}
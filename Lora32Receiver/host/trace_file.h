@@ -0,0 +1,22 @@
+#ifndef HOST_TRACE_FILE_H
+#define HOST_TRACE_FILE_H
+
+#include <stdio.h>
+#include "trace.h"
+
+// trace file on the host, same format as the SD card
+class FileTrace : public TraceSink, public TraceSource {
+public:
+    FileTrace() : f(NULL) {}
+    ~FileTrace() { close(); }
+    // fopen modes, "rb" or "wb"
+    bool open(const char *path, const char *mode);
+    void close();
+    size_t write(const uint8_t *data, size_t len) { return fwrite(data, 1, len, f); }
+    size_t read(uint8_t *data, size_t len) { return fread(data, 1, len, f); }
+
+private:
+    FILE *f;
+};
+
+#endif
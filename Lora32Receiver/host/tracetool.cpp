@@ -0,0 +1,175 @@
+// Converts packet traces (src/trace.h) to and from simulator scripts.
+//
+//   tracetool dump <trace>              prints the trace as script packet lines
+//   tracetool make <script> <trace>     packet lines of a script to a trace
+//   tracetool log <serial log> <trace>  collects TRACE: lines of a serial log
+//   tracetool stats <trace>             packets, duration, sizes and peak rate
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "trace.h"
+#include "trace_file.h"
+#include "script.h"
+
+static int usage()
+{
+    fprintf(stderr, "usage: tracetool dump <trace>\n"
+                    "       tracetool make <script> <trace>\n"
+                    "       tracetool log <serial log> <trace>\n"
+                    "       tracetool stats <trace>\n");
+    return 1;
+}
+
+static bool openTrace(FileTrace &file, TraceReader &reader, const char *path)
+{
+    if (!file.open(path, "rb") || !reader.begin()) {
+        fprintf(stderr, "%s is not a packet trace\n", path);
+        return false;
+    }
+    return true;
+}
+
+static bool createTrace(FileTrace &file, TraceWriter &writer, const char *path)
+{
+    if (!file.open(path, "wb") || !writer.begin()) {
+        fprintf(stderr, "can't write %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+static int dump(const char *path)
+{
+    FileTrace file;
+    TraceReader reader(file);
+    if (!openTrace(file, reader, path)) {
+        return 1;
+    }
+    TraceRecord r;
+    printf("# %s\n", path);
+    while (reader.next(r)) {
+        printf("%lu packet %d %.2f %s\n", (unsigned long)r.time, r.rssi, r.snr,
+               scriptEscape(r.payload, r.length).c_str());
+    }
+    return 0;
+}
+
+static int make(const char *scriptPath, const char *path)
+{
+    std::vector<ScriptLine> lines;
+    if (!readScript(scriptPath, lines)) {
+        return 1;
+    }
+    FileTrace file;
+    TraceWriter writer(file);
+    if (!createTrace(file, writer, path)) {
+        return 1;
+    }
+    unsigned long n = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        const ScriptLine &l = lines[i];
+        if (l.command != "packet") {
+            continue;
+        }
+        if (!writer.record((unsigned long)(l.at / 1000), l.rssi, l.snr,
+                           (const uint8_t *)l.payload.data(), l.payload.length())) {
+            fprintf(stderr, "packet at %lu ms is too long\n", (unsigned long)(l.at / 1000));
+            return 1;
+        }
+        n++;
+    }
+    printf("%lu packets written to %s\n", n, path);
+    return 0;
+}
+
+static int fromLog(const char *logPath, const char *path)
+{
+    FILE *log = fopen(logPath, "r");
+    if (log == NULL) {
+        fprintf(stderr, "can't open %s\n", logPath);
+        return 1;
+    }
+    FileTrace file;
+    TraceWriter writer(file);
+    if (!createTrace(file, writer, path)) {
+        fclose(log);
+        return 1;
+    }
+    char line[2 * TRACE_MAX_RECORD + 64];
+    unsigned long n = 0, broken = 0;
+    while (fgets(line, sizeof(line), log) != NULL) {
+        // the board may print something before the tag on the same line
+        const char *hex = strstr(line, "TRACE:");
+        if (hex == NULL) {
+            continue;
+        }
+        hex += 6;
+        uint8_t record[TRACE_MAX_RECORD];
+        size_t len = 0;
+        unsigned int byte;
+        while (len < sizeof(record) && sscanf(hex, "%2x", &byte) == 1) {
+            record[len++] = (uint8_t)byte;
+            hex += 2;
+        }
+        // records are already encoded, check and copy them
+        TraceRecord r;
+        if (traceDecodeRecord(record, len, r) != len) {
+            broken++;
+            continue;
+        }
+        file.write(record, len);
+        n++;
+    }
+    fclose(log);
+    printf("%lu packets written to %s, %lu broken lines skipped\n", n, path, broken);
+    return 0;
+}
+
+static int stats(const char *path)
+{
+    FileTrace file;
+    TraceReader reader(file);
+    if (!openTrace(file, reader, path)) {
+        return 1;
+    }
+    TraceRecord r;
+    unsigned long n = 0, bytes = 0, maxLen = 0, peak = 0;
+    std::vector<uint32_t> times;
+    while (reader.next(r)) {
+        n++;
+        bytes += r.length;
+        if (r.length > maxLen) {
+            maxLen = r.length;
+        }
+        times.push_back(r.time);
+    }
+    // most packets within one second
+    for (size_t i = 0, j = 0; i < times.size(); i++) {
+        while (times[i] - times[j] >= 1000) {
+            j++;
+        }
+        if (i - j + 1 > peak) {
+            peak = i - j + 1;
+        }
+    }
+    printf("%lu packets in %.3f s, %lu payload bytes (avg %.1f, max %lu), peak %lu packets/s\n",
+           n, times.empty() ? 0 : times.back() / 1000.0, bytes, n ? (double)bytes / n : 0, maxLen, peak);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && strcmp(argv[1], "dump") == 0) {
+        return dump(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "make") == 0) {
+        return make(argv[2], argv[3]);
+    }
+    if (argc == 4 && strcmp(argv[1], "log") == 0) {
+        return fromLog(argv[2], argv[3]);
+    }
+    if (argc == 3 && strcmp(argv[1], "stats") == 0) {
+        return stats(argv[2]);
+    }
+    return usage();
+}
@@ -11,17 +11,10 @@
 #include "Hash.h"
 
 #include <stdint.h>
-#include <stdlib.h>
 
-// You can define your random function to improve side-channel resistance
-extern "C" {
-
-    // use system random function
-    uint32_t random32(void){
-        return (uint32_t)rand();
-    }
-
-}
+// Random numbers come from a generator seeded by random_entropy()
+// (utility/trezor/rand.h). On a PC the library uses the system source,
+// define your own random_entropy to seed it from somewhere else.
 
 using namespace std;
 
@@ -0,0 +1,387 @@
+#include "Arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include "utility/trezor/prof.h"
+#if UBTC_NO_HEAP
+#include "Bitcoin.h"
+#include "PSBT.h"
+#include "Electrum.h"
+#endif
+
+// every block is prefixed with its payload size so realloc knows how much to copy
+#define BLOCK_HEADER UBTC_ARRAY_HEADER
+
+static Arena * bound_arena = NULL;
+static Arena * live_arenas = NULL;
+
+static size_t align_up(size_t len){
+    return ((len + UBTC_ALLOC_ALIGN - 1) / UBTC_ALLOC_ALIGN) * UBTC_ALLOC_ALIGN;
+}
+
+//------------------------------------------------------------ Arena
+
+void Arena::init(void * buffer, size_t len){
+    base = NULL;
+    size = 0;
+    offset = 0;
+    highWatermark = 0;
+    failed = 0;
+    if(buffer != NULL){
+        // align the beginning of the region, blocks are aligned relative to it
+        uintptr_t start = (uintptr_t)buffer;
+        size_t shift = (UBTC_ALLOC_ALIGN - (start % UBTC_ALLOC_ALIGN)) % UBTC_ALLOC_ALIGN;
+        if(len > shift){
+            base = (uint8_t *)buffer + shift;
+            size = ((len - shift) / UBTC_ALLOC_ALIGN) * UBTC_ALLOC_ALIGN;
+        }
+    }
+    next = live_arenas;
+    live_arenas = this;
+}
+Arena::Arena(void * buffer, size_t len){
+    owned = NULL;
+    init(buffer, len);
+}
+#if !UBTC_NO_HEAP
+Arena::Arena(size_t len){
+    owned = malloc(len);
+    init(owned, len);
+    // too small to hold an aligned block
+    if(base == NULL && owned != NULL){
+        free(owned);
+        owned = NULL;
+    }
+}
+#endif
+Arena::~Arena(){
+    if(bound_arena == this){
+        bound_arena = NULL;
+    }
+    Arena ** p = &live_arenas;
+    while(*p != NULL){
+        if(*p == this){
+            *p = next;
+            break;
+        }
+        p = &((*p)->next);
+    }
+#if !UBTC_NO_HEAP
+    if(owned != NULL){
+        free(owned);
+        owned = NULL;
+    }
+#endif
+    base = NULL;
+}
+bool Arena::owns(const void * ptr) const{
+    return (base != NULL && (const uint8_t *)ptr >= base && (const uint8_t *)ptr < base + size);
+}
+Arena * Arena::owner(const void * ptr){
+    for(Arena * a = live_arenas; a != NULL; a = a->next){
+        if(a->owns(ptr)){
+            return a;
+        }
+    }
+    return NULL;
+}
+void * Arena::allocate(size_t len){
+    if(len == 0){
+        len = 1; // keep pointers unique and inside the region
+    }
+    size_t need = BLOCK_HEADER + align_up(len);
+    if(base == NULL || need < len || need > size - offset){
+        failed++;
+        return NULL;
+    }
+    uint8_t * block = base + offset;
+    *(size_t *)block = len;
+    offset += need;
+    if(offset > highWatermark){
+        highWatermark = offset;
+    }
+    return block + BLOCK_HEADER;
+}
+void * Arena::reallocate(void * ptr, size_t len){
+    if(ptr == NULL){
+        return allocate(len);
+    }
+    uint8_t * block = (uint8_t *)ptr - BLOCK_HEADER;
+    size_t old_len = *(size_t *)block;
+    if(len == 0){
+        len = 1;
+    }
+    // last block - grow or shrink in place
+    if((uint8_t *)ptr + align_up(old_len) == base + offset){
+        size_t start = block - base;
+        size_t need = BLOCK_HEADER + align_up(len);
+        if(need < len || need > size - start){
+            failed++;
+            return NULL;
+        }
+        *(size_t *)block = len;
+        offset = start + need;
+        if(offset > highWatermark){
+            highWatermark = offset;
+        }
+        return ptr;
+    }
+    void * p = allocate(len);
+    if(p == NULL){
+        return NULL;
+    }
+    memcpy(p, ptr, (old_len < len) ? old_len : len);
+    return p;
+}
+void Arena::release(void * ptr){
+    if(ptr == NULL){
+        return;
+    }
+    uint8_t * block = (uint8_t *)ptr - BLOCK_HEADER;
+    if((uint8_t *)ptr + align_up(*(size_t *)block) == base + offset){
+        offset = block - base;
+    }
+}
+
+//------------------------------------------------------------ ArenaScope
+
+ArenaScope::ArenaScope(Arena &arena){
+    previous = bound_arena;
+    bound_arena = &arena;
+}
+ArenaScope::~ArenaScope(){
+    bound_arena = previous;
+}
+
+//------------------------------------------------------------ Static pool
+
+#if UBTC_NO_HEAP
+
+#define POOL_MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define POOL_ARRAY(T, n) (UBTC_ARRAY_HEADER + (n)*sizeof(T))
+
+/* Three classes of fixed-size blocks, each can be overridden from the build flags.
+ * Small blocks hold short scripts and derivation paths,
+ * medium blocks hold scripts and witnesses up to UBTC_MAX_SCRIPT_LEN,
+ * large blocks hold input / output arrays, PSBT metadata and conversion buffers.
+ */
+#ifndef UBTC_POOL_SMALL_SIZE
+#define UBTC_POOL_SMALL_SIZE 64
+#endif
+#ifndef UBTC_POOL_SMALL_BLOCKS
+#define UBTC_POOL_SMALL_BLOCKS ((UBTC_MAX_INPUTS+UBTC_MAX_OUTPUTS)*(3+UBTC_MAX_DERIVATIONS)+16)
+#endif
+#ifndef UBTC_POOL_MEDIUM_SIZE
+#define UBTC_POOL_MEDIUM_SIZE POOL_MAX(UBTC_MAX_SCRIPT_LEN+9, \
+                              POOL_MAX(POOL_ARRAY(PSBTDerivation, UBTC_MAX_DERIVATIONS), \
+                                       POOL_ARRAY(PSBTPartialSignature, UBTC_MAX_DERIVATIONS)))
+#endif
+#ifndef UBTC_POOL_MEDIUM_BLOCKS
+#define UBTC_POOL_MEDIUM_BLOCKS (2*(UBTC_MAX_INPUTS+UBTC_MAX_OUTPUTS)+4)
+#endif
+#ifndef UBTC_POOL_LARGE_SIZE
+#define UBTC_POOL_LARGE_SIZE POOL_MAX(UBTC_MAX_TX_LEN, \
+                             POOL_MAX(POOL_MAX(POOL_ARRAY(TxIn, UBTC_MAX_INPUTS), POOL_ARRAY(TxOut, UBTC_MAX_OUTPUTS)), \
+                             POOL_MAX(POOL_MAX(POOL_ARRAY(PSBTInputMetadata, UBTC_MAX_INPUTS), POOL_ARRAY(PSBTOutputMetadata, UBTC_MAX_OUTPUTS)), \
+                                      POOL_ARRAY(ElectrumInputMetadata, UBTC_MAX_INPUTS))))
+#endif
+#ifndef UBTC_POOL_LARGE_BLOCKS
+#define UBTC_POOL_LARGE_BLOCKS 8
+#endif
+
+#define POOL_CLASSES 3
+#define POOL_BLOCK(len) (((len) + UBTC_ALLOC_ALIGN - 1) / UBTC_ALLOC_ALIGN * UBTC_ALLOC_ALIGN)
+#define POOL_SMALL_BYTES  (POOL_BLOCK(UBTC_POOL_SMALL_SIZE)*UBTC_POOL_SMALL_BLOCKS)
+#define POOL_MEDIUM_BYTES (POOL_BLOCK(UBTC_POOL_MEDIUM_SIZE)*UBTC_POOL_MEDIUM_BLOCKS)
+#define POOL_LARGE_BYTES  (POOL_BLOCK(UBTC_POOL_LARGE_SIZE)*UBTC_POOL_LARGE_BLOCKS)
+#define POOL_BYTES (POOL_SMALL_BYTES + POOL_MEDIUM_BYTES + POOL_LARGE_BYTES)
+
+// union forces the alignment of the whole pool
+static union{
+    uint8_t bytes[POOL_BYTES];
+    void * align_ptr;
+    uint64_t align_u64;
+    double align_double;
+} ubtc_pool;
+
+typedef struct{
+    size_t block;
+    size_t offset;
+    size_t blocks;
+    void * free_list;
+} pool_class;
+
+static pool_class pool_classes[POOL_CLASSES] = {
+    { POOL_BLOCK(UBTC_POOL_SMALL_SIZE),  0,                                   UBTC_POOL_SMALL_BLOCKS,  NULL },
+    { POOL_BLOCK(UBTC_POOL_MEDIUM_SIZE), POOL_SMALL_BYTES,                    UBTC_POOL_MEDIUM_BLOCKS, NULL },
+    { POOL_BLOCK(UBTC_POOL_LARGE_SIZE),  POOL_SMALL_BYTES+POOL_MEDIUM_BYTES,  UBTC_POOL_LARGE_BLOCKS,  NULL },
+};
+static bool pool_ready = false;
+static size_t pool_used = 0;
+static size_t pool_peak = 0;
+static size_t pool_failed = 0;
+
+static void pool_init(){
+    for(int c=0; c<POOL_CLASSES; c++){
+        pool_class * pc = &pool_classes[c];
+        pc->free_list = NULL;
+        // thread free blocks into a list, first block on top
+        for(size_t i=pc->blocks; i>0; i--){
+            void ** block = (void **)(ubtc_pool.bytes + pc->offset + (i-1)*pc->block);
+            *block = pc->free_list;
+            pc->free_list = block;
+        }
+    }
+    pool_ready = true;
+}
+static int pool_class_of(const void * ptr){
+    const uint8_t * p = (const uint8_t *)ptr;
+    if(p < ubtc_pool.bytes || p >= ubtc_pool.bytes + POOL_BYTES){
+        return -1;
+    }
+    size_t offset = p - ubtc_pool.bytes;
+    for(int c=POOL_CLASSES-1; c>=0; c--){
+        if(offset >= pool_classes[c].offset){
+            return c;
+        }
+    }
+    return -1;
+}
+static void * heap_malloc(size_t size){
+    if(!pool_ready){
+        pool_init();
+    }
+    for(int c=0; c<POOL_CLASSES; c++){
+        pool_class * pc = &pool_classes[c];
+        if(size <= pc->block && pc->free_list != NULL){
+            void ** block = (void **)pc->free_list;
+            pc->free_list = *block;
+            pool_used += pc->block;
+            if(pool_used > pool_peak){
+                pool_peak = pool_used;
+            }
+            return block;
+        }
+    }
+    pool_failed++;
+    return NULL;
+}
+static void heap_free(void * ptr){
+    int c = pool_class_of(ptr);
+    if(c < 0){
+        return;
+    }
+    pool_class * pc = &pool_classes[c];
+    *(void **)ptr = pc->free_list;
+    pc->free_list = ptr;
+    pool_used -= pc->block;
+}
+static void * heap_calloc(size_t num, size_t size){
+    void * ptr = heap_malloc(num*size);
+    if(ptr != NULL){
+        memset(ptr, 0, num*size);
+    }
+    return ptr;
+}
+static void * heap_realloc(void * ptr, size_t size){
+    int c = pool_class_of(ptr);
+    if(c < 0){
+        return NULL;
+    }
+    if(size <= pool_classes[c].block){
+        return ptr;
+    }
+    void * p = heap_malloc(size);
+    if(p == NULL){
+        return NULL;
+    }
+    memcpy(p, ptr, pool_classes[c].block);
+    heap_free(ptr);
+    return p;
+}
+
+size_t ubtc_pool_capacity(){
+    return POOL_BYTES;
+}
+size_t ubtc_pool_used(){
+    return pool_used;
+}
+size_t ubtc_pool_peak(){
+    return pool_peak;
+}
+size_t ubtc_pool_failures(){
+    return pool_failed;
+}
+
+#else
+
+static void * heap_malloc(size_t size){ return malloc(size); }
+static void * heap_calloc(size_t num, size_t size){ return calloc(num, size); }
+static void * heap_realloc(void * ptr, size_t size){ return realloc(ptr, size); }
+static void heap_free(void * ptr){ free(ptr); }
+
+#endif // UBTC_NO_HEAP
+
+//------------------------------------------------------------ Allocator
+
+Arena * ubtc_arena(){
+    return bound_arena;
+}
+static void * bound_malloc(size_t size){
+    if(bound_arena != NULL){
+        return bound_arena->allocate(size);
+    }
+    return heap_malloc(size);
+}
+void * ubtc_malloc(size_t size){
+    UBTC_PROF_ENTER();
+    void * ptr = bound_malloc(size);
+    UBTC_PROF_LEAVE(UBTC_PROF_ALLOC);
+    return ptr;
+}
+void * ubtc_calloc(size_t num, size_t size){
+    if(size != 0 && num > ((size_t)-1) / size){
+        return NULL;
+    }
+    UBTC_PROF_ENTER();
+    void * ptr;
+    if(bound_arena != NULL){
+        ptr = bound_arena->allocate(num*size);
+        if(ptr != NULL){
+            memset(ptr, 0, num*size);
+        }
+    }else{
+        ptr = heap_calloc(num, size);
+    }
+    UBTC_PROF_LEAVE(UBTC_PROF_ALLOC);
+    return ptr;
+}
+void * ubtc_realloc(void * ptr, size_t size){
+    UBTC_PROF_ENTER();
+    void * res;
+    if(ptr == NULL){
+        res = bound_malloc(size);
+    }else{
+        // blocks stay in the region they were allocated from
+        Arena * a = Arena::owner(ptr);
+        if(a != NULL){
+            res = a->reallocate(ptr, size);
+        }else{
+            res = heap_realloc(ptr, size);
+        }
+    }
+    UBTC_PROF_LEAVE(UBTC_PROF_ALLOC);
+    return res;
+}
+void ubtc_free(void * ptr){
+    if(ptr == NULL){
+        return;
+    }
+    UBTC_PROF_ENTER();
+    Arena * a = Arena::owner(ptr);
+    if(a != NULL){
+        a->release(ptr);
+    }else{
+        heap_free(ptr);
+    }
+    UBTC_PROF_LEAVE(UBTC_PROF_FREE);
+}
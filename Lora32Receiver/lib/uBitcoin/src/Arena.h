@@ -0,0 +1,146 @@
+/** @file Arena.h
+ *  \brief Optional monotonic arena for Tx, PSBT and ElectrumTx object graphs.
+ *
+ *  All dynamic memory of the library goes through `ubtc_malloc` / `ubtc_free`
+ *  and friends. By default they forward to the system heap.
+ *  When an `ArenaScope` is active they take memory from the bound `Arena`
+ *  instead, so every script, witness and metadata array of a transaction
+ *  parsed or built inside the scope lives in one region that can be
+ *  dropped at once with `Arena::reset()`.
+ *
+ *  Usage:
+ *  ```
+ *  static uint8_t buf[8192];
+ *  Arena arena(buf, sizeof(buf));
+ *  {
+ *      ArenaScope scope(arena);
+ *      PSBT psbt;
+ *      psbt.parseBase64(b64);
+ *      psbt.sign(root);
+ *  } // psbt is destroyed, nothing is returned to the heap
+ *  arena.reset();
+ *  ```
+ *  Objects allocated from an arena must be destroyed before the arena is
+ *  reset or goes out of scope. Binding is global, not per-thread.
+ */
+#ifndef __UBTC_ARENA_H__
+#define __UBTC_ARENA_H__
+
+#include "uBitcoin_conf.h"
+#include <stdint.h>
+#include <stddef.h>
+#if defined(ARDUINO_ARCH_AVR)
+#include <new.h>
+#else
+#include <new>
+#endif
+
+/** \brief Alignment of every block returned by the library allocator */
+#define UBTC_ALLOC_ALIGN (2*sizeof(void *))
+
+/** \brief Monotonic buffer. Allocations bump an offset, `reset()` releases everything. */
+class Arena{
+public:
+    /** \brief uses external buffer as a backing region (static array, stack, PSRAM...) */
+    Arena(void * buffer, size_t size);
+#if !UBTC_NO_HEAP
+    /** \brief allocates backing region of `size` bytes from the heap once */
+    Arena(size_t size);
+#endif
+    ~Arena();
+
+    /** \brief returns `size` bytes aligned to UBTC_ALLOC_ALIGN or NULL if arena is full */
+    void * allocate(size_t size);
+    /** \brief grows the block in place if it is the last one, otherwise moves it */
+    void * reallocate(void * ptr, size_t size);
+    /** \brief gives memory back only if `ptr` is the last block, otherwise does nothing */
+    void release(void * ptr);
+    /** \brief true if `ptr` points inside arena region */
+    bool owns(const void * ptr) const;
+    /** \brief returns live arena that holds `ptr` or NULL if it is a heap pointer */
+    static Arena * owner(const void * ptr);
+    /** \brief releases all blocks in O(1) */
+    void reset(){ offset = 0; };
+
+    size_t capacity() const{ return size; };
+    size_t used() const{ return offset; };
+    /** \brief maximum number of bytes used since construction */
+    size_t peak() const{ return highWatermark; };
+    /** \brief number of allocations that did not fit */
+    size_t failures() const{ return failed; };
+    bool isValid() const{ return base != NULL; };
+    explicit operator bool() const{ return isValid(); };
+private:
+    Arena(const Arena &other); // not copyable
+    Arena &operator=(const Arena &other);
+    void init(void * buffer, size_t size);
+    uint8_t * base;
+    size_t size;
+    size_t offset;
+    size_t highWatermark;
+    size_t failed;
+    void * owned; // pointer malloc returned, base may be moved up from it
+    Arena * next; // list of live arenas, used by owner()
+};
+
+/** \brief Binds an arena to all library allocations while in scope. Scopes can be nested. */
+class ArenaScope{
+public:
+    ArenaScope(Arena &arena);
+    ~ArenaScope();
+private:
+    ArenaScope(const ArenaScope &other);
+    ArenaScope &operator=(const ArenaScope &other);
+    Arena * previous;
+};
+
+/** \brief returns currently bound arena or NULL if the heap is used */
+Arena * ubtc_arena();
+
+void * ubtc_malloc(size_t size);
+void * ubtc_calloc(size_t num, size_t size);
+void * ubtc_realloc(void * ptr, size_t size);
+void ubtc_free(void * ptr);
+
+#if UBTC_NO_HEAP
+/** \brief total size of the static pool, this is the worst-case RAM used by the library objects */
+size_t ubtc_pool_capacity();
+/** \brief bytes of the pool currently in use and maximum since boot */
+size_t ubtc_pool_used();
+size_t ubtc_pool_peak();
+/** \brief number of allocations that did not fit into the pool */
+size_t ubtc_pool_failures();
+#endif
+
+/** \brief Size of the hidden header that keeps number of elements of the array */
+#define UBTC_ARRAY_HEADER (((sizeof(size_t)+UBTC_ALLOC_ALIGN-1)/UBTC_ALLOC_ALIGN)*UBTC_ALLOC_ALIGN)
+
+/** \brief `new T[num]` through the library allocator. Returns NULL if num is 0 or allocation failed. */
+template<typename T>
+T * ubtc_new_array(size_t num){
+    if(num == 0 || num > ((size_t)-1 - UBTC_ARRAY_HEADER) / sizeof(T)){
+        return NULL;
+    }
+    uint8_t * mem = (uint8_t *)ubtc_malloc(UBTC_ARRAY_HEADER + num*sizeof(T));
+    if(mem == NULL){ return NULL; }
+    *(size_t *)mem = num;
+    T * arr = (T *)(mem + UBTC_ARRAY_HEADER);
+    for(size_t i=0; i<num; i++){
+        new (&arr[i]) T();
+    }
+    return arr;
+}
+
+/** \brief `delete [] arr` for arrays created with ubtc_new_array */
+template<typename T>
+void ubtc_delete_array(T * arr){
+    if(arr == NULL){ return; }
+    uint8_t * mem = ((uint8_t *)arr) - UBTC_ARRAY_HEADER;
+    size_t num = *(size_t *)mem;
+    for(size_t i=num; i>0; i--){
+        arr[i-1].~T();
+    }
+    ubtc_free(mem);
+}
+
+#endif // __UBTC_ARENA_H__
@@ -1,5 +1,6 @@
 #include "uBitcoin_conf.h"
 #include "BaseClasses.h"
+#include "Arena.h"
 #include <cstdlib>
 
 #if USE_STD_STRING
@@ -131,20 +132,20 @@ size_t SerializeByteStream::write(const uint8_t *arr, size_t length){
 #ifdef ARDUINO
 size_t Readable::printTo(Print& p) const{
     size_t len = this->stringLength()+1;
-    char * arr = (char *)calloc(len, sizeof(char));
+    char * arr = (char *)ubtc_calloc(len, sizeof(char));
     toString(arr, len);
     p.print(arr);
-    free(arr);
+    ubtc_free(arr);
     return len-1;
 }
 #endif
 #if USE_ARDUINO_STRING || USE_STD_STRING
 String Readable::toString() const{
     size_t len = this->stringLength()+1;
-    char * arr = (char *)calloc(len, sizeof(char));
+    char * arr = (char *)ubtc_calloc(len, sizeof(char));
     toString(arr, len);
     String s = arr;
-    free(arr);
+    ubtc_free(arr);
     return s;
 };
 #endif
@@ -156,10 +157,10 @@ String Streamable::serialize(size_t offset, size_t len) const{
     if(len == 0){
         len = (length()-offset);
     }
-    char * arr = (char *)calloc(2*len+1, sizeof(char));
+    char * arr = (char *)ubtc_calloc(2*len+1, sizeof(char));
     serialize(arr, 2*len, offset, HEX_ENCODING);
     String s = arr;
-    free(arr);
+    ubtc_free(arr);
     return s;
 };
 #endif
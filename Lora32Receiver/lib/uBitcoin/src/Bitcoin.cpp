@@ -437,19 +437,23 @@ Script PublicKey::script(ScriptType type) const{
 bool PublicKey::verify(const Signature sig, const uint8_t hash[32]) const{
     uint8_t signature[64] = {0};
     sig.bin(signature, 64);
-    uint8_t pub[65];
-    serialize(pub, 65);
+    // uncompressed form, a compressed key would be decompressed on every call
+    uint8_t pub[65] = {0x04};
+    memcpy(pub+1, point, 64);
     return (ecdsa_verify_digest(&secp256k1, pub, signature, hash)==0);
 }
-bool PublicKey::schnorr_verify(const SchnorrSignature sig, const uint8_t hash[32]) const{
-    PublicKey pub = *this;
-    if(!pub.isEven()){
+// checks s*G = R + e*P, prepared is NULL or the table for key
+static bool schnorr_verify_key(const PublicKey &key, const PreparedPublicKey * prepared, const SchnorrSignature &sig, const uint8_t hash[32]){
+    PublicKey pub = key;
+    bool negate = !pub.isEven();
+    if(negate){
         pub = -pub;
     }
     uint8_t rs[64];
     sig.serialize(rs, sizeof(rs));
+    // R is new with every signature, keep it out of the point cache
     PublicKey R;
-    R.from_x(rs, 32);
+    R.from_x_once(rs, 32);
     // calculate hash using tagged hash with "BIP0340/challenge" prefix
     uint8_t e[32];
     uint8_t tmp[32];
@@ -463,13 +467,83 @@ bool PublicKey::schnorr_verify(const SchnorrSignature sig, const uint8_t hash[32
     tch.write(hash, 32);
     tch.end(e);
     PrivateKey challenge(e);
-    PublicKey S = challenge*pub + R;
+    ECPoint eP;
+    if(prepared != NULL){
+        // table is for the original key, e*(-P) = -(e*P)
+        eP = prepared->multiply(challenge);
+        if(negate){
+            eP = -eP;
+        }
+    }else{
+        eP = multiplyPublic(challenge, pub);
+    }
+    PublicKey S = eP + R;
     S.x(tmp, sizeof(tmp));
     PrivateKey s(rs+32);
     s.publicKey().x(e, 32);
     return memcmp(tmp, e, 32) == 0;
+}
+bool PublicKey::schnorr_verify(const SchnorrSignature sig, const uint8_t hash[32]) const{
+    return schnorr_verify_key(*this, NULL, sig, hash);
 };
 
+// ---------------------------------------------------------------- PreparedPublicKey class
+
+int PreparedPublicKey::prepare(const PublicKey &pubkey){
+    clear();
+    if(!pubkey.isValid()){
+        return 0;
+    }
+    curve_point * t = (curve_point *)ubtc_malloc(point_table_length(UBTC_PREPARED_WINDOW) * sizeof(curve_point));
+    if(t == NULL){
+        return 0;
+    }
+    curve_point p;
+    bn_read_be(pubkey.point, &p.x);
+    bn_read_be(pubkey.point+32, &p.y);
+    point_table_build(&secp256k1, &p, UBTC_PREPARED_WINDOW, t);
+    pub = pubkey;
+    table = t;
+    return 1;
+}
+void PreparedPublicKey::clear(){
+    ubtc_free(table);
+    table = NULL;
+    pub = PublicKey();
+}
+ECPoint PreparedPublicKey::multiply(const ECScalar &d) const{
+    ECPoint r;
+    if(table == NULL){
+        return r;
+    }
+    uint8_t num[32];
+    d.getSecret(num);
+    bignum256 k;
+    bn_read_be(num, &k);
+    curve_point res;
+    point_table_multiply(&secp256k1, &k, (const curve_point *)table, UBTC_PREPARED_WINDOW, &res);
+    bn_write_be(&res.x, r.point);
+    bn_write_be(&res.y, r.point+32);
+    r.compressed = pub.compressed;
+    memzero(num, sizeof(num));
+    memzero(&k, sizeof(k));
+    return r;
+}
+bool PreparedPublicKey::verify(const Signature sig, const uint8_t hash[32]) const{
+    if(table == NULL){
+        return false;
+    }
+    uint8_t signature[64] = {0};
+    sig.bin(signature, 64);
+    return (ecdsa_verify_digest_table(&secp256k1, (const curve_point *)table, UBTC_PREPARED_WINDOW, signature, hash)==0);
+}
+bool PreparedPublicKey::schnorr_verify(const SchnorrSignature sig, const uint8_t hash[32]) const{
+    if(table == NULL){
+        return false;
+    }
+    return schnorr_verify_key(pub, this, sig, hash);
+}
+
 // ---------------------------------------------------------------- PrivateKey class
 
 size_t PrivateKey::from_stream(ParseStream *s){
@@ -640,6 +714,23 @@ int PrivateKey::ecdh(const PublicKey pub, uint8_t shared_secret[32], bool use_ha
     return 1;
 }
 
+int PrivateKey::ecdh(const PreparedPublicKey &pub, uint8_t shared_secret[32], bool use_hash){
+    if(!pub){
+        return 0;
+    }
+    ECPoint mult = pub.multiply(*this);
+    mult.compressed = false;
+    uint8_t sec[65];
+    mult.sec(sec, sizeof(sec));
+    if(use_hash){
+        sha256(sec+1, 64, shared_secret);
+    }else{
+        memcpy(shared_secret, sec+1, 32);
+    }
+    memzero(sec, sizeof(sec));
+    return 1;
+}
+
 static int is_canonical(uint8_t by, uint8_t sig[64]){
   return 1;
 }
@@ -653,6 +744,28 @@ Signature PrivateKey::sign(const uint8_t hash[32]) const{
     return sig;
 }
 
+PreparedPrivateKey::PreparedPrivateKey(){
+    memzero(&rng, sizeof(rng));
+}
+PreparedPrivateKey::~PreparedPrivateKey(){
+    memzero(&rng, sizeof(rng));
+}
+void PreparedPrivateKey::prepare(const PrivateKey &pk){
+    uint8_t secret[32];
+    key = pk;
+    key.getSecret(secret);
+    prepare_rfc6979_key(secret, &rng);
+    memzero(secret, sizeof(secret));
+}
+Signature PreparedPrivateKey::sign(const uint8_t hash[32]) const{
+    uint8_t signature[65] = {0};
+    uint8_t i = 0;
+    ecdsa_sign_digest_key(&secp256k1, &rng, hash, signature, &i, &is_canonical);
+    Signature sig(signature, signature+32);
+    sig.index = i;
+    return sig;
+}
+
 SchnorrSignature PrivateKey::schnorr_sign(const uint8_t hash[32]) const{
     PrivateKey prv = *this;
     PublicKey pub = prv.publicKey();
@@ -9,7 +9,9 @@
 #include "BitcoinCurve.h"
 #include "Conversion.h"
 #include "Networks.h"
+#include "Arena.h"
 #include "utility/trezor/rand.h"
+#include "utility/trezor/rfc6979.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -150,6 +152,42 @@ public:
     Script script(ScriptType type = P2PKH) const;
 };
 
+/**
+ *  PreparedPublicKey class.
+ *
+ *  Public key with a precomputed table of its multiples, like the one used for GeneratorPoint.
+ *  Verifying many signatures or doing ecdh many times with the same key
+ *  then runs at the speed of fixed-base multiplication.
+ *
+ *  Preparing costs about as much as a few verifications. The table takes
+ *  ceil(256/w) * 2^(w-1) * 72 bytes with w = UBTC_PREPARED_WINDOW (36 KB for 4)
+ *  and is allocated with ubtc_malloc, with UBTC_NO_HEAP bind an Arena while preparing.
+ */
+class PreparedPublicKey{
+    PublicKey pub;
+    void * table; // curve_point array, see point_table_build
+    // not copyable, the table is large
+    PreparedPublicKey(const PreparedPublicKey &other);
+    PreparedPublicKey &operator=(const PreparedPublicKey &other);
+public:
+    PreparedPublicKey(){ table = NULL; };
+    explicit PreparedPublicKey(const PublicKey &pubkey){ table = NULL; prepare(pubkey); };
+    ~PreparedPublicKey(){ clear(); };
+    /** \brief Builds the table, returns 0 if the key is invalid or allocation failed */
+    int prepare(const PublicKey &pubkey);
+    /** \brief Frees the table */
+    void clear();
+    const PublicKey &publicKey() const{ return pub; };
+    bool isValid() const{ return table != NULL; };
+    explicit operator bool() const { return isValid(); };
+    /** \brief Returns d * publicKey() */
+    ECPoint multiply(const ECScalar &d) const;
+    /** \brief Same as PublicKey::verify */
+    bool verify(const Signature sig, const uint8_t hash[32]) const;
+    /** \brief Same as PublicKey::schnorr_verify */
+    bool schnorr_verify(const SchnorrSignature sig, const uint8_t hash[32]) const;
+};
+
 /**
  *  PrivateKey class.
  *  Corresponding public key (point on curve) will be calculated in the constructor.
@@ -226,6 +264,32 @@ public:
      *  Having hash=true is recommended unless you have a very good reason not to use it.
      */
     int ecdh(const PublicKey pub, uint8_t shared_secret[32], bool hash=true);
+    int ecdh(const PreparedPublicKey &pub, uint8_t shared_secret[32], bool hash=true);
+};
+
+/**
+ *  PreparedPrivateKey class.
+ *
+ *  Private key with the key dependent part of the RFC6979 nonce generator
+ *  already hashed. Signing many hashes with the same key skips
+ *  a few SHA256 blocks per signature and the public key is derived only once.
+ *  Signatures are identical to PrivateKey::sign.
+ */
+class PreparedPrivateKey{
+    PrivateKey key;
+    rfc6979_key rng;
+public:
+    PreparedPrivateKey();
+    explicit PreparedPrivateKey(const PrivateKey &pk){ prepare(pk); };
+    ~PreparedPrivateKey();
+    /** \brief Stores the key and hashes its part of the nonce generator */
+    void prepare(const PrivateKey &pk);
+    const PrivateKey &privateKey() const{ return key; };
+    PublicKey publicKey() const{ return key.publicKey(); };
+    bool isValid() const{ return key.isValid(); };
+    explicit operator bool() const { return isValid(); };
+    /** \brief Same as PrivateKey::sign */
+    Signature sign(const uint8_t hash[32]) const;
 };
 
 /**
@@ -492,7 +556,7 @@ public:
     /** \brief creates one of standart scripts (P2SH, P2WSH) */
     Script(const Script &other, ScriptType type);
     Script(const Script &other); // copy
-    ~Script(){ if(scriptArray){ free(scriptArray); } };
+    ~Script(){ if(scriptArray){ ubtc_free(scriptArray); } };
 
     /** \brief tries to determine the script type */
     ScriptType type() const;
@@ -561,7 +625,7 @@ public:
     Witness(const uint8_t * buffer, size_t len);
     Witness(const Signature sig, const PublicKey pub);
     Witness(const Witness &other); // copy
-    ~Witness(){ if(witnessArray){ free(witnessArray); } };
+    ~Witness(){ if(witnessArray){ ubtc_free(witnessArray); } };
     /** \brief returns number of elements in the witness */
     uint8_t count() const{ return numElements; };
     /** \brief adds `<len><data>` to the witness */
@@ -714,6 +778,7 @@ public:
      *         For P2WPKH, P2WSH and P2SH-P2WPKH use signSegwitInput method.
      */
     Signature signInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, SigHashType sighash = SIGHASH_ALL);
+    Signature signInput(uint8_t inputIndex, const PreparedPrivateKey &pk, const Script redeemScript, SigHashType sighash = SIGHASH_ALL);
     /** \brief signs legacy input and returns a signature */
     Signature signInput(uint8_t inputIndex, const PrivateKey pk){
         return signInput(inputIndex, pk, Script(pk.publicKey(), P2PKH));
@@ -724,6 +789,7 @@ public:
      *         For P2PKH and P2SH use signInput method.
      */
     Signature signSegwitInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, uint64_t amount, ScriptType type = P2WSH, SigHashType sighash = SIGHASH_ALL);
+    Signature signSegwitInput(uint8_t inputIndex, const PreparedPrivateKey &pk, const Script redeemScript, uint64_t amount, ScriptType type = P2WSH, SigHashType sighash = SIGHASH_ALL);
     /** \brief signs segwit input and returns a signature. Uses native segwit (P2WPKH) by default, 
      *         you can also specify the type to be P2SH-P2WPKH to sign nested segwit transaction.
      */
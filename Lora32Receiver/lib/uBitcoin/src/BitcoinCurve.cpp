@@ -4,8 +4,105 @@
 #include "utility/trezor/ecdsa.h"
 #include "utility/trezor/secp256k1.h"
 
-const ECPoint InfinityPoint;
-const ECPoint GeneratorPoint("0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798");
+// x and y of the secp256k1 generator, plain constant data so nothing runs at boot
+static const uint8_t generator_xy[64] = {
+	0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b, 0x07,
+	0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17, 0x98,
+	0x48, 0x3a, 0xda, 0x77, 0x26, 0xa3, 0xc4, 0x65, 0x5d, 0xa4, 0xfb, 0xfc, 0x0e, 0x11, 0x08, 0xa8,
+	0xfd, 0x17, 0xb4, 0x48, 0xa6, 0x85, 0x54, 0x19, 0x9c, 0x47, 0xd0, 0x8f, 0xfb, 0x10, 0xd4, 0xb8
+};
+static const uint8_t infinity_xy[64] = { 0 };
+
+// only copy the constant tables, no parsing or point validation during static initialization
+const ECPoint InfinityPoint(infinity_xy, true);
+const ECPoint GeneratorPoint(generator_xy, true);
+
+#if UBTC_POINT_CACHE_SIZE > 0
+typedef struct{
+	uint8_t point[64]; // validated x and y
+	uint32_t used;     // last access, 0 for empty entry
+} point_cache_entry;
+
+static point_cache_entry point_cache[UBTC_POINT_CACHE_SIZE];
+static uint32_t point_cache_clock = 0;
+static size_t point_cache_hit = 0;
+static size_t point_cache_miss = 0;
+
+size_t ubtc_point_cache_hits(){ return point_cache_hit; }
+size_t ubtc_point_cache_misses(){ return point_cache_miss; }
+void ubtc_point_cache_clear(){
+	memset(point_cache, 0, sizeof(point_cache));
+	point_cache_clock = 0;
+	point_cache_hit = 0;
+	point_cache_miss = 0;
+}
+
+static uint32_t point_cache_tick(){
+	point_cache_clock++;
+	if(point_cache_clock == 0){ // wrapped around, forget the order but keep the points
+		for(size_t i=0; i<UBTC_POINT_CACHE_SIZE; i++){
+			if(point_cache[i].used){
+				point_cache[i].used = 1;
+			}
+		}
+		point_cache_clock = 2;
+	}
+	return point_cache_clock;
+}
+
+// finds point with x coordinate `x` and writes y with requested parity to `y`
+static bool point_cache_lookup(const uint8_t x[32], uint8_t odd, uint8_t y[32]){
+	for(size_t i=0; i<UBTC_POINT_CACHE_SIZE; i++){
+		point_cache_entry * e = &point_cache[i];
+		if(e->used && memcmp(e->point, x, 32) == 0){
+			e->used = point_cache_tick();
+			point_cache_hit++;
+			if((e->point[63] & 0x01) == (odd & 0x01)){
+				memcpy(y, e->point+32, 32);
+			}else{ // y = p - y
+				bignum256 b;
+				bn_read_be(e->point+32, &b);
+				bn_subtract(&secp256k1.prime, &b, &b);
+				bn_write_be(&b, y);
+			}
+			return true;
+		}
+	}
+	point_cache_miss++;
+	return false;
+}
+
+static void point_cache_store(const uint8_t point[64]){
+	size_t oldest = 0;
+	for(size_t i=0; i<UBTC_POINT_CACHE_SIZE; i++){
+		if(point_cache[i].used && memcmp(point_cache[i].point, point, 32) == 0){
+			oldest = i; // already there, refresh
+			break;
+		}
+		if(point_cache[i].used < point_cache[oldest].used){
+			oldest = i;
+		}
+	}
+	memcpy(point_cache[oldest].point, point, 64);
+	point_cache[oldest].used = point_cache_tick();
+}
+#endif
+
+// checks serialized point and remembers it on success
+static bool validate_sec(const uint8_t * sec){
+    curve_point pub;
+	if(!ecdsa_read_pubkey(&secp256k1, sec, &pub)){
+		return false;
+	}
+#if UBTC_POINT_CACHE_SIZE > 0
+	// compressed keys are checked by x only, so cache y as computed from the curve
+	uint8_t arr[64];
+	bn_write_be(&pub.x, arr);
+	bn_write_be(&pub.y, arr+32);
+	point_cache_store(arr);
+#endif
+	return true;
+}
 
 size_t ECPoint::from_stream(ParseStream *s){
 	static uint8_t first_byte;
@@ -43,16 +140,28 @@ size_t ECPoint::from_stream(ParseStream *s){
 		bytes_read++; bytes_to_read--;
 	}
 	if(bytes_to_read==0){
+		status = PARSING_DONE;
+#if UBTC_POINT_CACHE_SIZE > 0
+		if(compressed && point_cache_lookup(point, first_byte, point+32)){
+			bytes_parsed += bytes_read;
+			return bytes_read; // cached points are already validated
+		}
+#endif
 		if(compressed){
 			uint8_t buf[33];
 			buf[0] = first_byte;
 			memcpy(buf+1, point, 32);
             uint8_t arr[65];
-            ecdsa_uncompress_pubkey(&secp256k1, buf, arr);
-            memcpy(point, arr+1, 64);
-		}
-		status = PARSING_DONE;
-		if(!ECPoint::isValid()){
+			// uncompress also validates the point, no need to check it again
+            if(ecdsa_uncompress_pubkey(&secp256k1, buf, arr)){
+                memcpy(point, arr+1, 64);
+#if UBTC_POINT_CACHE_SIZE > 0
+                point_cache_store(point);
+#endif
+            }else{
+                status = PARSING_FAILED;
+            }
+		}else if(!ECPoint::isValid()){
 			status = PARSING_FAILED;
 		}
 	}
@@ -87,6 +196,27 @@ size_t ECPoint::fromSec(const uint8_t * arr, size_t len){
 	ParseByteStream s(arr, len);
 	return ECPoint::from_stream(&s);
 }
+size_t ECPoint::from_x_once(const uint8_t * arr, size_t len){
+	if(len < 32){
+		return 0;
+	}
+	reset();
+	memcpy(point, arr, 32);
+#if UBTC_POINT_CACHE_SIZE > 0
+	if(point_cache_lookup(point, 0x02, point+32)){
+		return 32;
+	}
+#endif
+	uint8_t buf[33] = {0x02};
+	memcpy(buf+1, arr, 32);
+	uint8_t full[65];
+	if(!ecdsa_uncompress_pubkey(&secp256k1, buf, full)){
+		status = PARSING_FAILED;
+		return 0;
+	}
+	memcpy(point, full+1, 64);
+	return 32;
+}
 
 ECPoint::ECPoint(const uint8_t pubkeyArr[64], bool use_compressed){ 
 	memcpy(point, pubkeyArr, 64);
@@ -109,20 +239,31 @@ bool ECPoint::isValid() const{
 	if(status != PARSING_DONE){
 		return false;
 	}
-    curve_point pub;
+#if UBTC_POINT_CACHE_SIZE > 0
+	uint8_t y[32];
+	if(point_cache_lookup(point, point[63], y)){
+		return memcmp(y, point+32, 32) == 0;
+	}
+#endif
 	uint8_t buf[65];
 	sec(buf, 65);
-	return ecdsa_read_pubkey(&secp256k1, buf, &pub);
+	return validate_sec(buf);
 };
+bool ECPoint::isInfinity() const{
+	return memcmp(point, infinity_xy, 64) == 0;
+}
+bool ECPoint::isGenerator() const{
+	return memcmp(point, generator_xy, 64) == 0;
+}
 bool ECPoint::isEven() const{
     return !bool(point[63] & 0x01);
 };
 
 ECPoint ECPoint::operator+(const ECPoint& other) const{
-	if(*this == InfinityPoint){
+	if(isInfinity()){
 		return other;
 	}
-	if(other == InfinityPoint){
+	if(other.isInfinity()){
 		return *this;
 	}
     curve_point p1, p2;
@@ -138,7 +279,7 @@ ECPoint ECPoint::operator+(const ECPoint& other) const{
 	return sum;
 };
 ECPoint ECPoint::operator-() const{
-	if(*this == InfinityPoint){
+	if(isInfinity()){
 		return *this;
 	}
     uint8_t buf[33];
@@ -268,24 +409,41 @@ bool ECPoint::operator<(const ECPoint& other) const{
 	other.sec(sec2, sizeof(sec2));
 	return memcmp(sec1, sec2, sizeof(sec1)) > 0;
 }
-ECPoint operator*(const ECScalar& scalar, const ECPoint& point){
+static ECPoint multiply(const ECScalar& scalar, const ECPoint& point, bool is_public){
 	ECPoint r;
 	uint8_t num[32];
 	scalar.getSecret(num);
-	if(point == GeneratorPoint){
+	if(point.isGenerator()){
 		uint8_t pubkey[65];
 		ecdsa_get_public_key65(&secp256k1, num, pubkey);
-		r.parse(pubkey, 65);
+		// validated here, parsing would put every derived key into the point cache
+		curve_point p;
+		memcpy(r.point, pubkey+1, 64);
+		if(!ecdsa_read_pubkey(&secp256k1, pubkey, &p)){
+			r.setStatus(PARSING_FAILED);
+		}
 	}else{
 		bignum256 d;
 		bn_read_be(num, &d);
 		curve_point p, res;
 		bn_read_be(point.point, &p.x);
 		bn_read_be(point.point+32, &p.y);
-		point_multiply(&secp256k1, &d, &p, &res);
+		if(is_public){
+			point_multiply_var(&secp256k1, &d, &p, &res);
+		}else{
+			point_multiply(&secp256k1, &d, &p, &res);
+		}
 		bn_write_be(&res.x, r.point);
 		bn_write_be(&res.y, r.point+32);
+		memzero(&d, sizeof(d));
 	}
+	memzero(num, sizeof(num));
 	r.compressed = point.compressed;
 	return r;
 }
+ECPoint operator*(const ECScalar& scalar, const ECPoint& point){
+	return multiply(scalar, point, false);
+}
+ECPoint multiplyPublic(const ECScalar& scalar, const ECPoint& point){
+	return multiply(scalar, point, true);
+}
@@ -40,6 +40,9 @@ public:
         memcpy(sec+1, arr, 32);
         return fromSec(sec, sizeof(sec));
     }
+    // same as from_x for points seen once like a signature nonce,
+    // uses the point cache but doesn't add the point to it
+    size_t from_x_once(const uint8_t * arr, size_t len);
 #if USE_ARDUINO_STRING
     String sec() const{
         char arr[65*2+1] = "";
@@ -77,6 +80,9 @@ public:
     // bool verify(const Signature sig, const uint8_t hash[32]) const;
     virtual bool isValid() const;
     bool isEven() const;
+    /** \brief checks against constant tables, safe to use during static initialization */
+    bool isInfinity() const;
+    bool isGenerator() const;
     explicit operator bool() const { return isValid(); };
     bool operator==(const ECPoint& other) const{ return (memcmp(point, other.point, 64) == 0); };
     bool operator!=(const ECPoint& other) const{ return !operator==(other); };
@@ -97,6 +103,19 @@ public:
 extern const ECPoint InfinityPoint;
 extern const ECPoint GeneratorPoint;
 
+#if UBTC_POINT_CACHE_SIZE > 0
+/* Cache of validated points keyed by x coordinate.
+ * ECPoint parsing and isValid() use it automatically,
+ * least recently used entry is replaced when the cache is full.
+ */
+/** \brief number of lookups answered from the cache */
+size_t ubtc_point_cache_hits();
+/** \brief number of lookups that had to decompress or validate the point */
+size_t ubtc_point_cache_misses();
+/** \brief drops all entries and resets the counters */
+void ubtc_point_cache_clear();
+#endif
+
 class ECScalar : public Streamable{
 protected:
     virtual size_t from_stream(ParseStream *s);
@@ -153,6 +172,9 @@ inline ECScalar operator-(uint32_t i, ECScalar& scalar){ return ECScalar(i) - sc
 inline ECScalar operator-(ECScalar& scalar, uint32_t i){ return scalar - ECScalar(i); };
 
 ECPoint operator*(const ECScalar& d, const ECPoint& p);
+/** \brief d*p with timing that depends on d, faster than d*p.
+ *         Only for public scalars, e.g. in signature verification. */
+ECPoint multiplyPublic(const ECScalar& d, const ECPoint& p);
 inline ECPoint operator*(const ECPoint& p, const ECScalar& d){ return d*p; };
 inline ECPoint operator/(const ECPoint& p, const ECScalar& d){ return (ECScalar(1)/d)*p; };
 
@@ -1,5 +1,6 @@
 #include "Conversion.h"
 #include "Hash.h"
+#include "Arena.h"
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -39,7 +40,7 @@ size_t toHex(const uint8_t * array, size_t arraySize, char * output, size_t outp
 String toHex(const uint8_t * array, size_t arraySize){
     if(array == NULL){ return String(); }
     size_t outputSize = arraySize * 2 + 1;
-    char * output = (char *) malloc(outputSize);
+    char * output = (char *) ubtc_malloc(outputSize);
     if(output == NULL){ return String(); }
 
     toHex(array, arraySize, output, outputSize);
@@ -47,7 +48,7 @@ String toHex(const uint8_t * array, size_t arraySize){
     String result(output);
 
     memzero(output, outputSize);
-    free(output);
+    ubtc_free(output);
 
     return result;
 }
@@ -182,7 +183,7 @@ size_t toBin(const uint8_t * array, size_t arraySize, char * output, size_t outp
 String toBin(const uint8_t * array, size_t arraySize){
     if(array == NULL){ return String(); }
     size_t outputSize = arraySize * 8 + 1;
-    char * output = (char *) malloc(outputSize);
+    char * output = (char *) ubtc_malloc(outputSize);
     if(output == NULL){ return String(); }
 
     toBin(array, arraySize, output, outputSize);
@@ -190,7 +191,7 @@ String toBin(const uint8_t * array, size_t arraySize){
     String result(output);
 
     memzero(output, outputSize);
-    free(output);
+    ubtc_free(output);
 
     return result;
 }
@@ -272,7 +273,7 @@ size_t toBase58(const uint8_t * array, size_t arraySize, char * output, size_t o
 
     // array copy for manipulations
     size_t bufferSize = arraySize - zeroCount;
-    uint8_t * buffer = (uint8_t *)calloc(bufferSize, sizeof(uint8_t));
+    uint8_t * buffer = (uint8_t *)ubtc_calloc(bufferSize, sizeof(uint8_t));
     if(buffer == NULL){ return 0; }
     for(size_t i = zeroCount; i < arraySize; i++){
         buffer[i - zeroCount] = array[i];
@@ -288,7 +289,7 @@ size_t toBase58(const uint8_t * array, size_t arraySize, char * output, size_t o
         }
         output[size+zeroCount-j-1] = BASE58_CHARS[reminder];
     }
-    free(buffer);
+    ubtc_free(buffer);
     for (size_t i = 0; i < zeroCount; i++){
         output[i] = BASE58_CHARS[0];
     }
@@ -320,18 +321,18 @@ size_t toBase58(const uint8_t * array, size_t arraySize, char * output, size_t o
 String toBase58(const uint8_t * array, size_t arraySize){
     if(array == NULL){ return String(); }
     size_t len = toBase58Length(array, arraySize) + 1; // +1 for null terminator
-    char * buf = (char *)malloc(len);
+    char * buf = (char *)ubtc_malloc(len);
     if(buf == NULL){ return String(); }
     toBase58(array, arraySize, buf, len);
     String result(buf);
-    free(buf);
+    ubtc_free(buf);
     return result;
 }
 #endif
 
 size_t toBase58Check(const uint8_t * array, size_t arraySize, char * output, size_t outputSize){
     if(array == NULL || output == NULL){ return 0; }
-    uint8_t * arr = (uint8_t *) malloc(arraySize+4);
+    uint8_t * arr = (uint8_t *) ubtc_malloc(arraySize+4);
     if(arr == NULL){ return 0; }
     memcpy(arr, array, arraySize);
 
@@ -341,18 +342,18 @@ size_t toBase58Check(const uint8_t * array, size_t arraySize, char * output, siz
 
     size_t l = toBase58(arr, arraySize+4, output, outputSize);
     memzero(arr, arraySize+4); // secret should not stay in RAM
-    free(arr);
+    ubtc_free(arr);
     return l;
 }
 #if USE_ARDUINO_STRING || USE_STD_STRING
 String toBase58Check(const uint8_t * array, size_t arraySize){
     if(array == NULL){ return String(); }
     size_t len = toBase58Length(array, arraySize + 4) + 1; // +4 checksum +1 for null terminator
-    char * buf = (char *)malloc(len);
+    char * buf = (char *)ubtc_malloc(len);
     if(buf == NULL){ return String(); }
     toBase58Check(array, arraySize, buf, len);
     String result(buf);
-    free(buf);
+    ubtc_free(buf);
     return result;
 }
 #endif
@@ -379,7 +380,7 @@ size_t fromBase58(const char * encoded, size_t encodedSize, uint8_t * output, si
     }
     encodedSize = l;
     size_t size = fromBase58Length(encoded, encodedSize);
-    uint8_t * tmp = (uint8_t *) calloc(size, sizeof(uint8_t));
+    uint8_t * tmp = (uint8_t *) ubtc_calloc(size, sizeof(uint8_t));
     if(tmp == NULL){ return 0; }
 
     uint8_t zeroCount = 0;
@@ -403,7 +404,7 @@ size_t fromBase58(const char * encoded, size_t encodedSize, uint8_t * output, si
                 tmp[size-j-1] = cur%256;
             }
         }else{
-            free(tmp);
+            ubtc_free(tmp);
             return 0;
         }
     }
@@ -417,35 +418,35 @@ size_t fromBase58(const char * encoded, size_t encodedSize, uint8_t * output, si
         }
     }
     if(size-shift > outputSize){
-        free(tmp);
+        ubtc_free(tmp);
         return 0;
     }
     memcpy(output, tmp+shift, size-shift);
-    free(tmp);
+    ubtc_free(tmp);
     return size-shift;
 }
 
 size_t fromBase58Check(const char * encoded, size_t encodedSize, uint8_t * output, size_t outputSize){
     if(encoded == NULL || output == NULL){ return 0; }
-    uint8_t * arr = (uint8_t *) malloc(outputSize+4);
+    uint8_t * arr = (uint8_t *) ubtc_malloc(outputSize+4);
     if(arr == NULL){ return 0; }
     size_t l = fromBase58(encoded, encodedSize, arr, outputSize+4);
     if(l<4){
-        free(arr);
+        ubtc_free(arr);
         return 0;
     }
 
     uint8_t hash[32];
     doubleSha(arr, l-4, hash);
     if(memcmp(arr+l-4, hash, 4)!=0){
-        free(arr);
+        ubtc_free(arr);
         return 0;
     }
 
     memcpy(output, arr, l-4);
 
     memzero(arr, outputSize+4); // secret should not stay in RAM
-    free(arr);
+    ubtc_free(arr);
     return l-4;
 }
 
@@ -499,7 +500,7 @@ size_t toBase43(const uint8_t * array, size_t arraySize, char * output, size_t o
 
     // array copy for manipulations
     size_t bufferSize = arraySize - zeroCount;
-    uint8_t * buffer = (uint8_t *)calloc(bufferSize, sizeof(uint8_t));
+    uint8_t * buffer = (uint8_t *)ubtc_calloc(bufferSize, sizeof(uint8_t));
     if(buffer == NULL){ return 0; }
     for(size_t i = zeroCount; i < arraySize; i++){
         buffer[i - zeroCount] = array[i];
@@ -515,7 +516,7 @@ size_t toBase43(const uint8_t * array, size_t arraySize, char * output, size_t o
         }
         output[size+zeroCount-j-1] = BASE43_CHARS[reminder];
     }
-    free(buffer);
+    ubtc_free(buffer);
     for (size_t i = 0; i < zeroCount; i++){
         output[i] = BASE43_CHARS[0];
     }
@@ -547,11 +548,11 @@ size_t toBase43(const uint8_t * array, size_t arraySize, char * output, size_t o
 String toBase43(const uint8_t * array, size_t arraySize){
     if(array == NULL){ return String(); }
     size_t l = toBase43Length(array, arraySize);
-    char * output = (char *)calloc(l+1, sizeof(char));
+    char * output = (char *)ubtc_calloc(l+1, sizeof(char));
     if(output == NULL){ return String(); }
     toBase43(array, arraySize, output, l);
     String s(output);
-    free(output);
+    ubtc_free(output);
     return s;
 }
 #endif
@@ -576,7 +577,7 @@ size_t fromBase43(const char * encoded, size_t encodedSize, uint8_t * output, si
     }
     encodedSize = l;
     size_t size = fromBase43Length(encoded, encodedSize);
-    uint8_t * tmp = (uint8_t *) calloc(size, sizeof(uint8_t));
+    uint8_t * tmp = (uint8_t *) ubtc_calloc(size, sizeof(uint8_t));
     if(tmp == NULL){ return 0; }
 
     uint8_t zeroCount = 0;
@@ -600,7 +601,7 @@ size_t fromBase43(const char * encoded, size_t encodedSize, uint8_t * output, si
                 tmp[size-j-1] = cur%256;
             }
         }else{
-            free(tmp);
+            ubtc_free(tmp);
             return 0;
         }
     }
@@ -614,11 +615,11 @@ size_t fromBase43(const char * encoded, size_t encodedSize, uint8_t * output, si
         }
     }
     if(size-shift > outputSize){
-        free(tmp);
+        ubtc_free(tmp);
         return 0;
     }
     memcpy(output, tmp+shift, size-shift);
-    free(tmp);
+    ubtc_free(tmp);
     return size-shift;
 }
 #if (USE_STD_STRING || USE_ARDUINO_STRING)
@@ -698,11 +699,11 @@ size_t toBase64(const uint8_t * array, size_t arraySize, char * output, size_t o
 String toBase64(const uint8_t * array, size_t arraySize, uint8_t flags){
     if(array == NULL){ return String(); }
     size_t len = toBase64Length(array, arraySize, flags) + 1; // +1 for null terminator
-    char * buf = (char *)malloc(len);
+    char * buf = (char *)ubtc_malloc(len);
     if(buf==NULL){ return String(); }
     toBase64(array, arraySize, buf, len, flags);
     String result(buf);
-    free(buf);
+    ubtc_free(buf);
     return result;
 }
 #endif
@@ -789,20 +790,20 @@ size_t fromBase64(String encoded, uint8_t * output, size_t outputSize, uint8_t f
 };
 String base64ToHex(String b64, uint8_t flags){
     size_t len = fromBase64Length(b64.c_str(), strlen(b64.c_str()), flags) + 1; // +1 for null terminator
-    uint8_t * buf = (uint8_t *)malloc(len);
+    uint8_t * buf = (uint8_t *)ubtc_malloc(len);
     if(buf==NULL){ return String(); }
     len = fromBase64(b64, buf, len, flags);
     String result = toHex(buf, len);
-    free(buf);
+    ubtc_free(buf);
     return result;
 };
 String hexToBase64(String hex, uint8_t flags){
     size_t len = strlen(hex.c_str())/2+1; // +1 for null terminator
-    uint8_t * buf = (uint8_t *)malloc(len);
+    uint8_t * buf = (uint8_t *)ubtc_malloc(len);
     if(buf==NULL){ return String(); }
     len = fromHex(hex, buf, len);
     String result = toBase64(buf, len, flags);
-    free(buf);
+    ubtc_free(buf);
     return result;
 };
 #endif
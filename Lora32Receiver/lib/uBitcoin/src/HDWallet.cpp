@@ -497,7 +497,7 @@ HDPrivateKey HDPrivateKey::derive(const char * path) const{
             derivationLen++;
         }
     }
-    uint32_t * derivation = (uint32_t *)calloc(derivationLen, sizeof(uint32_t));
+    uint32_t * derivation = (uint32_t *)ubtc_calloc(derivationLen, sizeof(uint32_t));
     if(derivation == NULL){ return pk; }
     size_t current = 0;
     for(size_t i=0; i<len; i++){
@@ -508,7 +508,7 @@ HDPrivateKey HDPrivateKey::derive(const char * path) const{
         const char * pch = strchr(VALID_CHARS, cur[i]);
         uint32_t val = pch-VALID_CHARS;
         if(derivation[current] >= HARDENED_INDEX){ // can't have anything after hardened
-            free(derivation);
+            ubtc_free(derivation);
             return pk;
         }
         if(val < 10){
@@ -518,7 +518,7 @@ HDPrivateKey HDPrivateKey::derive(const char * path) const{
         }
     }
     pk = derive(derivation, derivationLen);
-    free(derivation);
+    ubtc_free(derivation);
     return pk;
 }
 // ---------------------------------------------------------------- HDPublicKey class
@@ -836,13 +836,13 @@ HDPublicKey HDPublicKey::derive(const char * path) const{
             derivationLen++;
         }
     }
-    uint32_t * derivation = (uint32_t *)calloc(derivationLen, sizeof(uint32_t));
+    uint32_t * derivation = (uint32_t *)ubtc_calloc(derivationLen, sizeof(uint32_t));
     if(derivation == NULL){ return pk; }
     size_t current = 0;
     for(size_t i=0; i<len; i++){
         if(cur[i] == '/'){ // next
             if(derivation[current] >= HARDENED_INDEX){ // can't be hardened
-                free(derivation);
+                ubtc_free(derivation);
                 return pk;
             }
             current++;
@@ -853,7 +853,7 @@ HDPublicKey HDPublicKey::derive(const char * path) const{
         derivation[current] = derivation[current]*10 + val;
     }
     pk = derive(derivation, derivationLen);
-    free(derivation);
+    ubtc_free(derivation);
     return pk;
 }
 
@@ -55,8 +55,25 @@ const Network Regtest = {
     1 // bip32 coin type
 };
 
-// signet is the same as testnet
-const Network Signet = Testnet;
+// signet uses the same prefixes as testnet,
+// spelled out to keep it constant-initialized (a copy of Testnet would run at boot)
+const Network Signet = {
+    0x6F, // p2pkh
+    0xC4, // p2sh
+    "tb", // bech32
+    0xEF, // wif
+    { 0x04, 0x35, 0x83, 0x94 }, // tprv
+    { 0x04, 0x4a, 0x4e, 0x28 }, // uprv
+    { 0x04, 0x5f, 0x18, 0xbc }, // vprv
+    { 0x02, 0x42, 0x85, 0xb5 }, // Uprv
+    { 0x02, 0x57, 0x50, 0x48 }, // Vprv
+    { 0x04, 0x35, 0x87, 0xcf }, // tpub
+    { 0x04, 0x4a, 0x52, 0x62 }, // upub
+    { 0x04, 0x5f, 0x1c, 0xf6 }, // vpub
+    { 0x02, 0x42, 0x89, 0xef }, // Upub
+    { 0x02, 0x57, 0x54, 0x83 }, // Vpub
+    1 // bip32 coin type
+};
 
 const Network * networks[4] = { &Mainnet, &Testnet, &Regtest, &Signet };
 const uint8_t networks_len = 4;
@@ -0,0 +1,286 @@
+#include "Nip44.h"
+#include "Conversion.h"
+#include "utility/trezor/hmac.h"
+#include "utility/trezor/chacha20.h"
+#include "utility/trezor/memzero.h"
+
+size_t nip44_padded_length(size_t len){
+    if(len < NIP44_MIN_PLAINTEXT || len > NIP44_MAX_PLAINTEXT){
+        return 0;
+    }
+    if(len <= 32){
+        return 32;
+    }
+    size_t next_power = 1;
+    while(next_power < len){
+        next_power <<= 1;
+    }
+    size_t chunk = (next_power <= 256) ? 32 : next_power / 8;
+    return chunk * ((len - 1) / chunk + 1);
+}
+
+size_t nip44_payload_length(size_t len){
+    size_t padded = nip44_padded_length(len);
+    if(padded == 0){
+        return 0;
+    }
+    return NIP44_OVERHEAD + padded;
+}
+
+int nip44_conversation_key(PrivateKey &priv, const uint8_t pubkey[32], uint8_t conversation_key[32]){
+    // x-only key is the point with even y
+    uint8_t sec[33];
+    sec[0] = 0x02;
+    memcpy(sec+1, pubkey, 32);
+    PublicKey pub(sec);
+    if(!pub.isValid() || !priv.isValid()){
+        return 0;
+    }
+    uint8_t shared_x[32];
+    priv.ecdh(pub, shared_x, false);
+    ubtc_hmac_sha256((const uint8_t *)"nip44-v2", 8, shared_x, sizeof(shared_x), conversation_key);
+    memzero(shared_x, sizeof(shared_x));
+    return 1;
+}
+
+// HKDF-expand(conversation_key, nonce, 76) split into
+// chacha key (32 bytes), chacha nonce (12 bytes) and hmac key (32 bytes).
+// The key pad is hashed once for all three blocks.
+static void message_keys(const uint8_t conversation_key[32], const uint8_t nonce[32], uint8_t keys[96]){
+    HMAC_SHA256_CTX prk, ctx;
+    ubtc_hmac_sha256_Init(&prk, conversation_key, 32);
+    for(uint8_t i=1; i<=3; i++){
+        ctx = prk;
+        if(i > 1){
+            ubtc_hmac_sha256_Update(&ctx, keys + 32*(i-2), 32);
+        }
+        ubtc_hmac_sha256_Update(&ctx, nonce, 32);
+        ubtc_hmac_sha256_Update(&ctx, &i, 1);
+        ubtc_hmac_sha256_Final(&ctx, keys + 32*(i-1));
+    }
+    memzero(&prk, sizeof(prk));
+}
+
+// hmac over nonce and ciphertext
+static void message_mac(const uint8_t hmac_key[32], const uint8_t nonce[32], const uint8_t * ciphertext, size_t len, uint8_t mac[32]){
+    HMAC_SHA256_CTX ctx;
+    ubtc_hmac_sha256_Init(&ctx, hmac_key, 32);
+    ubtc_hmac_sha256_Update(&ctx, nonce, 32);
+    ubtc_hmac_sha256_Update(&ctx, ciphertext, len);
+    ubtc_hmac_sha256_Final(&ctx, mac);
+}
+
+size_t nip44_encrypt(const uint8_t conversation_key[32], const uint8_t nonce[32],
+                     const uint8_t * plaintext, size_t len,
+                     uint8_t * payload, size_t payloadSize){
+    size_t padded = nip44_padded_length(len);
+    if(padded == 0 || plaintext == NULL || payload == NULL){
+        return 0;
+    }
+    size_t total = NIP44_OVERHEAD + padded;
+    if(payloadSize < total){
+        return 0;
+    }
+    // version || nonce || chacha20(len_be16 || plaintext || zeros) || mac
+    payload[0] = NIP44_VERSION;
+    memcpy(payload+1, nonce, 32);
+    uint8_t * ciphertext = payload + 33;
+    ciphertext[0] = (len >> 8) & 0xFF;
+    ciphertext[1] = len & 0xFF;
+    memmove(ciphertext+2, plaintext, len);
+    memset(ciphertext+2+len, 0, padded-len);
+
+    uint8_t keys[96];
+    message_keys(conversation_key, nonce, keys);
+    chacha20_ctx ctx;
+    chacha20_init(&ctx, keys, keys+32, 0);
+    chacha20_xor(&ctx, ciphertext, ciphertext, padded+2);
+    message_mac(keys+44, nonce, ciphertext, padded+2, ciphertext+padded+2);
+
+    memzero(keys, sizeof(keys));
+    memzero(&ctx, sizeof(ctx));
+    return total;
+}
+
+size_t nip44_decrypt(const uint8_t conversation_key[32],
+                     const uint8_t * payload, size_t payloadLen,
+                     uint8_t * plaintext, size_t plaintextSize){
+    if(payload == NULL || plaintext == NULL){
+        return 0;
+    }
+    if(payloadLen < NIP44_OVERHEAD + 32 || payloadLen > NIP44_OVERHEAD + NIP44_MAX_PLAINTEXT + 1){
+        return 0;
+    }
+    if(payload[0] != NIP44_VERSION){
+        return 0;
+    }
+    const uint8_t * nonce = payload + 1;
+    const uint8_t * ciphertext = payload + 33;
+    size_t len = payloadLen - 1 - 32 - 32; // length prefix and padded plaintext
+    if(plaintextSize < len - 2){
+        return 0;
+    }
+
+    uint8_t keys[96];
+    uint8_t mac[32];
+    message_keys(conversation_key, nonce, keys);
+    message_mac(keys+44, nonce, ciphertext, len, mac);
+    uint8_t diff = 0;
+    for(size_t i=0; i<32; i++){ // constant time
+        diff |= mac[i] ^ ciphertext[len+i];
+    }
+    if(diff != 0){
+        memzero(keys, sizeof(keys));
+        return 0;
+    }
+
+    // decrypt the length prefix and the padded plaintext straight into the output
+    chacha20_ctx ctx;
+    uint8_t block[64];
+    uint8_t prefix[2];
+    chacha20_init(&ctx, keys, keys+32, 0);
+    for(size_t off=0; off<len; off+=64){
+        chacha20_block(&ctx, block);
+        for(size_t i=0; i<64 && off+i<len; i++){
+            uint8_t b = ciphertext[off+i] ^ block[i];
+            if(off+i < 2){
+                prefix[off+i] = b;
+            }else{
+                plaintext[off+i-2] = b;
+            }
+        }
+    }
+    memzero(keys, sizeof(keys));
+    memzero(&ctx, sizeof(ctx));
+    memzero(block, sizeof(block));
+
+    size_t unpadded = ((size_t)prefix[0] << 8) | prefix[1];
+    if(unpadded == 0 || nip44_padded_length(unpadded) != len - 2){
+        memzero(plaintext, len - 2);
+        return 0;
+    }
+    return unpadded;
+}
+
+Nip44::Nip44(){
+    clear();
+}
+Nip44::Nip44(const PrivateKey &pk){
+    setKey(pk);
+}
+Nip44::~Nip44(){
+    clear();
+}
+void Nip44::setKey(const PrivateKey &pk){
+    key = pk;
+    clear();
+}
+void Nip44::clear(){
+    memzero(cache, sizeof(cache));
+    clock = 0;
+    hit = 0;
+    miss = 0;
+}
+
+uint32_t Nip44::tick(){
+    clock++;
+    if(clock == 0){ // wrapped around, forget the order but keep the keys
+        for(size_t i=0; i<UBTC_NIP44_CACHE_SIZE; i++){
+            if(cache[i].used){
+                cache[i].used = 1;
+            }
+        }
+        clock = 2;
+    }
+    return clock;
+}
+
+int Nip44::conversationKey(const uint8_t peer[32], uint8_t conversation_key[32]){
+    size_t oldest = 0;
+    for(size_t i=0; i<UBTC_NIP44_CACHE_SIZE; i++){
+        if(cache[i].used && memcmp(cache[i].peer, peer, 32) == 0){
+            cache[i].used = tick();
+            hit++;
+            memcpy(conversation_key, cache[i].key, 32);
+            return 1;
+        }
+        if(cache[i].used < cache[oldest].used){
+            oldest = i;
+        }
+    }
+    miss++;
+    if(!nip44_conversation_key(key, peer, conversation_key)){
+        return 0;
+    }
+    memcpy(cache[oldest].peer, peer, 32);
+    memcpy(cache[oldest].key, conversation_key, 32);
+    cache[oldest].used = tick();
+    return 1;
+}
+
+size_t Nip44::encrypt(const uint8_t peer[32], const uint8_t nonce[32], const uint8_t * plaintext, size_t len, uint8_t * payload, size_t payloadSize){
+    uint8_t conversation_key[32];
+    if(!conversationKey(peer, conversation_key)){
+        return 0;
+    }
+    size_t res = nip44_encrypt(conversation_key, nonce, plaintext, len, payload, payloadSize);
+    memzero(conversation_key, sizeof(conversation_key));
+    return res;
+}
+
+size_t Nip44::encrypt(const uint8_t peer[32], const uint8_t * plaintext, size_t len, uint8_t * payload, size_t payloadSize){
+    uint8_t nonce[32];
+    random_buffer(nonce, sizeof(nonce));
+    return encrypt(peer, nonce, plaintext, len, payload, payloadSize);
+}
+
+size_t Nip44::decrypt(const uint8_t peer[32], const uint8_t * payload, size_t payloadLen, uint8_t * plaintext, size_t plaintextSize){
+    uint8_t conversation_key[32];
+    if(!conversationKey(peer, conversation_key)){
+        return 0;
+    }
+    size_t res = nip44_decrypt(conversation_key, payload, payloadLen, plaintext, plaintextSize);
+    memzero(conversation_key, sizeof(conversation_key));
+    return res;
+}
+
+size_t Nip44::encryptBase64(const uint8_t peer[32], const uint8_t * plaintext, size_t len, char * payload, size_t payloadSize){
+    size_t binLen = nip44_payload_length(len);
+    if(binLen == 0 || payload == NULL){
+        return 0;
+    }
+    uint8_t * bin = (uint8_t *)ubtc_malloc(binLen);
+    if(bin == NULL){
+        return 0;
+    }
+    size_t res = 0;
+    if(encrypt(peer, plaintext, len, bin, binLen) == binLen){
+        // leave room for the terminating zero
+        if(payloadSize > toBase64Length(bin, binLen)){
+            res = toBase64(bin, binLen, payload, payloadSize);
+        }
+    }
+    ubtc_free(bin);
+    return res;
+}
+
+size_t Nip44::decryptBase64(const uint8_t peer[32], const char * payload, size_t payloadLen, uint8_t * plaintext, size_t plaintextSize){
+    if(payload == NULL){
+        return 0;
+    }
+    size_t binLen = fromBase64Length(payload, payloadLen);
+    if(binLen < NIP44_OVERHEAD + 32){
+        return 0;
+    }
+    uint8_t * bin = (uint8_t *)ubtc_malloc(binLen);
+    if(bin == NULL){
+        return 0;
+    }
+    size_t res = 0;
+    binLen = fromBase64(payload, payloadLen, bin, binLen);
+    if(binLen > 0){
+        res = decrypt(peer, bin, binLen, plaintext, plaintextSize);
+    }
+    ubtc_free(bin);
+    return res;
+}
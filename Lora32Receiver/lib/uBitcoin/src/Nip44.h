@@ -0,0 +1,88 @@
+/** @file Nip44.h
+ *  \brief NIP-44 (version 2) encryption of nostr payloads, ChaCha20 + HMAC-SHA256
+ */
+#ifndef __NIP44_H__
+#define __NIP44_H__
+
+#include "uBitcoin_conf.h"
+#include "Bitcoin.h"
+#include <stdint.h>
+#include <string.h>
+
+#define NIP44_VERSION        2
+#define NIP44_MIN_PLAINTEXT  1
+#define NIP44_MAX_PLAINTEXT  65535
+/** \brief version byte, 32-byte nonce, 2-byte length prefix of the padded plaintext and 32-byte mac */
+#define NIP44_OVERHEAD       (1 + 32 + 2 + 32)
+
+/** \brief Length of the plaintext after padding, 0 if len is out of range */
+size_t nip44_padded_length(size_t len);
+/** \brief Length of the binary payload for len bytes of plaintext, 0 if len is out of range */
+size_t nip44_payload_length(size_t len);
+/** \brief Conversation key of priv and the x-only public key of the peer:
+ *         HKDF-extract(salt="nip44-v2", ecdh x coordinate). Returns 0 for an invalid key.
+ */
+int nip44_conversation_key(PrivateKey &priv, const uint8_t pubkey[32], uint8_t conversation_key[32]);
+/** \brief Encrypts plaintext with a 32-byte nonce into a binary payload,
+ *         returns the payload length or 0 if it doesn't fit.
+ *         The nonce must never repeat for the same conversation key, pass random bytes.
+ */
+size_t nip44_encrypt(const uint8_t conversation_key[32], const uint8_t nonce[32],
+                     const uint8_t * plaintext, size_t len,
+                     uint8_t * payload, size_t payloadSize);
+/** \brief Checks the mac and decrypts a binary payload,
+ *         returns the plaintext length or 0 if the payload is invalid or doesn't fit.
+ *         plaintext should have room for the padded plaintext: payloadLen - NIP44_OVERHEAD bytes.
+ */
+size_t nip44_decrypt(const uint8_t conversation_key[32],
+                     const uint8_t * payload, size_t payloadLen,
+                     uint8_t * plaintext, size_t plaintextSize);
+
+/**
+ *  Nip44 class.
+ *
+ *  Encrypts and decrypts NIP-44 payloads between our key and nostr peers.
+ *  A conversation key costs an ecdh, the keys of the last UBTC_NIP44_CACHE_SIZE
+ *  peers are kept so a known peer costs only ChaCha20 and HMAC-SHA256.
+ *  Payloads are binary (as sent over LoRa), the Base64 methods produce
+ *  the content of a nostr event and use ubtc_malloc for the binary payload.
+ */
+class Nip44{
+    typedef struct{
+        uint8_t peer[32]; // x-only public key
+        uint8_t key[32];  // conversation key
+        uint32_t used;    // last access, 0 for empty entry
+    } entry;
+    PrivateKey key;
+    entry cache[UBTC_NIP44_CACHE_SIZE];
+    uint32_t clock;
+    size_t hit;
+    size_t miss;
+    uint32_t tick();
+public:
+    Nip44();
+    explicit Nip44(const PrivateKey &pk);
+    ~Nip44();
+    /** \brief Sets our key and forgets all conversation keys */
+    void setKey(const PrivateKey &pk);
+    /** \brief Forgets all conversation keys */
+    void clear();
+    size_t hits() const{ return hit; };
+    size_t misses() const{ return miss; };
+    /** \brief Conversation key with peer, from the cache if possible. Returns 0 for an invalid peer */
+    int conversationKey(const uint8_t peer[32], uint8_t conversation_key[32]);
+
+    /** \brief Encrypts to peer with a random nonce, returns the payload length or 0 */
+    size_t encrypt(const uint8_t peer[32], const uint8_t * plaintext, size_t len, uint8_t * payload, size_t payloadSize);
+    /** \brief Encrypts to peer with the given nonce, for tests only */
+    size_t encrypt(const uint8_t peer[32], const uint8_t nonce[32], const uint8_t * plaintext, size_t len, uint8_t * payload, size_t payloadSize);
+    /** \brief Decrypts a payload from peer, returns the plaintext length or 0 */
+    size_t decrypt(const uint8_t peer[32], const uint8_t * payload, size_t payloadLen, uint8_t * plaintext, size_t plaintextSize);
+
+    /** \brief Encrypts to peer into a null-terminated base64 string, returns its length or 0 */
+    size_t encryptBase64(const uint8_t peer[32], const uint8_t * plaintext, size_t len, char * payload, size_t payloadSize);
+    /** \brief Decrypts a base64 payload from peer, returns the plaintext length or 0 */
+    size_t decryptBase64(const uint8_t peer[32], const char * payload, size_t payloadLen, uint8_t * plaintext, size_t plaintextSize);
+};
+
+#endif // __NIP44_H__
@@ -90,36 +90,7 @@ size_t PSBT::from_stream(ParseStream *s){
         return 0;
     }
     if(status == PARSING_DONE){
-        // free memory
-        if(tx.inputsNumber > 0){
-            for(size_t i=0; i<tx.inputsNumber; i++){
-                if(txInsMeta[i].derivationsLen > 0){
-                    for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
-                        if(txInsMeta[i].derivations[j].derivationLen > 0){
-                            free(txInsMeta[i].derivations[j].derivation);
-                        }
-                    }
-                    delete [] txInsMeta[i].derivations;
-                }
-                if(txInsMeta[i].signaturesLen > 0){
-                    delete [] txInsMeta[i].signatures;
-                }
-            }
-            delete [] txInsMeta;
-        }
-        if(tx.outputsNumber > 0){
-            for(size_t i=0; i<tx.outputsNumber; i++){
-                if(txOutsMeta[i].derivationsLen > 0){
-                    for(size_t j=0; j<txOutsMeta[i].derivationsLen; j++){
-                        if(txOutsMeta[i].derivations[j].derivationLen > 0){
-                            free(txOutsMeta[i].derivations[j].derivation);
-                        }
-                    }
-                    delete [] txOutsMeta[i].derivations;
-                }
-            }
-            delete [] txOutsMeta;
-        }
+        clearMeta();
         tx.reset();
         bytes_parsed = 0;
         current_section = 0;
@@ -162,19 +133,19 @@ size_t PSBT::from_stream(ParseStream *s){
         return bytes_read;
     }
     if(last_key_pos == 5 && value.getStatus() == PARSING_DONE && key.getStatus() == PARSING_DONE){
-        uint8_t * arr = (uint8_t *)calloc(key.length(), sizeof(uint8_t));
+        uint8_t * arr = (uint8_t *)ubtc_calloc(key.length(), sizeof(uint8_t));
         if(arr == NULL){ status = PARSING_FAILED; return 0; }
         key.serialize(arr, key.length());
         if(key.length() != 2 || arr[0] != 1 || arr[1] != 0){
             status = PARSING_FAILED;
             ubtc_errno = UBTC_ERR_PSBT_SCOPE;
         }
-        free(arr);
+        ubtc_free(arr);
         if(status == PARSING_FAILED){
             bytes_parsed += bytes_read;
             return bytes_read;
         }
-        arr = (uint8_t *)calloc(value.length(), sizeof(uint8_t));
+        arr = (uint8_t *)ubtc_calloc(value.length(), sizeof(uint8_t));
         if(arr == NULL){ status = PARSING_FAILED; return 0; }
         value.serialize(arr, value.length());
         size_t l = lenVarInt(value.length());
@@ -182,17 +153,22 @@ size_t PSBT::from_stream(ParseStream *s){
         if(tx.getStatus() != PARSING_DONE){
             status = PARSING_FAILED;
         }
-        free(arr);
+        ubtc_free(arr);
         if(status == PARSING_FAILED){
             bytes_parsed += bytes_read;
             return bytes_read;
         }
-        txInsMeta = new PSBTInputMetadata[tx.inputsNumber];
+        txInsMeta = ubtc_new_array<PSBTInputMetadata>(tx.inputsNumber);
+        txOutsMeta = ubtc_new_array<PSBTOutputMetadata>(tx.outputsNumber);
+        if((txInsMeta == NULL && tx.inputsNumber > 0) || (txOutsMeta == NULL && tx.outputsNumber > 0)){
+            status = PARSING_FAILED;
+            bytes_parsed += bytes_read;
+            return bytes_read;
+        }
         for(size_t i=0; i<tx.inputsNumber; i++){
             txInsMeta[i].derivationsLen = 0;
             txInsMeta[i].signaturesLen = 0;
         }
-        txOutsMeta = new PSBTOutputMetadata[tx.outputsNumber];
         for(size_t i=0; i<tx.outputsNumber; i++){
             txOutsMeta[i].derivationsLen = 0;
         }
@@ -252,11 +228,11 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
     if(section == 0 || section > 1+tx.inputsNumber+tx.outputsNumber){
         return 0;
     }
-    uint8_t * key_arr = (uint8_t *)calloc(k->length(), sizeof(uint8_t));
+    uint8_t * key_arr = (uint8_t *)ubtc_calloc(k->length(), sizeof(uint8_t));
     if(key_arr == NULL){ return 0; }
     k->serialize(key_arr, k->length());
-    uint8_t * val_arr = (uint8_t *)calloc(v->length(), sizeof(uint8_t));
-    if(val_arr == NULL){ free(key_arr); return 0; }
+    uint8_t * val_arr = (uint8_t *)ubtc_calloc(v->length(), sizeof(uint8_t));
+    if(val_arr == NULL){ ubtc_free(key_arr); return 0; }
     v->serialize(val_arr, v->length());
     uint8_t key_code = key_arr[lenVarInt(k->length())];
     int res = 0;
@@ -320,18 +296,14 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
                     res = -2;
                     break;
                 }
-                if(txInsMeta[input].signaturesLen == 0){
-                    txInsMeta[input].signaturesLen = 1;
-                    txInsMeta[input].signatures = new PSBTPartialSignature[txInsMeta[input].signaturesLen];
-                }else{
-                    PSBTPartialSignature * p = txInsMeta[input].signatures;
-                    txInsMeta[input].signatures = new PSBTPartialSignature[txInsMeta[input].signaturesLen+1];
-                    for(size_t i=0; i<txInsMeta[input].signaturesLen; i++){
-                        txInsMeta[input].signatures[i] = p[i];
-                    }
-                    txInsMeta[input].signaturesLen++;
-                    delete [] p;
+                PSBTPartialSignature * p = ubtc_new_array<PSBTPartialSignature>(txInsMeta[input].signaturesLen+1);
+                if(p == NULL){ res = -1; break; }
+                for(size_t i=0; i<txInsMeta[input].signaturesLen; i++){
+                    p[i] = txInsMeta[input].signatures[i];
                 }
+                ubtc_delete_array(txInsMeta[input].signatures);
+                txInsMeta[input].signatures = p;
+                txInsMeta[input].signaturesLen++;
                 txInsMeta[input].signatures[txInsMeta[input].signaturesLen-1] = psig;
                 res = 1;
                 break;
@@ -364,18 +336,14 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
                     res = -1;
                     break;
                 }
-                if(txInsMeta[input].derivationsLen == 0){
-                    txInsMeta[input].derivationsLen = 1;
-                    txInsMeta[input].derivations = new PSBTDerivation[txInsMeta[input].derivationsLen];
-                }else{
-                    PSBTDerivation * p = txInsMeta[input].derivations;
-                    txInsMeta[input].derivations = new PSBTDerivation[txInsMeta[input].derivationsLen+1];
-                    for(size_t i=0; i<txInsMeta[input].derivationsLen; i++){
-                        txInsMeta[input].derivations[i] = p[i];
-                    }
-                    txInsMeta[input].derivationsLen++;
-                    delete [] p;
+                PSBTDerivation * p = ubtc_new_array<PSBTDerivation>(txInsMeta[input].derivationsLen+1);
+                if(p == NULL){ res = -1; break; }
+                for(size_t i=0; i<txInsMeta[input].derivationsLen; i++){
+                    p[i] = txInsMeta[input].derivations[i];
                 }
+                ubtc_delete_array(txInsMeta[input].derivations);
+                txInsMeta[input].derivations = p;
+                txInsMeta[input].derivationsLen++;
                 PSBTDerivation * der = &txInsMeta[input].derivations[txInsMeta[input].derivationsLen-1];
                 der->pubkey.parse(key_arr+2, k->length()-2);
                 if(der->pubkey.getStatus() != PARSING_DONE){
@@ -384,7 +352,7 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
                 }
                 memcpy(der->fingerprint, val_arr+lenVarInt(v->length()), 4);
                 der->derivationLen = (v->length()-lenVarInt(v->length())-4)/sizeof(uint32_t);
-                der->derivation = (uint32_t *)calloc(der->derivationLen, sizeof(uint32_t));
+                der->derivation = (uint32_t *)ubtc_calloc(der->derivationLen, sizeof(uint32_t));
                 if(der->derivation == NULL){ der->derivationLen = 0; res = -1; break; }
                 for(size_t i=0; i<der->derivationLen; i++){
                     der->derivation[i] = littleEndianToInt(val_arr+lenVarInt(v->length())+4*(i+1),4);
@@ -426,18 +394,14 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
                     res = -1;
                     break;
                 }
-                if(txOutsMeta[output].derivationsLen == 0){
-                    txOutsMeta[output].derivationsLen = 1;
-                    txOutsMeta[output].derivations = new PSBTDerivation[txOutsMeta[output].derivationsLen];
-                }else{
-                    PSBTDerivation * p = txOutsMeta[output].derivations;
-                    txOutsMeta[output].derivations = new PSBTDerivation[txOutsMeta[output].derivationsLen+1];
-                    for(int i=0; i<txOutsMeta[output].derivationsLen; i++){
-                        txOutsMeta[output].derivations[i] = p[i];
-                    }
-                    txOutsMeta[output].derivationsLen++;
-                    delete [] p;
+                PSBTDerivation * p = ubtc_new_array<PSBTDerivation>(txOutsMeta[output].derivationsLen+1);
+                if(p == NULL){ res = -1; break; }
+                for(int i=0; i<txOutsMeta[output].derivationsLen; i++){
+                    p[i] = txOutsMeta[output].derivations[i];
                 }
+                ubtc_delete_array(txOutsMeta[output].derivations);
+                txOutsMeta[output].derivations = p;
+                txOutsMeta[output].derivationsLen++;
                 PSBTDerivation * der = &txOutsMeta[output].derivations[txOutsMeta[output].derivationsLen-1];
                 der->pubkey.parse(key_arr+2, k->length()-2);
                 if(der->pubkey.getStatus() != PARSING_DONE){
@@ -446,7 +410,7 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
                 }
                 memcpy(der->fingerprint, val_arr+lenVarInt(v->length()), 4);
                 der->derivationLen = (v->length()-lenVarInt(v->length())-4)/sizeof(uint32_t);
-                der->derivation = (uint32_t *)calloc(der->derivationLen, sizeof(uint32_t));
+                der->derivation = (uint32_t *)ubtc_calloc(der->derivationLen, sizeof(uint32_t));
                 if(der->derivation == NULL){ der->derivationLen = 0; res = -1; break; }
                 for(size_t i=0; i<der->derivationLen; i++){
                     der->derivation[i] = littleEndianToInt(val_arr+lenVarInt(v->length())+4*(i+1),4);
@@ -456,8 +420,9 @@ int PSBT::add(uint8_t section, const Script * k, const Script * v){
             }
         }
     }
-    free(key_arr);
-    free(val_arr);
+    // reverse order so a bound arena can reclaim both scratch buffers
+    ubtc_free(val_arr);
+    ubtc_free(key_arr);
     return res; // by default - ignore the key-value pair
 }
 
@@ -532,31 +497,56 @@ PSBT::PSBT(PSBT const &other){
     txInsMeta = NULL; txOutsMeta = NULL; status = PARSING_DONE; current_section = 0; last_key_pos = 0;
     tx = other.tx;
     status = other.status;
-    txInsMeta = new PSBTInputMetadata[tx.inputsNumber];
-    txOutsMeta = new PSBTOutputMetadata[tx.outputsNumber];
+    txInsMeta = ubtc_new_array<PSBTInputMetadata>(tx.inputsNumber);
+    txOutsMeta = ubtc_new_array<PSBTOutputMetadata>(tx.outputsNumber);
+    if((txInsMeta == NULL && tx.inputsNumber > 0) || (txOutsMeta == NULL && tx.outputsNumber > 0)){
+        clearMeta();
+        status = PARSING_FAILED;
+        return;
+    }
     for(size_t i=0; i<tx.inputsNumber; i++){
         txInsMeta[i] = other.txInsMeta[i];
-        txInsMeta[i].derivations = new PSBTDerivation[txInsMeta[i].derivationsLen];
+        txInsMeta[i].derivations = ubtc_new_array<PSBTDerivation>(txInsMeta[i].derivationsLen);
+        if(txInsMeta[i].derivations == NULL && txInsMeta[i].derivationsLen > 0){
+            // signatures still point to other's array
+            txInsMeta[i].derivationsLen = 0;
+            txInsMeta[i].signaturesLen = 0;
+            clearMeta();
+            status = PARSING_FAILED;
+            return;
+        }
         for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
             txInsMeta[i].derivations[j] = other.txInsMeta[i].derivations[j];
-            txInsMeta[i].derivations[j].derivation = (uint32_t *)calloc(txInsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
+            txInsMeta[i].derivations[j].derivation = (uint32_t *)ubtc_calloc(txInsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
             if(txInsMeta[i].derivations[j].derivation == NULL){
                 txInsMeta[i].derivations[j].derivationLen = 0;
             }else{
                 memcpy(txInsMeta[i].derivations[j].derivation, other.txInsMeta[i].derivations[j].derivation, txInsMeta[i].derivations[j].derivationLen*sizeof(uint32_t));
             }
         }
-        txInsMeta[i].signatures = new PSBTPartialSignature[txInsMeta[i].signaturesLen];
+        txInsMeta[i].signatures = ubtc_new_array<PSBTPartialSignature>(txInsMeta[i].signaturesLen);
+        if(txInsMeta[i].signatures == NULL && txInsMeta[i].signaturesLen > 0){
+            txInsMeta[i].signaturesLen = 0;
+            clearMeta();
+            status = PARSING_FAILED;
+            return;
+        }
         for(size_t j=0; j<txInsMeta[i].signaturesLen; j++){
             txInsMeta[i].signatures[j] = other.txInsMeta[i].signatures[j];
         }
     }
     for(size_t i=0; i<tx.outputsNumber; i++){
         txOutsMeta[i] = other.txOutsMeta[i];
-        txOutsMeta[i].derivations = new PSBTDerivation[txOutsMeta[i].derivationsLen];
+        txOutsMeta[i].derivations = ubtc_new_array<PSBTDerivation>(txOutsMeta[i].derivationsLen);
+        if(txOutsMeta[i].derivations == NULL && txOutsMeta[i].derivationsLen > 0){
+            txOutsMeta[i].derivationsLen = 0;
+            clearMeta();
+            status = PARSING_FAILED;
+            return;
+        }
         for(size_t j=0; j<txOutsMeta[i].derivationsLen; j++){
             txOutsMeta[i].derivations[j] = other.txOutsMeta[i].derivations[j];
-            txOutsMeta[i].derivations[j].derivation = (uint32_t *)calloc(txOutsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
+            txOutsMeta[i].derivations[j].derivation = (uint32_t *)ubtc_calloc(txOutsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
             if(txOutsMeta[i].derivations[j].derivation == NULL){
                 txOutsMeta[i].derivations[j].derivationLen = 0;
             }else{
@@ -566,37 +556,42 @@ PSBT::PSBT(PSBT const &other){
     }
 }
 
-PSBT::~PSBT(){
-    // free memory
-    if(tx.inputsNumber > 0){
+void PSBT::clearMeta(){
+    if(tx.inputsNumber > 0 && txInsMeta != NULL){
         for(size_t i=0; i<tx.inputsNumber; i++){
             if(txInsMeta[i].derivationsLen > 0){
                 for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
                     if(txInsMeta[i].derivations[j].derivationLen > 0){
-                        free(txInsMeta[i].derivations[j].derivation);
+                        ubtc_free(txInsMeta[i].derivations[j].derivation);
                     }
                 }
-                delete [] txInsMeta[i].derivations;
+                ubtc_delete_array(txInsMeta[i].derivations);
             }
             if(txInsMeta[i].signaturesLen > 0){
-                delete [] txInsMeta[i].signatures;
+                ubtc_delete_array(txInsMeta[i].signatures);
             }
         }
-        delete [] txInsMeta;
+        ubtc_delete_array(txInsMeta);
     }
-    if(tx.outputsNumber > 0){
+    if(tx.outputsNumber > 0 && txOutsMeta != NULL){
         for(size_t i=0; i<tx.outputsNumber; i++){
             if(txOutsMeta[i].derivationsLen > 0){
                 for(size_t j=0; j<txOutsMeta[i].derivationsLen; j++){
                     if(txOutsMeta[i].derivations[j].derivationLen > 0){
-                        free(txOutsMeta[i].derivations[j].derivation);
+                        ubtc_free(txOutsMeta[i].derivations[j].derivation);
                     }
                 }
-                delete [] txOutsMeta[i].derivations;
+                ubtc_delete_array(txOutsMeta[i].derivations);
             }
         }
-        delete [] txOutsMeta;
+        ubtc_delete_array(txOutsMeta);
     }
+    txInsMeta = NULL;
+    txOutsMeta = NULL;
+}
+
+PSBT::~PSBT(){
+    clearMeta();
 }
 
 uint8_t PSBT::sign(const HDPrivateKey root){
@@ -739,48 +734,33 @@ bool PSBT::isMine(uint8_t outputNumber, const HDPrivateKey xprv) const{
 
 PSBT& PSBT::operator=(PSBT const &other){
     if (this == &other){ return *this; } // self-assignment
-    // free memory
-    if(tx.inputsNumber > 0){
-        for(size_t i=0; i<tx.inputsNumber; i++){
-            if(txInsMeta[i].derivationsLen > 0){
-                for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
-                    if(txInsMeta[i].derivations[j].derivationLen > 0){
-                        free(txInsMeta[i].derivations[j].derivation);
-                    }
-                }
-                delete [] txInsMeta[i].derivations;
-            }
-            if(txInsMeta[i].signaturesLen > 0){
-                delete [] txInsMeta[i].signatures;
-            }
-        }
-        delete [] txInsMeta;
-    }
-    if(tx.outputsNumber > 0){
-        for(size_t i=0; i<tx.outputsNumber; i++){
-            if(txOutsMeta[i].derivationsLen > 0){
-                for(size_t j=0; j<txOutsMeta[i].derivationsLen; j++){
-                    if(txOutsMeta[i].derivations[j].derivationLen > 0){
-                        free(txOutsMeta[i].derivations[j].derivation);
-                    }
-                }
-                delete [] txOutsMeta[i].derivations;
-            }
-        }
-        delete [] txOutsMeta;
-    }
+    clearMeta();
     // copy
     tx = other.tx;
     status = other.status;
+    txInsMeta = ubtc_new_array<PSBTInputMetadata>(tx.inputsNumber);
+    txOutsMeta = ubtc_new_array<PSBTOutputMetadata>(tx.outputsNumber);
+    if((txInsMeta == NULL && tx.inputsNumber > 0) || (txOutsMeta == NULL && tx.outputsNumber > 0)){
+        clearMeta();
+        status = PARSING_FAILED;
+        return *this;
+    }
     if(tx.inputsNumber > 0){
-        txInsMeta = new PSBTInputMetadata[tx.inputsNumber];
         for(size_t i=0; i<tx.inputsNumber; i++){
             txInsMeta[i] = other.txInsMeta[i];
             if(txInsMeta[i].derivationsLen > 0){
-                txInsMeta[i].derivations = new PSBTDerivation[txInsMeta[i].derivationsLen];
+                txInsMeta[i].derivations = ubtc_new_array<PSBTDerivation>(txInsMeta[i].derivationsLen);
+                if(txInsMeta[i].derivations == NULL){
+                    // signatures still point to other's array
+                    txInsMeta[i].derivationsLen = 0;
+                    txInsMeta[i].signaturesLen = 0;
+                    clearMeta();
+                    status = PARSING_FAILED;
+                    return *this;
+                }
                 for(size_t j=0; j<txInsMeta[i].derivationsLen; j++){
                     txInsMeta[i].derivations[j] = other.txInsMeta[i].derivations[j];
-                    txInsMeta[i].derivations[j].derivation = (uint32_t*)calloc(txInsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
+                    txInsMeta[i].derivations[j].derivation = (uint32_t*)ubtc_calloc(txInsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
                     if(txInsMeta[i].derivations[j].derivation == NULL){
                         txInsMeta[i].derivations[j].derivationLen = 0;
                     }else{
@@ -789,7 +769,13 @@ PSBT& PSBT::operator=(PSBT const &other){
                 }
             }
             if(txInsMeta[i].signaturesLen > 0){
-                txInsMeta[i].signatures = new PSBTPartialSignature[txInsMeta[i].signaturesLen];
+                txInsMeta[i].signatures = ubtc_new_array<PSBTPartialSignature>(txInsMeta[i].signaturesLen);
+                if(txInsMeta[i].signatures == NULL){
+                    txInsMeta[i].signaturesLen = 0;
+                    clearMeta();
+                    status = PARSING_FAILED;
+                    return *this;
+                }
                 for(size_t j=0; j<txInsMeta[i].signaturesLen; j++){
                     txInsMeta[i].signatures[j] = other.txInsMeta[i].signatures[j];
                 }
@@ -797,13 +783,18 @@ PSBT& PSBT::operator=(PSBT const &other){
         }
     }
     if(tx.outputsNumber > 0){
-        txOutsMeta = new PSBTOutputMetadata[tx.outputsNumber];
         for(size_t i=0; i<tx.outputsNumber; i++){
             txOutsMeta[i] = other.txOutsMeta[i];
-            txOutsMeta[i].derivations = new PSBTDerivation[txOutsMeta[i].derivationsLen];
+            txOutsMeta[i].derivations = ubtc_new_array<PSBTDerivation>(txOutsMeta[i].derivationsLen);
+            if(txOutsMeta[i].derivations == NULL && txOutsMeta[i].derivationsLen > 0){
+                txOutsMeta[i].derivationsLen = 0;
+                clearMeta();
+                status = PARSING_FAILED;
+                return *this;
+            }
             for(size_t j=0; j<txOutsMeta[i].derivationsLen; j++){
                 txOutsMeta[i].derivations[j] = other.txOutsMeta[i].derivations[j];
-                txOutsMeta[i].derivations[j].derivation = (uint32_t *)calloc(txOutsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
+                txOutsMeta[i].derivations[j].derivation = (uint32_t *)ubtc_calloc(txOutsMeta[i].derivations[j].derivationLen, sizeof(uint32_t));
                 if(txOutsMeta[i].derivations[j].derivation == NULL){
                     txOutsMeta[i].derivations[j].derivationLen = 0;
                 }else{
@@ -9,7 +9,11 @@ using std::string;
 #define String string
 #endif
 
+#if UBTC_NO_HEAP
+#define MAX_SCRIPT_SIZE UBTC_MAX_SCRIPT_LEN
+#else
 #define MAX_SCRIPT_SIZE 10000
+#endif
 
 //------------------------------------------------------------ Script-generating functions
 
@@ -163,7 +167,7 @@ void Script::fromAddress(const char * address){
             return;
         }
         scriptLen = prog_len + 2;
-        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return; }
         scriptArray[0] = ver;
         scriptArray[1] = prog_len; // varint?
@@ -187,7 +191,7 @@ void Script::fromAddress(const char * address){
         }
         if(type == P2PKH){
             scriptLen = 25;
-            scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+            scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
             if(scriptArray == NULL){ scriptLen = 0; return; }
             scriptArray[0] = OP_DUP;
             scriptArray[1] = OP_HASH160;
@@ -198,7 +202,7 @@ void Script::fromAddress(const char * address){
         }
         if(type == P2SH){
             scriptLen = 23;
-            scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+            scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
             if(scriptArray == NULL){ scriptLen = 0; return; }
             scriptArray[0] = OP_HASH160;
             scriptArray[1] = 20;
@@ -211,7 +215,7 @@ Script::Script(const PublicKey pubkey, ScriptType type){
     init();
     if(type == P2PKH){
         scriptLen = 25;
-        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return; }
         scriptArray[0] = OP_DUP;
         scriptArray[1] = OP_HASH160;
@@ -224,7 +228,7 @@ Script::Script(const PublicKey pubkey, ScriptType type){
     }
     if(type == P2WPKH){
         scriptLen = 22;
-        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return; }
         scriptArray[0] = 0x00;
         scriptArray[1] = 20;
@@ -237,7 +241,7 @@ Script::Script(const Script &other, ScriptType type){
     init();
     if(type == P2SH){
         scriptLen = 23;
-        scriptArray = (uint8_t *) calloc(scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc(scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return; }
         hash160(other.scriptArray, other.scriptLen, scriptArray+2);
         scriptArray[0] = OP_HASH160;
@@ -246,7 +250,7 @@ Script::Script(const Script &other, ScriptType type){
     }
     if(type == P2WSH){
         scriptLen = 34;
-        scriptArray = (uint8_t *) calloc(scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc(scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return; }
         sha256(other.scriptArray, other.scriptLen, scriptArray+2);
         scriptArray[0] = 0x00;
@@ -255,7 +259,7 @@ Script::Script(const Script &other, ScriptType type){
 }
 void Script::clear(){
     if(scriptLen > 0 && scriptArray != NULL){
-        free(scriptArray);
+        ubtc_free(scriptArray);
         scriptArray = NULL;
         scriptLen = 0;
         lenLen = 0;
@@ -278,13 +282,13 @@ size_t Script::from_stream(ParseStream *s){
         if(lenLen < 0xfd){
             scriptLen = lenLen;
             if(scriptLen > 0){
-                scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+                scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
             }
             lenLen = 1;
         }else{
             scriptLen = 0;
             lenLen = 1+(1 << (lenLen - 0xfc));
-            scriptArray = (uint8_t *) calloc( 255, sizeof(uint8_t));
+            scriptArray = (uint8_t *) ubtc_calloc( 255, sizeof(uint8_t));
         }
         if(scriptArray == NULL && scriptLen > 0){ status = PARSING_FAILED; scriptLen = 0; return 0; }
     }
@@ -293,8 +297,8 @@ size_t Script::from_stream(ParseStream *s){
         bytes_read++;
     }
     if(bytes_parsed+bytes_read == lenLen && scriptLen > 0){
-        free(scriptArray);
-        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        ubtc_free(scriptArray);
+        scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ status = PARSING_FAILED; scriptLen = 0; return 0; }
     }
     if(bytes_parsed+bytes_read == lenLen && lenVarInt(scriptLen) != lenLen){
@@ -424,12 +428,12 @@ size_t Script::push(uint8_t code){
     }
     if(scriptLen == 0){
         scriptLen = 1;
-        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return 0; } // check if allocation failed
     }else{
         scriptLen ++;
-        uint8_t * ptr = (uint8_t *) realloc( scriptArray, scriptLen * sizeof(uint8_t));
-        if(ptr == NULL){ free(scriptArray); scriptArray = NULL; scriptLen = 0; return 0; } // check if realloc failed
+        uint8_t * ptr = (uint8_t *) ubtc_realloc( scriptArray, scriptLen * sizeof(uint8_t));
+        if(ptr == NULL){ ubtc_free(scriptArray); scriptArray = NULL; scriptLen = 0; return 0; } // check if realloc failed
         scriptArray = ptr;
     }
     scriptArray[scriptLen-1] = code;
@@ -441,10 +445,10 @@ size_t Script::push(const uint8_t * data, size_t len){
         return 0;
     }
     if(scriptLen == 0){
-        scriptArray = (uint8_t *) calloc( len, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc( len, sizeof(uint8_t));
     }else{
-        uint8_t * ptr = (uint8_t *) realloc( scriptArray, (scriptLen + len) * sizeof(uint8_t));
-        if(ptr == NULL){ free(scriptArray); scriptArray = NULL; scriptLen = 0; return 0; }
+        uint8_t * ptr = (uint8_t *) ubtc_realloc( scriptArray, (scriptLen + len) * sizeof(uint8_t));
+        if(ptr == NULL){ ubtc_free(scriptArray); scriptArray = NULL; scriptLen = 0; return 0; }
         scriptArray = ptr;
     }
     if(scriptArray == NULL){ scriptLen = 0; return 0; }
@@ -470,10 +474,11 @@ size_t Script::push(const Signature sig, SigHashType sigType){
 size_t Script::push(const Script sc){
     size_t len = sc.length();
     uint8_t * tmp;
-    tmp = (uint8_t *)calloc(len, sizeof(uint8_t));
+    tmp = (uint8_t *)ubtc_calloc(len, sizeof(uint8_t));
     if(tmp == NULL){ return 0; }
     sc.serialize(tmp, len);
     push(tmp, len);
+    ubtc_free(tmp);
     return scriptLen;
 }
 Script Script::scriptPubkey(ScriptType type) const{
@@ -486,7 +491,7 @@ Script &Script::operator=(const Script &other){
     clear();
     if(other.scriptLen > 0){
         scriptLen = other.scriptLen;
-        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return *this; }
         memcpy(scriptArray, other.scriptArray, scriptLen);
     }
@@ -496,7 +501,7 @@ Script::Script(const Script &other){
     init();
     if(other.scriptLen > 0){
         scriptLen = other.scriptLen;
-        scriptArray = (uint8_t *) calloc( scriptLen, sizeof(uint8_t));
+        scriptArray = (uint8_t *) ubtc_calloc( scriptLen, sizeof(uint8_t));
         if(scriptArray == NULL){ scriptLen = 0; return; }
         memcpy(scriptArray, other.scriptArray, scriptLen);
     }
@@ -507,7 +512,8 @@ Script::Script(const Script &other){
 void Witness::clear(){
     numElements = 0;
     if(witnessLen > 0){
-        free(witnessArray);
+        ubtc_free(witnessArray);
+        witnessArray = NULL;
         witnessLen = 0;
     }
 }
@@ -597,12 +603,12 @@ size_t Witness::from_stream(ParseStream *s){
         if(cur_bytes_parsed+cur_bytes_read == curLen && cur_bytes_read>0){
             if(witnessLen==0){
                 witnessLen = cur_element_len+lenVarInt(cur_element_len);
-                witnessArray = (uint8_t *)calloc(witnessLen, sizeof(uint8_t));
+                witnessArray = (uint8_t *)ubtc_calloc(witnessLen, sizeof(uint8_t));
                 if(witnessArray == NULL){ witnessLen = 0; status=PARSING_FAILED; return 0;}
                 writeVarInt(cur_element_len, witnessArray, lenVarInt(cur_element_len));
             }else{
-                uint8_t * ptr = (uint8_t *)realloc( witnessArray, (witnessLen + cur_element_len + lenVarInt(cur_element_len)) * sizeof(uint8_t));
-                if(ptr == NULL){ free(witnessArray); witnessLen = 0; status=PARSING_FAILED; return 0;}
+                uint8_t * ptr = (uint8_t *)ubtc_realloc( witnessArray, (witnessLen + cur_element_len + lenVarInt(cur_element_len)) * sizeof(uint8_t));
+                if(ptr == NULL){ ubtc_free(witnessArray); witnessArray = NULL; witnessLen = 0; status=PARSING_FAILED; return 0;}
                 witnessArray = ptr;
                 witnessLen += cur_element_len+lenVarInt(cur_element_len);
                 writeVarInt(cur_element_len, witnessArray+offset, lenVarInt(cur_element_len));
@@ -654,11 +660,11 @@ size_t Witness::push(const uint8_t * data, size_t len){
         return 0;
     }
     if(witnessLen == 0){
-        witnessArray = (uint8_t *) calloc( len + lenVarInt(len), sizeof(uint8_t));
+        witnessArray = (uint8_t *) ubtc_calloc( len + lenVarInt(len), sizeof(uint8_t));
         if(witnessArray == NULL){ witnessLen = 0; return 0; }
     }else{
-        uint8_t * ptr = (uint8_t *) realloc( witnessArray, (witnessLen + len + lenVarInt(len)) * sizeof(uint8_t));
-        if(ptr == NULL){ free(witnessArray); witnessLen = 0; return 0; }
+        uint8_t * ptr = (uint8_t *) ubtc_realloc( witnessArray, (witnessLen + len + lenVarInt(len)) * sizeof(uint8_t));
+        if(ptr == NULL){ ubtc_free(witnessArray); witnessArray = NULL; witnessLen = 0; return 0; }
         witnessArray = ptr;
     }
     writeVarInt(len, witnessArray+witnessLen, lenVarInt(len));
@@ -683,12 +689,12 @@ size_t Witness::push(const Signature sig, SigHashType sigType){
 size_t Witness::push(const Script sc){
     size_t len = sc.length();
     uint8_t * tmp;
-    tmp = (uint8_t *)calloc(len, sizeof(uint8_t));
+    tmp = (uint8_t *)ubtc_calloc(len, sizeof(uint8_t));
     if(tmp == NULL){ return 0; }
     size_t l = sc.serialize(tmp, len);
     size_t dl = readVarInt(tmp, len);
     push(tmp+l-dl, dl);
-    free(tmp);
+    ubtc_free(tmp);
     return witnessLen;
 }
 Witness::Witness(const Witness &other){
@@ -696,7 +702,7 @@ Witness::Witness(const Witness &other){
     numElements = other.numElements;
     if(other.witnessLen > 0){
         witnessLen = other.witnessLen;
-        witnessArray = (uint8_t *) calloc( witnessLen, sizeof(uint8_t));
+        witnessArray = (uint8_t *) ubtc_calloc( witnessLen, sizeof(uint8_t));
         if(witnessArray == NULL){ witnessLen = 0; return;}
         memcpy(witnessArray, other.witnessArray, witnessLen);
     }
@@ -707,7 +713,7 @@ Witness &Witness::operator=(Witness const &other){
     numElements = other.numElements;
     if(other.witnessLen > 0){
         witnessLen = other.witnessLen;
-        witnessArray = (uint8_t *) calloc( witnessLen, sizeof(uint8_t));
+        witnessArray = (uint8_t *) ubtc_calloc( witnessLen, sizeof(uint8_t));
         if(witnessArray == NULL){ witnessLen = 0; return *this;}
         memcpy(witnessArray, other.witnessArray, witnessLen);
     }
@@ -214,8 +214,10 @@ Tx::Tx(const Tx & other){
     version = other.version;
     inputsNumber = other.inputsNumber;
     outputsNumber = other.outputsNumber;
-    txIns = new TxIn[inputsNumber];
-    txOuts = new TxOut[outputsNumber];
+    txIns = ubtc_new_array<TxIn>(inputsNumber);
+    txOuts = ubtc_new_array<TxOut>(outputsNumber);
+    if(txIns == NULL){ inputsNumber = 0; }
+    if(txOuts == NULL){ outputsNumber = 0; }
     for(unsigned int i=0;i<inputsNumber;i++){
         txIns[i] = other.txIns[i];
     }
@@ -231,15 +233,17 @@ Tx& Tx::operator=(Tx const &other){ // copy-paste =(
     if (this == &other){ return *this; } // self-assignment
     version = other.version;
     if(inputsNumber > 0){
-        delete [] txIns;
+        ubtc_delete_array(txIns);
     }
     if(outputsNumber > 0){
-        delete [] txOuts;
+        ubtc_delete_array(txOuts);
     }
     inputsNumber = other.inputsNumber;
     outputsNumber = other.outputsNumber;
-    txIns = new TxIn[inputsNumber];
-    txOuts = new TxOut[outputsNumber];
+    txIns = ubtc_new_array<TxIn>(inputsNumber);
+    txOuts = ubtc_new_array<TxOut>(outputsNumber);
+    if(txIns == NULL){ inputsNumber = 0; }
+    if(txOuts == NULL){ outputsNumber = 0; }
     for(unsigned int i=0;i<inputsNumber;i++){
         txIns[i] = other.txIns[i];
     }
@@ -258,12 +262,12 @@ Tx::~Tx(){
 void Tx::clear(){
     if(inputsNumber > 0){
         inputsNumber = 0;
-        delete [] txIns;
+        ubtc_delete_array(txIns);
         txIns = NULL;
     }
     if(outputsNumber > 0){
         outputsNumber = 0;
-        delete [] txOuts;
+        ubtc_delete_array(txOuts);
         txOuts = NULL;
     }
 }
@@ -374,7 +378,13 @@ size_t Tx::from_stream(ParseStream *s){
             segwit_flag = 1;
         }else{
             inputsNumber = c; // FIXME: should be varint, but 255 inputs will kill the MCU...
-            txIns = new TxIn[inputsNumber];
+            txIns = ubtc_new_array<TxIn>(inputsNumber);
+            if(txIns == NULL && inputsNumber > 0){
+                inputsNumber = 0;
+                status = PARSING_FAILED;
+                bytes_parsed+=bytes_read;
+                return bytes_read;
+            }
             for(unsigned int i=0; i<inputsNumber; i++){ // this will at least set all txins to PARSING_INCOMPLETE
                 bytes_read += s->parse(&txIns[i]);
             }
@@ -392,7 +402,13 @@ size_t Tx::from_stream(ParseStream *s){
     if(s->available() && segwit_flag > 0 && bytes_read+bytes_parsed == 6){
         inputsNumber = s->read();
         bytes_read++;
-        txIns = new TxIn[inputsNumber];
+        txIns = ubtc_new_array<TxIn>(inputsNumber);
+        if(txIns == NULL && inputsNumber > 0){
+            inputsNumber = 0;
+            status = PARSING_FAILED;
+            bytes_parsed+=bytes_read;
+            return bytes_read;
+        }
         for(unsigned int i=0; i<inputsNumber; i++){ // this will at least set all txins to PARSING_INCOMPLETE
             bytes_read += s->parse(&txIns[i]);
         }
@@ -414,7 +430,13 @@ size_t Tx::from_stream(ParseStream *s){
     if(s->available() && bytes_read+bytes_parsed == current_offset){
         outputsNumber = s->read();
         bytes_read++;
-        txOuts = new TxOut[outputsNumber];
+        txOuts = ubtc_new_array<TxOut>(outputsNumber);
+        if(txOuts == NULL && outputsNumber > 0){
+            outputsNumber = 0;
+            status = PARSING_FAILED;
+            bytes_parsed+=bytes_read;
+            return bytes_read;
+        }
         for(unsigned int i=0; i<outputsNumber; i++){ // this will at least set all txouts to PARSING_INCOMPLETE
             bytes_read += s->parse(&txOuts[i]);
         }
@@ -599,26 +621,28 @@ String Tx::wtxid() const{
 #endif
 
 uint8_t Tx::addInput(const TxIn txIn){
-    TxIn * arr = new TxIn[inputsNumber+1];
+    TxIn * arr = ubtc_new_array<TxIn>(inputsNumber+1);
+    if(arr == NULL){ return 0; }
     for(unsigned int i=0; i<inputsNumber; i++){
         arr[i] = txIns[i];
     }
     arr[inputsNumber] = txIn;
     if(inputsNumber > 0){
-        delete [] txIns;
+        ubtc_delete_array(txIns);
     }
     txIns = arr;
     inputsNumber++;
     return inputsNumber;
 }
 uint8_t Tx::addOutput(const TxOut txOut){
-    TxOut * arr = new TxOut[outputsNumber+1];
+    TxOut * arr = ubtc_new_array<TxOut>(outputsNumber+1);
+    if(arr == NULL){ return 0; }
     for(unsigned int i=0; i<outputsNumber; i++){
         arr[i] = txOuts[i];
     }
     arr[outputsNumber] = txOut;
     if(outputsNumber > 0){
-        delete [] txOuts;
+        ubtc_delete_array(txOuts);
     }
     txOuts = arr;
     outputsNumber++;
@@ -696,6 +720,9 @@ int Tx::sigHashSegwit(uint8_t h[32], uint8_t inputIndex, const Script scriptPubK
 }
 
 Signature Tx::signInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, SigHashType sighash){
+    return signInput(inputIndex, PreparedPrivateKey(pk), redeemScript, sighash);
+}
+Signature Tx::signInput(uint8_t inputIndex, const PreparedPrivateKey &pk, const Script redeemScript, SigHashType sighash){
     uint8_t h[32];
     sigHash(h, inputIndex, redeemScript, sighash);
 
@@ -715,6 +742,9 @@ Signature Tx::signInput(uint8_t inputIndex, const PrivateKey pk, const Script re
     return sig;
 }
 Signature Tx::signSegwitInput(uint8_t inputIndex, const PrivateKey pk, const Script redeemScript, uint64_t amount, ScriptType type, SigHashType sighash){
+    return signSegwitInput(inputIndex, PreparedPrivateKey(pk), redeemScript, amount, type, sighash);
+}
+Signature Tx::signSegwitInput(uint8_t inputIndex, const PreparedPrivateKey &pk, const Script redeemScript, uint64_t amount, ScriptType type, SigHashType sighash){
     uint8_t h[32];
 
     ScriptType redeem_type = redeemScript.type();
@@ -55,4 +55,66 @@
 // using std::string;
 #endif
 
+/* No-heap mode: library never calls malloc / new.
+ * Scripts, witnesses, transaction arrays, PSBT metadata and conversion
+ * buffers are taken from a statically allocated pool of fixed-size blocks
+ * dimensioned from the limits below. Anything above the limits fails
+ * the same way as a failed allocation (parsing fails, functions return 0).
+ * Use ubtc_pool_capacity() or `nm -S` on `ubtc_pool` to see the footprint.
+ * Strings (String / std::string) still use their own allocator.
+ */
+#ifndef UBTC_NO_HEAP
+#define UBTC_NO_HEAP 0
+#endif
+
+#if UBTC_NO_HEAP
+ #ifndef UBTC_MAX_INPUTS
+  #define UBTC_MAX_INPUTS      8   /* inputs per transaction */
+ #endif
+ #ifndef UBTC_MAX_OUTPUTS
+  #define UBTC_MAX_OUTPUTS     8   /* outputs per transaction */
+ #endif
+ #ifndef UBTC_MAX_SCRIPT_LEN
+  #define UBTC_MAX_SCRIPT_LEN  520 /* script or witness bytes, 520 is the consensus push limit */
+ #endif
+ #ifndef UBTC_MAX_DERIVATIONS
+  #define UBTC_MAX_DERIVATIONS 3   /* PSBT bip32 derivations or partial signatures per input / output */
+ #endif
+ #ifndef UBTC_MAX_TX_LEN
+  #define UBTC_MAX_TX_LEN      2048 /* largest parsed key-value, serialized tx or conversion buffer */
+ #endif
+#endif
+
+/* Number of decompressed public keys to remember, keyed by x coordinate.
+ * Parsing a compressed or x-only key needs a field square root,
+ * with the cache a key seen before costs a lookup instead.
+ * Every entry takes 68 bytes of RAM, set to 0 to disable.
+ */
+#ifndef UBTC_POINT_CACHE_SIZE
+ #if defined(ARDUINO_ARCH_AVR)
+  #define UBTC_POINT_CACHE_SIZE 0
+ #else
+  #define UBTC_POINT_CACHE_SIZE 32
+ #endif
+#endif
+
+/* Window size of PreparedPublicKey tables, 2 to 8.
+ * A table takes ceil(256/w) * 2^(w-1) * 72 bytes: 18 KB for 2, 36 KB for 4,
+ * 288 KB for 8. Larger tables need fewer point additions per multiplication.
+ */
+#ifndef UBTC_PREPARED_WINDOW
+#define UBTC_PREPARED_WINDOW 4
+#endif
+
+/* Number of NIP-44 conversation keys a Nip44 object remembers, keyed by
+ * the peer x-only public key. A new peer costs an ecdh, a known one
+ * only symmetric crypto. Every entry takes 68 bytes.
+ */
+#ifndef UBTC_NIP44_CACHE_SIZE
+ #if defined(ARDUINO_ARCH_AVR)
+  #define UBTC_NIP44_CACHE_SIZE 1
+ #else
+  #define UBTC_NIP44_CACHE_SIZE 8
+ #endif
+#endif
 #endif //__UBITCOIN_CONF_H__
@@ -28,6 +28,10 @@
 #include <assert.h>
 #include "bignum.h"
 #include "memzero.h"
+#include "prof.h"
+#if USE_BN_SECP256K1_64 || USE_BN_SECP256K1_30
+#include "secp256k1.h"
+#endif
 
 /* big number library */
 
@@ -423,6 +427,27 @@ void bn_multiply_long(const bignum256 *k, const bignum256 *x, uint32_t res[18])
 	res[17] = temp;
 }
 
+// res = round(a * b / 2^384), used to split scalars for the GLV endomorphism.
+// assumes that a and b are normalized, the result is below 2^128 + 1.
+void bn_mul_shift_384(const bignum256 *a, const bignum256 *b, bignum256 *res)
+{
+	int i;
+	uint32_t prod[18];
+	bn_multiply_long(a, b, prod);
+	// bit 384 is bit 24 of limb 12, bit 383 decides the rounding
+	uint32_t carry = (prod[12] >> 23) & 1;
+	for (i = 0; i < 5; i++) {
+		carry += ((prod[12 + i] >> 24) | (prod[13 + i] << 6)) & 0x3FFFFFFFu;
+		res->val[i] = carry & 0x3FFFFFFFu;
+		carry >>= 30;
+	}
+	res->val[5] = carry + (prod[17] >> 24);
+	res->val[6] = 0;
+	res->val[7] = 0;
+	res->val[8] = 0;
+	memzero(prod, sizeof(prod));
+}
+
 // auxiliary function for multiplication.
 // reduces res modulo prime.
 // assumes    res normalized, res < 2^(30(i-7)) * 2 * prime
@@ -481,18 +506,354 @@ void bn_multiply_reduce(bignum256 *x, uint32_t res[18], const bignum256 *prime)
 	}
 }
 
+#if USE_BN_SECP256K1_64
+
+// Multiplication modulo secp256k1 prime and order for 64-bit hosts.
+// Numbers are converted to four 64-bit limbs, multiplied with 128-bit
+// products and reduced using 2^256 = c (mod m), where c = 2^256 - m is
+// 0x1000003D1 for the prime and a 129-bit number for the order.
+
+typedef unsigned __int128 bn_uint128;
+
+// 2^256 - prime
+#define BN_SECP256K1_PRIME_C 0x1000003D1ull
+// 2^256 - order = 2^128 + N1 * 2^64 + N0
+#define BN_SECP256K1_ORDER_N0 0x402DA1732FC9BEBFull
+#define BN_SECP256K1_ORDER_N1 0x4551231950B75FC4ull
+
+// 192-bit accumulator (c0, c1, c2) for the reduction modulo order
+#define BN_MULADD_64(a, b) { \
+	bn_uint128 p_ = (bn_uint128)(a) * (b); \
+	uint64_t lo_ = (uint64_t)p_, hi_ = (uint64_t)(p_ >> 64); \
+	c0 += lo_; hi_ += (c0 < lo_); \
+	c1 += hi_; c2 += (c1 < hi_); \
+}
+#define BN_SUMADD_64(a) { \
+	uint64_t a_ = (a); \
+	c0 += a_; a_ = (c0 < a_); \
+	c1 += a_; c2 += (c1 < a_); \
+}
+#define BN_EXTRACT_64(n) { (n) = c0; c0 = c1; c1 = c2; c2 = 0; }
+
+// normalized x < 2^270 to 4 limbs and the bits above 2^256
+static inline void bn_read_64(const bignum256 *x, uint64_t r[5])
+{
+	const uint32_t *v = x->val;
+	r[0] = v[0] | ((uint64_t)v[1] << 30) | ((uint64_t)v[2] << 60);
+	r[1] = (v[2] >> 4) | ((uint64_t)v[3] << 26) | ((uint64_t)v[4] << 56);
+	r[2] = (v[4] >> 8) | ((uint64_t)v[5] << 22) | ((uint64_t)v[6] << 52);
+	r[3] = (v[6] >> 12) | ((uint64_t)v[7] << 18) | ((uint64_t)v[8] << 48);
+	r[4] = v[8] >> 16;
+}
+
+static inline void bn_write_64(const uint64_t a[4], bignum256 *x)
+{
+	uint32_t *v = x->val;
+	v[0] = a[0] & 0x3FFFFFFF;
+	v[1] = (a[0] >> 30) & 0x3FFFFFFF;
+	v[2] = ((a[0] >> 60) | (a[1] << 4)) & 0x3FFFFFFF;
+	v[3] = (a[1] >> 26) & 0x3FFFFFFF;
+	v[4] = ((a[1] >> 56) | (a[2] << 8)) & 0x3FFFFFFF;
+	v[5] = (a[2] >> 22) & 0x3FFFFFFF;
+	v[6] = ((a[2] >> 52) | (a[3] << 12)) & 0x3FFFFFFF;
+	v[7] = (a[3] >> 18) & 0x3FFFFFFF;
+	v[8] = a[3] >> 48;
+}
+
+// t = a * b, inputs < 2^256
+static inline void bn_mul_64(const uint64_t a[4], const uint64_t b[4], uint64_t t[8])
+{
+	bn_uint128 acc;
+	uint64_t carry;
+	int i, j;
+
+	for (i = 0; i < 8; i++) {
+		t[i] = 0;
+	}
+	for (i = 0; i < 4; i++) {
+		carry = 0;
+		for (j = 0; j < 4; j++) {
+			acc = (bn_uint128)a[i] * b[j] + t[i + j] + carry;
+			t[i + j] = (uint64_t)acc;
+			carry = (uint64_t)(acc >> 64);
+		}
+		t[i + 4] = carry;
+	}
+}
+
+// a (4 limbs plus a[4] < 2^34 above them) to a number < 2^256 congruent mod prime
+static inline void bn_load_prime_64(uint64_t a[5])
+{
+	bn_uint128 c;
+	c = (bn_uint128)a[4] * BN_SECP256K1_PRIME_C + a[0]; a[0] = (uint64_t)c; c >>= 64;
+	c += a[1]; a[1] = (uint64_t)c; c >>= 64;
+	c += a[2]; a[2] = (uint64_t)c; c >>= 64;
+	c += a[3]; a[3] = (uint64_t)c; c >>= 64;
+	// overflow leaves a small number in a, adding c once more can't overflow
+	c = (bn_uint128)((uint64_t)c * BN_SECP256K1_PRIME_C) + a[0]; a[0] = (uint64_t)c; c >>= 64;
+	c += a[1]; a[1] = (uint64_t)c; c >>= 64;
+	c += a[2]; a[2] = (uint64_t)c; c >>= 64;
+	a[3] += (uint64_t)c;
+}
+
+// x = k * x mod secp256k1 prime, fully reduced
+static void bn_multiply_prime_64(const bignum256 *k, bignum256 *x)
+{
+	const uint64_t C = BN_SECP256K1_PRIME_C;
+	uint64_t a[5], b[5], t[8], s[4], mask;
+	bn_uint128 c;
+
+	bn_read_64(k, a);
+	bn_read_64(x, b);
+	bn_load_prime_64(a);
+	bn_load_prime_64(b);
+	bn_mul_64(a, b, t);
+	// t < 2^512, fold the upper half with 2^256 = C: a < 2^256 + 2^290
+	c = (bn_uint128)t[4] * C + t[0]; a[0] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)t[5] * C + t[1]; a[1] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)t[6] * C + t[2]; a[2] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)t[7] * C + t[3]; a[3] = (uint64_t)c; c >>= 64;
+	a[4] = (uint64_t)c;
+	bn_load_prime_64(a);
+	// s = a + C - 2^256 = a - prime, use it if a >= prime
+	c = (bn_uint128)a[0] + C; s[0] = (uint64_t)c; c >>= 64;
+	c += a[1]; s[1] = (uint64_t)c; c >>= 64;
+	c += a[2]; s[2] = (uint64_t)c; c >>= 64;
+	c += a[3]; s[3] = (uint64_t)c; c >>= 64;
+	mask = -(uint64_t)c;
+	a[0] = (s[0] & mask) | (a[0] & ~mask);
+	a[1] = (s[1] & mask) | (a[1] & ~mask);
+	a[2] = (s[2] & mask) | (a[2] & ~mask);
+	a[3] = (s[3] & mask) | (a[3] & ~mask);
+	bn_write_64(a, x);
+	memzero(a, sizeof(a));
+	memzero(b, sizeof(b));
+	memzero(t, sizeof(t));
+	memzero(s, sizeof(s));
+}
+
+// a (4 limbs plus small a[4] above them) to a number < 2^256 congruent mod order
+static inline void bn_load_order_64(uint64_t a[5])
+{
+	bn_uint128 c;
+	uint64_t k = a[4];
+	c = (bn_uint128)k * BN_SECP256K1_ORDER_N0 + a[0]; a[0] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)k * BN_SECP256K1_ORDER_N1 + a[1]; a[1] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)k + a[2]; a[2] = (uint64_t)c; c >>= 64;
+	c += a[3]; a[3] = (uint64_t)c; c >>= 64;
+	// overflow leaves a small number in a, adding c once more can't overflow
+	k = (uint64_t)c;
+	c = (bn_uint128)k * BN_SECP256K1_ORDER_N0 + a[0]; a[0] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)k * BN_SECP256K1_ORDER_N1 + a[1]; a[1] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)k + a[2]; a[2] = (uint64_t)c; c >>= 64;
+	a[3] += (uint64_t)c;
+}
+
+// x = k * x mod secp256k1 order, fully reduced
+static void bn_multiply_order_64(const bignum256 *k, bignum256 *x)
+{
+	uint64_t a[5], b[5], t[8], m[7], s[4], mask;
+	uint64_t c0 = 0, c1 = 0, c2 = 0;
+	bn_uint128 c;
+
+	bn_read_64(k, a);
+	bn_read_64(x, b);
+	bn_load_order_64(a);
+	bn_load_order_64(b);
+	bn_mul_64(a, b, t);
+
+	// m = t[0..3] + t[4..7] * (2^256 - order) < 2^386
+	BN_SUMADD_64(t[0]);
+	BN_MULADD_64(t[4], BN_SECP256K1_ORDER_N0);
+	BN_EXTRACT_64(m[0]);
+	BN_SUMADD_64(t[1]);
+	BN_MULADD_64(t[5], BN_SECP256K1_ORDER_N0);
+	BN_MULADD_64(t[4], BN_SECP256K1_ORDER_N1);
+	BN_EXTRACT_64(m[1]);
+	BN_SUMADD_64(t[2]);
+	BN_MULADD_64(t[6], BN_SECP256K1_ORDER_N0);
+	BN_MULADD_64(t[5], BN_SECP256K1_ORDER_N1);
+	BN_SUMADD_64(t[4]);
+	BN_EXTRACT_64(m[2]);
+	BN_SUMADD_64(t[3]);
+	BN_MULADD_64(t[7], BN_SECP256K1_ORDER_N0);
+	BN_MULADD_64(t[6], BN_SECP256K1_ORDER_N1);
+	BN_SUMADD_64(t[5]);
+	BN_EXTRACT_64(m[3]);
+	BN_MULADD_64(t[7], BN_SECP256K1_ORDER_N1);
+	BN_SUMADD_64(t[6]);
+	BN_EXTRACT_64(m[4]);
+	BN_SUMADD_64(t[7]);
+	BN_EXTRACT_64(m[5]);
+	m[6] = c0;
+
+	// a = m[0..3] + m[4..6] * (2^256 - order) < 2^260
+	c0 = 0; c1 = 0; c2 = 0;
+	BN_SUMADD_64(m[0]);
+	BN_MULADD_64(m[4], BN_SECP256K1_ORDER_N0);
+	BN_EXTRACT_64(a[0]);
+	BN_SUMADD_64(m[1]);
+	BN_MULADD_64(m[5], BN_SECP256K1_ORDER_N0);
+	BN_MULADD_64(m[4], BN_SECP256K1_ORDER_N1);
+	BN_EXTRACT_64(a[1]);
+	BN_SUMADD_64(m[2]);
+	BN_MULADD_64(m[6], BN_SECP256K1_ORDER_N0);
+	BN_MULADD_64(m[5], BN_SECP256K1_ORDER_N1);
+	BN_SUMADD_64(m[4]);
+	BN_EXTRACT_64(a[2]);
+	BN_SUMADD_64(m[3]);
+	BN_MULADD_64(m[6], BN_SECP256K1_ORDER_N1);
+	BN_SUMADD_64(m[5]);
+	BN_EXTRACT_64(a[3]);
+	BN_SUMADD_64(m[6]);
+	a[4] = c0;
+	bn_load_order_64(a);
+
+	// s = a + (2^256 - order) - 2^256 = a - order, use it if a >= order
+	c = (bn_uint128)a[0] + BN_SECP256K1_ORDER_N0; s[0] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)a[1] + BN_SECP256K1_ORDER_N1; s[1] = (uint64_t)c; c >>= 64;
+	c += (bn_uint128)a[2] + 1; s[2] = (uint64_t)c; c >>= 64;
+	c += a[3]; s[3] = (uint64_t)c; c >>= 64;
+	mask = -(uint64_t)c;
+	a[0] = (s[0] & mask) | (a[0] & ~mask);
+	a[1] = (s[1] & mask) | (a[1] & ~mask);
+	a[2] = (s[2] & mask) | (a[2] & ~mask);
+	a[3] = (s[3] & mask) | (a[3] & ~mask);
+	bn_write_64(a, x);
+	memzero(a, sizeof(a));
+	memzero(b, sizeof(b));
+	memzero(t, sizeof(t));
+	memzero(m, sizeof(m));
+	memzero(s, sizeof(s));
+}
+
+#endif
+
+#if USE_BN_SECP256K1_30
+
+// Multiplication modulo secp256k1 prime for 32-bit targets, in the same
+// nine 30-bit limb layout. The reduction uses 2^256 = 2^32 + 977 (mod prime)
+// instead of the generic division steps, and squaring computes every
+// cross product only once.
+
+// compute x * x as a 540 bit number in base 2^30 (normalized).
+// assumes that x is normalized.
+static inline void bn_square_long(const bignum256 *x, uint32_t res[18])
+{
+	int i, j;
+	uint64_t temp = 0, acc;
+	const uint32_t *v = x->val;
+
+	for (i = 0; i < 17; i++) {
+		// no overflow: at most 4 cross products, doubled, plus a square
+		acc = 0;
+		for (j = (i < 9 ? 0 : i - 8); j < i - j; j++) {
+			acc += v[j] * (uint64_t)v[i - j];
+		}
+		temp += acc << 1;
+		if ((i & 1) == 0) {
+			temp += v[i / 2] * (uint64_t)v[i / 2];
+		}
+		res[i] = temp & 0x3FFFFFFF;
+		temp >>= 30;
+	}
+	res[17] = temp;
+}
+
+// reduces x = res modulo secp256k1 prime.
+// assumes    res normalized
+// guarantees x partly reduced, x < 2^256 + 2^95 < 2 * prime
+static inline void bn_reduce_prime_30(const uint32_t res[18], bignum256 *x)
+{
+	uint32_t h[10], r[11];
+	uint64_t temp;
+	int i;
+
+	// h = res >> 256, 256 = 8*30 + 16
+	for (i = 0; i < 9; i++) {
+		h[i] = ((res[8 + i] >> 16) | (res[9 + i] << 14)) & 0x3FFFFFFF;
+	}
+	h[9] = res[17] >> 16;
+	// r = (res mod 2^256) + h * 977 + h * 2^32, and 2^32 = 4 * 2^30
+	temp = 0;
+	for (i = 0; i < 11; i++) {
+		if (i < 8) {
+			temp += res[i];
+		} else if (i == 8) {
+			temp += res[8] & 0xFFFF;
+		}
+		if (i < 10) {
+			temp += h[i] * (uint64_t)977;
+		}
+		if (i > 0) {
+			temp += (uint64_t)h[i - 1] << 2;
+		}
+		r[i] = temp & 0x3FFFFFFF;
+		temp >>= 30;
+	}
+	// r < 2^318, fold the remaining 62 bits above 2^256 the same way
+	h[0] = ((r[8] >> 16) | (r[9] << 14)) & 0x3FFFFFFF;
+	h[1] = ((r[9] >> 16) | (r[10] << 14)) & 0x3FFFFFFF;
+	h[2] = r[10] >> 16;
+	r[8] &= 0xFFFF;
+	temp = 0;
+	for (i = 0; i < 9; i++) {
+		temp += r[i];
+		if (i < 3) {
+			temp += h[i] * (uint64_t)977;
+		}
+		if (i > 0 && i < 4) {
+			temp += (uint64_t)h[i - 1] << 2;
+		}
+		x->val[i] = temp & 0x3FFFFFFF;
+		temp >>= 30;
+	}
+	memzero(h, sizeof(h));
+	memzero(r, sizeof(r));
+}
+
+#endif
+
 // Compute x := k * x  (mod prime)
 // both inputs must be smaller than 180 * prime.
 // result is partly reduced (0 <= x < 2 * prime)
 // This only works for primes between 2^256-2^224 and 2^256.
 void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime)
 {
+#if USE_BN_SECP256K1_64
+	if (prime == &secp256k1.prime) {
+		bn_multiply_prime_64(k, x);
+		return;
+	}
+	if (prime == &secp256k1.order) {
+		bn_multiply_order_64(k, x);
+		return;
+	}
+#endif
 	uint32_t res[18] = {0};
+#if USE_BN_SECP256K1_30
+	if (prime == &secp256k1.prime) {
+		if (k == x) {
+			bn_square_long(x, res);
+		} else {
+			bn_multiply_long(k, x, res);
+		}
+		bn_reduce_prime_30(res, x);
+		memzero(res, sizeof(res));
+		return;
+	}
+#endif
 	bn_multiply_long(k, x, res);
 	bn_multiply_reduce(x, res, prime); 
 	memzero(res, sizeof(res));
 }
 
+// Compute x := x * x  (mod prime), same requirements as bn_multiply
+void bn_square(bignum256 *x, const bignum256 *prime)
+{
+	bn_multiply(x, x, prime);
+}
+
 // partly reduce x modulo prime
 // input x does not have to be normalized.
 // x can be any number that fits.
@@ -547,7 +908,7 @@ void bn_sqrt(bignum256 *x, const bignum256 *prime)
 				bn_multiply(x, &res, prime);
 			}
 			limb >>= 1;
-			bn_multiply(x, x, prime);
+			bn_square(x, prime);
 		}
 	}
 	bn_mod(&res, prime);
@@ -556,11 +917,24 @@ void bn_sqrt(bignum256 *x, const bignum256 *prime)
 	memzero(&p, sizeof(p));
 }
 
-#if ! USE_INVERSE_FAST
+#if USE_INVERSE_SAFEGCD
+
+// in field G_prime, constant time, see bn_inverse_ct below
+// the input must not be 0 mod prime.
+// the result is smaller than prime
+void bn_inverse(bignum256 *x, const bignum256 *prime)
+{
+	UBTC_PROF_ENTER();
+	bn_inverse_ct(x, prime);
+	UBTC_PROF_LEAVE(UBTC_PROF_BN_INVERSE);
+}
+
+#elif ! USE_INVERSE_FAST
 
 // in field G_prime, small but slow
 void bn_inverse(bignum256 *x, const bignum256 *prime)
 {
+	UBTC_PROF_ENTER();
 	// this method compute x^-1 = x^(prime-2)
 	uint32_t i, j, limb;
 	bignum256 res;
@@ -584,11 +958,12 @@ void bn_inverse(bignum256 *x, const bignum256 *prime)
 				bn_multiply(x, &res, prime);
 			}
 			limb >>= 1;
-			bn_multiply(x, x, prime);
+			bn_square(x, prime);
 		}
 	}
 	bn_mod(&res, prime);
 	memcpy(x, &res, sizeof(bignum256));
+	UBTC_PROF_LEAVE(UBTC_PROF_BN_INVERSE);
 }
 
 #else
@@ -598,6 +973,7 @@ void bn_inverse(bignum256 *x, const bignum256 *prime)
 // the result is smaller than prime
 void bn_inverse(bignum256 *x, const bignum256 *prime)
 {
+	UBTC_PROF_ENTER();
 	int i, j, k, cmp;
 	struct combo {
 		uint32_t a[9];
@@ -677,8 +1053,10 @@ void bn_inverse(bignum256 *x, const bignum256 *prime)
 			// if input was 0, return.
 			// This simple check prevents crashing with stack underflow
 			// or worse undesired behaviour for illegal input.
-			if (even->len1 < 0)
+			if (even->len1 < 0) {
+				UBTC_PROF_LEAVE(UBTC_PROF_BN_INVERSE);
 				return;
+			}
 		}
 
 		// reduce even->a while it is even
@@ -864,9 +1242,336 @@ void bn_inverse(bignum256 *x, const bignum256 *prime)
 	memzero(pp, sizeof(pp));
 	memzero(&us, sizeof(us));
 	memzero(&vr, sizeof(vr));
+	UBTC_PROF_LEAVE(UBTC_PROF_BN_INVERSE);
 }
 #endif
 
+// Safegcd inversion from Bernstein and Yang, "Fast constant-time gcd
+// computation and modular inversion", following the 32-bit implementation
+// in libsecp256k1 (modinv32). Numbers are kept as nine signed 30-bit limbs,
+// the same layout as bignum256, so conversion is just a copy.
+// Every round applies 30 divsteps to the low limbs of f and g and
+// then updates the full numbers with the resulting 2x2 matrix.
+
+typedef struct {
+	int32_t v[9];
+} bn_signed30;
+
+typedef struct {
+	bn_signed30 modulus;
+	uint32_t modulus_inv30; // modulus^-1 mod 2^30
+} bn_modinfo;
+
+// transition matrix of 30 divsteps, scaled by 2^30
+typedef struct {
+	int32_t u, v, q, r;
+} bn_trans2x2;
+
+#define BN_M30 ((int32_t)0x3FFFFFFF)
+
+static void bn_modinfo_init(bn_modinfo *mi, const bignum256 *prime)
+{
+	int i;
+	uint32_t inv;
+	for (i = 0; i < 9; i++) {
+		mi->modulus.v[i] = (int32_t)prime->val[i];
+	}
+	// Newton iteration, every step doubles the number of correct low bits
+	inv = prime->val[0]; // correct mod 2^3 for odd numbers
+	for (i = 0; i < 4; i++) {
+		inv *= 2 - prime->val[0] * inv;
+	}
+	mi->modulus_inv30 = inv & BN_M30;
+}
+
+// 30 divsteps in constant time, zeta = -(delta+1/2)
+static int32_t bn_divsteps_30(int32_t zeta, uint32_t f0, uint32_t g0, bn_trans2x2 *t)
+{
+	uint32_t u = 1, v = 0, q = 0, r = 1;
+	uint32_t c1, c2, f = f0, g = g0, x, y, z;
+	int i;
+
+	for (i = 0; i < 30; i++) {
+		// c1 is all ones if delta > 0, c2 is all ones if g is odd
+		c1 = (uint32_t)(zeta >> 31);
+		c2 = -(g & 1);
+		// g is odd: g = g - f if delta > 0, g = g + f otherwise
+		x = (f ^ c1) - c1;
+		y = (u ^ c1) - c1;
+		z = (v ^ c1) - c1;
+		g += x & c2;
+		q += y & c2;
+		r += z & c2;
+		// swap if delta > 0 and g is odd
+		c1 &= c2;
+		zeta = (zeta ^ (int32_t)c1) - 1;
+		f += g & c1;
+		u += q & c1;
+		v += r & c1;
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+	t->u = (int32_t)u;
+	t->v = (int32_t)v;
+	t->q = (int32_t)q;
+	t->r = (int32_t)r;
+	return zeta;
+}
+
+#if defined(__GNUC__)
+#define bn_ctz32(x) __builtin_ctz(x)
+#else
+static int bn_ctz32(uint32_t x)
+{
+	int n = 0;
+	while ((x & 1) == 0) {
+		x >>= 1;
+		n++;
+	}
+	return n;
+}
+#endif
+
+// up to 30 divsteps in variable time, eta = -delta
+static int32_t bn_divsteps_30_var(int32_t eta, uint32_t f0, uint32_t g0, bn_trans2x2 *t)
+{
+	// inv256[i] = -(2*i+1)^-1 mod 256
+	static const uint8_t inv256[128] = {
+		0xFF, 0x55, 0x33, 0x49, 0xC7, 0x5D, 0x3B, 0x11, 0x0F, 0xE5, 0xC3, 0x59, 0xD7, 0xED, 0xCB, 0x21,
+		0x1F, 0x75, 0x53, 0x69, 0xE7, 0x7D, 0x5B, 0x31, 0x2F, 0x05, 0xE3, 0x79, 0xF7, 0x0D, 0xEB, 0x41,
+		0x3F, 0x95, 0x73, 0x89, 0x07, 0x9D, 0x7B, 0x51, 0x4F, 0x25, 0x03, 0x99, 0x17, 0x2D, 0x0B, 0x61,
+		0x5F, 0xB5, 0x93, 0xA9, 0x27, 0xBD, 0x9B, 0x71, 0x6F, 0x45, 0x23, 0xB9, 0x37, 0x4D, 0x2B, 0x81,
+		0x7F, 0xD5, 0xB3, 0xC9, 0x47, 0xDD, 0xBB, 0x91, 0x8F, 0x65, 0x43, 0xD9, 0x57, 0x6D, 0x4B, 0xA1,
+		0x9F, 0xF5, 0xD3, 0xE9, 0x67, 0xFD, 0xDB, 0xB1, 0xAF, 0x85, 0x63, 0xF9, 0x77, 0x8D, 0x6B, 0xC1,
+		0xBF, 0x15, 0xF3, 0x09, 0x87, 0x1D, 0xFB, 0xD1, 0xCF, 0xA5, 0x83, 0x19, 0x97, 0xAD, 0x8B, 0xE1,
+		0xDF, 0x35, 0x13, 0x29, 0xA7, 0x3D, 0x1B, 0xF1, 0xEF, 0xC5, 0xA3, 0x39, 0xB7, 0xCD, 0xAB, 0x01,
+	};
+	uint32_t u = 1, v = 0, q = 0, r = 1;
+	uint32_t f = f0, g = g0, m, w, tmp;
+	int i = 30, limit, zeros;
+
+	for (;;) {
+		// drop all zero bits of g at once, but not more than i
+		zeros = bn_ctz32(g | (0xFFFFFFFFu << i));
+		g >>= zeros;
+		u <<= zeros;
+		v <<= zeros;
+		eta -= zeros;
+		i -= zeros;
+		if (i == 0) {
+			break;
+		}
+		// g is odd now, swap if delta > 0
+		if (eta < 0) {
+			eta = -eta;
+			tmp = f; f = g; g = -tmp;
+			tmp = u; u = q; q = -tmp;
+			tmp = v; v = r; r = -tmp;
+		}
+		// cancel up to 8 low bits of g with a multiple of f
+		limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+		m = (0xFFFFFFFFu >> (32 - limit)) & 255u;
+		w = (g * inv256[(f >> 1) & 127]) & m;
+		g += f * w;
+		q += u * w;
+		r += v * w;
+	}
+	t->u = (int32_t)u;
+	t->v = (int32_t)v;
+	t->q = (int32_t)q;
+	t->r = (int32_t)r;
+	return eta;
+}
+
+// [d, e] = t * [d, e] / 2^30 mod modulus, keeps d and e in (-2*modulus, modulus)
+static void bn_update_de_30(bn_signed30 *d, bn_signed30 *e, const bn_trans2x2 *t, const bn_modinfo *mi)
+{
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t di, ei, md, me, sd, se;
+	int64_t cd, ce;
+	int i;
+
+	// start with a multiple of modulus that makes negative inputs positive
+	sd = d->v[8] >> 31;
+	se = e->v[8] >> 31;
+	md = (u & sd) + (v & se);
+	me = (q & sd) + (r & se);
+	di = d->v[0];
+	ei = e->v[0];
+	cd = (int64_t)u * di + (int64_t)v * ei;
+	ce = (int64_t)q * di + (int64_t)r * ei;
+	// correct md, me so the low 30 bits of the result are zero
+	md -= (int32_t)((mi->modulus_inv30 * (uint32_t)cd + (uint32_t)md) & BN_M30);
+	me -= (int32_t)((mi->modulus_inv30 * (uint32_t)ce + (uint32_t)me) & BN_M30);
+	cd += (int64_t)mi->modulus.v[0] * md;
+	ce += (int64_t)mi->modulus.v[0] * me;
+	cd >>= 30;
+	ce >>= 30;
+	for (i = 1; i < 9; i++) {
+		di = d->v[i];
+		ei = e->v[i];
+		cd += (int64_t)u * di + (int64_t)v * ei;
+		ce += (int64_t)q * di + (int64_t)r * ei;
+		cd += (int64_t)mi->modulus.v[i] * md;
+		ce += (int64_t)mi->modulus.v[i] * me;
+		d->v[i - 1] = (int32_t)cd & BN_M30;
+		cd >>= 30;
+		e->v[i - 1] = (int32_t)ce & BN_M30;
+		ce >>= 30;
+	}
+	d->v[8] = (int32_t)cd;
+	e->v[8] = (int32_t)ce;
+}
+
+// [f, g] = t * [f, g] / 2^30, only the lowest len limbs are used
+static void bn_update_fg_30(int len, bn_signed30 *f, bn_signed30 *g, const bn_trans2x2 *t)
+{
+	const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int32_t fi, gi;
+	int64_t cf, cg;
+	int i;
+
+	fi = f->v[0];
+	gi = g->v[0];
+	cf = (int64_t)u * fi + (int64_t)v * gi;
+	cg = (int64_t)q * fi + (int64_t)r * gi;
+	cf >>= 30;
+	cg >>= 30;
+	for (i = 1; i < len; i++) {
+		fi = f->v[i];
+		gi = g->v[i];
+		cf += (int64_t)u * fi + (int64_t)v * gi;
+		cg += (int64_t)q * fi + (int64_t)r * gi;
+		f->v[i - 1] = (int32_t)cf & BN_M30;
+		cf >>= 30;
+		g->v[i - 1] = (int32_t)cg & BN_M30;
+		cg >>= 30;
+	}
+	f->v[len - 1] = (int32_t)cf;
+	g->v[len - 1] = (int32_t)cg;
+}
+
+// brings r from (-2*modulus, modulus) to [0, modulus) and negates it if sign < 0
+static void bn_normalize_30(bn_signed30 *r, int32_t sign, const bn_modinfo *mi)
+{
+	int32_t cond_add, cond_negate;
+	int i;
+
+	cond_add = r->v[8] >> 31;
+	cond_negate = sign >> 31;
+	for (i = 0; i < 9; i++) {
+		r->v[i] += mi->modulus.v[i] & cond_add;
+		r->v[i] = (r->v[i] ^ cond_negate) - cond_negate;
+	}
+	for (i = 0; i < 8; i++) {
+		r->v[i + 1] += r->v[i] >> 30;
+		r->v[i] &= BN_M30;
+	}
+	cond_add = r->v[8] >> 31;
+	for (i = 0; i < 9; i++) {
+		r->v[i] += mi->modulus.v[i] & cond_add;
+	}
+	for (i = 0; i < 8; i++) {
+		r->v[i + 1] += r->v[i] >> 30;
+		r->v[i] &= BN_M30;
+	}
+}
+
+static void bn_to_signed30(bignum256 *x, const bignum256 *prime, bn_signed30 *out)
+{
+	int i;
+	// reduce x modulo prime, both algorithms need 0 <= x < prime
+	bn_fast_mod(x, prime);
+	bn_mod(x, prime);
+	for (i = 0; i < 9; i++) {
+		out->v[i] = (int32_t)x->val[i];
+	}
+}
+
+static void bn_from_signed30(const bn_signed30 *in, bignum256 *x)
+{
+	int i;
+	for (i = 0; i < 9; i++) {
+		x->val[i] = (uint32_t)in->v[i];
+	}
+}
+
+// in field G_prime, constant time.
+// prime must be odd, the input must not be 0 mod prime.
+// the result is smaller than prime
+void bn_inverse_ct(bignum256 *x, const bignum256 *prime)
+{
+	bn_modinfo mi;
+	bn_trans2x2 t;
+	bn_signed30 d = {{0}}, e = {{1}}, f, g;
+	int32_t zeta = -1; // delta = 1/2
+	int i;
+
+	bn_modinfo_init(&mi, prime);
+	f = mi.modulus;
+	bn_to_signed30(x, prime, &g);
+	// 20*30 = 600 divsteps, more than 590 needed for 256-bit inputs
+	for (i = 0; i < 20; i++) {
+		zeta = bn_divsteps_30(zeta, (uint32_t)f.v[0], (uint32_t)g.v[0], &t);
+		bn_update_de_30(&d, &e, &t, &mi);
+		bn_update_fg_30(9, &f, &g, &t);
+	}
+	// f is +1 or -1 now, d is x^-1 times f
+	bn_normalize_30(&d, f.v[8], &mi);
+	bn_from_signed30(&d, x);
+
+	memzero(&d, sizeof(d));
+	memzero(&e, sizeof(e));
+	memzero(&g, sizeof(g));
+	memzero(&t, sizeof(t));
+}
+
+// in field G_prime, variable time, use only with public data.
+// prime must be odd, the input must not be 0 mod prime.
+// the result is smaller than prime
+void bn_inverse_var(bignum256 *x, const bignum256 *prime)
+{
+	bn_modinfo mi;
+	bn_trans2x2 t;
+	bn_signed30 d = {{0}}, e = {{1}}, f, g;
+	int32_t eta = -1; // delta = 1
+	int32_t cond, fn, gn;
+	int j, len = 9;
+
+	bn_modinfo_init(&mi, prime);
+	f = mi.modulus;
+	bn_to_signed30(x, prime, &g);
+	for (;;) {
+		eta = bn_divsteps_30_var(eta, (uint32_t)f.v[0], (uint32_t)g.v[0], &t);
+		bn_update_de_30(&d, &e, &t, &mi);
+		bn_update_fg_30(len, &f, &g, &t);
+		// done when g is zero
+		if (g.v[0] == 0) {
+			cond = 0;
+			for (j = 1; j < len; j++) {
+				cond |= g.v[j];
+			}
+			if (cond == 0) {
+				break;
+			}
+		}
+		// shorten f and g if both top limbs are 0 or -1
+		fn = f.v[len - 1];
+		gn = g.v[len - 1];
+		cond = ((int32_t)len - 2) >> 31;
+		cond |= fn ^ (fn >> 31);
+		cond |= gn ^ (gn >> 31);
+		if (cond == 0) {
+			f.v[len - 2] |= (int32_t)((uint32_t)fn << 30);
+			g.v[len - 2] |= (int32_t)((uint32_t)gn << 30);
+			len--;
+		}
+	}
+	bn_normalize_30(&d, f.v[len - 1], &mi);
+	bn_from_signed30(&d, x);
+}
+
 void bn_normalize(bignum256 *a) {
 	bn_addi(a, 0);
 }
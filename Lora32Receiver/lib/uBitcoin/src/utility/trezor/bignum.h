@@ -130,12 +130,22 @@ void bn_mod(bignum256 *x, const bignum256 *prime);
 
 void bn_multiply(const bignum256 *k, bignum256 *x, const bignum256 *prime);
 
+void bn_square(bignum256 *x, const bignum256 *prime);
+
+void bn_mul_shift_384(const bignum256 *a, const bignum256 *b, bignum256 *res);
+
 void bn_fast_mod(bignum256 *x, const bignum256 *prime);
 
 void bn_sqrt(bignum256 *x, const bignum256 *prime);
 
 void bn_inverse(bignum256 *x, const bignum256 *prime);
 
+// safegcd inversion, constant time, for secret values
+void bn_inverse_ct(bignum256 *x, const bignum256 *prime);
+
+// safegcd inversion, variable time, only for public values
+void bn_inverse_var(bignum256 *x, const bignum256 *prime);
+
 void bn_normalize(bignum256 *a);
 
 void bn_add(bignum256 *a, const bignum256 *b);
@@ -0,0 +1,75 @@
+#include <string.h>
+#include "chacha20.h"
+#include "memzero.h"
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d) \
+	a += b; d ^= a; d = ROTL32(d, 16); \
+	c += d; b ^= c; b = ROTL32(b, 12); \
+	a += b; d ^= a; d = ROTL32(d, 8); \
+	c += d; b ^= c; b = ROTL32(b, 7);
+
+static uint32_t read_le32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void chacha20_init(chacha20_ctx *ctx, const uint8_t key[32], const uint8_t nonce[12], uint32_t counter)
+{
+	// "expand 32-byte k"
+	ctx->state[0] = 0x61707865;
+	ctx->state[1] = 0x3320646e;
+	ctx->state[2] = 0x79622d32;
+	ctx->state[3] = 0x6b206574;
+	for (int i = 0; i < 8; i++) {
+		ctx->state[4 + i] = read_le32(key + 4 * i);
+	}
+	ctx->state[12] = counter;
+	for (int i = 0; i < 3; i++) {
+		ctx->state[13 + i] = read_le32(nonce + 4 * i);
+	}
+}
+
+void chacha20_block(chacha20_ctx *ctx, uint8_t out[64])
+{
+	uint32_t x[16];
+	memcpy(x, ctx->state, sizeof(x));
+	for (int i = 0; i < 10; i++) {
+		// columns
+		QUARTERROUND(x[0], x[4], x[8],  x[12]);
+		QUARTERROUND(x[1], x[5], x[9],  x[13]);
+		QUARTERROUND(x[2], x[6], x[10], x[14]);
+		QUARTERROUND(x[3], x[7], x[11], x[15]);
+		// diagonals
+		QUARTERROUND(x[0], x[5], x[10], x[15]);
+		QUARTERROUND(x[1], x[6], x[11], x[12]);
+		QUARTERROUND(x[2], x[7], x[8],  x[13]);
+		QUARTERROUND(x[3], x[4], x[9],  x[14]);
+	}
+	for (int i = 0; i < 16; i++) {
+		uint32_t v = x[i] + ctx->state[i];
+		out[4 * i]     = v & 0xFF;
+		out[4 * i + 1] = (v >> 8) & 0xFF;
+		out[4 * i + 2] = (v >> 16) & 0xFF;
+		out[4 * i + 3] = v >> 24;
+	}
+	ctx->state[12]++;
+	memzero(x, sizeof(x));
+}
+
+void chacha20_xor(chacha20_ctx *ctx, const uint8_t *in, uint8_t *out, size_t len)
+{
+	uint8_t block[64];
+	while (len > 0) {
+		size_t n = len < sizeof(block) ? len : sizeof(block);
+		chacha20_block(ctx, block);
+		for (size_t i = 0; i < n; i++) {
+			out[i] = in[i] ^ block[i];
+		}
+		in += n;
+		out += n;
+		len -= n;
+	}
+	memzero(block, sizeof(block));
+}
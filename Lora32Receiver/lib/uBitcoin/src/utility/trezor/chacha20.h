@@ -0,0 +1,28 @@
+#ifndef __CHACHA20_H__
+#define __CHACHA20_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ChaCha20 as in RFC 8439: 256-bit key, 96-bit nonce, 32-bit block counter
+typedef struct {
+	uint32_t state[16];
+} chacha20_ctx;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+void chacha20_init(chacha20_ctx *ctx, const uint8_t key[32], const uint8_t nonce[12], uint32_t counter);
+// writes the next 64 bytes of the keystream and advances the counter
+void chacha20_block(chacha20_ctx *ctx, uint8_t out[64]);
+// xors len bytes with the keystream, in and out may be the same buffer.
+// every call starts with a new block
+void chacha20_xor(chacha20_ctx *ctx, const uint8_t *in, uint8_t *out, size_t len);
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif
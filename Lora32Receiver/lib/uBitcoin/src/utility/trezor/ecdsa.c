@@ -36,6 +36,7 @@
 #include "secp256k1.h"
 #include "rfc6979.h"
 #include "memzero.h"
+#include "prof.h"
 
 // Set cp2 = cp1
 void point_copy(const curve_point *cp1, curve_point *cp2)
@@ -71,7 +72,7 @@ void point_add(const ecdsa_curve *curve, const curve_point *cp1, curve_point *cp
 
 	// xr = lambda^2 - x1 - x2
 	xr = lambda;
-	bn_multiply(&xr, &xr, &curve->prime);
+	bn_square(&xr, &curve->prime);
 	yr = cp1->x;
 	bn_addmod(&yr, &(cp2->x), &curve->prime);
 	bn_subtractmod(&xr, &yr, &xr, &curve->prime);
@@ -108,14 +109,14 @@ void point_double(const ecdsa_curve *curve, curve_point *cp)
 	bn_inverse(&lambda, &curve->prime);
 
 	xr = cp->x;
-	bn_multiply(&xr, &xr, &curve->prime);
+	bn_square(&xr, &curve->prime);
 	bn_mult_k(&xr, 3, &curve->prime);
 	bn_subi(&xr, -curve->a, &curve->prime);
 	bn_multiply(&xr, &lambda, &curve->prime);
 
 	// xr = lambda^2 - 2*x
 	xr = lambda;
-	bn_multiply(&xr, &xr, &curve->prime);
+	bn_square(&xr, &curve->prime);
 	yr = cp->x;
 	bn_lshift(&yr);
 	bn_subtractmod(&xr, &yr, &xr, &curve->prime);
@@ -223,7 +224,7 @@ void jacobian_to_curve(const jacobian_curve_point *jp, curve_point *p, const big
 	bn_inverse(&p->y, prime);
 	// p->y = z^-1
 	p->x = p->y;
-	bn_multiply(&p->x, &p->x, prime);
+	bn_square(&p->x, prime);
 	// p->x = z^-2
 	bn_multiply(&p->x, &p->y, prime);
 	// p->y = z^-3
@@ -235,6 +236,14 @@ void jacobian_to_curve(const jacobian_curve_point *jp, curve_point *p, const big
 	bn_mod(&p->y, prime);
 }
 
+// jp = p with z = 1, no randomization
+static void curve_to_jacobian_var(const curve_point *p, jacobian_curve_point *jp)
+{
+	jp->x = p->x;
+	jp->y = p->y;
+	bn_one(&jp->z);
+}
+
 void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const ecdsa_curve *curve) {
 	bignum256 r, h, r2;
 	bignum256 hcby, hsqx;
@@ -278,13 +287,13 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 	 */
 
 	xz = p2->z;
-	bn_multiply(&xz, &xz, prime); // xz = z2^2
+	bn_square(&xz, prime); // xz = z2^2
 	yz = p2->z;
 	bn_multiply(&xz, &yz, prime); // yz = z2^3
 
 	if (a != 0) {
 		az  = xz;
-		bn_multiply(&az, &az, prime);   // az = z2^4
+		bn_square(&az, prime);   // az = z2^4
 		bn_mult_k(&az, -a, prime);      // az = -az2^4
 	}
 
@@ -311,7 +320,7 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 	// yz = y1' + y2
 
 	r2 = p2->x;
-	bn_multiply(&r2, &r2, prime);
+	bn_square(&r2, prime);
 	bn_mult_k(&r2, 3, prime);
 
 	if (a != 0) {
@@ -324,7 +333,7 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 
 	// hsqx = h^2
 	hsqx = h;
-	bn_multiply(&hsqx, &hsqx, prime);
+	bn_square(&hsqx, prime);
 
 	// hcby = h^3
 	hcby = h;
@@ -341,7 +350,7 @@ void point_jacobian_add(const curve_point *p1, jacobian_curve_point *p2, const e
 
 	// x3 = r^2 - h^2 (x1 + x2)
 	p2->x = r;
-	bn_multiply(&p2->x, &p2->x, prime);
+	bn_square(&p2->x, prime);
 	bn_subtractmod(&p2->x, &hsqx, &p2->x, prime);
 	bn_fast_mod(&p2->x, prime);
 
@@ -384,22 +393,22 @@ void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
 	 */
 
 	m = p->x;
-	bn_multiply(&m, &m, prime);
+	bn_square(&m, prime);
 	bn_mult_k(&m, 3, prime);
 
 	az4 = p->z;
-	bn_multiply(&az4, &az4, prime);
-	bn_multiply(&az4, &az4, prime);
+	bn_square(&az4, prime);
+	bn_square(&az4, prime);
 	bn_mult_k(&az4, -curve->a, prime);
 	bn_subtractmod(&m, &az4, &m, prime);
 	bn_mult_half(&m, prime);
 
 	// msq = m^2
 	msq = m;
-	bn_multiply(&msq, &msq, prime);
+	bn_square(&msq, prime);
 	// ysq = y^2
 	ysq = p->y;
-	bn_multiply(&ysq, &ysq, prime);
+	bn_square(&ysq, prime);
 	// xysq = xy^2
 	xysq = p->x;
 	bn_multiply(&ysq, &xysq, prime);
@@ -417,14 +426,291 @@ void point_jacobian_double(jacobian_curve_point *p, const ecdsa_curve *curve) {
 	// y3 = m*(xy^2 - x3) - y^4
 	bn_subtractmod(&xysq, &p->x, &p->y, prime);
 	bn_multiply(&m, &p->y, prime);
-	bn_multiply(&ysq, &ysq, prime);
+	bn_square(&ysq, prime);
 	bn_subtractmod(&p->y, &ysq, &p->y, prime);
 	bn_fast_mod(&p->y, prime);
 }
 
+// bits pos .. pos+count-1 of a, count <= 30
+static uint32_t window_bits(const bignum256 *a, int pos, int count)
+{
+	int limb = pos / 30;
+	int shift = pos % 30;
+	uint32_t bits = a->val[limb] >> shift;
+	if (shift + count > 30) {
+		bits |= a->val[limb + 1] << (30 - shift);
+	}
+	return bits & ((1u << count) - 1);
+}
+
+#if USE_SECP256K1_GLV
+
+// secp256k1 has an endomorphism lambda * (x, y) = (beta * x, y).
+// k is split into k = k1 + lambda * k2 (mod order) with |k1|, |k2| < 2^128,
+// so k * p = k1 * p + k2 * (lambda * p) needs only 128 doublings.
+// Constants are taken from libsecp256k1.
+static const bignum256 glv_lambda = {/*.val =*/{0x1b23bd72, 0x3c0a59f0, 0x816678d, 0xb88ba88, 0x12645a12, 0x18700a20, 0x30e0a52, 0x2b533017, 0x5363}};
+static const bignum256 glv_beta = {/*.val =*/{0x319501ee, 0x4e5b0a1, 0x2f58995c, 0x3c125d44, 0x3434e99c, 0x111e7ab0, 0x7106e6, 0x1a8ad95f, 0x7ae9}};
+static const bignum256 glv_minus_b1 = {/*.val =*/{0xabfe4c3, 0x3d51fea4, 0x10e88286, 0x10dfb580, 0xe4, 0x0, 0x0, 0x0, 0x0}};
+static const bignum256 glv_minus_b2 = {/*.val =*/{0x3db1562c, 0x1d9736a0, 0x374346dd, 0xa02b141, 0x3ffffe8a, 0x3fffffff, 0x3fffffff, 0x3fffffff, 0xffff}};
+static const bignum256 glv_g1 = {/*.val =*/{0x5dbb031, 0x224c8269, 0x1e8ca7fe, 0x2aa2851c, 0x4eb153d, 0x3243924a, 0x6bcde86, 0x348869f5, 0x3086}};
+static const bignum256 glv_g2 = {/*.val =*/{0xac47f71, 0x15c6d2ba, 0x1f506c61, 0x4822b27, 0x3fe4c422, 0x11fea42a, 0x288286f5, 0x1fb58043, 0xe443}};
+
+// k1 is either below 2^128 or order - k1 is.
+// In the second case k1 is negated and 0xffffffff is returned, 0 otherwise.
+// The timing of this function does not depend on k1.
+static uint32_t glv_abs(bignum256 *k1, const bignum256 *order)
+{
+	bignum256 neg;
+	uint32_t high = (k1->val[4] >> 8) | k1->val[5] | k1->val[6] | k1->val[7] | k1->val[8];
+	uint32_t sign = (high | -high) >> 31;
+	bn_subtract(order, k1, &neg);
+	bn_cmov(k1, sign, &neg, k1);
+	memzero(&neg, sizeof(neg));
+	return -sign;
+}
+
+// k = k1 + lambda * k2 (mod order), k1 and k2 are replaced with their
+// absolute values below 2^128 and the signs are returned in sign1, sign2.
+// The timing of this function does not depend on k.
+static void glv_split(const bignum256 *k, bignum256 *k1, bignum256 *k2, uint32_t *sign1, uint32_t *sign2)
+{
+	const bignum256 *order = &secp256k1.order;
+	bignum256 c1, c2;
+
+	// c1 = round(k * g1 / 2^384), c2 = round(k * g2 / 2^384)
+	bn_mul_shift_384(k, &glv_g1, &c1);
+	bn_mul_shift_384(k, &glv_g2, &c2);
+	// k2 = c1 * (-b1) + c2 * (-b2)
+	bn_multiply(&glv_minus_b1, &c1, order);
+	bn_multiply(&glv_minus_b2, &c2, order);
+	bn_addmod(&c1, &c2, order);
+	bn_mod(&c1, order);
+	*k2 = c1;
+	// k1 = k - lambda * k2
+	bn_multiply(&glv_lambda, &c1, order);
+	bn_mod(&c1, order);
+	bn_subtractmod(k, &c1, k1, order);
+	bn_fast_mod(k1, order);
+	bn_mod(k1, order);
+
+	*sign1 = glv_abs(k1, order);
+	*sign2 = glv_abs(k2, order);
+	memzero(&c1, sizeof(c1));
+	memzero(&c2, sizeof(c2));
+}
+
+// pmult1[i] = (2*i+1) * p1 where p1 = (-1)^sign1 p,
+// pmult2[i] = (2*i+1) * p2 where p2 = (-1)^sign2 lambda * p.
+static void glv_tables(const ecdsa_curve *curve, const curve_point *p, uint32_t sign1, uint32_t sign2, curve_point pmult1[8], curve_point pmult2[8])
+{
+	const bignum256 *prime = &curve->prime;
+	bignum256 neg;
+	int i;
+
+	pmult1[0] = *p;
+	bn_subtract(prime, &p->y, &neg);
+	bn_cmov(&pmult1[0].y, sign1 & 1, &neg, &p->y);
+	// store p1^2 temporarily in pmult1[7]
+	pmult1[7] = pmult1[0];
+	point_double(curve, &pmult1[7]);
+	for (i = 1; i < 8; i++) {
+		pmult1[i] = pmult1[7];
+		point_add(curve, &pmult1[i-1], &pmult1[i]);
+	}
+	// the endomorphism is cheap, no need for more point additions
+	for (i = 0; i < 8; i++) {
+		pmult2[i].x = glv_beta;
+		bn_multiply(&pmult1[i].x, &pmult2[i].x, prime);
+		bn_mod(&pmult2[i].x, prime);
+		bn_subtract(prime, &pmult1[i].y, &neg);
+		bn_cmov(&pmult2[i].y, (sign1 ^ sign2) & 1, &neg, &pmult1[i].y);
+	}
+}
+
+// k * p on secp256k1 with the endomorphism, same approach as the width-w NAF
+// method in point_multiply below but with two 128 bit scalars.
+// The timing does not depend on k, use it for secret scalars.
+static void point_multiply_glv(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	assert (bn_is_less(k, &curve->order));
+
+	int i, j;
+	static CONFIDENTIAL bignum256 a[2];
+	uint32_t skew[2];
+	uint32_t sign1, sign2;
+	uint32_t bits, sign, nsign;
+	static CONFIDENTIAL jacobian_curve_point jres, jtmp;
+	curve_point pmult[2][8];
+	curve_point neg;
+	const bignum256 *prime = &curve->prime;
+
+	// special case 0*p:  just return zero. We don't care about constant time.
+	if (bn_is_zero(k)) {
+		point_set_infinity(res);
+		return;
+	}
+
+	glv_split(k, &a[0], &a[1], &sign1, &sign2);
+	glv_tables(curve, p, sign1, sign2, pmult[0], pmult[1]);
+
+	// Both halves have to be odd for the recoding, even ones are
+	// incremented and the extra point is subtracted in the end.
+	// Adding 2^128 makes the top digit positive like 2^256 in point_multiply.
+	for (j = 0; j < 2; j++) {
+		skew[j] = 1 - (a[j].val[0] & 1);
+		a[j].val[0] |= 1;
+		bn_setbit(&a[j], 128);
+	}
+
+	// res = sum_{i=0..31} (a1[i] * p1 + a2[i] * p2) * 16^i,
+	// digits a[i] are odd with |a[i]| < 16 and the top ones are positive.
+	bits = window_bits(&a[0], 124, 5);
+	curve_to_jacobian(&pmult[0][(bits & 15) >> 1], &jres, prime);
+	bits = window_bits(&a[1], 124, 5);
+	point_jacobian_add(&pmult[1][(bits & 15) >> 1], &jres, curve);
+	sign = 0;
+	for (i = 30; i >= 0; i--) {
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+		point_jacobian_double(&jres, curve);
+
+		for (j = 0; j < 2; j++) {
+			bits = window_bits(&a[j], 4 * i, 5);
+			nsign = (bits >> 4) - 1;
+			bits ^= nsign;
+			bits &= 15;
+			// negate last result to make signs of this digit and the
+			// previous one equal.
+			conditional_negate(sign ^ nsign, &jres.z, prime);
+			point_jacobian_add(&pmult[j][bits >> 1], &jres, curve);
+			sign = nsign;
+		}
+	}
+	conditional_negate(sign, &jres.z, prime);
+
+	// subtract p1 and p2 for incremented halves, always computed
+	for (j = 0; j < 2; j++) {
+		neg.x = pmult[j][0].x;
+		bn_subtract(prime, &pmult[j][0].y, &neg.y);
+		jtmp = jres;
+		point_jacobian_add(&neg, &jtmp, curve);
+		bn_cmov(&jres.x, skew[j], &jtmp.x, &jres.x);
+		bn_cmov(&jres.y, skew[j], &jtmp.y, &jres.y);
+		bn_cmov(&jres.z, skew[j], &jtmp.z, &jres.z);
+	}
+	jacobian_to_curve(&jres, res, prime);
+	memzero(a, sizeof(a));
+	memzero(&jres, sizeof(jres));
+	memzero(&jtmp, sizeof(jtmp));
+	memzero(pmult, sizeof(pmult));
+	memzero(skew, sizeof(skew));
+}
+
+// width-5 NAF of k < 2^128: digits are zero or odd with |naf[i]| < 16,
+// returns the number of digits
+static int glv_wnaf(const bignum256 *k, int8_t naf[129])
+{
+	int bit = 0, len = 0;
+	uint32_t carry = 0;
+	memset(naf, 0, 129);
+	while (bit < 129) {
+		if (window_bits(k, bit, 1) == carry) {
+			bit++;
+			continue;
+		}
+		int now = 129 - bit < 5 ? 129 - bit : 5;
+		int32_t word = window_bits(k, bit, now) + carry;
+		carry = (word >> 4) & 1;
+		word -= carry << 5;
+		naf[bit] = word;
+		bit += now;
+		len = bit;
+	}
+	return len;
+}
+
+// jp += d * p where d is a NAF digit and pmult[i] = (2*i+1) * p.
+// started is 0 while jp is the point at infinity.
+static void glv_add_digit(const ecdsa_curve *curve, const curve_point pmult[8], int d, jacobian_curve_point *jp, int *started)
+{
+	curve_point q = pmult[(d < 0 ? -d : d) >> 1];
+	bignum256 z;
+	if (d < 0) {
+		bn_subtract(&curve->prime, &pmult[(-d) >> 1].y, &q.y);
+	}
+	if (!*started) {
+		curve_to_jacobian_var(&q, jp);
+		*started = 1;
+		return;
+	}
+	point_jacobian_add(&q, jp, curve);
+	// adding the negation of jp gives z = 0
+	z = jp->z;
+	bn_fast_mod(&z, &curve->prime);
+	bn_mod(&z, &curve->prime);
+	if (bn_is_zero(&z)) {
+		*started = 0;
+	}
+}
+
+static void point_multiply_glv_var(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	assert (bn_is_less(k, &curve->order));
+
+	int i, len;
+	int started = 0;
+	bignum256 k1, k2;
+	uint32_t sign1, sign2;
+	int8_t naf1[129], naf2[129];
+	jacobian_curve_point jres;
+	curve_point pmult1[8], pmult2[8];
+
+	if (bn_is_zero(k) || point_is_infinity(p)) {
+		point_set_infinity(res);
+		return;
+	}
+
+	glv_split(k, &k1, &k2, &sign1, &sign2);
+	glv_tables(curve, p, sign1, sign2, pmult1, pmult2);
+	len = glv_wnaf(&k1, naf1);
+	i = glv_wnaf(&k2, naf2);
+	if (i > len) {
+		len = i;
+	}
+
+	for (i = len - 1; i >= 0; i--) {
+		if (started) {
+			point_jacobian_double(&jres, curve);
+		}
+		if (naf1[i]) {
+			glv_add_digit(curve, pmult1, naf1[i], &jres, &started);
+		}
+		if (naf2[i]) {
+			glv_add_digit(curve, pmult2, naf2[i], &jres, &started);
+		}
+	}
+	if (!started) {
+		point_set_infinity(res);
+		return;
+	}
+	jacobian_to_curve(&jres, res, &curve->prime);
+}
+
+#endif
+
 // res = k * p
 void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
 {
+	UBTC_PROF_ENTER();
+#if USE_SECP256K1_GLV
+	if (curve == &secp256k1) {
+		point_multiply_glv(curve, k, p, res);
+		UBTC_PROF_LEAVE(UBTC_PROF_POINT_MULTIPLY);
+		return;
+	}
+#endif
 	// this algorithm is loosely based on
 	//  Katsuyuki Okeya and Tsuyoshi Takagi, The Width-w NAF Method Provides
 	//  Small Memory and Fast Elliptic Scalar Multiplications Secure against
@@ -542,101 +828,201 @@ void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_po
 	jacobian_to_curve(&jres, res, prime);
 	memzero(&a, sizeof(a));
 	memzero(&jres, sizeof(jres));
+	UBTC_PROF_LEAVE(UBTC_PROF_POINT_MULTIPLY);
 }
 
-#if USE_PRECOMPUTED_CP
+// res = k * p, the timing depends on k.
+// Only use it for public scalars, like in signature verification.
+void point_multiply_var(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res)
+{
+	UBTC_PROF_ENTER();
+#if USE_SECP256K1_GLV
+	if (curve == &secp256k1) {
+		point_multiply_glv_var(curve, k, p, res);
+		UBTC_PROF_LEAVE(UBTC_PROF_POINT_MULTIPLY_VAR);
+		return;
+	}
+#endif
+	point_multiply(curve, k, p, res);
+	UBTC_PROF_LEAVE(UBTC_PROF_POINT_MULTIPLY_VAR);
+}
 
-// res = k * G
+// number of points in a table for window size w
+size_t point_table_length(int w)
+{
+	return ((256 + w - 1) / w) << (w - 1);
+}
+
+// number of points converted to affine coordinates with one inversion
+#define TABLE_BATCH 16
+
+// table[i * 2^(w-1) + j] = (2*j+1) * 2^(w*i) * p, same layout as curve->cp
+void point_table_build(const ecdsa_curve *curve, const curve_point *p, int w, curve_point *table)
+{
+	int i, j, m, n;
+	const int windows = (256 + w - 1) / w;
+	const int points = 1 << (w - 1);
+	const bignum256 *prime = &curve->prime;
+	curve_point base = *p;
+	curve_point twice, next;
+	curve_point *dst[TABLE_BATCH];
+	jacobian_curve_point jp;
+	bignum256 z[TABLE_BATCH], c[TABLE_BATCH];
+	bignum256 inv, zinv, zinv2;
+	assert (2 <= w && w <= 8);
+
+	for (i = 0; i < windows; i++) {
+		// base = 2^(w*i) * p, entries are base, 3*base, ... and
+		// the last one 2^w * base is the base of the next window
+		twice = base;
+		point_double(curve, &twice);
+		curve_to_jacobian_var(&base, &jp);
+		for (j = 0; j <= points; j += n) {
+			n = points + 1 - j;
+			if (n > TABLE_BATCH) {
+				n = TABLE_BATCH;
+			}
+			for (m = 0; m < n; m++) {
+				dst[m] = (j + m < points) ? &table[i * points + j + m] : &next;
+				dst[m]->x = jp.x;
+				dst[m]->y = jp.y;
+				z[m] = jp.z;
+				if (j + m + 1 < points) {
+					point_jacobian_add(&twice, &jp, curve);
+				} else if (j + m + 1 == points) {
+					point_jacobian_add(&base, &jp, curve);
+				}
+			}
+			// one inversion for all z: c[m] = z[0] * ... * z[m]
+			c[0] = z[0];
+			for (m = 1; m < n; m++) {
+				c[m] = c[m - 1];
+				bn_multiply(&z[m], &c[m], prime);
+			}
+			inv = c[n - 1];
+			bn_inverse_var(&inv, prime); // table of a public point
+			for (m = n - 1; m >= 0; m--) {
+				// inv = (z[0] * ... * z[m])^-1
+				zinv = inv;
+				if (m > 0) {
+					bn_multiply(&c[m - 1], &zinv, prime);
+					bn_multiply(&z[m], &inv, prime);
+				}
+				zinv2 = zinv;
+				bn_square(&zinv2, prime);
+				bn_multiply(&zinv2, &dst[m]->x, prime);
+				bn_multiply(&zinv2, &zinv, prime);
+				bn_multiply(&zinv, &dst[m]->y, prime);
+				bn_mod(&dst[m]->x, prime);
+				bn_mod(&dst[m]->y, prime);
+			}
+		}
+		base = next;
+	}
+}
+
+// res = k * p where table is built by point_table_build for p
 // k must be a normalized number with 0 <= k < curve->order
-void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+void point_table_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_point *table, int w, curve_point *res)
 {
 	assert (bn_is_less(k, &curve->order));
+	assert (2 <= w && w <= 8);
 
 	int i, j;
+	const int windows = (256 + w - 1) / w;
+	const int points = 1 << (w - 1);
+	const int top = w * windows;
 	static CONFIDENTIAL bignum256 a;
+	bignum256 t;
 	uint32_t is_even = (k->val[0] & 1) - 1;
-	uint32_t lowbits;
+	uint32_t bits;
 	static CONFIDENTIAL jacobian_curve_point jres;
 	const bignum256 *prime = &curve->prime;
 
 	// is_even = 0xffffffff if k is even, 0 otherwise.
 
-	// add 2^256.
+	// add 2^top where top = w * windows >= 256.
 	// make number odd: subtract curve->order if even
-	uint32_t tmp = 1;
 	uint32_t is_non_zero = 0;
-	for (j = 0; j < 8; j++) {
+	for (j = 0; j < 9; j++) {
 		is_non_zero |= k->val[j];
-		tmp += 0x3fffffff + k->val[j] - (curve->order.val[j] & is_even);
-		a.val[j] = tmp & 0x3fffffff;
-		tmp >>= 30;
+		t.val[j] = curve->order.val[j] & is_even;
 	}
-	is_non_zero |= k->val[j];
-	a.val[j] = tmp + 0xffff + k->val[j] - (curve->order.val[j] & is_even);
+	a = *k;
+	a.val[top / 30] |= 1u << (top % 30);
+	bn_subtract(&a, &t, &a);
 	assert((a.val[0] & 1) != 0);
 
-	// special case 0*G:  just return zero. We don't care about constant time.
+	// special case 0*p:  just return zero. We don't care about constant time.
 	if (!is_non_zero) {
 		point_set_infinity(res);
 		return;
 	}
 
-	// Now a = k + 2^256 (mod curve->order) and a is odd.
+	// Now a = k + 2^top (mod curve->order) and a is odd.
 	//
 	// The idea is to bring the new a into the form.
-	// sum_{i=0..64} a[i] 16^i,  where |a[i]| < 16 and a[i] is odd.
+	// sum_{i=0..n} a[i] 2^(w*i),  where |a[i]| < 2^w and a[i] is odd.
 	// a[0] is odd, since a is odd.  If a[i] would be even, we can
-	// add 1 to it and subtract 16 from a[i-1].  Afterwards,
-	// a[64] = 1, which is the 2^256 that we added before.
+	// add 1 to it and subtract 2^w from a[i-1].  Afterwards,
+	// a[n] = 1, which is the 2^top that we added before.
 	//
-	// Since k = a - 2^256 (mod curve->order), we can compute
-	//   k*G = sum_{i=0..63} a[i] 16^i * G
+	// Since k = a - 2^top (mod curve->order), we can compute
+	//   k*p = sum_{i=0..n-1} a[i] 2^(w*i) * p
 	//
-	// We have a big table curve->cp that stores all possible
-	// values of |a[i]| 16^i * G.
-	// curve->cp[i][j] = (2*j+1) * 16^i * G
-
-	// now compute  res = sum_{i=0..63} a[i] * 16^i * G step by step.
-	// initial res = |a[0]| * G.  Note that a[0] = a & 0xf if (a&0x10) != 0
-	// and - (16 - (a & 0xf)) otherwise.   We can compute this as
-	//   ((a ^ (((a >> 4) & 1) - 1)) & 0xf) >> 1
+	// We have a big table that stores all possible
+	// values of |a[i]| 2^(w*i) * p.
+	// table[i * 2^(w-1) + j] = (2*j+1) * 2^(w*i) * p
+
+	// now compute  res = sum_{i=0..n-1} a[i] * 2^(w*i) * p step by step.
+	// initial res = |a[0]| * p.  Note that a[0] = a & (2^w-1) if a & 2^w != 0
+	// and - (2^w - (a & (2^w-1))) otherwise.   We can compute this as
+	//   ((a ^ (((a >> w) & 1) - 1)) & (2^w-1)) >> 1
 	// since a is odd.
-	lowbits = a.val[0] & ((1 << 5) - 1);
-	lowbits ^= (lowbits >> 4) - 1;
-	lowbits &= 15;
-	curve_to_jacobian(&curve->cp[0][lowbits >> 1], &jres, prime);
-	for (i = 1; i < 64; i ++) {
-		// invariant res = sign(a[i-1]) sum_{j=0..i-1} (a[j] * 16^j * G)
-
-		// shift a by 4 places.
-		for (j = 0; j < 8; j++) {
-			a.val[j] = (a.val[j] >> 4) | ((a.val[j + 1] & 0xf) << 26);
-		}
-		a.val[j] >>= 4;
-		// a = old(a)>>(4*i)
-		// a is even iff sign(a[i-1]) = -1
-
-		lowbits = a.val[0] & ((1 << 5) - 1);
-		lowbits ^= (lowbits >> 4) - 1;
-		lowbits &= 15;
+	bits = window_bits(&a, 0, w + 1);
+	bits ^= (bits >> w) - 1;
+	bits &= (1u << w) - 1;
+	curve_to_jacobian(&table[bits >> 1], &jres, prime);
+	for (i = 1; i < windows; i ++) {
+		// invariant res = sign(a[i-1]) sum_{j=0..i-1} (a[j] * 2^(w*j) * p)
+
+		// bits = lowbits(old(a)>>(w*i)),
+		// the lowest bit is set iff sign(a[i-1]) = sign(a[i])
+		bits = window_bits(&a, w * i, w + 1);
+		bits ^= (bits >> w) - 1;
+		bits &= (1u << w) - 1;
 		// negate last result to make signs of this round and the
 		// last round equal.
-		conditional_negate((lowbits & 1) - 1, &jres.y, prime);
+		conditional_negate((bits & 1) - 1, &jres.y, prime);
 
 		// add odd factor
-		point_jacobian_add(&curve->cp[i][lowbits >> 1], &jres, curve);
+		point_jacobian_add(&table[i * points + (bits >> 1)], &jres, curve);
 	}
-	conditional_negate(((a.val[0] >> 4) & 1) - 1, &jres.y, prime);
+	conditional_negate(window_bits(&a, top, 1) - 1, &jres.y, prime);
 	jacobian_to_curve(&jres, res, prime);
 	memzero(&a, sizeof(a));
+	memzero(&t, sizeof(t));
 	memzero(&jres, sizeof(jres));
 }
 
+#if USE_PRECOMPUTED_CP
+
+// res = k * G
+// k must be a normalized number with 0 <= k < curve->order
+void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
+{
+	UBTC_PROF_ENTER();
+	point_table_multiply(curve, k, &curve->cp[0][0], UBTC_ECMULT_GEN_WINDOW, res);
+	UBTC_PROF_LEAVE(UBTC_PROF_SCALAR_MULTIPLY);
+}
+
 #else
 
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res)
 {
+	UBTC_PROF_ENTER();
 	point_multiply(curve, k, &curve->G, res);
+	UBTC_PROF_LEAVE(UBTC_PROF_SCALAR_MULTIPLY);
 }
 
 #endif
@@ -723,13 +1109,8 @@ int ecdsa_sign(const ecdsa_curve *curve, HasherType hasher_sign, const uint8_t *
 
 }
 
-// uses secp256k1 curve
-// priv_key is a 32 byte big endian stored number
-// sig is 64 bytes long array for the signature
-// digest is 32 bytes of digest
-// is_canonical is an optional function that checks if the signature
-// conforms to additional coin-specific rules.
-int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
+// rng is the initialized rfc6979 generator, ignored without USE_RFC6979
+static int sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, rfc6979_state *rng, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
 {
 	int i;
 	curve_point R;
@@ -737,9 +1118,8 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 	bignum256 *s = &R.y;
 	uint8_t by; // signature recovery byte
 
-#if USE_RFC6979
-	rfc6979_state rng;
-	init_rfc6979(priv_key, digest, &rng);
+#if !USE_RFC6979
+	(void)rng;
 #endif
 
 	bn_read_be(digest, &z);
@@ -748,7 +1128,7 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 
 #if USE_RFC6979
 		// generate K deterministically
-		generate_k_rfc6979(&k, &rng);
+		generate_k_rfc6979(&k, rng);
 		// if k is too big or too small, we don't like it
 		if (bn_is_zero(&k) || !bn_is_less(&k, &curve->order)) {
 			continue;
@@ -806,9 +1186,6 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 
 		memzero(&k, sizeof(k));
 		memzero(&randk, sizeof(randk));
-#if USE_RFC6979
-		memzero(&rng, sizeof(rng));
-#endif
 		return 0;
 	}
 
@@ -816,10 +1193,43 @@ int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const u
 	// -> fail with an error
 	memzero(&k, sizeof(k));
 	memzero(&randk, sizeof(randk));
+	return -1;
+}
+
+// uses secp256k1 curve
+// priv_key is a 32 byte big endian stored number
+// sig is 64 bytes long array for the signature
+// digest is 32 bytes of digest
+// is_canonical is an optional function that checks if the signature
+// conforms to additional coin-specific rules.
+int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
+{
+	UBTC_PROF_ENTER();
+	int res;
+	rfc6979_state rng;
 #if USE_RFC6979
+	init_rfc6979(priv_key, digest, &rng);
+#endif
+	res = sign_digest(curve, priv_key, &rng, digest, sig, pby, is_canonical);
 	memzero(&rng, sizeof(rng));
+	UBTC_PROF_LEAVE(UBTC_PROF_ECDSA_SIGN);
+	return res;
+}
+
+// same as ecdsa_sign_digest with the key dependent part of the
+// rfc6979 initialization done once by prepare_rfc6979_key
+int ecdsa_sign_digest_key(const ecdsa_curve *curve, const rfc6979_key *key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]))
+{
+	UBTC_PROF_ENTER();
+	int res;
+	rfc6979_state rng;
+#if USE_RFC6979
+	init_rfc6979_key(key, digest, &rng);
 #endif
-	return -1;
+	res = sign_digest(curve, key->priv_key, &rng, digest, sig, pby, is_canonical);
+	memzero(&rng, sizeof(rng));
+	UBTC_PROF_LEAVE(UBTC_PROF_ECDSA_SIGN);
+	return res;
 }
 
 void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key)
@@ -1057,16 +1467,16 @@ int ecdsa_recover_pub_from_sig (const ecdsa_curve *curve, uint8_t *pub_key, cons
 	bn_subtractmod(&curve->order, &e, &e, &curve->order);
 	bn_fast_mod(&e, &curve->order);
 	bn_mod(&e, &curve->order);
-	// r := r^-1
-	bn_inverse(&r, &curve->order);
+	// r := r^-1, r is public
+	bn_inverse_var(&r, &curve->order);
 	// cp := s * R = s * k *G
-	point_multiply(curve, &s, &cp, &cp);
+	point_multiply_var(curve, &s, &cp, &cp);
 	// cp2 := -digest * G
 	scalar_multiply(curve, &e, &cp2);
 	// cp := (s * k - digest) * G = (r*priv) * G = r * Pub
 	point_add(curve, &cp2, &cp);
 	// cp := r^{-1} * r * Pub = Pub
-	point_multiply(curve, &r, &cp, &cp);
+	point_multiply_var(curve, &r, &cp, &cp);
 	pub_key[0] = 0x04;
 	bn_write_be(&cp.x, pub_key + 1);
 	bn_write_be(&cp.y, pub_key + 33);
@@ -1074,15 +1484,12 @@ int ecdsa_recover_pub_from_sig (const ecdsa_curve *curve, uint8_t *pub_key, cons
 }
 
 // returns 0 if verification succeeded
-int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest)
+// table is NULL or built by point_table_build for pub with window w
+static int verify_digest(const ecdsa_curve *curve, const curve_point *pub_point, const curve_point *table, int w, const uint8_t *sig, const uint8_t *digest)
 {
 	curve_point pub, res;
 	bignum256 r, s, z;
 
-	if (!ecdsa_read_pubkey(curve, pub_key, &pub)) {
-		return 1;
-	}
-
 	bn_read_be(sig, &r);
 	bn_read_be(sig + 32, &s);
 
@@ -1092,7 +1499,7 @@ int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const
 		(!bn_is_less(&r, &curve->order)) ||
 		(!bn_is_less(&s, &curve->order))) return 2;
 
-	bn_inverse(&s, &curve->order); // s^-1
+	bn_inverse_var(&s, &curve->order); // s^-1, signature is public
 	bn_multiply(&s, &z, &curve->order); // z*s^-1
 	bn_mod(&z, &curve->order);
 	bn_multiply(&r, &s, &curve->order); // r*s^-1
@@ -1109,7 +1516,11 @@ int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const
 
 	if (result == 0) {
 		// both pub and res can be infinity, can have y = 0 OR can be equal -> false negative
-		point_multiply(curve, &s, &pub, &pub);
+		if (table) {
+			point_table_multiply(curve, &s, table, w, &pub);
+		} else {
+			point_multiply_var(curve, &s, pub_point, &pub);
+		}
 		point_add(curve, &pub, &res);
 		bn_mod(&(res.x), &curve->order);
 		// signature does not match
@@ -1128,6 +1539,24 @@ int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const
 	return result;
 }
 
+int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest)
+{
+	curve_point pub;
+	if (!ecdsa_read_pubkey(curve, pub_key, &pub)) {
+		return 1;
+	}
+	int result = verify_digest(curve, &pub, NULL, 0, sig, digest);
+	memzero(&pub, sizeof(pub));
+	return result;
+}
+
+// same as ecdsa_verify_digest with a precomputed table of the public key,
+// table[0] is the public key itself
+int ecdsa_verify_digest_table(const ecdsa_curve *curve, const curve_point *table, int w, const uint8_t *sig, const uint8_t *digest)
+{
+	return verify_digest(curve, &table[0], table, w, sig, digest);
+}
+
 int ecdsa_sig_to_der(const uint8_t *sig, uint8_t *der)
 {
 	int i;
@@ -28,6 +28,16 @@
 #include "options.h"
 #include "bignum.h"
 #include "hasher.h"
+#include "rfc6979.h"
+
+#if USE_PRECOMPUTED_CP
+#if UBTC_ECMULT_GEN_WINDOW < 2 || UBTC_ECMULT_GEN_WINDOW > 8
+#error "UBTC_ECMULT_GEN_WINDOW should be between 2 and 8"
+#endif
+// cp[i][j] = (2*j+1) * 2^(w*i) * G with window size w
+#define ECMULT_GEN_WINDOWS ((256 + UBTC_ECMULT_GEN_WINDOW - 1) / UBTC_ECMULT_GEN_WINDOW)
+#define ECMULT_GEN_POINTS (1 << (UBTC_ECMULT_GEN_WINDOW - 1))
+#endif
 
 // curve point x and y
 typedef struct {
@@ -44,7 +54,7 @@ typedef struct {
 	bignum256 b;           // coefficient 'b' of the elliptic curve
 
 #if USE_PRECOMPUTED_CP
-	const curve_point cp[64][8];
+	const curve_point cp[ECMULT_GEN_WINDOWS][ECMULT_GEN_POINTS];
 #endif
 
 } ecdsa_curve;
@@ -71,17 +81,22 @@ void point_copy(const curve_point *cp1, curve_point *cp2);
 void point_add(const ecdsa_curve *curve, const curve_point *cp1, curve_point *cp2);
 void point_double(const ecdsa_curve *curve, curve_point *cp);
 void point_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res);
+void point_multiply_var(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res);
 void point_set_infinity(curve_point *p);
 int point_is_infinity(const curve_point *p);
 int point_is_equal(const curve_point *p, const curve_point *q);
 int point_is_negative_of(const curve_point *p, const curve_point *q);
 void scalar_multiply(const ecdsa_curve *curve, const bignum256 *k, curve_point *res);
+size_t point_table_length(int w);
+void point_table_build(const ecdsa_curve *curve, const curve_point *p, int w, curve_point *table);
+void point_table_multiply(const ecdsa_curve *curve, const bignum256 *k, const curve_point *table, int w, curve_point *res);
 int ecdh_multiply(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *pub_key, uint8_t *session_key);
 void uncompress_coords(const ecdsa_curve *curve, uint8_t odd, const bignum256 *x, bignum256 *y);
 int ecdsa_uncompress_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key, uint8_t *uncompressed);
 
 int ecdsa_sign(const ecdsa_curve *curve, HasherType hasher_sign, const uint8_t *priv_key, const uint8_t *msg, uint32_t msg_len, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]));
 int ecdsa_sign_digest(const ecdsa_curve *curve, const uint8_t *priv_key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]));
+int ecdsa_sign_digest_key(const ecdsa_curve *curve, const rfc6979_key *key, const uint8_t *digest, uint8_t *sig, uint8_t *pby, int (*is_canonical)(uint8_t by, uint8_t sig[64]));
 void ecdsa_get_public_key33(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key);
 void ecdsa_get_public_key65(const ecdsa_curve *curve, const uint8_t *priv_key, uint8_t *pub_key);
 void ecdsa_get_pubkeyhash(const uint8_t *pub_key, HasherType hasher_pubkey, uint8_t *pubkeyhash);
@@ -96,6 +111,7 @@ int ecdsa_read_pubkey(const ecdsa_curve *curve, const uint8_t *pub_key, curve_po
 int ecdsa_validate_pubkey(const ecdsa_curve *curve, const curve_point *pub);
 int ecdsa_verify(const ecdsa_curve *curve, HasherType hasher_sign, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *msg, uint32_t msg_len);
 int ecdsa_verify_digest(const ecdsa_curve *curve, const uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest);
+int ecdsa_verify_digest_table(const ecdsa_curve *curve, const curve_point *table, int w, const uint8_t *sig, const uint8_t *digest);
 int ecdsa_recover_pub_from_sig (const ecdsa_curve *curve, uint8_t *pub_key, const uint8_t *sig, const uint8_t *digest, int recid);
 int ecdsa_sig_to_der(const uint8_t *sig, uint8_t *der);
 
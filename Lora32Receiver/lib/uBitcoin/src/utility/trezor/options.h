@@ -28,16 +28,64 @@
 #define USE_PRECOMPUTED_CP 1
 #endif
 
+// window size in bits of the precomputed table, 2 to 8.
+// The table takes ceil(256/w) * 2^(w-1) * 72 bytes of flash:
+// 18 KB for 2, 36 KB for 4, 288 KB for 8. Larger windows need fewer
+// point additions in scalar_multiply. Only the table for 4 is shipped,
+// others are generated with tools/mktable.c as secp256k1_w<w>.table
+#ifndef UBTC_ECMULT_GEN_WINDOW
+#define UBTC_ECMULT_GEN_WINDOW 4
+#endif
+
 // use fast inverse method
 #ifndef USE_INVERSE_FAST
 #define USE_INVERSE_FAST 1
 #endif
 
+// use constant time safegcd (Bernstein-Yang) method in bn_inverse,
+// takes precedence over USE_INVERSE_FAST
+#ifndef USE_INVERSE_SAFEGCD
+#define USE_INVERSE_SAFEGCD 1
+#endif
+
+// multiply modulo secp256k1 prime and order with 64-bit limbs,
+// enabled on hosts with 128-bit integers (x86-64, aarch64)
+#ifndef USE_BN_SECP256K1_64
+#if defined(__SIZEOF_INT128__)
+#define USE_BN_SECP256K1_64 1
+#else
+#define USE_BN_SECP256K1_64 0
+#endif
+#endif
+
+// multiply and square modulo secp256k1 prime with a dedicated reduction
+// in the 30-bit limb layout, used when the 64-bit code is not available
+#ifndef USE_BN_SECP256K1_30
+#define USE_BN_SECP256K1_30 1
+#endif
+
+// split scalars with the secp256k1 endomorphism in point_multiply,
+// halves the number of point doublings
+#ifndef USE_SECP256K1_GLV
+#define USE_SECP256K1_GLV 1
+#endif
+
 // support for printing bignum256 structures via printf
 #ifndef USE_BN_PRINT
 #define USE_BN_PRINT 0
 #endif
 
+// random_buffer and random32 reseed their ChaCha20 generator from
+// random_entropy after handing out this many bytes
+#ifndef RAND_RESEED_INTERVAL
+#define RAND_RESEED_INTERVAL (64 * 1024)
+#endif
+
+// count calls and cycles of the hot paths, see prof.h
+#ifndef UBTC_PROFILE
+#define UBTC_PROFILE 0
+#endif
+
 // use deterministic signatures
 #ifndef USE_RFC6979
 #define USE_RFC6979 1
@@ -0,0 +1,78 @@
+#include <string.h>
+#include "prof.h"
+
+#if UBTC_PROFILE && !defined(__XTENSA__) && !defined(__x86_64__) && !defined(__i386__)
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#define PROF_CLOCK_NS 1
+#endif
+#endif
+
+static const char *const prof_names[UBTC_PROF_COUNT] = {
+	"point_multiply",
+	"point_multiply_var",
+	"scalar_multiply",
+	"bn_inverse",
+	"sha256_Transform",
+	"sha512_Transform",
+	"ecdsa_sign_digest",
+	"alloc",
+	"free",
+};
+
+#if UBTC_PROFILE
+
+UBTC_PROF_THREAD_LOCAL ubtc_prof_counter ubtc_prof_counters[UBTC_PROF_COUNT];
+
+#if !defined(__XTENSA__) && !defined(__x86_64__) && !defined(__i386__)
+ubtc_prof_tick ubtc_prof_ticks(void)
+{
+#if PROF_CLOCK_NS
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ubtc_prof_tick)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+	return 0;
+#endif
+}
+#endif
+
+void ubtc_prof_get(ubtc_prof_counter *out)
+{
+	memcpy(out, ubtc_prof_counters, sizeof(ubtc_prof_counters));
+}
+
+void ubtc_prof_reset(void)
+{
+	memset(ubtc_prof_counters, 0, sizeof(ubtc_prof_counters));
+}
+
+#else
+
+void ubtc_prof_get(ubtc_prof_counter *out)
+{
+	memset(out, 0, sizeof(ubtc_prof_counter) * UBTC_PROF_COUNT);
+}
+
+void ubtc_prof_reset(void)
+{
+}
+
+#endif
+
+const char *ubtc_prof_name(ubtc_prof_id id)
+{
+	if ((unsigned)id >= UBTC_PROF_COUNT) {
+		return "";
+	}
+	return prof_names[id];
+}
+
+const char *ubtc_prof_unit(void)
+{
+#if defined(__XTENSA__) || defined(__x86_64__) || defined(__i386__)
+	return "cycles";
+#else
+	return "ns";
+#endif
+}
@@ -0,0 +1,105 @@
+#ifndef __PROF_H__
+#define __PROF_H__
+
+#include <stdint.h>
+#include "options.h"
+
+// Call counters and cycle counters for the hot paths of the library.
+// Compiled in with UBTC_PROFILE=1, otherwise the hooks expand to nothing
+// and ubtc_prof_get() returns zeros.
+// Every thread has its own counters. Time is inclusive: a nested call
+// (point_multiply inside ecdsa_sign) is counted in both.
+
+typedef enum {
+	UBTC_PROF_POINT_MULTIPLY = 0,
+	UBTC_PROF_POINT_MULTIPLY_VAR,
+	UBTC_PROF_SCALAR_MULTIPLY,
+	UBTC_PROF_BN_INVERSE,
+	UBTC_PROF_SHA256_TRANSFORM,
+	UBTC_PROF_SHA512_TRANSFORM,
+	UBTC_PROF_ECDSA_SIGN,
+	UBTC_PROF_ALLOC,  // ubtc_malloc, ubtc_calloc, ubtc_realloc
+	UBTC_PROF_FREE,   // ubtc_free
+	UBTC_PROF_COUNT
+} ubtc_prof_id;
+
+typedef struct {
+	uint64_t calls;
+	uint64_t ticks;
+} ubtc_prof_counter;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// copies the counters of the calling thread to out[UBTC_PROF_COUNT]
+void ubtc_prof_get(ubtc_prof_counter *out);
+// zeroes the counters of the calling thread
+void ubtc_prof_reset(void);
+// "point_multiply", "sha256_Transform"...
+const char *ubtc_prof_name(ubtc_prof_id id);
+// unit of the ticks: "cycles" or "ns"
+const char *ubtc_prof_unit(void);
+
+#if UBTC_PROFILE
+
+#if defined(ARDUINO_ARCH_AVR)
+#define UBTC_PROF_THREAD_LOCAL
+#elif defined(__GNUC__) || defined(__clang__)
+#define UBTC_PROF_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define UBTC_PROF_THREAD_LOCAL __declspec(thread)
+#else
+#define UBTC_PROF_THREAD_LOCAL
+#endif
+
+extern UBTC_PROF_THREAD_LOCAL ubtc_prof_counter ubtc_prof_counters[UBTC_PROF_COUNT];
+
+#if defined(__XTENSA__)
+// 32-bit cycle counter, differences stay correct across a wrap
+typedef uint32_t ubtc_prof_tick;
+static inline ubtc_prof_tick ubtc_prof_ticks(void)
+{
+	uint32_t ccount;
+	__asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+	return ccount;
+}
+#elif defined(__x86_64__) || defined(__i386__)
+typedef uint64_t ubtc_prof_tick;
+static inline ubtc_prof_tick ubtc_prof_ticks(void)
+{
+	uint32_t lo, hi;
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)hi << 32) | lo;
+}
+#else
+typedef uint64_t ubtc_prof_tick;
+// monotonic clock in ns, 0 where there is none
+ubtc_prof_tick ubtc_prof_ticks(void);
+#endif
+
+static inline void ubtc_prof_add(ubtc_prof_id id, ubtc_prof_tick start)
+{
+	ubtc_prof_tick ticks = ubtc_prof_ticks() - start;
+	ubtc_prof_counters[id].calls++;
+	ubtc_prof_counters[id].ticks += ticks;
+}
+
+// UBTC_PROF_ENTER at the top of the function,
+// UBTC_PROF_LEAVE before every return
+#define UBTC_PROF_ENTER() ubtc_prof_tick ubtc_prof_start = ubtc_prof_ticks()
+#define UBTC_PROF_LEAVE(id) ubtc_prof_add((id), ubtc_prof_start)
+
+#else
+
+#define UBTC_PROF_ENTER()
+#define UBTC_PROF_LEAVE(id)
+
+#endif
+
+#ifdef __cplusplus
+} /* end of extern "C" */
+#endif
+
+#endif
@@ -23,29 +23,37 @@
 
 // Node: heavily edited by uBitcoin developers with inspiration from micropython source code.
 
+// rand_s on windows
+#define _CRT_RAND_S
+
 #include "rand.h"
-#include "sha2.h"
+#include "options.h"
+#include "chacha20.h"
+#include "memzero.h"
 #include <string.h>
+#include <stdlib.h>
+
+//
+// Platform entropy sources, only used to seed the generator below
+//
 
 // esp boards
 #if defined(ESP_PLATFORM)
 
   #include <esp_system.h>
-  uint32_t __attribute__((weak)) random32(void){
-    return esp_random();
+  int __attribute__((weak)) random_entropy(uint8_t *buf, size_t len){
+    esp_fill_random(buf, len);
+    return 1;
   }
 
 #elif defined(ESP8266)
   // see http://esp8266-re.foogod.com/wiki/Random_Number_Generator
   #define WDEV_HWRNG ((volatile uint32_t*)0x3ff20e44)
-  uint32_t __attribute__((weak)) random32(void){
-    uint32_t rngint = 0;
-    uint32_t v = 0;
-    for(int i=0; i<4; i++){
-      v = (*WDEV_HWRNG);
-      rngint = (rngint << 8) | v;
+  int __attribute__((weak)) random_entropy(uint8_t *buf, size_t len){
+    for(size_t i=0; i<len; i++){
+      buf[i] = (*WDEV_HWRNG) & 0xFF;
     }
-    return rngint;
+    return 1;
   }
 
 // stm boards
@@ -56,7 +64,7 @@
     // taken from micropython source code
     #define RNG_TIMEOUT_MS (10)
 
-    uint32_t __attribute__((weak)) random32(void) {
+    int __attribute__((weak)) random_entropy(uint8_t *buf, size_t len) {
         // Enable the RNG peripheral if it's not already enabled
         if (!(RNG->CR & RNG_CR_RNGEN)) {
             #if defined(STM32H7)
@@ -68,16 +76,20 @@
             RNG->CR |= RNG_CR_RNGEN;
         }
 
-        // Wait for a new random number to be ready, takes on the order of 10us
-        uint32_t start = HAL_GetTick();
-        while (!(RNG->SR & RNG_SR_DRDY)) {
-            if (HAL_GetTick() - start >= RNG_TIMEOUT_MS) {
-                return 0;
+        for (size_t i = 0; i < len; i += 4) {
+            // Wait for a new random number to be ready, takes on the order of 10us
+            uint32_t start = HAL_GetTick();
+            while (!(RNG->SR & RNG_SR_DRDY)) {
+                if (HAL_GetTick() - start >= RNG_TIMEOUT_MS) {
+                    return 0;
+                }
+            }
+            uint32_t r = RNG->DR;
+            for (size_t j = 0; j < 4 && i + j < len; j++) {
+                buf[i + j] = (r >> (8 * j)) & 0xFF;
             }
         }
-
-        // Get and return the new random number
-        return RNG->DR;
+        return 1;
     }
   #else
 
@@ -87,13 +99,64 @@
   #endif // defined RNG
 
 // PC
-#elif defined(__unix__) || defined(__APPLE__) || defined(_WIN32) || defined(_WIN64) || defined(__CYGWIN__) || defined(__ANDROID__)
+#elif defined(__APPLE__)
 
-// rand from os random source
-#include <stdlib.h>
+int __attribute__((weak)) random_entropy(uint8_t *buf, size_t len){
+    arc4random_buf(buf, len);
+    return 1;
+}
+
+#elif defined(_WIN32) || defined(_WIN64)
+
+int __attribute__((weak)) random_entropy(uint8_t *buf, size_t len){
+    for(size_t i=0; i<len; i += 4){
+        unsigned int r;
+        if(rand_s(&r) != 0){
+            return 0;
+        }
+        for(size_t j=0; j<4 && i+j<len; j++){
+            buf[i+j] = (r >> (8*j)) & 0xFF;
+        }
+    }
+    return 1;
+}
+
+#elif defined(__unix__) || defined(__CYGWIN__) || defined(__ANDROID__)
+
+#include <stdio.h>
+#include <errno.h>
+#if defined(__linux__) && defined(__has_include) && !(defined(__ANDROID__) && __ANDROID_API__ < 28)
+  #if __has_include(<sys/random.h>)
+    #include <sys/random.h>
+    #define RAND_HAVE_GETRANDOM
+  #endif
+#endif
 
-uint32_t __attribute__((weak)) random32(void){
-    return (uint32_t)rand();
+// getrandom where available, /dev/urandom otherwise
+int __attribute__((weak)) random_entropy(uint8_t *buf, size_t len){
+#ifdef RAND_HAVE_GETRANDOM
+    size_t done = 0;
+    while(done < len){
+        ssize_t n = getrandom(buf + done, len - done, 0);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break; // ENOSYS on old kernels
+        }
+        done += n;
+    }
+    if(done == len){
+        return 1;
+    }
+#endif
+    FILE * f = fopen("/dev/urandom", "rb");
+    if(f == NULL){
+        return 0;
+    }
+    size_t n = fread(buf, 1, len, f);
+    fclose(f);
+    return n == len;
 }
 
 #else
@@ -108,26 +171,29 @@ uint32_t __attribute__((weak)) random32(void){
 
 #pragma message("\nWARGNING! RANDOM NUMBER GENERATOR IS NOT SUPPORTED ON THIS PLATFORM! \n\
 Pseudo-random generator will be used unless you define\n\
-your own random function like so: \n\n\
+your own entropy source like so: \n\n\
 extern \"C\" { \n\
-  uint32_t random32(){\n\
-    ...get random value somehow...\n\
-    return value;\n\
+  int random_entropy(uint8_t *buf, size_t len){\n\
+    ...fill buf with random bytes somehow...\n\
+    return 1;\n\
   }\n\
 }")
 
 
-uint32_t __attribute__((weak)) random32(void) {
+int __attribute__((weak)) random_entropy(uint8_t *buf, size_t len) {
     static uint32_t pad = 0xeda4baba, n = 69, d = 233;
     static uint8_t dat = 0;
 
-    pad += dat + d * n;
-    pad = (pad << 3) + (pad >> 29);
-    n = pad | 2;
-    d ^= (pad << 31) + (pad >> 1);
-    dat ^= (char)pad ^ (d >> 8) ^ 1;
+    for (size_t i = 0; i < len; i++) {
+        pad += dat + d * n;
+        pad = (pad << 3) + (pad >> 29);
+        n = pad | 2;
+        d ^= (pad << 31) + (pad >> 1);
+        dat ^= (char)pad ^ (d >> 8) ^ 1;
 
-    return pad ^ (d << 5) ^ (pad >> 18) ^ (dat << 1);
+        buf[i] = (pad ^ (d << 5) ^ (pad >> 18) ^ (dat << 1)) & 0xFF;
+    }
+    return 1;
 }
 
 #endif // UBTC_USE_PRNG
@@ -136,17 +202,129 @@ uint32_t __attribute__((weak)) random32(void) {
 // The following code is platform independent
 //
 
+// Every thread has its own generator, no locking needed
+#if defined(ARDUINO_ARCH_AVR)
+#define RAND_THREAD_LOCAL
+#elif defined(__GNUC__) || defined(__clang__)
+#define RAND_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define RAND_THREAD_LOCAL __declspec(thread)
+#else
+#define RAND_THREAD_LOCAL
+#endif
+
+// A forked child gets a copy of the parent generator, count forks
+// so the child reseeds before handing out anything
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(ESP_PLATFORM)
+#include <pthread.h>
+#define RAND_WATCH_FORK
+static volatile uint32_t fork_generation = 0;
+static pthread_once_t fork_once = PTHREAD_ONCE_INIT;
+static void on_fork_child(void) {
+	fork_generation++;
+}
+static void watch_fork(void) {
+	pthread_atfork(NULL, NULL, on_fork_child);
+}
+#else
+static const uint32_t fork_generation = 0;
+#endif
+
+// keystream blocks per refill, the first 32 bytes become the next key
+#define RAND_BLOCKS 4
+
+// ChaCha20 generator with fast key erasure: output bytes are wiped
+// once handed out and the key used for them is already replaced
+typedef struct {
+	uint8_t key[32];
+	uint8_t buf[RAND_BLOCKS * 64 - 32];
+	size_t available;  // unused bytes at the end of buf
+	size_t since_seed; // bytes handed out since the last reseed
+	uint32_t fork_generation;
+	uint8_t seeded;
+} rand_state;
+
+static RAND_THREAD_LOCAL rand_state rng;
+
+static void rand_refill(rand_state *s)
+{
+	static const uint8_t nonce[12] = {0};
+	uint8_t block[RAND_BLOCKS * 64];
+	chacha20_ctx ctx;
+
+	chacha20_init(&ctx, s->key, nonce, 0);
+	for (int i = 0; i < RAND_BLOCKS; i++) {
+		chacha20_block(&ctx, block + 64 * i);
+	}
+	memcpy(s->key, block, sizeof(s->key));
+	memcpy(s->buf, block + sizeof(s->key), sizeof(s->buf));
+	s->available = sizeof(s->buf);
+	memzero(block, sizeof(block));
+	memzero(&ctx, sizeof(ctx));
+}
+
+static void rand_reseed(rand_state *s)
+{
+	uint8_t seed[32];
+	int ok = 0;
+	for (int i = 0; i < 10 && !ok; i++) {
+		ok = random_entropy(seed, sizeof(seed));
+	}
+	if (!ok) {
+		// never hand out predictable keys
+		abort();
+	}
+	// mix into the old key so earlier entropy is kept
+	for (size_t i = 0; i < sizeof(seed); i++) {
+		s->key[i] ^= seed[i];
+	}
+	memzero(seed, sizeof(seed));
+	s->since_seed = 0;
+	s->fork_generation = fork_generation;
+	s->seeded = 1;
+	// drop whatever was buffered under the old key
+	rand_refill(s);
+}
+
+void random_reseed(void)
+{
+	rand_reseed(&rng);
+}
+
 void __attribute__((weak)) random_buffer(uint8_t *buf, size_t len)
 {
-	uint32_t r = 0;
-	for (size_t i = 0; i < len; i++) {
-		if (i % 4 == 0) {
-			r = random32();
+	rand_state *s = &rng;
+#ifdef RAND_WATCH_FORK
+	pthread_once(&fork_once, watch_fork);
+#endif
+	if (!s->seeded || s->fork_generation != fork_generation) {
+		rand_reseed(s);
+	}
+	while (len > 0) {
+		if (s->since_seed >= RAND_RESEED_INTERVAL) {
+			rand_reseed(s);
+		}
+		if (s->available == 0) {
+			rand_refill(s);
 		}
-		buf[i] = (r >> ((i % 4) * 8)) & 0xFF;
+		size_t n = len < s->available ? len : s->available;
+		uint8_t *src = s->buf + sizeof(s->buf) - s->available;
+		memcpy(buf, src, n);
+		memzero(src, n);
+		s->available -= n;
+		s->since_seed += n;
+		buf += n;
+		len -= n;
 	}
 }
 
+uint32_t __attribute__((weak)) random32(void)
+{
+	uint8_t b[4];
+	random_buffer(b, sizeof(b));
+	return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
 uint32_t random_uniform(uint32_t n)
 {
 	uint32_t x, max = 0xFFFFFFFF - (0xFFFFFFFF % n);
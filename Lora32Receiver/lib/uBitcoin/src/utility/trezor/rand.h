@@ -32,8 +32,17 @@ extern "C"
 {
 #endif
 
+// Platform entropy source, only used to seed the generator behind
+// random32 and random_buffer. Define your own to support a new platform,
+// return 0 on failure.
+int random_entropy(uint8_t *buf, size_t len);
+
+// ChaCha20 generator, one per thread. Seeded on first use and
+// reseeded after a fork and every RAND_RESEED_INTERVAL bytes.
 uint32_t random32(void);
 void random_buffer(uint8_t *buf, size_t len);
+// mixes fresh entropy into the generator of the calling thread
+void random_reseed(void);
 
 uint32_t random_uniform(uint32_t n);
 void random_permute(char *buf, size_t len);
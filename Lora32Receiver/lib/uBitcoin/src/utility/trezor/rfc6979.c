@@ -27,32 +27,87 @@
 #include "hmac.h"
 #include "memzero.h"
 
-void init_rfc6979(const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *state) {
-	uint8_t bx[2*32];
-	uint8_t buf[32 + 1 + 2*32];
+// hashes both pads of a 32 byte HMAC-SHA256 key, every message
+// under that key then costs its own blocks and one outer block
+static void hmac_pads(const uint8_t key[32], SHA256_CTX *inner, SHA256_CTX *outer)
+{
+	uint8_t pad[SHA256_BLOCK_LENGTH];
+	int i;
 
-	memcpy(bx, priv_key, 32);
-	memcpy(bx+32, hash, 32);
+	memset(pad, 0x36, sizeof(pad));
+	for (i = 0; i < 32; i++) {
+		pad[i] ^= key[i];
+	}
+	sha256_Init(inner);
+	sha256_Update(inner, pad, sizeof(pad));
+	for (i = 0; i < SHA256_BLOCK_LENGTH; i++) {
+		pad[i] ^= 0x36 ^ 0x5c;
+	}
+	sha256_Init(outer);
+	sha256_Update(outer, pad, sizeof(pad));
+	memzero(pad, sizeof(pad));
+}
 
-	memset(state->v, 1, sizeof(state->v));
-	memset(state->k, 0, sizeof(state->k));
+// finishes the HMAC, sha256_Final wipes both contexts
+static void hmac_final(SHA256_CTX *inner, SHA256_CTX *outer, uint8_t hmac[32])
+{
+	sha256_Final(inner, hmac);
+	sha256_Update(outer, hmac, 32);
+	sha256_Final(outer, hmac);
+}
 
-	memcpy(buf, state->v, sizeof(state->v));
-	buf[sizeof(state->v)] = 0x00;
-	memcpy(buf + sizeof(state->v) + 1, bx, 64);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), buf, sizeof(buf), state->k);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), state->v, sizeof(state->v), state->v);
+void prepare_rfc6979_key(const uint8_t *priv_key, rfc6979_key *key) {
+	uint8_t zero[32];
+	uint8_t buf[32 + 1 + 32];
 
-	memcpy(buf, state->v, sizeof(state->v));
-	buf[sizeof(state->v)] = 0x01;
-	memcpy(buf + sizeof(state->v) + 1, bx, 64);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), buf, sizeof(buf), state->k);
-	ubtc_hmac_sha256(state->k, sizeof(state->k), state->v, sizeof(state->v), state->v);
+	memset(zero, 0, sizeof(zero));
+	hmac_pads(zero, &key->inner, &key->outer);
+	// first block of the message and one byte of the next one
+	memset(buf, 1, 32);
+	buf[32] = 0x00;
+	memcpy(buf + 33, priv_key, 32);
+	sha256_Update(&key->inner, buf, sizeof(buf));
+	memcpy(key->priv_key, priv_key, 32);
 
-	memzero(bx, sizeof(bx));
 	memzero(buf, sizeof(buf));
 }
 
+void init_rfc6979_key(const rfc6979_key *key, const uint8_t *hash, rfc6979_state *state) {
+	SHA256_CTX inner = key->inner;
+	SHA256_CTX outer = key->outer;
+	SHA256_CTX k_inner, k_outer;
+	const uint8_t one = 0x01;
+
+	// k = HMAC_k(v || 0x00 || priv_key || hash), with k = 0 and v = 1
+	memset(state->v, 1, sizeof(state->v));
+	sha256_Update(&inner, hash, 32);
+	hmac_final(&inner, &outer, state->k);
+
+	// v = HMAC_k(v), k = HMAC_k(v || 0x01 || priv_key || hash), the pads of k are hashed once
+	hmac_pads(state->k, &k_inner, &k_outer);
+	inner = k_inner;
+	outer = k_outer;
+	sha256_Update(&inner, state->v, sizeof(state->v));
+	hmac_final(&inner, &outer, state->v);
+	sha256_Update(&k_inner, state->v, sizeof(state->v));
+	sha256_Update(&k_inner, &one, 1);
+	sha256_Update(&k_inner, key->priv_key, 32);
+	sha256_Update(&k_inner, hash, 32);
+	hmac_final(&k_inner, &k_outer, state->k);
+
+	// v = HMAC_k(v)
+	hmac_pads(state->k, &inner, &outer);
+	sha256_Update(&inner, state->v, sizeof(state->v));
+	hmac_final(&inner, &outer, state->v);
+}
+
+void init_rfc6979(const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *state) {
+	rfc6979_key key;
+	prepare_rfc6979_key(priv_key, &key);
+	init_rfc6979_key(&key, hash, state);
+	memzero(&key, sizeof(key));
+}
+
 // generate next number from deterministic random number generator
 void generate_rfc6979(uint8_t rnd[32], rfc6979_state *state)
 {
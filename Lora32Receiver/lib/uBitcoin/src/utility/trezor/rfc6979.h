@@ -27,18 +27,29 @@
 
 #include <stdint.h>
 #include "bignum.h"
+#include "sha2.h"
 
 // rfc6979 pseudo random number generator state
 typedef struct {
 	uint8_t v[32], k[32];
 } rfc6979_state;
 
+// part of the initialization that depends only on the private key,
+// reusable for any number of hashes signed with that key
+typedef struct {
+	SHA256_CTX inner; // (0^32 ^ ipad) || 0x01^32 || 0x00 || priv_key absorbed
+	SHA256_CTX outer; // (0^32 ^ opad) absorbed
+	uint8_t priv_key[32];
+} rfc6979_key;
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
 void init_rfc6979(const uint8_t *priv_key, const uint8_t *hash, rfc6979_state *rng);
+void prepare_rfc6979_key(const uint8_t *priv_key, rfc6979_key *key);
+void init_rfc6979_key(const rfc6979_key *key, const uint8_t *hash, rfc6979_state *rng);
 void generate_rfc6979(uint8_t rnd[32], rfc6979_state *rng);
 void generate_k_rfc6979(bignum256 *k, rfc6979_state *rng);
 
@@ -50,7 +50,21 @@ const ecdsa_curve secp256k1 = {
 #if USE_PRECOMPUTED_CP
 	,
 	/* cp */ {
+#if UBTC_ECMULT_GEN_WINDOW == 4
 #include "secp256k1.table"
+#elif UBTC_ECMULT_GEN_WINDOW == 2
+#include "secp256k1_w2.table"
+#elif UBTC_ECMULT_GEN_WINDOW == 3
+#include "secp256k1_w3.table"
+#elif UBTC_ECMULT_GEN_WINDOW == 5
+#include "secp256k1_w5.table"
+#elif UBTC_ECMULT_GEN_WINDOW == 6
+#include "secp256k1_w6.table"
+#elif UBTC_ECMULT_GEN_WINDOW == 7
+#include "secp256k1_w7.table"
+#elif UBTC_ECMULT_GEN_WINDOW == 8
+#include "secp256k1_w8.table"
+#endif
 	}
 #endif
 };
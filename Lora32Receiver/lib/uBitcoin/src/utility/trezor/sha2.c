@@ -32,6 +32,7 @@
 #include <stdint.h>
 #include "sha2.h"
 #include "memzero.h"
+#include "prof.h"
 
 /*
  * ASSERT NOTE:
@@ -302,6 +303,7 @@ void sha256_Init(SHA256_CTX* context) {
 	j++
 
 void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2_word32* state_out) {
+	UBTC_PROF_ENTER();
 	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
 	sha2_word32	T1;
 	sha2_word32 W256[16];
@@ -354,11 +356,13 @@ void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = 0;
+	UBTC_PROF_LEAVE(UBTC_PROF_SHA256_TRANSFORM);
 }
 
 #else /* SHA2_UNROLL_TRANSFORM */
 
 void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2_word32* state_out) {
+	UBTC_PROF_ENTER();
 	sha2_word32	a, b, c, d, e, f, g, h, s0, s1;
 	sha2_word32	T1, T2, W256[16];
 	int		j;
@@ -425,6 +429,7 @@ void sha256_Transform(const sha2_word32* state_in, const sha2_word32* data, sha2
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = T2 = 0;
+	UBTC_PROF_LEAVE(UBTC_PROF_SHA256_TRANSFORM);
 }
 
 #endif /* SHA2_UNROLL_TRANSFORM */
@@ -609,6 +614,7 @@ void sha512_Init(SHA512_CTX* context) {
 	j++
 
 void sha512_Transform(const sha2_word64* state_in, const sha2_word64* data, sha2_word64* state_out) {
+	UBTC_PROF_ENTER();
 	sha2_word64	a, b, c, d, e, f, g, h, s0, s1;
 	sha2_word64	T1, W512[16];
 	int		j;
@@ -659,11 +665,13 @@ void sha512_Transform(const sha2_word64* state_in, const sha2_word64* data, sha2
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = 0;
+	UBTC_PROF_LEAVE(UBTC_PROF_SHA512_TRANSFORM);
 }
 
 #else /* SHA2_UNROLL_TRANSFORM */
 
 void sha512_Transform(const sha2_word64* state_in, const sha2_word64* data, sha2_word64* state_out) {
+	UBTC_PROF_ENTER();
 	sha2_word64	a, b, c, d, e, f, g, h, s0, s1;
 	sha2_word64	T1, T2, W512[16];
 	int		j;
@@ -730,6 +738,7 @@ void sha512_Transform(const sha2_word64* state_in, const sha2_word64* data, sha2
 
 	/* Clean up */
 	a = b = c = d = e = f = g = h = T1 = T2 = 0;
+	UBTC_PROF_LEAVE(UBTC_PROF_SHA512_TRANSFORM);
 }
 
 #endif /* SHA2_UNROLL_TRANSFORM */
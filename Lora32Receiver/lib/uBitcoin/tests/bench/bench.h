@@ -0,0 +1,118 @@
+// Minimal benchmark harness.
+// bench() runs a function until a sample takes at least BENCH_MIN_NS,
+// keeps the best of BENCH_SAMPLES samples (the machine may be busy)
+// and counts allocations per call. bench_report() prints all results as JSON.
+//
+// Allocations are counted in operator new and, when built with
+// BENCH_WRAP_MALLOC and -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+// (tests/Makefile does this on Linux), in malloc / calloc / realloc
+// called by the library.
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef BENCH_MIN_NS
+#define BENCH_MIN_NS 20e6
+#endif
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES 3
+#endif
+
+static size_t bench_allocs = 0;
+
+// results go here so the compiler can't drop the work
+static volatile uint8_t bench_sink = 0;
+static inline void bench_keep(const void * ptr){ bench_sink ^= *(const uint8_t *)ptr; }
+
+#ifdef BENCH_WRAP_MALLOC
+extern "C" {
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t num, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+void * __wrap_malloc(size_t size){ bench_allocs++; return __real_malloc(size); }
+void * __wrap_calloc(size_t num, size_t size){ bench_allocs++; return __real_calloc(num, size); }
+void * __wrap_realloc(void * ptr, size_t size){ bench_allocs++; return __real_realloc(ptr, size); }
+}
+#endif
+
+// std::string and friends, malloc is already counted when wrapped
+static void * bench_new(size_t size){
+#ifndef BENCH_WRAP_MALLOC
+    bench_allocs++;
+#endif
+    void * ptr = malloc(size ? size : 1);
+    if(ptr == NULL){ throw std::bad_alloc(); }
+    return ptr;
+}
+void * operator new(size_t size){ return bench_new(size); }
+void * operator new[](size_t size){ return bench_new(size); }
+void operator delete(void * ptr) noexcept { free(ptr); }
+void operator delete[](void * ptr) noexcept { free(ptr); }
+void operator delete(void * ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void * ptr, size_t) noexcept { free(ptr); }
+
+typedef struct{
+    std::string name;
+    double ns;         // per call, best sample
+    double allocs;     // per call
+    unsigned long iterations; // calls per sample
+} bench_result;
+
+static std::vector<bench_result> bench_results;
+
+template<typename F>
+static double bench_sample(F &fn, unsigned long n, size_t * allocs){
+    size_t before = bench_allocs;
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned long i=0; i<n; i++){
+        fn();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    *allocs = bench_allocs - before;
+    return ns;
+}
+
+template<typename F>
+static void bench(const char * name, F fn){
+    size_t allocs = 0;
+    unsigned long n = 1;
+    double ns = bench_sample(fn, n, &allocs); // warm up and first estimate
+    while(ns < BENCH_MIN_NS){
+        n *= (ns < BENCH_MIN_NS / 100) ? 10 : 2;
+        ns = bench_sample(fn, n, &allocs);
+    }
+    double best = ns;
+    for(int i=1; i<BENCH_SAMPLES; i++){
+        ns = bench_sample(fn, n, &allocs);
+        if(ns < best){ best = ns; }
+    }
+    bench_result r;
+    r.name = name;
+    r.ns = best / n;
+    r.allocs = (double)allocs / n;
+    r.iterations = n;
+    bench_results.push_back(r);
+    fprintf(stderr, "%-32s %12.0f ns/op %12.0f ops/s %8.2f allocs/op\n", name, r.ns, 1e9 / r.ns, r.allocs);
+}
+
+// JSON on stdout, one object per benchmark
+static void bench_report(const char * suite){
+    printf("{\n  \"suite\": \"%s\",\n  \"results\": [\n", suite);
+    for(size_t i=0; i<bench_results.size(); i++){
+        const bench_result &r = bench_results[i];
+        printf("    {\"name\": \"%s\", \"ns_per_op\": %.1f, \"ops_per_s\": %.1f, \"allocs_per_op\": %.2f, \"iterations\": %lu}%s\n",
+               r.name.c_str(), r.ns, 1e9 / r.ns, r.allocs, r.iterations,
+               (i + 1 < bench_results.size()) ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+#endif // __BENCH_H__
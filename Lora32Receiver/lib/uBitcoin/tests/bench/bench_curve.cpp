@@ -0,0 +1,106 @@
+// Field and scalar multiplication and the EC operations built on them.
+// Build with BENCH_OPT="-O2 -DUSE_BN_SECP256K1_64=0" to measure the 30-bit limb code
+// used on 32-bit targets, add -DUSE_BN_SECP256K1_30=0 for the generic code.
+// -DUSE_SECP256K1_GLV=0 disables the endomorphism in variable base multiplication.
+#include "bench.h"
+#include "Bitcoin.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/secp256k1.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/rfc6979.h"
+
+static void bench_multiply(const char * name, const bignum256 * prime, bool square = false){
+    bignum256 k, x;
+    bn_read_be(GeneratorPoint.point, &k);
+    bn_read_be(GeneratorPoint.point+32, &x);
+    if(square){
+        bench(name, [&](){ bn_square(&x, prime); });
+    }else{
+        bench(name, [&](){ bn_multiply(&k, &x, prime); });
+    }
+    bench_keep(&x);
+}
+
+typedef void (*point_multiply_fn)(const ecdsa_curve *curve, const bignum256 *k, const curve_point *p, curve_point *res);
+
+static void bench_point_multiply(const char * name, const ECPoint& point, point_multiply_fn fn){
+    curve_point p, res;
+    bignum256 d;
+    uint8_t num[32];
+    memset(num, 0x33, sizeof(num));
+    bn_read_be(point.point, &p.x);
+    bn_read_be(point.point+32, &p.y);
+    bench(name, [&](){
+        num[0]++;
+        bn_read_be(num, &d);
+        fn(&secp256k1, &d, &p, &res);
+    });
+    bench_keep(&res);
+}
+
+int main(){
+    // a copy of the modulus is not recognized and takes the generic path
+    bignum256 prime = secp256k1.prime;
+    bignum256 order = secp256k1.order;
+    bench_multiply("bn_multiply prime", &secp256k1.prime);
+    bench_multiply("bn_multiply prime (gen)", &prime);
+    bench_multiply("bn_square prime", &secp256k1.prime, true);
+    bench_multiply("bn_square prime (gen)", &prime, true);
+    bench_multiply("bn_multiply order", &secp256k1.order);
+    bench_multiply("bn_multiply order (gen)", &order);
+
+    uint8_t secret[32];
+    memset(secret, 0x11, sizeof(secret));
+    uint8_t hash[32];
+    memset(hash, 0x22, sizeof(hash));
+    PrivateKey pk(secret);
+    PublicKey pub = pk.publicKey();
+    uint8_t n = 0;
+
+    bench("publicKey", [&](){
+        secret[0] = n++;
+        PrivateKey k(secret);
+        if(!k.publicKey()){ printf("?"); }
+    });
+
+    // variable base multiplication, used in ecdh, verification and schnorr challenge*pub
+    bench_point_multiply("point_multiply", pub, point_multiply);
+    bench_point_multiply("point_multiply_var", pub, point_multiply_var);
+
+    Signature sig;
+    bench("ecdsa sign", [&](){ hash[0] = n++; sig = pk.sign(hash); });
+
+    // nonce generator alone and signing with its key dependent part prepared
+    uint8_t secret_key[32];
+    pk.getSecret(secret_key);
+    rfc6979_state rng;
+    bench("rfc6979 init", [&](){ hash[0] = n++; init_rfc6979(secret_key, hash, &rng); });
+    bench_keep(&rng);
+
+    PreparedPrivateKey prepared_pk(pk);
+    rfc6979_key rng_key;
+    prepare_rfc6979_key(secret_key, &rng_key);
+    bench("rfc6979 init prepared", [&](){ hash[0] = n++; init_rfc6979_key(&rng_key, hash, &rng); });
+    bench_keep(&rng);
+
+    bench("ecdsa sign prepared", [&](){ hash[0] = n++; sig = prepared_pk.sign(hash); });
+    bench("ecdsa verify", [&](){ if(!pub.verify(sig, hash)){ printf("?"); } });
+
+    SchnorrSignature ssig;
+    bench("schnorr sign", [&](){ hash[0] = n++; ssig = pk.schnorr_sign(hash); });
+    bench("schnorr verify", [&](){ if(!pub.schnorr_verify(ssig, hash)){ printf("?"); } });
+
+    // the same key with a precomputed table, sig has to match the hash again
+    sig = pk.sign(hash);
+    PreparedPublicKey prepared;
+    bench("prepare", [&](){ if(!prepared.prepare(pub)){ printf("?"); } });
+    bench("ecdsa verify prepared", [&](){ if(!prepared.verify(sig, hash)){ printf("?"); } });
+    bench("schnorr verify prepared", [&](){ if(!prepared.schnorr_verify(ssig, hash)){ printf("?"); } });
+
+    uint8_t shared[32];
+    PrivateKey peer(hash);
+    bench("ecdh", [&](){ peer.ecdh(pub, shared); bench_keep(shared); });
+    bench("ecdh prepared", [&](){ peer.ecdh(prepared, shared); bench_keep(shared); });
+    bench_report("curve");
+    return 0;
+}
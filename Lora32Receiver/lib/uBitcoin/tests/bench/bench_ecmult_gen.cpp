@@ -0,0 +1,27 @@
+// Base point multiplication with the precomputed table.
+// Run `make bench_gen` to compare all UBTC_ECMULT_GEN_WINDOW settings.
+#include "bench.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/ecdsa.h"
+#include "utility/trezor/secp256k1.h"
+
+int main(){
+    uint8_t num[32];
+    memset(num, 0x5A, sizeof(num));
+    bignum256 k;
+    curve_point res;
+    uint16_t i = 0;
+    std::string name = "scalar_multiply w" + std::to_string(UBTC_ECMULT_GEN_WINDOW);
+    bench(name.c_str(), [&](){
+        num[0] = i;
+        num[1] = i >> 8;
+        i++;
+        bn_read_be(num, &k);
+        scalar_multiply(&secp256k1, &k, &res);
+    });
+    bench_keep(&res);
+    fprintf(stderr, "window %d: table %zu bytes, %d additions\n",
+            UBTC_ECMULT_GEN_WINDOW, sizeof(secp256k1.cp), ECMULT_GEN_WINDOWS - 1);
+    bench_report("ecmult_gen");
+    return 0;
+}
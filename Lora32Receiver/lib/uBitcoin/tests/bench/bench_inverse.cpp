@@ -0,0 +1,57 @@
+// Modular inversion: safegcd (constant and variable time) vs Fermat x^(p-2).
+// bn_inverse is whatever options.h selects, build with
+// BENCH_OPT="-O2 -DUSE_INVERSE_SAFEGCD=0" to measure the previous fast inverse.
+#include "bench.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/secp256k1.h"
+
+typedef void (*inverse_fn)(bignum256 *x, const bignum256 *prime);
+
+// x^(prime-2), reference for the slow method
+static void inverse_fermat(bignum256 *x, const bignum256 *prime){
+    bignum256 res, e;
+    bn_one(&res);
+    bn_subtract(prime, &res, &e);
+    bn_subi(&e, 1, prime);
+    for(int i=255; i>=0; i--){
+        bn_multiply(&res, &res, prime);
+        if(bn_testbit(&e, i)){
+            bn_multiply(x, &res, prime);
+        }
+    }
+    bn_mod(&res, prime);
+    *x = res;
+}
+
+int main(){
+    struct { const char * name; inverse_fn fn; } fns[] = {
+        { "fermat", inverse_fermat },
+        { "bn_inverse", bn_inverse },
+        { "bn_inverse_ct", bn_inverse_ct },
+        { "bn_inverse_var", bn_inverse_var },
+    };
+    struct { const char * name; const bignum256 * prime; } moduli[] = {
+        { "prime", &secp256k1.prime },
+        { "order", &secp256k1.order },
+    };
+    uint8_t num[32];
+    uint32_t seed = 0xC0FFEE;
+    for(int j=0; j<32; j++){
+        seed = seed * 1103515245 + 12345;
+        num[j] = seed >> 24;
+    }
+    for(size_t m=0; m<sizeof(moduli)/sizeof(moduli[0]); m++){
+        for(size_t i=0; i<sizeof(fns)/sizeof(fns[0]); i++){
+            bignum256 x;
+            bn_read_be(num, &x);
+            std::string name = std::string(fns[i].name) + " " + moduli[m].name;
+            bench(name.c_str(), [&](){
+                fns[i].fn(&x, moduli[m].prime); // chain results so nothing is optimized away
+                x.val[0] ^= 1;
+            });
+            bench_keep(&x);
+        }
+    }
+    bench_report("inverse");
+    return 0;
+}
@@ -0,0 +1,56 @@
+// NIP-44 encryption and decryption of LoRa sized messages.
+// cold: conversation key cache cleared before every message (ecdh each time),
+// warm: repeat peer, only ChaCha20 and HMAC-SHA256.
+#include "bench.h"
+#include "Bitcoin.h"
+#include "Nip44.h"
+
+#define MAX_MSG 1024
+
+static uint8_t payload[NIP44_OVERHEAD + MAX_MSG];
+static uint8_t plaintext[MAX_MSG];
+
+static void bench_nip44(Nip44 &sender, Nip44 &receiver, const uint8_t to[32], const uint8_t from[32],
+                        size_t msglen, bool cold, bool decrypt){
+    uint8_t msg[MAX_MSG];
+    memset(msg, 'x', sizeof(msg));
+    size_t len = sender.encrypt(to, msg, msglen, payload, sizeof(payload));
+    std::string name = std::string(decrypt ? "decrypt" : "encrypt") + (cold ? " cold " : " warm ") +
+                       std::to_string(msglen) + "B";
+    uint8_t n = 0;
+    if(decrypt){
+        bench(name.c_str(), [&](){
+            if(cold){ receiver.clear(); }
+            if(receiver.decrypt(from, payload, len, plaintext, sizeof(plaintext)) != msglen){ printf("?"); }
+        });
+    }else{
+        bench(name.c_str(), [&](){
+            if(cold){ sender.clear(); }
+            msg[0] = n++;
+            if(sender.encrypt(to, msg, msglen, payload, sizeof(payload)) != len){ printf("?"); }
+        });
+    }
+}
+
+int main(){
+    uint8_t secret[32];
+    memset(secret, 0x11, sizeof(secret));
+    PrivateKey a(secret);
+    memset(secret, 0x22, sizeof(secret));
+    PrivateKey b(secret);
+    uint8_t pub_a[32], pub_b[32];
+    a.publicKey().x(pub_a, sizeof(pub_a));
+    b.publicKey().x(pub_b, sizeof(pub_b));
+    Nip44 alice(a), bob(b);
+
+    size_t sizes[] = { 32, 200, 1024 };
+    for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++){
+        size_t len = sizes[i];
+        bench_nip44(alice, bob, pub_b, pub_a, len, true, false);
+        bench_nip44(alice, bob, pub_b, pub_a, len, false, false);
+        bench_nip44(alice, bob, pub_b, pub_a, len, true, true);
+        bench_nip44(alice, bob, pub_b, pub_a, len, false, true);
+    }
+    bench_report("nip44");
+    return 0;
+}
@@ -0,0 +1,20 @@
+// Buffered ChaCha20 generator vs asking the platform source every time.
+#include "bench.h"
+#include "utility/trezor/rand.h"
+
+static uint8_t buf[1024];
+
+int main(){
+    bench("random32", [&](){ buf[0] ^= random32(); });
+    size_t sizes[] = { 32, 1024 };
+    for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++){
+        size_t len = sizes[i];
+        std::string name = "random_buffer " + std::to_string(len) + "B";
+        bench(name.c_str(), [&](){ random_buffer(buf, len); });
+        name = "random_entropy " + std::to_string(len) + "B";
+        bench(name.c_str(), [&](){ random_entropy(buf, len); });
+    }
+    bench_keep(buf);
+    bench_report("rand");
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Hot paths of the library in one run: hashing, encodings, keys,
+// signatures, HD derivation, transactions and PSBT.
+// Human readable table on stderr, JSON on stdout (make bench_json).
+#include "bench.h"
+#include "Bitcoin.h"
+#include "Hash.h"
+#include "Conversion.h"
+#include "PSBT.h"
+
+#define MNEMONIC "flight canvas heart purse potato mixed offer tooth maple blue kitten salute almost staff physical remain coral clump midnight rotate innocent shield inch ski"
+// 2-input psbt signed by MNEMONIC, same as examples/psbt
+#define PSBT_B64 "cHNidP8BAJoCAAAAAqQW9JR6TFv46IXybtf9tKAy5WsYusr6O4rsfN8DIywEAQAAAAD9////9YKXV2aJad3wScN70cgZHMhQtwhTjw95loZfUB57+H4AAAAAAP3///8CwOHkAAAAAAAWABQzSSTq9G6AboazU3oS+BWVAw1zp21KTAAAAAAAFgAU2SSg4OQMonZrrLpdtTzcNes1MthDAQAAAAEAcQIAAAAB6GDWQUAnmq5s8Nm68qPp3fHnpARmx67Q5ZRHGj1rCjgBAAAAAP7///8CdIv2XwAAAAAWABRozVhYn14Pmv8XoAJePV7AQggf/4CWmAAAAAAAFgAUcOVKtnxrbE7ragGagzMqQ7kJsZkAAAAAAQEfgJaYAAAAAAAWABRw5Uq2fGtsTutqAZqDMypDuQmxmSIGA3s6OgE8GCKOcHDJe7XY0q/i/XSe6e933ErCDCCKR5WoGARkI4xUAACAAQAAgAAAAIAAAAAAAAAAAAABAHECAAAAAaH0XE8I0jQHvCDfdDTUbHrm9+oHbq1yt5ansxoaeeNjAQAAAAD+////AoCWmAAAAAAAFgAUQZD8n6hVi91tRSlWl4WkMwuBnoXsVTuMAAAAABYAFMbknFZNyqOzappeWfZi2+EP0asDAAAAAAEBH4CWmAAAAAAAFgAUQZD8n6hVi91tRSlWl4WkMwuBnoUiBgKNwymEX374HvJHU9FIT4YmCn8CuNteCOxtw7bJXGfscxgEZCOMVAAAgAEAAIAAAACAAAAAAAEAAAAAACICA9OwnpVPPgWAC/O7SuxHNPjX46Iz2Qv9dcI033AqEyv+GARkI4xUAACAAQAAgAAAAIABAAAAAAAAAAA="
+
+static uint8_t data[1024];
+
+static void bench_hashes(){
+    uint8_t h[64];
+    bench("sha256 64B", [&](){ sha256(data, 64, h); bench_keep(h); });
+    bench("sha256 1KB", [&](){ sha256(data, 1024, h); bench_keep(h); });
+    bench("sha512 1KB", [&](){ sha512(data, 1024, h); bench_keep(h); });
+    bench("hmac-sha256 64B", [&](){ sha256Hmac(data, 32, data, 64, h); bench_keep(h); });
+    bench("hmac-sha512 64B", [&](){ sha512Hmac(data, 32, data, 64, h); bench_keep(h); });
+    bench("tagged hash 96B", [&](){
+        TaggedHash th("BIP0340/challenge");
+        th.write(data, 96);
+        th.end(h);
+        bench_keep(h);
+    });
+}
+
+static void bench_encodings(){
+    char str[200];
+    uint8_t out[100];
+    bench("toHex 32B", [&](){ toHex(data, 32, str, sizeof(str)); bench_keep(str); });
+    toHex(data, 32, str, sizeof(str));
+    bench("fromHex 32B", [&](){ fromHex(str, 64, out, sizeof(out)); bench_keep(out); });
+    bench("toBase58Check 33B", [&](){ toBase58Check(data, 33, str, sizeof(str)); bench_keep(str); });
+    toBase58Check(data, 33, str, sizeof(str));
+    bench("fromBase58Check 33B", [&](){ fromBase58Check(str, strlen(str), out, sizeof(out)); bench_keep(out); });
+    bench("toBase64 99B", [&](){ toBase64(data, 99, str, sizeof(str)); bench_keep(str); });
+    toBase64(data, 99, str, sizeof(str));
+    bench("fromBase64 99B", [&](){ fromBase64(str, strlen(str), out, sizeof(out)); bench_keep(out); });
+}
+
+static void bench_keys(){
+    uint8_t secret[32], hash[32];
+    memset(secret, 0x11, sizeof(secret));
+    memset(hash, 0x22, sizeof(hash));
+    uint8_t n = 0;
+    bench("PrivateKey(secret)", [&](){
+        secret[0] = n++;
+        PrivateKey pk(secret);
+        bench_keep(pk.publicKey().point);
+    });
+    memset(secret, 0x11, sizeof(secret));
+    PrivateKey pk(secret);
+    PublicKey pub = pk.publicKey();
+
+    Signature sig = pk.sign(hash);
+    bench("ecdsa sign", [&](){ hash[0] = n++; Signature s = pk.sign(hash); bench_keep(&s.index); });
+    hash[0] = 0;
+    bench("ecdsa verify", [&](){ bool ok = pub.verify(sig, hash); bench_keep(&ok); });
+
+    SchnorrSignature ssig = pk.schnorr_sign(hash);
+    bench("schnorr_sign", [&](){ hash[0] = n++; SchnorrSignature s = pk.schnorr_sign(hash); bench_keep(&s); });
+    hash[0] = 0;
+    bench("schnorr_verify", [&](){ bool ok = pub.schnorr_verify(ssig, hash); bench_keep(&ok); });
+}
+
+static void bench_hd(){
+    HDPrivateKey root;
+    bench("fromMnemonic", [&](){ root.fromMnemonic(MNEMONIC, ""); bench_keep(root.chainCode); });
+    uint32_t idx = 0;
+    bench("HDPrivateKey::child", [&](){ HDPrivateKey c = root.child(idx++); bench_keep(c.chainCode); });
+    bench("HDPrivateKey::child hardened", [&](){ HDPrivateKey c = root.child(idx++, true); bench_keep(c.chainCode); });
+    bench("HDPrivateKey::derive m/84h/0h/0h/0/1", [&](){ HDPrivateKey c = root.derive("m/84h/0h/0h/0/1"); bench_keep(c.chainCode); });
+}
+
+static void bench_tx(){
+    PSBT psbt;
+    psbt.parseBase64(PSBT_B64);
+    uint8_t raw[1000];
+    size_t len = psbt.tx.serialize(raw, sizeof(raw));
+    bench("Tx parse 2-in 2-out", [&](){ Tx tx; tx.parse(raw, len); bench_keep(&tx.inputsNumber); });
+    uint8_t out[1000];
+    bench("Tx serialize 2-in 2-out", [&](){ psbt.tx.serialize(out, sizeof(out)); bench_keep(out); });
+
+    uint8_t secret[32];
+    memset(secret, 0x11, sizeof(secret));
+    PrivateKey pk(secret);
+    Script script(pk.publicKey(), P2PKH);
+    uint8_t h[32];
+    unsigned inputs[] = { 1, 10, 100 };
+    for(size_t i=0; i<sizeof(inputs)/sizeof(inputs[0]); i++){
+        Tx tx;
+        uint8_t prev[32];
+        memset(prev, 0x33, sizeof(prev));
+        for(unsigned j=0; j<inputs[i]; j++){
+            prev[0] = j;
+            tx.addInput(TxIn(prev, j));
+        }
+        tx.addOutput(TxOut(100000, script));
+        char name[40];
+        snprintf(name, sizeof(name), "sigHashSegwit %u inputs", inputs[i]);
+        bench(name, [&](){ tx.sigHashSegwit(h, 0, script, 100000); bench_keep(h); });
+    }
+
+    HDPrivateKey root(MNEMONIC, "");
+    bench("PSBT parse", [&](){ PSBT p; p.parseBase64(PSBT_B64); bench_keep(&p.tx.inputsNumber); });
+    bench("PSBT parse + sign 2 inputs", [&](){
+        PSBT p;
+        p.parseBase64(PSBT_B64);
+        uint8_t n = p.sign(root);
+        bench_keep(&n);
+    });
+}
+
+int main(){
+    for(size_t i=0; i<sizeof(data); i++){
+        data[i] = i * 7 + 3;
+    }
+    bench_hashes();
+    bench_encodings();
+    bench_keys();
+    bench_hd();
+    bench_tx();
+    bench_report("ubitcoin");
+    return 0;
+}
@@ -0,0 +1,134 @@
+#ifdef UBTC_TEST // only compile with test flag
+
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "PSBT.h"
+
+using namespace std;
+
+#define MNEMONIC "flight canvas heart purse potato mixed offer tooth maple blue kitten salute almost staff physical remain coral clump midnight rotate innocent shield inch ski"
+#define PSBT_B64 "cHNidP8BAJoCAAAAAqQW9JR6TFv46IXybtf9tKAy5WsYusr6O4rsfN8DIywEAQAAAAD9////9YKXV2aJad3wScN70cgZHMhQtwhTjw95loZfUB57+H4AAAAAAP3///8CwOHkAAAAAAAWABQzSSTq9G6AboazU3oS+BWVAw1zp21KTAAAAAAAFgAU2SSg4OQMonZrrLpdtTzcNes1MthDAQAAAAEAcQIAAAAB6GDWQUAnmq5s8Nm68qPp3fHnpARmx67Q5ZRHGj1rCjgBAAAAAP7///8CdIv2XwAAAAAWABRozVhYn14Pmv8XoAJePV7AQggf/4CWmAAAAAAAFgAUcOVKtnxrbE7ragGagzMqQ7kJsZkAAAAAAQEfgJaYAAAAAAAWABRw5Uq2fGtsTutqAZqDMypDuQmxmSIGA3s6OgE8GCKOcHDJe7XY0q/i/XSe6e933ErCDCCKR5WoGARkI4xUAACAAQAAgAAAAIAAAAAAAAAAAAABAHECAAAAAaH0XE8I0jQHvCDfdDTUbHrm9+oHbq1yt5ansxoaeeNjAQAAAAD+////AoCWmAAAAAAAFgAUQZD8n6hVi91tRSlWl4WkMwuBnoXsVTuMAAAAABYAFMbknFZNyqOzappeWfZi2+EP0asDAAAAAAEBH4CWmAAAAAAAFgAUQZD8n6hVi91tRSlWl4WkMwuBnoUiBgKNwymEX374HvJHU9FIT4YmCn8CuNteCOxtw7bJXGfscxgEZCOMVAAAgAEAAIAAAACAAAAAAAEAAAAAACICA9OwnpVPPgWAC/O7SuxHNPjX46Iz2Qv9dcI033AqEyv+GARkI4xUAACAAQAAgAAAAIABAAAAAAAAAAA="
+
+MU_TEST(test_arena_blocks) {
+  uint8_t buf[256];
+  Arena arena(buf, sizeof(buf));
+  mu_assert(bool(arena), "arena should be valid");
+  {
+    ArenaScope scope(arena);
+    uint8_t * a = (uint8_t *)ubtc_malloc(10);
+    mu_assert(arena.owns(a), "allocation should come from the arena");
+    memset(a, 0xAB, 10);
+    uint8_t * b = (uint8_t *)ubtc_realloc(a, 40);
+    mu_assert(a == b, "last block should grow in place");
+    mu_assert(b[9] == 0xAB, "realloc should keep data");
+    size_t used = arena.used();
+    uint8_t * c = (uint8_t *)ubtc_calloc(8, 1);
+    ubtc_free(c);
+    mu_assert(arena.used() == used, "freeing last block should roll back");
+    mu_assert(ubtc_malloc(1000) == NULL, "allocation larger than arena should fail");
+    mu_assert(arena.failures() == 1, "failure should be counted");
+  }
+  mu_assert(ubtc_arena() == NULL, "scope should unbind the arena");
+  void * heap = ubtc_malloc(10);
+  mu_assert(!arena.owns(heap), "without scope heap should be used");
+  ubtc_free(heap);
+  arena.reset();
+  mu_assert(arena.used() == 0, "reset should release everything");
+#if !UBTC_NO_HEAP
+  // heap regions are freed by the destructor, also when too small to use
+  Arena tiny(1);
+  mu_assert(tiny.capacity() == 0, "region smaller than a block should have no capacity");
+  Arena owned(256);
+  mu_assert(bool(owned) && owned.capacity() > 0, "heap region should be valid");
+#endif
+}
+
+MU_TEST(test_arena_psbt) {
+  HDPrivateKey hd(MNEMONIC, "");
+  PSBT reference;
+  reference.parseBase64(PSBT_B64);
+  mu_assert(bool(reference), "psbt should be valid");
+  reference.sign(hd);
+  string expected = reference.toBase64();
+
+  static uint8_t buf[16384];
+  Arena arena(buf, sizeof(buf));
+  {
+    ArenaScope scope(arena);
+    PSBT psbt;
+    psbt.parseBase64(PSBT_B64);
+    mu_assert(bool(psbt), "psbt should be valid in the arena");
+    mu_assert(arena.owns(psbt.txInsMeta), "metadata should live in the arena");
+    mu_assert(arena.owns(psbt.tx.txIns), "inputs should live in the arena");
+    mu_assert(psbt.fee() == reference.fee(), "fee should match");
+    mu_assert(psbt.sign(hd) == 2, "both inputs should be signed");
+    mu_assert(psbt.toBase64() == expected, "signed psbt should match heap version");
+  }
+  mu_assert(arena.peak() > 0, "peak usage should be recorded");
+  arena.reset();
+
+  uint8_t small_buf[512];
+  Arena small(small_buf, sizeof(small_buf));
+  {
+    ArenaScope scope(small);
+    PSBT psbt;
+    psbt.parseBase64(PSBT_B64);
+    mu_assert(!psbt, "psbt should fail cleanly when arena is too small");
+    mu_assert(small.failures() > 0, "failure should be counted");
+  }
+
+  // copies running out of memory at any allocation fail cleanly
+  for(size_t len=128; len<=sizeof(buf); len+=128){
+    Arena copies(buf, len);
+    ArenaScope scope(copies);
+    PSBT copy(reference);
+    PSBT assigned;
+    assigned = reference;
+    if(copies.failures() == 0){
+      mu_assert(bool(copy) && bool(assigned), "copies should be valid when they fit");
+      break;
+    }
+  }
+}
+
+#if UBTC_NO_HEAP
+MU_TEST(test_static_pool) {
+  mu_assert(ubtc_pool_capacity() > 0, "pool capacity should be reported");
+  size_t used = ubtc_pool_used();
+  {
+    HDPrivateKey hd(MNEMONIC, "");
+    PSBT psbt;
+    psbt.parseBase64(PSBT_B64);
+    mu_assert(bool(psbt), "psbt should be valid with static pool");
+    mu_assert(psbt.sign(hd) == 2, "both inputs should be signed");
+    mu_assert(ubtc_pool_used() > used, "psbt should use the pool");
+  }
+  mu_assert(ubtc_pool_used() == used, "all blocks should return to the pool");
+  Tx tx;
+  uint8_t prev[32] = { 0 };
+  for(int i=0; i<UBTC_MAX_INPUTS; i++){
+    mu_assert(tx.addInput(TxIn(prev, i)) == i+1, "input within limits should be added");
+  }
+  size_t failures = ubtc_pool_failures();
+  Script big;
+  uint8_t data[UBTC_MAX_SCRIPT_LEN+1] = { 0 };
+  mu_assert(big.push(data, sizeof(data)) == 0, "script above the limit should fail");
+  mu_assert(ubtc_pool_failures() == failures, "limit check should not hit the pool");
+}
+#endif
+
+MU_TEST_SUITE(test_arena) {
+  MU_RUN_TEST(test_arena_blocks);
+  MU_RUN_TEST(test_arena_psbt);
+#if UBTC_NO_HEAP
+  MU_RUN_TEST(test_static_pool);
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_arena);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
+
+#endif // UBTC_TEST
@@ -0,0 +1,445 @@
+#ifdef UBTC_TEST // only compile with test flag
+
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "utility/trezor/bignum.h"
+#include "utility/trezor/secp256k1.h"
+#include "utility/trezor/ecdsa.h"
+
+using namespace std;
+
+#define PUB_EVEN "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"
+#define PUB_ODD  "0379be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"
+// generator x with the last byte changed is not on the curve
+#define PUB_BAD  "0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f8179c"
+
+#if UBTC_POINT_CACHE_SIZE > 0
+MU_TEST(test_point_cache) {
+  ubtc_point_cache_clear();
+  ECPoint a(PUB_EVEN);
+  mu_assert(ubtc_point_cache_hits() == 0, "first parse should miss");
+  mu_assert(ubtc_point_cache_misses() == 1, "first parse should decompress once");
+  mu_assert(a.isValid(), "point should be valid");
+  size_t misses = ubtc_point_cache_misses();
+
+  ECPoint b(PUB_EVEN);
+  mu_assert(b.isValid(), "cached point should be valid");
+  mu_assert(a == b, "cached point should match decompressed one");
+  mu_assert(ubtc_point_cache_misses() == misses, "second parse should not miss");
+  mu_assert(ubtc_point_cache_hits() > 0, "second parse should hit");
+
+  // other parity is derived from the cached entry
+  ECPoint c(PUB_ODD);
+  mu_assert(c == -a, "odd point should be the negation of even one");
+  mu_assert(c.isValid(), "odd point should be valid");
+  mu_assert(ubtc_point_cache_misses() == misses, "other parity should not miss");
+
+  uint8_t x[32];
+  a.x(x, sizeof(x));
+  PublicKey xonly;
+  xonly.from_x(x, sizeof(x));
+  mu_assert(xonly == a, "x-only key should be taken from the cache");
+  mu_assert(ubtc_point_cache_misses() == misses, "x-only parse should not miss");
+
+  ECPoint bad(PUB_BAD);
+  mu_assert(!bad.isValid(), "point not on the curve should fail");
+  ECPoint bad2(PUB_BAD);
+  mu_assert(!bad2.isValid(), "invalid point should never be cached");
+
+  // wrong y with cached x is not valid
+  ECPoint wrong = a;
+  wrong.compressed = false;
+  wrong.point[63] ^= 0x02;
+  mu_assert(!wrong.isValid(), "wrong y should fail");
+}
+
+MU_TEST(test_point_cache_eviction) {
+  ubtc_point_cache_clear();
+  uint8_t secret[32] = { 0 };
+  secret[31] = 1;
+  PublicKey first = PrivateKey(secret).publicKey();
+  // fill the cache with other points, first one should be replaced
+  for(int i=0; i<UBTC_POINT_CACHE_SIZE; i++){
+    secret[31] = i+2;
+    PublicKey pub = PrivateKey(secret).publicKey();
+    mu_assert(pub.isValid(), "point should be valid");
+  }
+  uint8_t sec[33];
+  first.sec(sec, sizeof(sec));
+  size_t misses = ubtc_point_cache_misses();
+  PublicKey again(sec);
+  mu_assert(again == first, "evicted point should decompress");
+  mu_assert(ubtc_point_cache_misses() == misses+1, "evicted point should miss");
+}
+
+MU_TEST(test_point_cache_keeps_verified_key) {
+  uint8_t secret[32] = { 0 };
+  secret[31] = 7;
+  PrivateKey pk(secret);
+  uint8_t hash[32] = { 0 };
+  // more signatures than entries, every one has its own nonce point
+  const int n = UBTC_POINT_CACHE_SIZE + 8;
+  SchnorrSignature sigs[n];
+  for(int i=0; i<n; i++){
+    hash[0] = i;
+    sigs[i] = pk.schnorr_sign(hash);
+  }
+  uint8_t sec[33];
+  pk.publicKey().sec(sec, sizeof(sec));
+  ubtc_point_cache_clear();
+  PublicKey pub(sec);
+  for(int i=0; i<n; i++){
+    hash[0] = i;
+    mu_assert(pub.schnorr_verify(sigs[i], hash), "signature should verify");
+  }
+  size_t misses = ubtc_point_cache_misses();
+  PublicKey again(sec);
+  mu_assert(again == pub, "key should parse");
+  mu_assert(ubtc_point_cache_misses() == misses, "nonce points should not evict the key");
+}
+#endif
+
+// checks x * x^-1 = 1 for both safegcd variants
+static bool check_inverse(const uint8_t num[32], const bignum256 * prime){
+  bignum256 x, ct, var, one;
+  bn_read_be(num, &x);
+  ct = x;
+  var = x;
+  bn_inverse_ct(&ct, prime);
+  bn_inverse_var(&var, prime);
+  if(!bn_is_equal(&ct, &var) || !bn_is_less(&ct, prime)){
+    return false;
+  }
+  bn_multiply(&x, &ct, prime);
+  bn_fast_mod(&ct, prime);
+  bn_mod(&ct, prime);
+  bn_one(&one);
+  return bn_is_equal(&ct, &one);
+}
+
+MU_TEST(test_inverse) {
+  const bignum256 * moduli[2] = { &secp256k1.prime, &secp256k1.order };
+  uint8_t num[32];
+  for(int m=0; m<2; m++){
+    memset(num, 0, sizeof(num));
+    num[31] = 1;
+    mu_assert(check_inverse(num, moduli[m]), "inverse of 1 should be 1");
+    bn_write_be(moduli[m], num);
+    num[31] -= 1;
+    mu_assert(check_inverse(num, moduli[m]), "inverse of -1 should work");
+    num[31] += 2;
+    mu_assert(check_inverse(num, moduli[m]), "unreduced input should work");
+    memset(num, 0xFF, sizeof(num));
+    mu_assert(check_inverse(num, moduli[m]), "2^256-1 should work");
+    // pseudo-random values
+    uint32_t seed = 0x12345678;
+    for(int i=0; i<200; i++){
+      for(int j=0; j<32; j++){
+        seed = seed * 1103515245 + 12345;
+        num[j] = seed >> 24;
+      }
+      mu_assert(check_inverse(num, moduli[m]), "random inverse should work");
+    }
+  }
+}
+
+// specialized multiplication is selected by the prime pointer,
+// a copy of the prime goes through the generic code
+static bool check_multiply(const uint8_t a[32], const uint8_t b[32], const bignum256 * prime){
+  bignum256 copy = *prime;
+  bignum256 x, y, k;
+  bn_read_be(a, &k);
+  bn_read_be(b, &x);
+  y = x;
+  bn_multiply(&k, &x, prime);
+  bn_multiply(&k, &y, &copy);
+  bn_mod(&x, prime);
+  bn_mod(&y, prime);
+  if(!bn_is_equal(&x, &y)){
+    return false;
+  }
+  // squaring has its own code path
+  x = k;
+  bn_square(&x, prime);
+  bn_multiply(&k, &k, &copy);
+  bn_mod(&x, prime);
+  bn_mod(&k, prime);
+  return bn_is_equal(&x, &k);
+}
+
+MU_TEST(test_multiply) {
+  const bignum256 * moduli[2] = { &secp256k1.prime, &secp256k1.order };
+  uint8_t a[32], b[32];
+  for(int m=0; m<2; m++){
+    memset(a, 0xFF, sizeof(a));
+    memset(b, 0xFF, sizeof(b));
+    mu_assert(check_multiply(a, b, moduli[m]), "(2^256-1)^2 should match");
+    bn_write_be(moduli[m], b);
+    mu_assert(check_multiply(a, b, moduli[m]), "multiple of the modulus should match");
+    b[31] -= 1;
+    mu_assert(check_multiply(b, b, moduli[m]), "(-1)^2 should match");
+    uint32_t seed = 0xDEADBEEF;
+    for(int i=0; i<500; i++){
+      for(int j=0; j<32; j++){
+        seed = seed * 1103515245 + 12345;
+        a[j] = seed >> 24;
+        seed = seed * 1103515245 + 12345;
+        b[j] = seed >> 24;
+      }
+      // some sparse values to hit carries
+      if(i % 5 == 0){ memset(a, 0xFF, 16); }
+      if(i % 7 == 0){ memset(b+16, 0, 16); }
+      mu_assert(check_multiply(a, b, moduli[m]), "random product should match");
+    }
+  }
+  // unreduced input with bits above 2^256, as bn_multiply allows
+  bignum256 x, y, k, copy = secp256k1.prime;
+  for(int i=0; i<9; i++){ k.val[i] = 0x3FFFFFFF; }
+  k.val[8] = 0x3FFFFF; // < 2^262
+  bn_one(&x);
+  x.val[3] = 12345;
+  y = x;
+  bn_multiply(&k, &x, &secp256k1.prime);
+  bn_multiply(&k, &y, &copy);
+  bn_mod(&x, &secp256k1.prime);
+  bn_mod(&y, &secp256k1.prime);
+  mu_assert(bn_is_equal(&x, &y), "unreduced input should match");
+  y = k;
+  bn_square(&k, &secp256k1.prime);
+  bn_multiply(&y, &y, &copy);
+  bn_mod(&k, &secp256k1.prime);
+  bn_mod(&y, &secp256k1.prime);
+  mu_assert(bn_is_equal(&k, &y), "unreduced square should match");
+}
+
+// k * (a * G) should be (k * a) * G for both point_multiply variants
+static bool check_point_multiply(const bignum256 * k, const bignum256 * a){
+  const ecdsa_curve * curve = &secp256k1;
+  curve_point p, ct, var, expected;
+  bignum256 ka = *a;
+  scalar_multiply(curve, a, &p);
+  point_multiply(curve, k, &p, &ct);
+  point_multiply_var(curve, k, &p, &var);
+  bn_multiply(k, &ka, &curve->order);
+  bn_mod(&ka, &curve->order);
+  scalar_multiply(curve, &ka, &expected);
+  return point_is_equal(&ct, &expected) && point_is_equal(&var, &expected);
+}
+
+MU_TEST(test_point_multiply) {
+  // lambda, k = lambda splits into k1 = 0, k2 = 1
+  const uint8_t lambda[32] = {
+    0x53, 0x63, 0xad, 0x4c, 0xc0, 0x5c, 0x30, 0xe0, 0xa5, 0x26, 0x1c, 0x02, 0x88, 0x12, 0x64, 0x5a,
+    0x12, 0x2e, 0x22, 0xea, 0x20, 0x81, 0x66, 0x78, 0xdf, 0x02, 0x96, 0x7c, 0x1b, 0x23, 0xbd, 0x72
+  };
+  bignum256 k, a;
+  bn_read_uint32(0x12345, &a);
+  for(uint32_t i=1; i<20; i++){
+    bn_read_uint32(i, &k);
+    mu_assert(check_point_multiply(&k, &a), "small scalar should work");
+    bn_subtract(&secp256k1.order, &k, &k);
+    mu_assert(check_point_multiply(&k, &a), "negative small scalar should work");
+  }
+  bn_read_be(lambda, &k);
+  mu_assert(check_point_multiply(&k, &a), "lambda should work");
+  bn_subtract(&secp256k1.order, &k, &k);
+  mu_assert(check_point_multiply(&k, &a), "-lambda should work");
+  bn_addi(&k, 1);
+  mu_assert(check_point_multiply(&k, &a), "1-lambda should work");
+  bn_zero(&k);
+  bn_setbit(&k, 128);
+  mu_assert(check_point_multiply(&k, &a), "2^128 should work");
+  bn_subi(&k, 1, &secp256k1.order);
+  bn_mod(&k, &secp256k1.order);
+  mu_assert(check_point_multiply(&k, &a), "2^128-1 should work");
+
+  bn_zero(&k);
+  curve_point p, res;
+  scalar_multiply(&secp256k1, &a, &p);
+  point_multiply(&secp256k1, &k, &p, &res);
+  mu_assert(point_is_infinity(&res), "0*p should be infinity");
+  point_multiply_var(&secp256k1, &k, &p, &res);
+  mu_assert(point_is_infinity(&res), "0*p should be infinity in variable time");
+
+  uint8_t num[32];
+  uint32_t seed = 0xA5A5A5A5;
+  for(int i=0; i<100; i++){
+    for(int j=0; j<32; j++){
+      seed = seed * 1103515245 + 12345;
+      num[j] = seed >> 24;
+    }
+    bn_read_be(num, &k);
+    bn_mod(&k, &secp256k1.order);
+    for(int j=0; j<32; j++){
+      seed = seed * 1103515245 + 12345;
+      num[j] = seed >> 24;
+    }
+    bn_read_be(num, &a);
+    bn_mod(&a, &secp256k1.order);
+    mu_assert(check_point_multiply(&k, &a), "random scalar should work");
+  }
+}
+
+MU_TEST(test_point_table) {
+  const ecdsa_curve * curve = &secp256k1;
+#if USE_PRECOMPUTED_CP
+  // the table of G should be the shipped one
+  size_t len = point_table_length(UBTC_ECMULT_GEN_WINDOW);
+  curve_point * table = (curve_point *)malloc(len * sizeof(curve_point));
+  point_table_build(curve, &curve->G, UBTC_ECMULT_GEN_WINDOW, table);
+  bool same = true;
+  for(size_t i=0; i<len; i++){
+    same &= (bool)point_is_equal(&table[i], &(&curve->cp[0][0])[i]);
+  }
+  free(table);
+  mu_assert(same, "table of G should match curve->cp");
+#endif
+  // all window sizes, 8 needs more than one batch per window
+  bignum256 k, a;
+  curve_point p, expected, res;
+  bn_read_uint32(777, &a);
+  scalar_multiply(curve, &a, &p);
+  int windows[] = { 2, 3, 5, 8 };
+  uint32_t seed = 0x5EED;
+  for(int i=0; i<4; i++){
+    int w = windows[i];
+    curve_point * t = (curve_point *)malloc(point_table_length(w) * sizeof(curve_point));
+    point_table_build(curve, &p, w, t);
+    bool ok = true;
+    for(int n=0; n<5; n++){
+      for(int j=0; j<9; j++){
+        seed = seed * 1103515245 + 12345;
+        k.val[j] = seed & 0x3FFFFFFF;
+      }
+      k.val[8] &= 0xFFFF;
+      bn_mod(&k, &curve->order);
+      point_table_multiply(curve, &k, t, w, &res);
+      point_multiply(curve, &k, &p, &expected);
+      ok &= (bool)point_is_equal(&res, &expected);
+    }
+    free(t);
+    mu_assert(ok, "table multiplication should match point_multiply");
+  }
+}
+
+MU_TEST(test_prepared_pubkey) {
+  uint8_t secret[32], hash[32], other[32];
+  memset(hash, 0x42, sizeof(hash));
+  memset(other, 0x24, sizeof(other));
+  for(int i=0; i<4; i++){
+    memset(secret, 0x11 + i, sizeof(secret));
+    PrivateKey pk(secret);
+    PublicKey pub = pk.publicKey();
+#if UBTC_NO_HEAP
+    // the pool has no room for tables, they come from an arena
+    static uint8_t buf[36*1024+1024];
+    Arena arena(buf, sizeof(buf));
+    PreparedPublicKey prepared;
+    {
+      ArenaScope scope(arena);
+      prepared.prepare(pub);
+    }
+#else
+    PreparedPublicKey prepared(pub);
+#endif
+    mu_assert(prepared.isValid(), "valid key should be prepared");
+    mu_assert(prepared.publicKey() == pub, "prepared key should keep the public key");
+
+    Signature sig = pk.sign(hash);
+    mu_assert(prepared.verify(sig, hash), "ecdsa signature should verify");
+    mu_assert(!prepared.verify(sig, other), "ecdsa signature for other hash should fail");
+
+    // covers keys with both odd and even y
+    SchnorrSignature ssig = pk.schnorr_sign(hash);
+    mu_assert(pub.schnorr_verify(ssig, hash), "schnorr signature should verify with plain key");
+    mu_assert(prepared.schnorr_verify(ssig, hash), "schnorr signature should verify");
+    mu_assert(!prepared.schnorr_verify(ssig, other), "schnorr signature for other hash should fail");
+
+    PrivateKey peer(other);
+    uint8_t s1[32], s2[32];
+    peer.ecdh(pub, s1);
+    peer.ecdh(prepared, s2);
+    mu_assert(memcmp(s1, s2, 32) == 0, "ecdh should match");
+
+    ECScalar d(hash, 32);
+    mu_assert(prepared.multiply(d) == d * pub, "multiplication should match");
+  }
+  PreparedPublicKey empty;
+  mu_assert(!empty, "empty key should be invalid");
+  mu_assert(!empty.prepare(PublicKey(PUB_BAD)), "invalid key should not be prepared");
+  mu_assert(!empty.verify(Signature(), hash), "invalid key should not verify");
+}
+
+MU_TEST(test_rfc6979) {
+  // sha256("sample") with the key from the trezor-crypto tests
+  uint8_t priv[32], hash[32], expected[32], k[32];
+  fromHex("cca9fbcc1b41e5a95d369eaa6ddcff73b61a4efaa279cfc6567e8daa39cbaf50", priv, 32);
+  fromHex("af2bdbe1aa9b6ec1e2ade1d694f41fc71a831d0268e9891562113d8a62add1bf", hash, 32);
+  fromHex("2df40ca70e639d89528a6b670d9d48d9165fdc0febc0974056bdce192b8e16a3", expected, 32);
+  rfc6979_state rng;
+  init_rfc6979(priv, hash, &rng);
+  generate_rfc6979(k, &rng);
+  mu_assert(memcmp(k, expected, 32) == 0, "nonce should match the test vector");
+
+  rfc6979_key key;
+  prepare_rfc6979_key(priv, &key);
+  init_rfc6979_key(&key, hash, &rng);
+  generate_rfc6979(k, &rng);
+  mu_assert(memcmp(k, expected, 32) == 0, "nonce from prepared key should match");
+
+#if USE_RFC6979
+  uint8_t sig1[64], sig2[64], by1 = 0, by2 = 0;
+  for(int i=0; i<8; i++){
+    hash[0] = i;
+    ecdsa_sign_digest(&secp256k1, priv, hash, sig1, &by1, NULL);
+    ecdsa_sign_digest_key(&secp256k1, &key, hash, sig2, &by2, NULL);
+    mu_assert(memcmp(sig1, sig2, 64) == 0 && by1 == by2, "signatures should match");
+  }
+#endif
+}
+
+MU_TEST(test_prepared_privkey) {
+  uint8_t secret[32], hash[32];
+  memset(hash, 0x42, sizeof(hash));
+  for(int i=0; i<4; i++){
+    memset(secret, 0x11 + i, sizeof(secret));
+    PrivateKey pk(secret);
+    PreparedPrivateKey prepared(pk);
+    mu_assert(prepared.isValid(), "valid key should be prepared");
+    mu_assert(prepared.publicKey() == pk.publicKey(), "prepared key should keep the public key");
+    for(int j=0; j<4; j++){
+      hash[0] = j;
+      Signature sig = prepared.sign(hash);
+#if USE_RFC6979
+      mu_assert(sig == pk.sign(hash), "signature should match PrivateKey::sign");
+      mu_assert(sig.index == pk.sign(hash).index, "recovery index should match");
+#endif
+      mu_assert(pk.publicKey().verify(sig, hash), "signature should verify");
+    }
+  }
+  PreparedPrivateKey empty;
+  mu_assert(!empty, "empty key should be invalid");
+}
+
+MU_TEST_SUITE(test_curve) {
+  MU_RUN_TEST(test_rfc6979);
+  MU_RUN_TEST(test_prepared_privkey);
+  MU_RUN_TEST(test_point_table);
+  MU_RUN_TEST(test_prepared_pubkey);
+  MU_RUN_TEST(test_point_multiply);
+  MU_RUN_TEST(test_multiply);
+  MU_RUN_TEST(test_inverse);
+#if UBTC_POINT_CACHE_SIZE > 0
+  MU_RUN_TEST(test_point_cache);
+  MU_RUN_TEST(test_point_cache_eviction);
+  MU_RUN_TEST(test_point_cache_keeps_verified_key);
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_curve);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
+
+#endif // UBTC_TEST
@@ -0,0 +1,136 @@
+#ifdef UBTC_TEST // only compile with test flag
+
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "Nip44.h"
+#include "Conversion.h"
+#include "utility/trezor/chacha20.h"
+
+using namespace std;
+
+// x-only public keys of secrets 1 and 2
+#define PUB1 "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"
+#define PUB2 "c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5"
+
+static PrivateKey key_from_int(uint8_t n){
+  uint8_t secret[32] = { 0 };
+  secret[31] = n;
+  return PrivateKey(secret);
+}
+
+MU_TEST(test_chacha20) {
+  // RFC 8439, section 2.4.2
+  uint8_t key[32], nonce[12];
+  for(int i=0; i<32; i++){ key[i] = i; }
+  fromHex("000000000000004a00000000", nonce, sizeof(nonce));
+  const char plaintext[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+  size_t len = strlen(plaintext);
+  uint8_t out[114];
+  mu_assert(len == sizeof(out), "wrong plaintext length");
+  chacha20_ctx ctx;
+  chacha20_init(&ctx, key, nonce, 1);
+  chacha20_xor(&ctx, (const uint8_t *)plaintext, out, len);
+  mu_assert(toHex(out, 16) == "6e2e359a2568f98041ba0728dd0d6981", "first block is invalid");
+  mu_assert(toHex(out+96, 18) == "5af90bbf74a35be6b40b8eedf2785e42874d", "last block is invalid");
+
+  chacha20_init(&ctx, key, nonce, 1);
+  chacha20_xor(&ctx, out, out, len);
+  mu_assert(memcmp(out, plaintext, len) == 0, "in place decryption failed");
+}
+
+MU_TEST(test_nip44_padding) {
+  size_t lengths[][2] = {
+    {1, 32}, {16, 32}, {32, 32}, {33, 64}, {37, 64}, {64, 64}, {65, 96},
+    {100, 128}, {111, 128}, {200, 224}, {250, 256}, {320, 320}, {383, 384},
+    {384, 384}, {400, 448}, {500, 512}, {512, 512}, {515, 640}, {700, 768},
+    {800, 896}, {900, 1024}, {1020, 1024}, {65535, 65536},
+  };
+  for(size_t i=0; i<sizeof(lengths)/sizeof(lengths[0]); i++){
+    mu_assert(nip44_padded_length(lengths[i][0]) == lengths[i][1], "padded length is invalid");
+  }
+  mu_assert(nip44_padded_length(0) == 0, "empty plaintext is not allowed");
+  mu_assert(nip44_padded_length(65536) == 0, "too long plaintext is not allowed");
+}
+
+MU_TEST(test_nip44_vector) {
+  // first encrypt_decrypt vector from the NIP-44 spec
+  PrivateKey sec1 = key_from_int(1);
+  uint8_t pub2[32], pub1[32], ck[32], nonce[32] = { 0 };
+  fromHex(PUB2, pub2, 32);
+  fromHex(PUB1, pub1, 32);
+  mu_assert(nip44_conversation_key(sec1, pub2, ck), "conversation key failed");
+  mu_assert(toHex(ck, 32) == "c41c775356fd92eadc63ff5a0dc1da211b268cbea22316767095b2871ea1412d", "conversation key is invalid");
+
+  nonce[31] = 1;
+  const char expected[] = "AgAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAABee0G5VSK0/9YypIObAtDKfYEAjD35uVkHyB0F4DwrcNaCXlCWZKaArsGrY6M9wnuTMxWfp1RTN9Xga8no+kF5Vsb";
+  uint8_t payload[NIP44_OVERHEAD + 32];
+  size_t len = nip44_encrypt(ck, nonce, (const uint8_t *)"a", 1, payload, sizeof(payload));
+  mu_assert(len == sizeof(payload), "payload length is invalid");
+  mu_assert(toBase64(payload, len) == expected, "payload is invalid");
+
+  // the other side decrypts with its own key
+  Nip44 alice(key_from_int(2));
+  uint8_t plaintext[32];
+  len = alice.decryptBase64(pub1, expected, strlen(expected), plaintext, sizeof(plaintext));
+  mu_assert(len == 1 && plaintext[0] == 'a', "decryption failed");
+}
+
+MU_TEST(test_nip44_cache) {
+  Nip44 alice(key_from_int(1));
+  Nip44 bob(key_from_int(2));
+  uint8_t pub1[32], pub2[32];
+  fromHex(PUB1, pub1, 32);
+  fromHex(PUB2, pub2, 32);
+
+  const char msg[] = "hello from the mesh";
+  uint8_t payload[NIP44_OVERHEAD + 32];
+  uint8_t plaintext[32];
+  for(int i=0; i<3; i++){
+    size_t len = alice.encrypt(pub2, (const uint8_t *)msg, strlen(msg), payload, sizeof(payload));
+    mu_assert(len == nip44_payload_length(strlen(msg)), "encryption failed");
+    len = bob.decrypt(pub1, payload, len, plaintext, sizeof(plaintext));
+    mu_assert(len == strlen(msg) && memcmp(plaintext, msg, len) == 0, "decryption failed");
+  }
+  mu_assert(alice.misses() == 1 && alice.hits() == 2, "repeat peer should hit the cache");
+  mu_assert(bob.misses() == 1 && bob.hits() == 2, "repeat peer should hit the cache");
+
+  // every byte of the payload is authenticated
+  size_t len = nip44_payload_length(strlen(msg));
+  for(size_t i=0; i<len; i++){
+    payload[i] ^= 0x01;
+    mu_assert(bob.decrypt(pub1, payload, len, plaintext, sizeof(plaintext)) == 0, "modified payload should fail");
+    payload[i] ^= 0x01;
+  }
+  mu_assert(bob.decrypt(pub1, payload, len, plaintext, 16) == 0, "short buffer should fail");
+  mu_assert(bob.decrypt(pub1, payload, len-1, plaintext, sizeof(plaintext)) == 0, "truncated payload should fail");
+
+  // more peers than entries evicts the least recently used one
+  for(uint8_t i=3; i<3+UBTC_NIP44_CACHE_SIZE; i++){
+    uint8_t pub[32];
+    key_from_int(i).publicKey().x(pub, sizeof(pub));
+    mu_assert(alice.encrypt(pub, (const uint8_t *)msg, strlen(msg), payload, sizeof(payload)) > 0, "encryption failed");
+  }
+  size_t misses = alice.misses();
+  alice.encrypt(pub2, (const uint8_t *)msg, strlen(msg), payload, sizeof(payload));
+  mu_assert(alice.misses() == misses + 1, "evicted peer should miss");
+
+  // x coordinate that is not on the curve
+  uint8_t bad[32];
+  memset(bad, 0xFF, sizeof(bad));
+  mu_assert(alice.encrypt(bad, (const uint8_t *)msg, strlen(msg), payload, sizeof(payload)) == 0, "invalid peer should fail");
+}
+
+MU_TEST_SUITE(test_nip44) {
+  MU_RUN_TEST(test_chacha20);
+  MU_RUN_TEST(test_nip44_padding);
+  MU_RUN_TEST(test_nip44_vector);
+  MU_RUN_TEST(test_nip44_cache);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_nip44);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
+
+#endif // UBTC_TEST
@@ -0,0 +1,79 @@
+#ifdef UBTC_TEST // only compile with test flag
+
+#include "minunit.h"
+#include "Bitcoin.h"
+#include "Hash.h"
+#include "Arena.h"
+#include "utility/trezor/prof.h"
+#include <thread>
+
+using namespace std;
+
+MU_TEST(test_prof_names) {
+  for(int i=0; i<UBTC_PROF_COUNT; i++){
+    mu_assert(strlen(ubtc_prof_name((ubtc_prof_id)i)) > 0, "every counter should have a name");
+  }
+  mu_assert(strcmp(ubtc_prof_name(UBTC_PROF_SHA256_TRANSFORM), "sha256_Transform") == 0, "wrong name");
+  mu_assert(strcmp(ubtc_prof_name(UBTC_PROF_COUNT), "") == 0, "invalid id should have no name");
+  mu_assert(strlen(ubtc_prof_unit()) > 0, "unit is missing");
+}
+
+MU_TEST(test_prof_counters) {
+  ubtc_prof_counter c[UBTC_PROF_COUNT];
+  uint8_t secret[32], hash[64], data[128] = { 0 };
+  memset(secret, 0x11, sizeof(secret));
+  PrivateKey pk(secret);
+  PublicKey pub = pk.publicKey();
+
+  ubtc_prof_reset();
+  sha256(data, sizeof(data), hash); // 128 bytes + padding = 3 blocks
+  sha512(data, sizeof(data), hash); // 2 blocks
+  Signature sig = pk.sign(hash);
+  pub.verify(sig, hash);
+  void * ptr = ubtc_malloc(10);
+  ptr = ubtc_realloc(ptr, 20);
+  ubtc_free(ptr);
+  ubtc_prof_get(c);
+#if UBTC_PROFILE
+  mu_assert(c[UBTC_PROF_SHA512_TRANSFORM].calls == 2, "sha512 should process 2 blocks");
+  mu_assert(c[UBTC_PROF_SHA256_TRANSFORM].calls >= 3, "sha256 blocks are not counted");
+  mu_assert(c[UBTC_PROF_ECDSA_SIGN].calls == 1, "one signature expected");
+  mu_assert(c[UBTC_PROF_SCALAR_MULTIPLY].calls >= 1, "signing should multiply G");
+  mu_assert(c[UBTC_PROF_BN_INVERSE].calls >= 1, "signing should invert k");
+  mu_assert(c[UBTC_PROF_POINT_MULTIPLY_VAR].calls >= 1, "verification should multiply the public key");
+  mu_assert(c[UBTC_PROF_ALLOC].calls == 2, "malloc and realloc expected");
+  mu_assert(c[UBTC_PROF_FREE].calls == 1, "free expected");
+  mu_assert(c[UBTC_PROF_ECDSA_SIGN].ticks > 0, "signing should take time");
+  mu_assert(c[UBTC_PROF_SHA256_TRANSFORM].ticks > 0, "hashing should take time");
+
+  // counters are per thread
+  ubtc_prof_counter other[UBTC_PROF_COUNT];
+  thread t([&other](){
+    uint8_t h[32];
+    sha256((const uint8_t *)"abc", 3, h);
+    ubtc_prof_get(other);
+  });
+  t.join();
+  mu_assert(other[UBTC_PROF_SHA256_TRANSFORM].calls == 1, "thread should have its own counters");
+  mu_assert(other[UBTC_PROF_ECDSA_SIGN].calls == 0, "thread should have its own counters");
+
+  ubtc_prof_reset();
+  ubtc_prof_get(c);
+#endif
+  for(int i=0; i<UBTC_PROF_COUNT; i++){
+    mu_assert(c[i].calls == 0 && c[i].ticks == 0, "counters should be zero");
+  }
+}
+
+MU_TEST_SUITE(test_prof) {
+  MU_RUN_TEST(test_prof_names);
+  MU_RUN_TEST(test_prof_counters);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_prof);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
+
+#endif // UBTC_TEST
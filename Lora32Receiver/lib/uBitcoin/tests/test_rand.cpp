@@ -0,0 +1,108 @@
+#ifdef UBTC_TEST // only compile with test flag
+
+#include "minunit.h"
+#include "utility/trezor/rand.h"
+#include "utility/trezor/options.h"
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// count seeding calls, entropy still comes from the system
+static volatile int entropy_calls = 0;
+
+extern "C" int random_entropy(uint8_t *buf, size_t len){
+  entropy_calls++;
+  FILE * f = fopen("/dev/urandom", "rb");
+  if(f == NULL){
+    return 0;
+  }
+  size_t n = fread(buf, 1, len, f);
+  fclose(f);
+  return n == len;
+}
+
+static bool is_zero(const uint8_t * buf, size_t len){
+  for(size_t i=0; i<len; i++){
+    if(buf[i] != 0){ return false; }
+  }
+  return true;
+}
+
+MU_TEST(test_random_buffer) {
+  uint8_t a[32], b[32], big[1000];
+  random_buffer(a, sizeof(a));
+  random_buffer(b, sizeof(b));
+  mu_assert(!is_zero(a, sizeof(a)), "output should not be zero");
+  mu_assert(memcmp(a, b, sizeof(a)) != 0, "outputs should differ");
+  // longer than the internal buffer
+  random_buffer(big, sizeof(big));
+  mu_assert(!is_zero(big + sizeof(big) - 32, 32), "long output should be filled");
+  mu_assert(random32() != random32(), "random32 should not repeat");
+  for(int i=0; i<100; i++){
+    mu_assert(random_uniform(10) < 10, "random_uniform out of range");
+  }
+}
+
+MU_TEST(test_random_reseed) {
+  uint8_t buf[1024];
+  random_buffer(buf, 1); // seeded
+  int calls = entropy_calls;
+  for(size_t i=0; i<RAND_RESEED_INTERVAL/sizeof(buf); i++){
+    random_buffer(buf, sizeof(buf));
+  }
+  mu_assert(entropy_calls == calls + 1, "generator should reseed after RAND_RESEED_INTERVAL bytes");
+  random_reseed();
+  mu_assert(entropy_calls == calls + 2, "random_reseed should get entropy");
+}
+
+MU_TEST(test_random_fork) {
+  uint8_t parent[32], child[32];
+  random_buffer(parent, 1); // make sure the state is seeded before fork
+  int fds[2];
+  mu_assert(pipe(fds) == 0, "pipe failed");
+  pid_t pid = fork();
+  mu_assert(pid >= 0, "fork failed");
+  if(pid == 0){
+    int calls = entropy_calls;
+    random_buffer(child, sizeof(child));
+    ssize_t n = write(fds[1], child, sizeof(child));
+    _exit((n == sizeof(child) && entropy_calls == calls + 1) ? 0 : 1);
+  }
+  random_buffer(parent, sizeof(parent));
+  mu_assert(read(fds[0], child, sizeof(child)) == sizeof(child), "child output missing");
+  int status = 0;
+  waitpid(pid, &status, 0);
+  close(fds[0]);
+  close(fds[1]);
+  mu_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0, "child should reseed after fork");
+  mu_assert(memcmp(parent, child, sizeof(child)) != 0, "parent and child should not share output");
+}
+
+MU_TEST(test_random_threads) {
+  uint8_t a[32], b[32];
+  random_buffer(a, sizeof(a));
+  int calls = entropy_calls;
+  thread t([&b](){ random_buffer(b, sizeof(b)); });
+  t.join();
+  mu_assert(entropy_calls == calls + 1, "new thread should seed its own generator");
+  mu_assert(memcmp(a, b, sizeof(a)) != 0, "threads should not share output");
+}
+
+MU_TEST_SUITE(test_rand) {
+  MU_RUN_TEST(test_random_buffer);
+  MU_RUN_TEST(test_random_reseed);
+  MU_RUN_TEST(test_random_fork);
+  MU_RUN_TEST(test_random_threads);
+}
+
+int main(int argc, char *argv[]) {
+  MU_RUN_SUITE(test_rand);
+  MU_REPORT();
+  return MU_EXIT_CODE;
+}
+
+#endif // UBTC_TEST
@@ -0,0 +1,86 @@
+/*
+ * Prints the contents of the secp256k1.cp array for a window size w.
+ * The entry cp[i][j] contains the number (2*j+1)*2^(w*i)*G,
+ * where G is the generator of secp256k1.
+ *
+ * The table for w = 4 is shipped as src/utility/trezor/secp256k1.table,
+ * other sizes are selected with UBTC_ECMULT_GEN_WINDOW and have to be
+ * generated next to it (or anywhere in the include path):
+ *
+ *   cd src/utility/trezor
+ *   cc -I. -DUSE_PRECOMPUTED_CP=0 -O2 ../../../tools/mktable.c *.c -o mktable
+ *   ./mktable 8 > secp256k1_w8.table
+ *
+ * tests/Makefile does this automatically for ECMULT_GEN_WINDOW.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "bignum.h"
+#include "ecdsa.h"
+#include "secp256k1.h"
+
+int main(int argc, char **argv) {
+	int i, j, k;
+	int w = 4;
+	if (argc > 2) {
+		printf("Usage: %s [WINDOW]\n", argv[0]);
+		return 1;
+	}
+	if (argc == 2) {
+		w = atoi(argv[1]);
+	}
+	if (w < 2 || w > 8) {
+		fprintf(stderr, "Window should be between 2 and 8\n");
+		return 1;
+	}
+	const ecdsa_curve *curve = &secp256k1;
+	int windows = (256 + w - 1) / w;
+	int points = 1 << (w - 1);
+
+	curve_point ng = curve->G;
+	curve_point pow2ig = curve->G;
+	for (i = 0; i < windows; i++) {
+		// invariants:
+		//   pow2ig = 2^(w*i) * G
+		//   ng     = pow2ig
+		printf("\t{\n");
+		for (j = 0; j < points; j++) {
+			// invariants:
+			//   pow2ig = 2^(w*i) * G
+			//   ng     = (2*j+1) * 2^(w*i) * G
+#ifndef NDEBUG
+			curve_point checkresult;
+			bignum256 a;
+			bn_zero(&a);
+			a.val[(w*i) / 30] = (((uint32_t) 2*j+1) << ((w*i) % 30)) & 0x3FFFFFFF;
+			if ((w*i) / 30 < 8) {
+				a.val[(w*i) / 30 + 1] = ((uint32_t) 2*j+1) >> (30 - (w*i) % 30);
+			}
+			bn_fast_mod(&a, &curve->order);
+			bn_mod(&a, &curve->order);
+			point_multiply(curve, &a, &curve->G, &checkresult);
+			assert(point_is_equal(&checkresult, &ng));
+#endif
+			printf("\t\t/* %2d*%d^%d*G: */\n\t\t{{{", 2*j + 1, 1 << w, i);
+			// print x coordinate
+			for (k = 0; k < 9; k++) {
+				printf((k < 8 ? "0x%08x, " : "0x%04x"), ng.x.val[k]);
+			}
+			printf("}},\n\t\t {{");
+			// print y coordinate
+			for (k = 0; k < 9; k++) {
+				printf((k < 8 ? "0x%08x, " : "0x%04x"), ng.y.val[k]);
+			}
+			if (j == points - 1) {
+				printf("}}}\n\t},\n");
+			} else {
+				printf("}}},\n");
+				point_add(curve, &pow2ig, &ng);
+			}
+			point_add(curve, &pow2ig, &ng);
+		}
+		pow2ig = ng;
+	}
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include "acktable.h"
+#include <string.h>
+
+#if (ACK_TABLE_SIZE & (ACK_TABLE_SIZE - 1)) != 0
+#error ACK_TABLE_SIZE must be a power of two
+#endif
+#if ACK_MAX_RELAYS > 8
+#error ACK_MAX_RELAYS is limited by the acked bits
+#endif
+
+AckTable::AckTable() : used(0), probed(0)
+{
+    memset(slots, 0, sizeof(slots));
+}
+
+size_t AckTable::home(const uint8_t id[32]) const
+{
+    uint32_t h = id[0] | (uint32_t)id[1] << 8 | (uint32_t)id[2] << 16 | (uint32_t)id[3] << 24;
+    return h & (ACK_TABLE_SIZE - 1);
+}
+
+AckSlot *AckTable::find(const uint8_t id[32])
+{
+    size_t i = home(id);
+    for (size_t n = 0; n < ACK_TABLE_SIZE; n++) {
+        probed++;
+        AckSlot &s = slots[i];
+        if (!s.used) {
+            return NULL;
+        }
+        if (memcmp(s.id, id, sizeof(s.id)) == 0) {
+            return &s;
+        }
+        i = (i + 1) & (ACK_TABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+AckSlot *AckTable::insert(const uint8_t id[32], uint16_t event)
+{
+    if (full()) {
+        return NULL;
+    }
+    size_t i = home(id);
+    while (true) {
+        probed++;
+        AckSlot &s = slots[i];
+        if (!s.used) {
+            memset(&s, 0, sizeof(s));
+            memcpy(s.id, id, sizeof(s.id));
+            s.event = event;
+            s.used = 1;
+            used++;
+            return &s;
+        }
+        if (memcmp(s.id, id, sizeof(s.id)) == 0) {
+            return NULL;
+        }
+        i = (i + 1) & (ACK_TABLE_SIZE - 1);
+    }
+}
+
+void AckTable::remove(AckSlot *slot)
+{
+    size_t hole = slot - slots;
+    if (hole >= ACK_TABLE_SIZE || !slot->used) {
+        return;
+    }
+    // move back every later slot of the run that may sit in the hole
+    size_t i = hole;
+    while (true) {
+        i = (i + 1) & (ACK_TABLE_SIZE - 1);
+        if (!slots[i].used) {
+            break;
+        }
+        size_t want = home(slots[i].id);
+        // distance from the wanted slot, the hole is closer than i
+        if (((i - want) & (ACK_TABLE_SIZE - 1)) >= ((i - hole) & (ACK_TABLE_SIZE - 1))) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole].used = 0;
+    used--;
+}
+
+void AckTable::clear()
+{
+    memset(slots, 0, sizeof(slots));
+    used = 0;
+}
+
+void AckTable::sent(AckSlot *slot, uint8_t relay, unsigned long now)
+{
+    if (relay >= ACK_MAX_RELAYS) {
+        return;
+    }
+    slot->sentAt[relay] = now;
+    slot->waiting |= 1 << relay;
+    slot->late &= ~(1 << relay);
+    if (slot->tries[relay] < 0xFF) {
+        slot->tries[relay]++;
+    }
+}
+
+long AckTable::ack(AckSlot *slot, uint8_t relay, unsigned long now)
+{
+    if (relay >= ACK_MAX_RELAYS || (slot->acked & (1 << relay))) {
+        return -1;
+    }
+    slot->acked |= 1 << relay;
+    slot->waiting &= ~(1 << relay);
+    return slot->tries[relay] ? (long)(now - slot->sentAt[relay]) : 0;
+}
+
+bool AckTable::due(const AckSlot *slot, uint8_t relay, unsigned long now) const
+{
+    if (relay >= ACK_MAX_RELAYS || (slot->acked & (1 << relay)) || slot->tries[relay] >= ACK_MAX_TRIES) {
+        return false;
+    }
+    return slot->tries[relay] == 0 || now - slot->sentAt[relay] >= ACK_DEADLINE_MS;
+}
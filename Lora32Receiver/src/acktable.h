@@ -0,0 +1,77 @@
+#ifndef GATEWAY_ACKTABLE_H
+#define GATEWAY_ACKTABLE_H
+
+// Events in flight, keyed by the 32 byte event id: which relays were sent
+// the event, when, how often, and which ones answered OK. Open addressing
+// with linear probing in a fixed array. The id is a sha256, its first bytes
+// are the hash. Removal shifts the following slots back, no tombstones.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// relays a slot can track, one bit each in acked
+#ifndef ACK_MAX_RELAYS
+#define ACK_MAX_RELAYS 8
+#endif
+// slots, a power of two
+#ifndef ACK_TABLE_SIZE
+#define ACK_TABLE_SIZE 64
+#endif
+// a relay without OK this long after the send gets the event again
+#ifndef ACK_DEADLINE_MS
+#define ACK_DEADLINE_MS 10000
+#endif
+// sends to one relay, the first one included
+#ifndef ACK_MAX_TRIES
+#define ACK_MAX_TRIES 8
+#endif
+
+// inserts stop here so probe runs stay short
+#define ACK_TABLE_LOAD (ACK_TABLE_SIZE * 3 / 4)
+
+typedef struct {
+    uint8_t id[32];
+    uint16_t event;             // the owner's number for the event
+    uint8_t used;
+    uint8_t acked;              // bit per relay that accepted
+    uint8_t waiting;            // bit per relay whose last send is not answered
+    uint8_t late;               // bit per relay past its hedge time, or refused
+    uint8_t tries[ACK_MAX_RELAYS];
+    unsigned long sentAt[ACK_MAX_RELAYS];   // millis of the last send
+} AckSlot;
+
+class AckTable {
+public:
+    AckTable();
+
+    // slot for a new event, NULL if the table is full or the id is in it
+    AckSlot *insert(const uint8_t id[32], uint16_t event);
+    AckSlot *find(const uint8_t id[32]);
+    // the slot pointer and the ones after it may move
+    void remove(AckSlot *slot);
+    void clear();
+
+    void sent(AckSlot *slot, uint8_t relay, unsigned long now);
+    // OK from relay, returns ms since the last send to it or -1 if it acked before
+    long ack(AckSlot *slot, uint8_t relay, unsigned long now);
+    // the relay needs the event (again) at now
+    bool due(const AckSlot *slot, uint8_t relay, unsigned long now) const;
+    static uint8_t acks(const AckSlot *slot) { return (uint8_t)__builtin_popcount(slot->acked); }
+
+    size_t size() const { return used; }
+    bool full() const { return used >= ACK_TABLE_LOAD; }
+    // for walking the table, check used
+    AckSlot *at(size_t i) { return &slots[i]; }
+    size_t capacity() const { return ACK_TABLE_SIZE; }
+    // slots looked at by find and insert, to check the hash
+    unsigned long probes() const { return probed; }
+
+private:
+    size_t home(const uint8_t id[32]) const;
+
+    AckSlot slots[ACK_TABLE_SIZE];
+    size_t used;
+    unsigned long probed;
+};
+
+#endif
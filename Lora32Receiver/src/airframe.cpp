@@ -0,0 +1,94 @@
+#include "airframe.h"
+#include <string.h>
+
+static size_t writeVarint(uint32_t v, uint8_t *out)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// 0 if the varint runs past len, overflows 32 bits or has a needless 0 byte at the end.
+// One encoding per value keeps sender and sequence comparable as bytes
+static size_t readVarint(const uint8_t *data, size_t len, uint32_t &v)
+{
+    v = 0;
+    for (size_t i = 0; i < len && i < 5; i++) {
+        if (i == 4 && data[i] > 0x0F) {
+            return 0;
+        }
+        v |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if (!(data[i] & 0x80)) {
+            return (i > 0 && data[i] == 0) ? 0 : i + 1;
+        }
+    }
+    return 0;
+}
+
+bool isAirFrame(const uint8_t *data, size_t len)
+{
+    return len > 0 && (data[0] & AIRFRAME_MAGIC) == AIRFRAME_MAGIC;
+}
+
+size_t airFrameEncode(uint8_t type, uint8_t flags, uint32_t sender, uint32_t seq,
+                      const uint8_t *payload, size_t len, uint8_t *out, size_t size)
+{
+    uint8_t head[AIRFRAME_MAX_HEADER];
+    head[0] = AIRFRAME_MAGIC | AIRFRAME_VERSION;
+    head[1] = (uint8_t)((type & 0x0F) | flags << 4);
+    size_t n = 2;
+    n += writeVarint(sender, head + n);
+    n += writeVarint(seq, head + n);
+    if (len > size || n > size - len) {
+        return 0;
+    }
+    memcpy(out, head, n);
+    memcpy(out + n, payload, len);
+    return n + len;
+}
+
+bool airFrameDecode(const uint8_t *data, size_t len, AirFrame &frame)
+{
+    if (len < 4 || !isAirFrame(data, len)) {
+        return false;
+    }
+    frame.version = data[0] & ~AIRFRAME_MAGIC;
+    if (frame.version != AIRFRAME_VERSION) {
+        return false;
+    }
+    frame.type = data[1] & 0x0F;
+    frame.flags = data[1] >> 4;
+    size_t pos = 2;
+    size_t n = readVarint(data + pos, len - pos, frame.sender);
+    if (!n) {
+        return false;
+    }
+    pos += n;
+    n = readVarint(data + pos, len - pos, frame.seq);
+    if (!n) {
+        return false;
+    }
+    pos += n;
+    frame.payload = data + pos;
+    frame.length = len - pos;
+    return true;
+}
+
+unsigned long loraAirtimeMicros(size_t len, int spreadingFactor)
+{
+    // Semtech AN1200.13, symbols of 2^SF / 125 kHz = 2^SF * 8 us
+    const int sf = spreadingFactor, codingRate = 1, crc = 1, explicitHeader = 1;
+    // low data rate optimization, the library turns it on above 16 ms symbols
+    const int lowRate = sf >= 11 ? 1 : 0;
+    unsigned long symbol = 8UL << sf;
+    long bits = 8 * (long)len - 4 * sf + 28 + 16 * crc - 20 * (1 - explicitHeader);
+    long perBlock = 4 * (sf - 2 * lowRate);
+    long blocks = bits > 0 ? (bits + perBlock - 1) / perBlock : 0;
+    unsigned long symbols = 8 + blocks * (codingRate + 4);
+    // 8 preamble symbols plus 4.25 of sync word
+    return symbol * (8 * 4 + 17) / 4 + symbol * symbols;
+}
@@ -0,0 +1,53 @@
+#ifndef GATEWAY_AIRFRAME_H
+#define GATEWAY_AIRFRAME_H
+
+// LoRa air frames: a binary header in front of the payload, so a sender
+// doesn't spell out who it is and which message this is in text. Shared
+// with Lora32Sender, nothing here depends on the board.
+//
+// Frame format, all varints are LEB128 in their shortest form:
+//   byte     AIRFRAME_MAGIC | version, 0xF8..0xFF never appear in UTF-8
+//            so a frame can't be mistaken for the plain text of old senders
+//   byte     type in the low 4 bits, flags in the high 4 bits
+//   varint   sender short id
+//   varint   sequence number, counts up per sender
+//   payload  the rest of the frame
+// The header of sender 0x1234 message 5 is 5 bytes.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AIRFRAME_MAGIC 0xF8
+#define AIRFRAME_VERSION 1
+// two bytes and two varints of up to 5 bytes
+#define AIRFRAME_MAX_HEADER 12
+
+// message types
+#define AIRFRAME_TEXT 1         // UTF-8 text, the content of a note
+
+// flags
+#define AIRFRAME_COMPRESSED 1   // the payload is text packed by textcodec.h
+
+typedef struct {
+    uint8_t version;
+    uint8_t type;
+    uint8_t flags;
+    uint32_t sender;
+    uint32_t seq;
+    const uint8_t *payload;     // points into the decoded frame
+    size_t length;
+} AirFrame;
+
+// true if data starts like an air frame of any version, false for plain text
+bool isAirFrame(const uint8_t *data, size_t len);
+// writes header and payload, returns the frame size or 0 if it doesn't fit
+size_t airFrameEncode(uint8_t type, uint8_t flags, uint32_t sender, uint32_t seq,
+                      const uint8_t *payload, size_t len, uint8_t *out, size_t size);
+// false if the frame is cut short, not minimally encoded or of an unknown version
+bool airFrameDecode(const uint8_t *data, size_t len, AirFrame &frame);
+
+// time on air of a frame of len bytes with the LoRa library defaults:
+// 125 kHz, coding rate 4/5, 8 preamble symbols, explicit header and CRC
+unsigned long loraAirtimeMicros(size_t len, int spreadingFactor);
+
+#endif
@@ -0,0 +1,115 @@
+#include "dedup.h"
+#include <math.h>
+#include <string.h>
+
+#if (DEDUP_BITS & (DEDUP_BITS - 1)) != 0 || DEDUP_BITS > 65535
+#error DEDUP_BITS must be a power of two below 65536
+#endif
+
+// FNV-1a over the bytes, continued from h
+static uint64_t fnv1a(const uint8_t *data, size_t len, uint64_t h)
+{
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// spreads FNV's weak low bits over the word (splitmix64 finalizer)
+static uint64_t mix(uint64_t h)
+{
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+static float bloomRate(float ones)
+{
+    return powf(ones / DEDUP_BITS, DEDUP_HASHES);
+}
+
+DuplicateFilter::DuplicateFilter(SystemClock &clock) : clock(clock), current(0), rotatedAt(0)
+{
+    memset(&counters, 0, sizeof(counters));
+    memset(bits, 0, sizeof(bits));
+    ones[0] = ones[1] = 0;
+    frames[0] = frames[1] = 0;
+}
+
+void DuplicateFilter::clear()
+{
+    memset(bits, 0, sizeof(bits));
+    ones[0] = ones[1] = 0;
+    frames[0] = frames[1] = 0;
+    rotatedAt = clock.millis();
+}
+
+void DuplicateFilter::rotate(unsigned long now)
+{
+    current ^= 1;
+    memset(bits[current], 0, sizeof(bits[current]));
+    ones[current] = 0;
+    frames[current] = 0;
+    rotatedAt = now;
+    counters.rotations++;
+}
+
+bool DuplicateFilter::seen(const uint8_t *data, size_t len)
+{
+    return seen(NULL, 0, data, len);
+}
+
+bool DuplicateFilter::seen(const uint8_t *prefix, size_t prefixLen, const uint8_t *data, size_t len)
+{
+    unsigned long now = clock.millis();
+    if (now - rotatedAt >= DEDUP_WINDOW_MS) {
+        // quiet for a whole window, both generations are too old
+        clear();
+    } else if (now - rotatedAt >= DEDUP_WINDOW_MS / 2 || frames[current] >= DEDUP_CAPACITY) {
+        rotate(now);
+    }
+    counters.checked++;
+
+    uint64_t h = mix(fnv1a(data, len, fnv1a(prefix, prefixLen, 0xcbf29ce484222325ULL)));
+    // double hashing, h2 odd so the probes cover every bit
+    uint32_t h1 = (uint32_t)h;
+    uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    uint8_t *cur = bits[current];
+    const uint8_t *old = bits[current ^ 1];
+    bool inCurrent = true, inOld = true;
+    for (int i = 0; i < DEDUP_HASHES; i++) {
+        uint32_t bit = (h1 + i * h2) & (DEDUP_BITS - 1);
+        uint8_t mask = 1 << (bit & 7);
+        if (!(old[bit >> 3] & mask)) {
+            inOld = false;
+        }
+        if (!(cur[bit >> 3] & mask)) {
+            inCurrent = false;
+            cur[bit >> 3] |= mask;
+            ones[current]++;
+        }
+    }
+    if (!inCurrent) {
+        frames[current]++;
+    }
+    if (inCurrent || inOld) {
+        counters.suppressed++;
+        return true;
+    }
+    return false;
+}
+
+float DuplicateFilter::configuredFalsePositiveRate()
+{
+    // expected bits set with DEDUP_CAPACITY frames in a generation
+    float full = DEDUP_BITS * (1.0f - expf(-(float)DEDUP_HASHES * DEDUP_CAPACITY / DEDUP_BITS));
+    float p = bloomRate(full);
+    return 1.0f - (1.0f - p) * (1.0f - p);
+}
+
+float DuplicateFilter::falsePositiveRate() const
+{
+    float a = bloomRate(ones[0]);
+    float b = bloomRate(ones[1]);
+    return 1.0f - (1.0f - a) * (1.0f - b);
+}
@@ -0,0 +1,65 @@
+#ifndef GATEWAY_DEDUP_H
+#define GATEWAY_DEDUP_H
+
+// Duplicate frame filter: the same LoRa frame heard again through another
+// repeater, or twice by the radio, is dropped before it is signed. Two
+// Bloom filter generations rotate every DEDUP_WINDOW_MS / 2, or earlier
+// when the current one holds DEDUP_CAPACITY frames, and a frame counts as
+// seen if either holds it. A frame is remembered for at least half the
+// window. Bloom filters give false positives, never false negatives:
+// a new frame is dropped with about falsePositiveRate() probability.
+
+#include "hal.h"
+
+// bits per generation, a power of two
+#ifndef DEDUP_BITS
+#define DEDUP_BITS 8192
+#endif
+#ifndef DEDUP_HASHES
+#define DEDUP_HASHES 7
+#endif
+// frames per generation before it rotates early
+#ifndef DEDUP_CAPACITY
+#define DEDUP_CAPACITY 512
+#endif
+#ifndef DEDUP_WINDOW_MS
+#define DEDUP_WINDOW_MS 30000
+#endif
+
+typedef struct {
+    unsigned long checked;      // frames looked up
+    unsigned long suppressed;   // found in the filter
+    unsigned long rotations;    // generations started
+} DedupStats;
+
+class DuplicateFilter {
+public:
+    explicit DuplicateFilter(SystemClock &clock);
+
+    // true if the frame is in the window, remembers it either way
+    bool seen(const uint8_t *data, size_t len);
+    // the same for a frame given as prefix and data, hashed as one. The
+    // gateway passes the air frame's sender id and sequence as the prefix
+    // and the decoded text as data
+    bool seen(const uint8_t *prefix, size_t prefixLen, const uint8_t *data, size_t len);
+    void clear();
+
+    // false-positive rate with both generations at DEDUP_CAPACITY
+    static float configuredFalsePositiveRate();
+    // the same from the bits set now
+    float falsePositiveRate() const;
+    const DedupStats &stats() const { return counters; }
+
+private:
+    void rotate(unsigned long now);
+
+    SystemClock &clock;
+    uint8_t bits[2][DEDUP_BITS / 8];
+    uint16_t ones[2];           // bits set per generation
+    uint16_t frames[2];         // frames added per generation
+    uint8_t current;
+    unsigned long rotatedAt;
+    DedupStats counters;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "gateway.h"
+#include <stdio.h>
+#include <string.h>
+
+Gateway::Gateway(RadioLink &radio, Uplink &uplink, SystemClock &clock, NoteSigner &signer, RelayLink &relays)
+    : radio(radio), uplink(uplink), clock(clock), signer(signer), relays(relays), log(NULL), recorder(NULL),
+      outbox(NULL), dedup(NULL), frameLength(0), content(frame), contentLength(0), sender(0), seq(0), rssi(0),
+      snr(0), receivedAt(0)
+{
+    memset(&counters, 0, sizeof(counters));
+    frame[0] = 0;
+    text[0] = 0;
+}
+
+void Gateway::begin(const char *ssid, const char *password)
+{
+    uplink.begin(ssid, password);
+    while (!uplink.connected()) {
+        clock.delay(500);
+    }
+    if (log) {
+        log("WiFi connected");
+    }
+}
+
+unsigned long Gateway::secondsSinceLastReceive()
+{
+    return (clock.millis() - receivedAt) / 1000;
+}
+
+bool Gateway::poll()
+{
+    int packetSize = radio.parsePacket();
+    if (packetSize <= 0) {
+        return false;
+    }
+    receivedAt = clock.millis();
+    counters.received++;
+
+    frameLength = radio.readPacket(frame, GATEWAY_MAX_FRAME);
+    frame[frameLength] = 0;
+    content = frame;
+    contentLength = frameLength;
+    sender = seq = 0;
+    rssi = radio.packetRssi();
+    snr = radio.packetSnr();
+    if (recorder) {
+        recorder->record(receivedAt, rssi, snr, frame, frameLength);
+    }
+
+    // old senders send plain text, the whole of it tells frames apart
+    bool framed = isAirFrame(frame, frameLength);
+    if (framed) {
+        AirFrame air;
+        bool known = airFrameDecode(frame, frameLength, air) && air.type == AIRFRAME_TEXT &&
+                     (air.flags & ~AIRFRAME_COMPRESSED) == 0;
+        if (known && (air.flags & AIRFRAME_COMPRESSED)) {
+            contentLength = textDecompress(air.payload, air.length, text, GATEWAY_MAX_TEXT);
+            text[contentLength] = 0;
+            content = text;
+            known = contentLength > 0;
+        } else if (known) {
+            content = air.payload;
+            contentLength = air.length;
+        }
+        if (!known) {
+            content = frame;
+            contentLength = frameLength;
+            counters.invalid++;
+            if (log) {
+                log("Unknown air frame dropped");
+            }
+            return true;
+        }
+        sender = air.sender;
+        seq = air.seq;
+    }
+    if (log) {
+        char line[GATEWAY_MAX_TEXT + 80];
+        if (framed) {
+            snprintf(line, sizeof(line), "Received #%lu from %lx '%s' with RSSI %d", (unsigned long)seq,
+                     (unsigned long)sender, (const char *)content, rssi);
+        } else {
+            snprintf(line, sizeof(line), "Received packet '%s' with RSSI %d", (const char *)content, rssi);
+        }
+        log(line);
+    }
+
+    // sender and sequence number name a message, the text goes in too so
+    // a sender that starts counting again after a reboot isn't dropped
+    bool repeat = false;
+    if (dedup && framed) {
+        const uint8_t key[8] = { (uint8_t)sender, (uint8_t)(sender >> 8), (uint8_t)(sender >> 16),
+                                 (uint8_t)(sender >> 24), (uint8_t)seq, (uint8_t)(seq >> 8),
+                                 (uint8_t)(seq >> 16), (uint8_t)(seq >> 24) };
+        repeat = dedup->seen(key, sizeof(key), content, contentLength);
+    } else if (dedup) {
+        repeat = dedup->seen(frame, frameLength);
+    }
+    if (repeat) {
+        counters.duplicates++;
+        if (log) {
+            log("Duplicate packet dropped");
+        }
+        return true;
+    }
+
+    size_t n = signer.note(clock.unixTime(), content, contentLength, note, sizeof(note));
+    if (!n) {
+        counters.failed++;
+        if (log) {
+            log("Signing failed");
+        }
+        return true;
+    }
+    if (log) {
+        log("Sending note to nostr");
+        log(note);
+    }
+    bool handedOff = outbox != NULL && outbox->add(note, n, uplink.connected());
+    // a full outbox doesn't hold back a note that can go out now
+    if (!handedOff && (outbox == NULL || uplink.connected())) {
+        // once to every relay that is up, nothing tracks the OKs
+        for (size_t r = 0; r < relays.count(); r++) {
+            if (relays.connected(r) && relays.send(r, note)) {
+                handedOff = true;
+            }
+        }
+    }
+    if (!handedOff) {
+        counters.dropped++;
+        if (log) {
+            log("Note dropped, no room in the outbox and no relay up");
+        }
+        return true;
+    }
+    counters.published++;
+    return true;
+}
+
+bool Gateway::loop()
+{
+    bool received = poll();
+    if (outbox) {
+        outbox->loop(uplink.connected());
+    }
+    // nothing to talk to without the uplink, notes wait in the outbox
+    if (uplink.connected()) {
+        relays.loop();
+    }
+    return received;
+}
+
+void Gateway::onOk(const char *payload, int relay)
+{
+    if (outbox) {
+        outbox->onOk(payload, relay);
+    }
+    // ["OK","<id>",true,""], the flag follows the id
+    const char *p = strstr(payload, "\"OK\"");
+    if (p != NULL) {
+        p = strchr(p + 4, ',');
+    }
+    if (p != NULL) {
+        p = strchr(p + 1, ',');
+    }
+    if (p == NULL) {
+        return;
+    }
+    p++;
+    while (*p == ' ') {
+        p++;
+    }
+    if (strncmp(p, "true", 4) == 0) {
+        counters.oks++;
+    } else {
+        counters.rejected++;
+    }
+    if (log) {
+        log(payload);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+// Receiver logic without the hardware: LoRa packet -> signed note -> relays.
+// main.cpp wires it to the board, host/ to a fake radio and loopback relays.
+
+#include "hal.h"
+#include "trace.h"
+#include "outbox.h"
+#include "dedup.h"
+#include "airframe.h"
+#include "textcodec.h"
+
+typedef struct {
+    unsigned long received;   // packets read from the radio
+    unsigned long published;  // notes handed to the outbox or the relays
+    unsigned long dropped;    // signed notes neither the outbox nor a relay took
+    unsigned long failed;     // packets that could not be signed
+    unsigned long duplicates; // dropped by the duplicate filter
+    unsigned long invalid;    // air frames that don't decode or that this gateway can't handle
+    unsigned long oks;        // accepted by a relay
+    unsigned long rejected;   // refused by a relay
+} GatewayStats;
+
+class Gateway {
+public:
+    Gateway(RadioLink &radio, Uplink &uplink, SystemClock &clock, NoteSigner &signer, RelayLink &relays);
+
+    // blocks until the uplink is up
+    void begin(const char *ssid, const char *password);
+    // handles one received packet if there is one, true if it did
+    bool poll();
+    // poll and relay traffic, call from loop(). True if a packet was handled
+    bool loop();
+    // ["OK",<event id>,<true|false>,<message>] from a relay, -1 if the relay isn't known
+    void onOk(const char *payload, int relay = -1);
+
+    // optional debug output, one line per call
+    void setLogger(void (*logger)(const char *line)) { log = logger; }
+    // optional trace of every received packet, NULL to stop
+    void setRecorder(TraceWriter *writer) { recorder = writer; }
+    // optional persistent outbox between the signer and the relays, call its begin first
+    void setOutbox(Outbox *box) { outbox = box; }
+    // optional filter that drops frames heard before, they are not signed
+    void setDuplicateFilter(DuplicateFilter *filter) { dedup = filter; }
+
+    const GatewayStats &stats() const { return counters; }
+    // text of the last packet without the air frame header and unpacked,
+    // NUL terminated for display, it may hold other NULs
+    const char *lastPayload() const { return (const char *)content; }
+    size_t lastLength() const { return contentLength; }
+    // sender and sequence number of the last packet, 0 for plain text
+    uint32_t lastSender() const { return sender; }
+    uint32_t lastSeq() const { return seq; }
+    int lastRssi() const { return rssi; }
+    float lastSnr() const { return snr; }
+    unsigned long lastReceiveTime() const { return receivedAt; }
+    // seconds since the last packet
+    unsigned long secondsSinceLastReceive();
+
+private:
+    RadioLink &radio;
+    Uplink &uplink;
+    SystemClock &clock;
+    NoteSigner &signer;
+    RelayLink &relays;
+    void (*log)(const char *line);
+    TraceWriter *recorder;
+    Outbox *outbox;
+    DuplicateFilter *dedup;
+
+    GatewayStats counters;
+    // preallocated so the packet path doesn't touch the heap
+    uint8_t frame[GATEWAY_MAX_FRAME + 1];
+    size_t frameLength;
+    // into frame or text
+    const uint8_t *content;
+    size_t contentLength;
+    uint8_t text[GATEWAY_MAX_TEXT + 1];
+    uint32_t sender;
+    uint32_t seq;
+    char note[GATEWAY_MAX_NOTE];
+    int rssi;
+    float snr;
+    unsigned long receivedAt;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef GATEWAY_HAL_H
+#define GATEWAY_HAL_H
+
+// Thin interfaces between the gateway logic and the hardware, so the same
+// Gateway runs on the board (main.cpp) and in the host simulator (host/).
+
+#include <stddef.h>
+#include <stdint.h>
+
+// largest LoRa frame, the size of the SX127x FIFO
+#define GATEWAY_MAX_FRAME 255
+// largest note text, a compressed frame may not unpack to more
+#define GATEWAY_MAX_TEXT GATEWAY_MAX_FRAME
+// largest ["EVENT",{...}] message: the fixed fields plus the content
+// escaped as \u00XX in the worst case
+#define GATEWAY_MAX_NOTE (512 + 6 * GATEWAY_MAX_TEXT)
+
+// LoRa radio
+class RadioLink {
+public:
+    virtual ~RadioLink() {}
+    // size of the received packet, 0 if there is none
+    virtual int parsePacket() = 0;
+    // copies the packet announced by parsePacket in one go, returns its length
+    virtual size_t readPacket(uint8_t *buf, size_t size) = 0;
+    virtual int packetRssi() = 0;
+    virtual float packetSnr() = 0;
+};
+
+// WiFi uplink
+class Uplink {
+public:
+    virtual ~Uplink() {}
+    virtual void begin(const char *ssid, const char *password) = 0;
+    virtual bool connected() = 0;
+};
+
+class SystemClock {
+public:
+    virtual ~SystemClock() {}
+    // milliseconds since boot
+    virtual unsigned long millis() = 0;
+    // seconds since epoch, 0 if the time is not known yet
+    virtual unsigned long unixTime() = 0;
+    virtual void delay(unsigned long ms) = 0;
+};
+
+// turns a text into a signed ["EVENT",{...}] message
+class NoteSigner {
+public:
+    virtual ~NoteSigner() {}
+    // writes the message to out (NUL terminated), returns its length or 0 on failure
+    virtual size_t note(unsigned long createdAt, const uint8_t *content, size_t len, char *out, size_t size) = 0;
+};
+
+// the Nostr relays, by index. Relay responses come back through
+// Gateway::onOk with the index of the relay that sent them.
+class RelayLink {
+public:
+    virtual ~RelayLink() {}
+    virtual size_t count() = 0;
+    virtual bool connected(size_t relay) = 0;
+    // false if the relay can't take the message now
+    virtual bool send(size_t relay, const char *message) = 0;
+    // keeps the connections alive and reads the responses
+    virtual void loop() = 0;
+};
+
+#endif
@@ -3,25 +3,75 @@
 #include "boards.h"
 #include "WiFiClientSecure.h"
 #include "time.h"
-#include <NostrEvent.h>
-#include <NostrRelayManager.h>
+#include <WebSocketsClient.h>
+#include <LittleFS.h>
+#include "gateway.h"
+#include "nip01.h"
+#include "scheduler.h"
 
 const char* ssid     = "Maddox Guest"; // wifi SSID here
 const char* password = "MadGuest1"; // wifi password here
 
-NostrEvent nostr;
-NostrRelayManager nostrRelayManager;
-NostrQueueProcessor nostrQueue;
+// Packet traces (trace.h). TRACE_RECORD writes every received packet
+// to TRACE_FILE on the SD card (HAS_SDCARD boards) or as TRACE: lines on serial.
+// TRACE_REPLAY feeds REPLAY_FILE from the SD card to the gateway instead
+// of the radio, TRACE_REPLAY_SPEED 1 keeps the recorded timing.
+#define TRACE_OFF     0
+#define TRACE_SD      1
+#define TRACE_SERIAL  2
+#ifndef TRACE_RECORD
+#define TRACE_RECORD TRACE_OFF
+#endif
+#ifndef TRACE_REPLAY
+#define TRACE_REPLAY 0
+#endif
+#ifndef TRACE_REPLAY_SPEED
+#define TRACE_REPLAY_SPEED 1.0
+#endif
+#define TRACE_FILE "/trace.ltr"
+#define REPLAY_FILE "/replay.ltr"
+
+// Persistent outbox (outbox.h): notes are logged to OUTBOX_FILE, on the SD
+// card on HAS_SDCARD boards and on LittleFS otherwise, and sent again after
+// an outage or a reboot until MIN_RELAYS relays took them. A relay without
+// OK after ACK_DEADLINE_MS gets the note again (acktable.h). OUTBOX 0 sends
+// each note once to the connected relays.
+#ifndef OUTBOX
+#define OUTBOX 1
+#endif
+#define OUTBOX_FILE "/outbox.log"
+#define MIN_RELAYS 2
 
-bool hasSentEvent = false;
+// Relay scheduler (scheduler.h), with the outbox: a note goes to the
+// MIN_RELAYS relays with the best latency and error record first, the
+// others only when one of them is late. SCHEDULER 0 sends every note to
+// every relay. The relay health is kept in HEALTH_FILE next to the outbox.
+#ifndef SCHEDULER
+#define SCHEDULER 1
+#endif
+#define HEALTH_FILE "/relays.bin"
+
+// Duplicate filter (dedup.h): a frame heard again within DEDUP_WINDOW_MS,
+// through a repeater or a second receive, is dropped before signing.
+// DEDUP 0 signs and publishes every frame.
+#ifndef DEDUP
+#define DEDUP 1
+#endif
+
+const char *const relayHosts[] = {
+    "relay.damus.io",
+    "nostr.mom",
+    "relay.nostr.bg"
+};
+#define RELAY_COUNT (sizeof(relayHosts) / sizeof(relayHosts[0]))
 
 // NTP server to request epoch time
 const char* ntpServer = "0.uk.pool.ntp.org";
 const long  gmtOffset_sec = 0;
 const int   daylightOffset_sec = 3600;
 
+// the public key d0bfc94bd4324f7df2a7601c4177209828047c4d3904d64009a3c67fb5d5e7ca follows from it
 char const *nsecHex = "bdd19cecd942ed8964c2e0ddc92d5e09838d3a09ebb230d974868be00886704b";
-char const *npubHex = "d0bfc94bd4324f7df2a7601c4177209828047c4d3904d64009a3c67fb5d5e7ca";
 
 unsigned long getUnixTimestamp() {
   time_t now;
@@ -29,126 +79,296 @@ unsigned long getUnixTimestamp() {
   if(!getLocalTime(&timeinfo)){
     Serial.println("Failed to obtain time");
     return 0;
-  } else {
-    Serial.println("Got timestamp of " + String(now));
   }
   time(&now);
+  Serial.print("Got timestamp of ");
+  Serial.println((unsigned long)now);
   return now;
 }
 
-void okEvent(const std::string& key, const char* payload) {
-    Serial.println("OK event");
-    Serial.println("payload is: ");
-    Serial.println(payload);
-    // writeToDisplay("OK event");
+// board side of the gateway interfaces (hal.h)
+
+class LoRaRadio : public RadioLink {
+public:
+    LoRaRadio() : packetSize(0) {}
+    int parsePacket() {
+        packetSize = LoRa.parsePacket();
+        return packetSize;
+    }
+    // through the library, it owns the SPI settings and the FIFO position
+    size_t readPacket(uint8_t *buf, size_t size) {
+        size_t n = (size_t)packetSize < size ? (size_t)packetSize : size;
+        n = LoRa.readBytes(buf, n);
+        packetSize = 0;
+        return n;
+    }
+    int packetRssi() { return LoRa.packetRssi(); }
+    float packetSnr() { return LoRa.packetSnr(); }
+private:
+    int packetSize;
+};
+
+class WiFiUplink : public Uplink {
+public:
+    void begin(const char *ssid, const char *password) { WiFi.begin(ssid, password); }
+    bool connected() { return WiFi.status() == WL_CONNECTED; }
+};
+
+class ArduinoClock : public SystemClock {
+public:
+    unsigned long millis() { return ::millis(); }
+    unsigned long unixTime() { return getUnixTimestamp(); }
+    void delay(unsigned long ms) { ::delay(ms); }
+};
+
+// one websocket per relay so every OK comes with the relay that sent it
+class WebSocketRelays : public RelayLink {
+public:
+    WebSocketRelays() : onOk(NULL) {}
+    void begin(void (*okCallback)(size_t relay, const char *payload)) {
+        onOk = okCallback;
+        for (size_t i = 0; i < RELAY_COUNT; i++) {
+            clients[i].beginSSL(relayHosts[i], 443, "/");
+            clients[i].setReconnectInterval(5000);
+            clients[i].onEvent([this, i](WStype_t type, uint8_t *payload, size_t length) {
+                received(i, type, payload, length);
+            });
+        }
+    }
+    size_t count() { return RELAY_COUNT; }
+    bool connected(size_t relay) { return clients[relay].isConnected(); }
+    bool send(size_t relay, const char *message) { return clients[relay].sendTXT(message); }
+    void loop() {
+        for (size_t i = 0; i < RELAY_COUNT; i++) {
+            clients[i].loop();
+        }
+    }
+private:
+    void received(size_t relay, WStype_t type, uint8_t *payload, size_t length) {
+        if (type == WStype_CONNECTED) {
+            Serial.print("Connected to ");
+            Serial.println(relayHosts[relay]);
+        } else if (type == WStype_DISCONNECTED) {
+            Serial.print("Disconnected from ");
+            Serial.println(relayHosts[relay]);
+        } else if (type == WStype_TEXT) {
+            // text payloads are NUL terminated
+            if (strncmp((const char *)payload, "[\"OK\"", 5) == 0 && onOk) {
+                onOk(relay, (const char *)payload);
+            } else {
+                Serial.println((const char *)payload);
+            }
+        }
+    }
+    WebSocketsClient clients[RELAY_COUNT];
+    void (*onOk)(size_t relay, const char *payload);
+};
+
+// outbox log and relay health on SD or LittleFS, the file is only open while it is used
+class FsOutboxStore : public OutboxStore {
+public:
+    FsOutboxStore(fs::FS &fs, const char *path) : fs(fs), path(path) {}
+    size_t size() {
+        File file = fs.open(path, FILE_READ);
+        return file ? file.size() : 0;
+    }
+    size_t read(size_t offset, uint8_t *data, size_t len) {
+        File file = fs.open(path, FILE_READ);
+        if (!file || !file.seek(offset)) {
+            return 0;
+        }
+        return file.read(data, len);
+    }
+    size_t append(const uint8_t *data, size_t len) {
+        File file = fs.open(path, FILE_APPEND);
+        return file ? file.write(data, len) : 0;
+    }
+    bool clear() {
+        return !fs.exists(path) || fs.remove(path);
+    }
+private:
+    fs::FS &fs;
+    const char *path;
+};
+
+#ifdef HAS_SDCARD
+class SdTraceFile : public TraceSink, public TraceSource {
+public:
+    bool open(const char *path, const char *mode) {
+        file = SD.open(path, mode);
+        return (bool)file;
+    }
+    size_t size() { return file.size(); }
+    size_t write(const uint8_t *data, size_t len) {
+        size_t n = file.write(data, len);
+        // a record is lost at most when the power goes
+        file.flush();
+        return n;
+    }
+    size_t read(uint8_t *data, size_t len) { return file.read(data, len); }
+private:
+    File file;
+};
+#endif
+
+class SerialTraceSink : public TraceSink {
+public:
+    size_t write(const uint8_t *data, size_t len) {
+        Serial.print("TRACE:");
+        for (size_t i = 0; i < len; i++) {
+            if (data[i] < 0x10) {
+                Serial.print('0');
+            }
+            Serial.print(data[i], HEX);
+        }
+        Serial.println();
+        return len;
+    }
+};
+
+WiFiUplink uplink;
+ArduinoClock gatewayClock;
+Nip01Signer signer(nsecHex);
+WebSocketRelays relayLink;
+
+#if TRACE_REPLAY && defined(HAS_SDCARD)
+SdTraceFile replayFile;
+TraceReader replayReader(replayFile);
+TraceRadio radio(replayReader, gatewayClock, TRACE_REPLAY_SPEED);
+#else
+LoRaRadio radio;
+#endif
+Gateway gateway(radio, uplink, gatewayClock, signer, relayLink);
+#if DEDUP
+DuplicateFilter dedup(gatewayClock);
+#endif
+
+#if OUTBOX
+#ifdef HAS_SDCARD
+FsOutboxStore outboxStore(SD, OUTBOX_FILE);
+FsOutboxStore healthStore(SD, HEALTH_FILE);
+#else
+FsOutboxStore outboxStore(LittleFS, OUTBOX_FILE);
+FsOutboxStore healthStore(LittleFS, HEALTH_FILE);
+#endif
+Outbox outbox(outboxStore, relayLink, gatewayClock);
+RelayScheduler scheduler(relayLink, gatewayClock);
+#endif
+
+#if TRACE_RECORD == TRACE_SD && defined(HAS_SDCARD)
+SdTraceFile traceFile;
+TraceWriter traceWriter(traceFile);
+#elif TRACE_RECORD == TRACE_SERIAL
+SerialTraceSink traceSerial;
+TraceWriter traceWriter(traceSerial);
+#endif
+
+void serialLog(const char *line) {
+    Serial.println(line);
 }
 
-void nip01Event(const std::string& key, const char* payload) {
-    Serial.println("NIP01 event");
-    Serial.println("payload is: ");
-    Serial.println(payload);
-    // writeToDisplay("NIP01");
-    delay(1000);
-    // writeToDisplay(payload);
+void okEvent(size_t relay, const char *payload) {
+    Serial.print("OK event from ");
+    Serial.println(relayHosts[relay]);
+    gateway.onOk(payload, (int)relay);
+    // writeToDisplay("OK event");
 }
 
 void setup()
 {
     initBoard();
 
-    WiFi.begin(ssid, password);
-
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-    }
-    Serial.println("");
-    Serial.println("WiFi connected");
+    gateway.setLogger(serialLog);
+#if DEDUP
+    gateway.setDuplicateFilter(&dedup);
+    Serial.print("Duplicate filter false positives when full: ");
+    Serial.println(DuplicateFilter::configuredFalsePositiveRate(), 5);
+#endif
+    gateway.begin(ssid, password);
     Serial.println("IP address: ");
     Serial.println(WiFi.localIP());
 
     configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
 
-    const char *const relays[] = {
-        "relay.damus.io",
-        "nostr.mom",
-        "relay.nostr.bg"
-    };
-    int relayCount = sizeof(relays) / sizeof(relays[0]);
-    
-    nostr.setLogging(false);
-    nostrRelayManager.setRelays(relays, relayCount);
-    nostrRelayManager.setMinRelaysAndTimeout(2,10000);
-
-    // Set some event specific callbacks here
-    nostrRelayManager.setEventCallback("ok", okEvent);
-    nostrRelayManager.setEventCallback("nip01", nip01Event);
-    nostrRelayManager.connect();
+    relayLink.begin(okEvent);
+
+#if OUTBOX
+#ifndef HAS_SDCARD
+    // formats the partition the first time
+    if (!LittleFS.begin(true)) {
+        Serial.println("LittleFS mount failed, notes are not kept");
+    } else
+#endif
+    {
+        outbox.setQuorum(MIN_RELAYS);
+        if (!outbox.begin()) {
+            Serial.println(OUTBOX_FILE " is not an outbox log, starting a new one");
+            outbox.reset();
+        }
+        Serial.print("Outbox events to send: ");
+        Serial.println((unsigned long)outbox.pending());
+        gateway.setOutbox(&outbox);
+#if SCHEDULER
+        scheduler.setNames(relayHosts, RELAY_COUNT);
+        if (!scheduler.begin(&healthStore)) {
+            Serial.println("No relay health saved, learning it");
+        }
+        outbox.setScheduler(&scheduler);
+#endif
+    }
+#endif
 
     // When the power is turned on, a delay is required.
     delay(1500);
 
     Serial.println("LoRa Receiver");
 
+#if TRACE_RECORD == TRACE_SD && defined(HAS_SDCARD)
+    // sessions are appended, the header goes at the start of a new file
+    if (traceFile.open(TRACE_FILE, FILE_APPEND) && (traceFile.size() > 0 || traceWriter.begin())) {
+        gateway.setRecorder(&traceWriter);
+    } else {
+        Serial.println("Can't open " TRACE_FILE);
+    }
+#elif TRACE_RECORD == TRACE_SERIAL
+    gateway.setRecorder(&traceWriter);
+#endif
+
+#if TRACE_REPLAY && defined(HAS_SDCARD)
+    if (!replayFile.open(REPLAY_FILE, FILE_READ) || !replayReader.begin()) {
+        Serial.println("Can't read " REPLAY_FILE);
+        while (1);
+    }
+    Serial.println("Replaying " REPLAY_FILE);
+#else
     LoRa.setPins(RADIO_CS_PIN, RADIO_RST_PIN, RADIO_DIO0_PIN);
     if (!LoRa.begin(LoRa_frequency)) {
         Serial.println("Starting LoRa failed!");
         while (1);
     }
+#endif
 }
 
-long lastReceiveTime = 0;
-
-String getSecsSinceLastReceive()
-{
-    long now = millis();
-    long diff = now - lastReceiveTime;
-    return String(diff / 1000);
-}
-
-String lastTimeUpdate = "";
 void loop()
 {
-    // try to parse packet
-    int packetSize = LoRa.parsePacket();
-    if (packetSize) {
-        lastReceiveTime = millis();
-        // received a packet
-        Serial.print("Received packet '");
-
-        String recv = "";
-        // read packet
-        while (LoRa.available()) {
-            recv += (char)LoRa.read();
-        }
-
-        Serial.println(recv);
-
-        // print RSSI of packet
-        Serial.print("' with RSSI ");
-        Serial.println(LoRa.packetRssi());
-
-
-        long timestamp = getUnixTimestamp();
-        String note = nostr.getNote(nsecHex, npubHex, timestamp, recv.c_str());
-        Serial.println("Sending not to nostr" + note);
-        nostrRelayManager.enqueueMessage(note.c_str());
-
+    if (gateway.loop()) {
 #ifdef HAS_DISPLAY
         if (u8g2) {
             u8g2->clearBuffer();
             char buf[256];
             u8g2->drawStr(0, 10, "Received OK!");
-            u8g2->drawStr(0, 20, recv.c_str());
-            snprintf(buf, sizeof(buf), "RSSI:%i", LoRa.packetRssi());
+            u8g2->drawStr(0, 20, gateway.lastPayload());
+            snprintf(buf, sizeof(buf), "RSSI:%i", gateway.lastRssi());
             u8g2->drawStr(0, 30, buf);
-            snprintf(buf, sizeof(buf), "SNR:%.1f", LoRa.packetSnr());
+            snprintf(buf, sizeof(buf), "SNR:%.1f", gateway.lastSnr());
             u8g2->drawStr(0, 40, buf);
+            if (gateway.lastSender()) {
+                snprintf(buf, sizeof(buf), "From %lX #%lu", (unsigned long)gateway.lastSender(),
+                         (unsigned long)gateway.lastSeq());
+                u8g2->drawStr(0, 50, buf);
+            }
             u8g2->sendBuffer();
         }
 #endif
     }
-
-  nostrRelayManager.loop();
-  nostrRelayManager.broadcastEvents();
 }
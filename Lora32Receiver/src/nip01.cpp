@@ -0,0 +1,173 @@
+#include "nip01.h"
+#include <string.h>
+#include "Hash.h"
+#include "Conversion.h"
+
+static const char hexDigits[] = "0123456789abcdef";
+
+size_t jsonEscape(SerializeStream &out, const uint8_t *content, size_t len, SerializeStream *canonical)
+{
+    size_t n = 0;
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = content[i];
+        char esc = 0;
+        switch (c) {
+        case '"':  esc = '"'; break;
+        case '\\': esc = '\\'; break;
+        case '\n': esc = 'n'; break;
+        case '\r': esc = 'r'; break;
+        case '\t': esc = 't'; break;
+        case '\b': esc = 'b'; break;
+        case '\f': esc = 'f'; break;
+        default:
+            if (c >= 0x20) {
+                continue;
+            }
+        }
+        n += out.write(content + run, i - run);
+        if (canonical) {
+            canonical->write(content + run, i - run);
+        }
+        run = i + 1;
+        if (esc) {
+            uint8_t buf[2] = { '\\', (uint8_t)esc };
+            n += out.write(buf, sizeof(buf));
+            if (canonical) {
+                canonical->write(buf, sizeof(buf));
+            }
+        } else {
+            // NIP-01 hashes other control bytes as they are
+            uint8_t buf[6] = { '\\', 'u', '0', '0', (uint8_t)hexDigits[c >> 4], (uint8_t)hexDigits[c & 0x0F] };
+            n += out.write(buf, sizeof(buf));
+            if (canonical) {
+                canonical->write(&c, 1);
+            }
+        }
+    }
+    n += out.write(content + run, len - run);
+    if (canonical) {
+        canonical->write(content + run, len - run);
+    }
+    return n;
+}
+
+FrameStream::FrameStream(char *buf, size_t size) : buf(buf), size(size), used(0), full(size == 0)
+{
+}
+
+size_t FrameStream::available()
+{
+    // one byte stays free for the NUL
+    return full ? 0 : size - 1 - used;
+}
+
+size_t FrameStream::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t FrameStream::write(const uint8_t *data, size_t len)
+{
+    if (len > available()) {
+        full = true;
+        return 0;
+    }
+    memcpy(buf + used, data, len);
+    used += len;
+    return len;
+}
+
+size_t FrameStream::print(const char *text)
+{
+    return write((const uint8_t *)text, strlen(text));
+}
+
+size_t FrameStream::printHex(const uint8_t *data, size_t len)
+{
+    if (2 * len > available()) {
+        full = true;
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        buf[used++] = hexDigits[data[i] >> 4];
+        buf[used++] = hexDigits[data[i] & 0x0F];
+    }
+    return 2 * len;
+}
+
+size_t FrameStream::printNumber(unsigned long n)
+{
+    char digits[24];
+    size_t i = sizeof(digits);
+    do {
+        digits[--i] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    return write((const uint8_t *)digits + i, sizeof(digits) - i);
+}
+
+size_t FrameStream::finish()
+{
+    if (full) {
+        if (size > 0) {
+            buf[0] = 0;
+        }
+        return 0;
+    }
+    buf[used] = 0;
+    return used;
+}
+
+Nip01Signer::Nip01Signer(const char *nsecHex)
+{
+    uint8_t secret[32];
+    fromHex(nsecHex, secret, sizeof(secret));
+    key = PrivateKey(secret);
+    memset(secret, 0, sizeof(secret));
+    uint8_t x[32];
+    key.publicKey().x(x, sizeof(x));
+    toHex(x, sizeof(x), pubkeyHex, sizeof(pubkeyHex));
+}
+
+size_t Nip01Signer::note(unsigned long createdAt, const uint8_t *content, size_t len, char *out, size_t size)
+{
+    // the number is written the same way to both
+    char number[24];
+    FrameStream numberStream(number, sizeof(number));
+    numberStream.printNumber(createdAt);
+    numberStream.finish();
+
+    // id is the sha256 of [0,pubkey,created_at,kind,tags,content]
+    SHA256 hash;
+    hash.write((const uint8_t *)"[0,\"", 4);
+    hash.write((const uint8_t *)pubkeyHex, 64);
+    hash.write((const uint8_t *)"\",", 2);
+    hash.write((const uint8_t *)number, strlen(number));
+    hash.write((const uint8_t *)",1,[],\"", 7);
+
+    FrameStream frame(out, size);
+    frame.print("[\"EVENT\",{\"content\":\"");
+    jsonEscape(frame, content, len, &hash);
+    hash.write((const uint8_t *)"\"]", 2);
+    if (frame.overflow()) {
+        return frame.finish();
+    }
+
+    uint8_t id[32];
+    hash.end(id);
+    SchnorrSignature sig = key.schnorr_sign(id);
+    uint8_t rs[64];
+    sig.serialize(rs, sizeof(rs));
+
+    frame.print("\",\"pubkey\":\"");
+    frame.print(pubkeyHex);
+    frame.print("\",\"created_at\":");
+    frame.print(number);
+    frame.print(",\"kind\":1,\"tags\":[],\"id\":\"");
+    frame.printHex(id, sizeof(id));
+    frame.print("\",\"sig\":\"");
+    frame.printHex(rs, sizeof(rs));
+    frame.print("\"}]");
+    return frame.finish();
+}
@@ -0,0 +1,53 @@
+#ifndef GATEWAY_NIP01_H
+#define GATEWAY_NIP01_H
+
+// NIP-01 kind 1 notes built without intermediate strings.
+// The content is escaped once and each escaped run goes both into the
+// SHA256 of [0,pubkey,created_at,kind,tags,content] (the event id) and
+// into the outbound ["EVENT",{...}] buffer. For that the message starts
+// with the content, relays don't care about the order of the keys.
+
+#include "hal.h"
+#include "Bitcoin.h"
+
+// writes content as the inside of a JSON string, unescaped runs in one
+// write. Returns the number of bytes written to out. canonical gets the
+// NIP-01 serialization for the id: only \b \t \n \f \r \" and \\ are
+// escaped there, other control bytes stay raw instead of \u00XX
+size_t jsonEscape(SerializeStream &out, const uint8_t *content, size_t len, SerializeStream *canonical = NULL);
+
+// text into a fixed buffer, remembers if anything didn't fit
+class FrameStream : public SerializeStream {
+public:
+    FrameStream(char *buf, size_t size);
+    size_t available();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t *data, size_t len);
+    size_t print(const char *text);
+    size_t printHex(const uint8_t *data, size_t len);
+    size_t printNumber(unsigned long n);
+    size_t length() const { return used; }
+    bool overflow() const { return full; }
+    // NUL terminates the text, returns its length or 0 if it didn't fit
+    size_t finish();
+
+private:
+    char *buf;
+    size_t size;
+    size_t used;
+    bool full;
+};
+
+class Nip01Signer : public NoteSigner {
+public:
+    explicit Nip01Signer(const char *nsecHex);
+    size_t note(unsigned long createdAt, const uint8_t *content, size_t len, char *out, size_t size);
+    // x-only public key in hex
+    const char *pubkey() const { return pubkeyHex; }
+
+private:
+    PrivateKey key;
+    char pubkeyHex[65];
+};
+
+#endif
@@ -0,0 +1,628 @@
+#include "outbox.h"
+#include "scheduler.h"
+#include <string.h>
+
+static const uint8_t outboxMagic[4] = { 'L', 'O', 'B', 'X' };
+static const uint8_t blockSync[2] = { 0xB5, 0x0B };
+
+uint32_t logCrc32(const uint8_t *data, size_t len, uint32_t crc)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static size_t writeVarint(uint32_t v, uint8_t *out)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// 0 if the varint runs past len
+static size_t readVarint(const uint8_t *data, size_t len, uint32_t &v)
+{
+    v = 0;
+    for (size_t i = 0; i < len && i < 5; i++) {
+        v |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if (!(data[i] & 0x80)) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// 64 hex characters to 32 bytes
+static bool parseId(const char *hex, uint8_t id[32])
+{
+    for (int i = 0; i < 32; i++) {
+        int hi = hexValue(hex[2 * i]);
+        int lo = hi < 0 ? -1 : hexValue(hex[2 * i + 1]);
+        if (lo < 0) {
+            return false;
+        }
+        id[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+Outbox::Outbox(OutboxStore &store, RelayLink &relays, SystemClock &clock)
+    : store(store), relays(relays), clock(clock), scheduler(NULL), quorum(1), rate(OUTBOX_SEND_RATE),
+      burst(OUTBOX_SEND_BURST), tokens(OUTBOX_SEND_BURST), refilledAt(0),
+      count(0), done(0), first(0), flushed(0), headerPending(true), buffered(0), bufferedAt(0)
+{
+    memset(&counters, 0, sizeof(counters));
+}
+
+void Outbox::setSendRate(float perSecond, uint8_t burstSize)
+{
+    rate = perSecond;
+    burst = burstSize ? burstSize : 1;
+    tokens = burst;
+}
+
+void Outbox::reset()
+{
+    store.clear();
+    acks.clear();
+    count = done = first = 0;
+    flushed = 0;
+    headerPending = true;
+    buffered = 0;
+}
+
+bool Outbox::begin()
+{
+    acks.clear();
+    count = done = first = 0;
+    buffered = 0;
+    refilledAt = clock.millis();
+    size_t size = store.size();
+    if (size == 0) {
+        flushed = 0;
+        headerPending = true;
+        return true;
+    }
+    uint8_t header[OUTBOX_HEADER_SIZE];
+    if (store.read(0, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, outboxMagic, sizeof(outboxMagic)) != 0 || header[4] != OUTBOX_VERSION) {
+        return false;
+    }
+    flushed = size;
+    headerPending = false;
+
+    size_t p = OUTBOX_HEADER_SIZE;
+    while (p + OUTBOX_BLOCK_HEADER <= size) {
+        size_t next;
+        if (scanBlock(p, next)) {
+            p = next;
+            continue;
+        }
+        // torn block, the next one starts at the next sync bytes
+        counters.skipped++;
+        size_t found = size;
+        for (size_t q = p + 1; q + 1 < size && found == size; q += sizeof(message) - 1) {
+            size_t n = store.read(q, (uint8_t *)message, sizeof(message));
+            for (size_t i = 0; i + 1 < n; i++) {
+                if ((uint8_t)message[i] == blockSync[0] && (uint8_t)message[i + 1] == blockSync[1]) {
+                    found = q + i;
+                    break;
+                }
+            }
+            if (n < sizeof(message)) {
+                break;
+            }
+        }
+        p = found;
+    }
+    return true;
+}
+
+bool Outbox::scanBlock(size_t offset, size_t &next)
+{
+    uint8_t *header = buffer;
+    if (store.read(offset, header, OUTBOX_BLOCK_HEADER) != OUTBOX_BLOCK_HEADER ||
+        memcmp(header, blockSync, sizeof(blockSync)) != 0) {
+        return false;
+    }
+    size_t len = header[2] | (size_t)header[3] << 8;
+    uint32_t crc = header[4] | (uint32_t)header[5] << 8 | (uint32_t)header[6] << 16 | (uint32_t)header[7] << 24;
+    if (len > sizeof(buffer) - OUTBOX_BLOCK_HEADER) {
+        return false;
+    }
+    uint8_t *body = buffer + OUTBOX_BLOCK_HEADER;
+    if (store.read(offset + OUTBOX_BLOCK_HEADER, body, len) != len || logCrc32(body, len) != crc) {
+        return false;
+    }
+    parseBody(body, len, offset + OUTBOX_BLOCK_HEADER);
+    next = offset + OUTBOX_BLOCK_HEADER + len;
+    return true;
+}
+
+void Outbox::parseBody(const uint8_t *body, size_t len, size_t offset)
+{
+    size_t pos = 0;
+    while (pos < len) {
+        uint8_t type = body[pos++];
+        uint32_t v;
+        size_t n;
+        if (type == 'E') {
+            if (len - pos < 32) {
+                return;
+            }
+            n = readVarint(body + pos + 32, len - pos - 32, v);
+            if (n == 0 || v > len - pos - 32 - n) {
+                return;
+            }
+            if (count < OUTBOX_MAX_EVENTS) {
+                Entry &e = entries[count++];
+                memset(&e, 0, sizeof(e));
+                e.offset = (uint32_t)(offset + pos + 32 + n);
+                e.length = (uint16_t)v;
+            }
+            pos += 32 + n + v;
+            continue;
+        }
+        n = readVarint(body + pos, len - pos, v);
+        if (n == 0) {
+            return;
+        }
+        pos += n;
+        if (type == 'A') {
+            if (pos >= len) {
+                return;
+            }
+            uint8_t relay = body[pos++];
+            if (v < count && !entries[v].done) {
+                Entry &e = entries[v];
+                if (relay < 8) {
+                    e.relays |= 1 << relay;
+                }
+                if (e.oks < 0xFF) {
+                    e.oks++;
+                }
+                if (e.oks >= quorum) {
+                    markDone(v);
+                }
+            }
+        } else if (type == 'D') {
+            if (v < count && !entries[v].done) {
+                markDone(v);
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+void Outbox::markDone(size_t event)
+{
+    entries[event].done = 1;
+    entries[event].inFlight = 0;
+    done++;
+    while (first < count && entries[first].done) {
+        first++;
+    }
+}
+
+bool Outbox::record(const uint8_t *data, size_t len)
+{
+    if (buffered + len > sizeof(buffer) && !flush()) {
+        return false;
+    }
+    if (buffered == 0) {
+        buffered = OUTBOX_BLOCK_HEADER;
+        bufferedAt = clock.millis();
+    }
+    memcpy(buffer + buffered, data, len);
+    buffered += len;
+    return true;
+}
+
+bool Outbox::flush()
+{
+    if (buffered == 0) {
+        return true;
+    }
+    size_t start = base();
+    if (headerPending) {
+        uint8_t header[OUTBOX_HEADER_SIZE] = { 0 };
+        memcpy(header, outboxMagic, sizeof(outboxMagic));
+        header[4] = OUTBOX_VERSION;
+        if (store.append(header, sizeof(header)) != sizeof(header)) {
+            return false;
+        }
+        flushed += sizeof(header);
+        headerPending = false;
+    }
+    size_t len = buffered - OUTBOX_BLOCK_HEADER;
+    uint32_t crc = logCrc32(buffer + OUTBOX_BLOCK_HEADER, len);
+    buffer[0] = blockSync[0];
+    buffer[1] = blockSync[1];
+    buffer[2] = (uint8_t)len;
+    buffer[3] = (uint8_t)(len >> 8);
+    for (int i = 0; i < 4; i++) {
+        buffer[4 + i] = (uint8_t)(crc >> (8 * i));
+    }
+    if (store.append(buffer, buffered) != buffered) {
+        // whatever made it is a torn block, the next try goes after it
+        size_t size = store.size();
+        for (size_t i = 0; i < count; i++) {
+            if (entries[i].offset >= start && size > start) {
+                entries[i].offset += (uint32_t)(size - start);
+            }
+        }
+        flushed = size;
+        return false;
+    }
+    flushed += buffered;
+    buffered = 0;
+    counters.blocks++;
+    return true;
+}
+
+
+void Outbox::refill()
+{
+    unsigned long now = clock.millis();
+    tokens += (now - refilledAt) * rate / 1000.0f;
+    if (tokens > burst) {
+        tokens = burst;
+    }
+    refilledAt = now;
+}
+
+uint8_t Outbox::targets(AckSlot *slot)
+{
+    unsigned long now = clock.millis();
+    size_t n = relays.count() < ACK_MAX_RELAYS ? relays.count() : ACK_MAX_RELAYS;
+    uint8_t mask = 0;
+    if (scheduler == NULL) {
+        for (size_t r = 0; r < n; r++) {
+            if (acks.due(slot, r, now) && relays.connected(r)) {
+                mask |= 1 << r;
+            }
+        }
+        return mask;
+    }
+
+    // relays still expected to answer count toward the quorum
+    size_t have = AckTable::acks(slot);
+    for (size_t r = 0; r < n; r++) {
+        uint8_t bit = 1 << r;
+        if (!(slot->waiting & bit) || (slot->late & bit)) {
+            continue;
+        }
+        unsigned long elapsed = now - slot->sentAt[r];
+        if (elapsed >= scheduler->hedgeAfter(r)) {
+            slot->late |= bit;
+            scheduler->late(r, elapsed);
+        } else {
+            have++;
+        }
+    }
+    // the best relays make up the rest, a stale one comes along
+    uint8_t order[ACK_MAX_RELAYS];
+    size_t ranked = scheduler->rank(order);
+    for (size_t i = 0; i < ranked; i++) {
+        size_t r = order[i];
+        if (!acks.due(slot, r, now)) {
+            continue;
+        }
+        if (have < quorum) {
+            mask |= 1 << r;
+            have++;
+        } else if (slot->tries[r] == 0 && scheduler->wantsProbe(r)) {
+            mask |= 1 << r;
+        }
+    }
+    return mask;
+}
+
+size_t Outbox::send(AckSlot *slot, const char *text, uint8_t mask)
+{
+    unsigned long now = clock.millis();
+    size_t sent = 0;
+    for (size_t r = 0; r < ACK_MAX_RELAYS; r++) {
+        uint8_t bit = 1 << r;
+        if (!(mask & bit) || !relays.send(r, text)) {
+            continue;
+        }
+        if (scheduler) {
+            if (slot->waiting & bit) {
+                // no OK for the last one before the deadline
+                scheduler->failed(r);
+            }
+            scheduler->sent(r);
+        }
+        acks.sent(slot, r, now);
+        counters.sent++;
+        if (slot->tries[r] > 1) {
+            counters.retransmitted++;
+        }
+        sent++;
+    }
+    if (sent) {
+        tokens -= 1;
+    }
+    return sent;
+}
+
+void Outbox::release(AckSlot *slot)
+{
+    for (size_t r = 0; r < ACK_MAX_RELAYS && scheduler; r++) {
+        if (slot->waiting & (1 << r)) {
+            scheduler->dropped(r);
+        }
+    }
+    entries[slot->event].inFlight = 0;
+    acks.remove(slot);
+}
+
+bool Outbox::exhausted(const AckSlot *slot) const
+{
+    size_t n = relays.count() < ACK_MAX_RELAYS ? relays.count() : ACK_MAX_RELAYS;
+    for (size_t r = 0; r < n; r++) {
+        if (!(slot->acked & (1 << r)) && slot->tries[r] < ACK_MAX_TRIES) {
+            return false;
+        }
+    }
+    return n > 0;
+}
+
+void Outbox::abandon(size_t event)
+{
+    uint8_t rec[1 + 5];
+    rec[0] = 'D';
+    size_t n = 1 + writeVarint((uint32_t)event, rec + 1);
+    record(rec, n);
+    markDone(event);
+    counters.abandoned++;
+}
+
+const char *Outbox::load(size_t event)
+{
+    const Entry &e = entries[event];
+    if (e.length >= sizeof(message)) {
+        return NULL;
+    }
+    if (e.offset >= base()) {
+        // still in the buffer
+        memcpy(message, buffer + (e.offset - base()), e.length);
+    } else if (store.read(e.offset, (uint8_t *)message, e.length) != e.length) {
+        return NULL;
+    }
+    message[e.length] = 0;
+    return message;
+}
+
+AckSlot *Outbox::track(size_t event, const char *text)
+{
+    // "id":"<64 hex>"
+    const char *p = strstr(text, "\"id\":\"");
+    uint8_t id[32];
+    if (p == NULL || !parseId(p + 6, id)) {
+        return NULL;
+    }
+    // NULL for a second event with the same id, it waits for the first
+    AckSlot *slot = acks.insert(id, (uint16_t)event);
+    if (slot != NULL) {
+        slot->acked = entries[event].relays;
+        entries[event].inFlight = 1;
+    }
+    return slot;
+}
+
+bool Outbox::add(const char *text, size_t len, bool online)
+{
+    // "id":"<64 hex>"
+    const char *p = strstr(text, "\"id\":\"");
+    uint8_t id[32];
+    if (p == NULL || !parseId(p + 6, id) || len >= GATEWAY_MAX_NOTE) {
+        return false;
+    }
+    uint8_t head[1 + 32 + 5];
+    head[0] = 'E';
+    memcpy(head + 1, id, sizeof(id));
+    size_t n = 1 + sizeof(id) + writeVarint((uint32_t)len, head + 1 + sizeof(id));
+    size_t needed = n + len + (buffered ? 0 : OUTBOX_BLOCK_HEADER) + (headerPending ? OUTBOX_HEADER_SIZE : 0);
+    if (count == OUTBOX_MAX_EVENTS || logSize() + needed > OUTBOX_MAX_BYTES) {
+        counters.dropped++;
+        return false;
+    }
+    // one record, head and message in the same block
+    if (buffered + n + len > sizeof(buffer) && !flush()) {
+        counters.dropped++;
+        return false;
+    }
+    record(head, n);
+    record((const uint8_t *)text, len);
+
+    Entry &e = entries[count];
+    memset(&e, 0, sizeof(e));
+    e.offset = (uint32_t)(base() + buffered - len);
+    e.length = (uint16_t)len;
+    count++;
+    counters.added++;
+    // write-ahead: the event is on the store before any relay sees it, OKs
+    // and give-ups wait for the next block. A failed write doesn't hold the
+    // note back, the block is tried again with the next flush
+    flush();
+
+    if (online) {
+        // straight from the caller when nothing older waits for its first send
+        bool waiting = false;
+        for (size_t i = first; i + 1 < count && !waiting; i++) {
+            waiting = !entries[i].done && !entries[i].inFlight;
+        }
+        refill();
+        if (!waiting && tokens >= 1) {
+            AckSlot *slot = track(count - 1, text);
+            if (slot != NULL && !send(slot, text, targets(slot))) {
+                // no relay took it, loop tries again
+                release(slot);
+            }
+        }
+    }
+    return true;
+}
+
+void Outbox::loop(bool online)
+{
+    unsigned long now = clock.millis();
+    if (buffered && now - bufferedAt >= OUTBOX_FLUSH_MS) {
+        flush();
+    }
+    if (count > 0 && done == count) {
+        // everything delivered, the log starts over
+        reset();
+        return;
+    }
+    if (scheduler) {
+        scheduler->loop();
+    }
+    if (!online) {
+        return;
+    }
+    refill();
+
+    // events in flight: the relays past the deadline get them again
+    size_t i = 0;
+    while (i < acks.capacity()) {
+        AckSlot *slot = acks.at(i);
+        if (!slot->used) {
+            i++;
+            continue;
+        }
+        size_t event = slot->event;
+        if (exhausted(slot)) {
+            abandon(event);
+            // a later slot may have moved into i
+            release(slot);
+            continue;
+        }
+        i++;
+        uint8_t mask = targets(slot);
+        if (!mask || tokens < 1) {
+            continue;
+        }
+        const char *text = load(event);
+        if (text == NULL) {
+            abandon(event);
+            release(slot);
+            i--;
+            continue;
+        }
+        send(slot, text, mask);
+    }
+
+    // then events that were not sent yet, oldest first
+    for (size_t i = first; i < count && tokens >= 1 && !acks.full(); i++) {
+        Entry &e = entries[i];
+        if (e.done || e.inFlight) {
+            continue;
+        }
+        const char *text = load(i);
+        if (text == NULL) {
+            abandon(i);
+            continue;
+        }
+        AckSlot *slot = track(i, text);
+        if (slot != NULL && !send(slot, text, targets(slot))) {
+            release(slot);
+            break; // no relay is connected
+        }
+    }
+}
+
+void Outbox::onOk(const char *payload, int relay)
+{
+    // ["OK","<id>",true,""]
+    const char *p = strstr(payload, "\"OK\"");
+    if (p != NULL) {
+        p = strchr(p + 4, '"');
+    }
+    uint8_t id[32];
+    if (p == NULL || !parseId(p + 1, id) || p[65] != '"') {
+        return;
+    }
+    p = strchr(p + 66, ',');
+    if (p == NULL) {
+        return;
+    }
+    p++;
+    while (*p == ' ') {
+        p++;
+    }
+    bool accepted = strncmp(p, "true", 4) == 0;
+    // events not in flight are delivered or wait for their first send
+    AckSlot *slot = acks.find(id);
+    if (slot == NULL) {
+        return;
+    }
+    size_t i = slot->event;
+    Entry &e = entries[i];
+    bool known = relay >= 0 && relay < ACK_MAX_RELAYS;
+    uint8_t bit = known ? 1 << relay : 0;
+    if (!accepted) {
+        // sent again after ACK_DEADLINE_MS, another relay may get it before
+        if (slot->waiting & bit) {
+            slot->waiting &= ~bit;
+            slot->late |= bit;
+            if (scheduler) {
+                scheduler->failed(relay);
+            }
+        }
+        return;
+    }
+    if (known) {
+        bool waited = slot->waiting & bit;
+        // a late send already gave its sample
+        bool sampled = slot->late & bit;
+        long ms = acks.ack(slot, (uint8_t)relay, clock.millis());
+        if (ms < 0) {
+            return;
+        }
+        if (scheduler && waited) {
+            scheduler->acked(relay, ms, sampled);
+        }
+        e.relays |= bit;
+    }
+    if (e.oks < 0xFF) {
+        e.oks++;
+    }
+    uint8_t rec[1 + 5 + 1];
+    rec[0] = 'A';
+    size_t n = 1 + writeVarint((uint32_t)i, rec + 1);
+    rec[n++] = (relay >= 0 && relay < OUTBOX_UNKNOWN_RELAY) ? (uint8_t)relay : OUTBOX_UNKNOWN_RELAY;
+    record(rec, n);
+    if (e.oks >= quorum) {
+        // the relays that have not answered don't get it again
+        release(slot);
+        markDone(i);
+        counters.delivered++;
+    }
+}
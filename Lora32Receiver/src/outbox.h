@@ -0,0 +1,166 @@
+#ifndef GATEWAY_OUTBOX_H
+#define GATEWAY_OUTBOX_H
+
+// Store-and-forward outbox: every signed event is written to an
+// append-only log on flash or SD before it goes to the relays, and relay
+// OKs are logged against it. Events go out in order and at a limited rate,
+// once the uplink is up, also after a reboot. While an event is in flight
+// the AckTable keeps which relays have it: a relay without OK after
+// ACK_DEADLINE_MS gets it again, the others don't, and once a quorum of
+// relays accepted it nobody gets it again. With a RelayScheduler an event
+// goes to the fastest relays that make the quorum first (scheduler.h).
+// When every event in the log is delivered the log starts over.
+//
+// Log format, varints are LEB128:
+//   header  "LOBX" <version 1> <3 reserved bytes>
+//   block   <0xB5 0x0B> <uint16 LE body length> <uint32 LE crc32 of body> <body>
+// A block is one batch of records, a torn block (power lost while
+// writing) fails the crc and is skipped. Records in a body:
+//   'E' <32 byte event id> <varint length> <["EVENT",{...}] message>
+//   'A' <varint event number> <relay index, 0xFF if unknown>   one OK
+//   'D' <varint event number>                                  given up
+// Events are numbered from 0 in log order.
+
+#include "hal.h"
+#include "acktable.h"
+
+class RelayScheduler;
+
+#ifndef OUTBOX_MAX_EVENTS
+#define OUTBOX_MAX_EVENTS 256
+#endif
+#ifndef OUTBOX_MAX_BYTES
+#define OUTBOX_MAX_BYTES (256 * 1024UL)
+#endif
+// OK and give-up records are collected in RAM and written as one block,
+// an event record is written at once
+#ifndef OUTBOX_FLUSH_MS
+#define OUTBOX_FLUSH_MS 10000
+#endif
+// events sent or resent per second and burst, one event to several
+// relays is one send
+#ifndef OUTBOX_SEND_RATE
+#define OUTBOX_SEND_RATE 2.0f
+#endif
+#ifndef OUTBOX_SEND_BURST
+#define OUTBOX_SEND_BURST 4
+#endif
+
+#define OUTBOX_VERSION 1
+#define OUTBOX_HEADER_SIZE 8
+#define OUTBOX_BLOCK_HEADER 8
+// the largest block holds one event record
+#define OUTBOX_BLOCK_SIZE (OUTBOX_BLOCK_HEADER + 1 + 32 + 3 + GATEWAY_MAX_NOTE)
+#define OUTBOX_UNKNOWN_RELAY 0xFF
+
+// crc32 (IEEE) of log blocks and other small files, crc continues a previous call
+uint32_t logCrc32(const uint8_t *data, size_t len, uint32_t crc = 0);
+
+// the log file
+class OutboxStore {
+public:
+    virtual ~OutboxStore() {}
+    virtual size_t size() = 0;
+    virtual size_t read(size_t offset, uint8_t *data, size_t len) = 0;
+    virtual size_t append(const uint8_t *data, size_t len) = 0;
+    // empties the log
+    virtual bool clear() = 0;
+};
+
+typedef struct {
+    unsigned long added;          // events written to the log
+    unsigned long sent;           // messages to single relays, retransmits included
+    unsigned long retransmitted;  // to a relay that had the event before
+    unsigned long delivered;      // reached the quorum
+    unsigned long dropped;        // log full, not stored
+    unsigned long abandoned;      // no quorum after ACK_MAX_TRIES sends to every relay
+    unsigned long blocks;         // blocks written to the store
+    unsigned long skipped;        // torn blocks found by begin
+} OutboxStats;
+
+class Outbox {
+public:
+    Outbox(OutboxStore &store, RelayLink &relays, SystemClock &clock);
+
+    // OKs an event needs, relays known by index are counted once
+    void setQuorum(uint8_t relays) { quorum = relays ? relays : 1; }
+    void setSendRate(float perSecond, uint8_t burst);
+    // optional, events go to the best relays for the quorum instead of all
+    void setScheduler(RelayScheduler *relayScheduler) { scheduler = relayScheduler; }
+
+    // reads the log, events without quorum are sent again.
+    // False if the store holds something else, call reset then
+    bool begin();
+    // forgets every event and empties the store
+    void reset();
+
+    // logs a signed event and sends it when the rate allows.
+    // False if it wasn't stored (log full or no event id)
+    bool add(const char *message, size_t len, bool online);
+    // sends, resends and flushes, call from loop()
+    void loop(bool online);
+    // ["OK",<id>,<accepted>,...] from relay, -1 if the relay isn't known
+    void onOk(const char *payload, int relay);
+    // writes the buffered records now
+    bool flush();
+
+    // events without quorum
+    size_t pending() const { return count - done; }
+    // events sent and waiting for OKs
+    size_t inFlight() const { return acks.size(); }
+    // bytes of the log, buffered records included
+    size_t logSize() const { return buffered ? base() + buffered : flushed; }
+    const OutboxStats &stats() const { return counters; }
+
+private:
+    typedef struct {
+        uint32_t offset;        // of the message in the log
+        uint16_t length;
+        uint8_t relays;         // bit per relay index that accepted
+        uint8_t oks;            // accepted, relays known or not
+        uint8_t done;           // quorum reached or given up
+        uint8_t inFlight;       // has a slot in the ack table
+    } Entry;
+
+    size_t base() const { return flushed + (headerPending ? OUTBOX_HEADER_SIZE : 0); }
+    bool record(const uint8_t *data, size_t len);
+    bool scanBlock(size_t offset, size_t &next);
+    void parseBody(const uint8_t *body, size_t len, size_t offset);
+    void markDone(size_t event);
+    void abandon(size_t event);
+    AckSlot *track(size_t event, const char *message);
+    // relays the event should go to now, bit per relay
+    uint8_t targets(AckSlot *slot);
+    // returns how many relays took it
+    size_t send(AckSlot *slot, const char *message, uint8_t mask);
+    // out of the table, the relays are not waited for
+    void release(AckSlot *slot);
+    bool exhausted(const AckSlot *slot) const;
+    const char *load(size_t event);
+    void refill();
+
+    OutboxStore &store;
+    RelayLink &relays;
+    SystemClock &clock;
+    RelayScheduler *scheduler;
+    uint8_t quorum;
+    float rate;
+    float burst;
+    float tokens;
+    unsigned long refilledAt;
+
+    Entry entries[OUTBOX_MAX_EVENTS];
+    AckTable acks;
+    size_t count;
+    size_t done;
+    size_t first;           // no event before it is waiting
+    size_t flushed;         // bytes in the store
+    bool headerPending;     // the store is empty, the file header goes first
+    uint8_t buffer[OUTBOX_BLOCK_SIZE];
+    size_t buffered;        // bytes in buffer, block header included
+    unsigned long bufferedAt;
+    char message[GATEWAY_MAX_NOTE];
+    OutboxStats counters;
+};
+
+#endif
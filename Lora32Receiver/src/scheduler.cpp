@@ -0,0 +1,298 @@
+#include "scheduler.h"
+#include <string.h>
+
+static const uint8_t healthMagic[4] = { 'L', 'R', 'L', 'Y' };
+
+// weights of a new sample
+#define LATENCY_ALPHA 0.125f
+#define ERROR_ALPHA 0.0625f
+
+static uint32_t nameHash(const char *name)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    }
+    return h;
+}
+
+// two buckets per octave, the upper one starts at 1.5 times the octave
+static size_t bucket(unsigned long ms)
+{
+    unsigned long q = ms / SCHED_BUCKET_MS;
+    if (q == 0) {
+        return 0;
+    }
+    size_t k = 0;
+    while (q >> (k + 1)) {
+        k++;
+    }
+    unsigned long octave = (unsigned long)SCHED_BUCKET_MS << k;
+    size_t b = 2 * k + 1 + (2 * ms >= 3 * octave);
+    return b < SCHED_BUCKETS ? b : SCHED_BUCKETS - 1;
+}
+
+// first ms past the bucket
+static unsigned long bucketEnd(size_t b)
+{
+    if (b == 0) {
+        return SCHED_BUCKET_MS;
+    }
+    size_t k = (b - 1) / 2;
+    unsigned long octave = (unsigned long)SCHED_BUCKET_MS << k;
+    return (b - 1) % 2 ? 2 * octave : octave + octave / 2;
+}
+
+RelayScheduler::RelayScheduler(RelayLink &relays, SystemClock &clock)
+    : relays(relays), clock(clock), file(NULL), savedAt(0), changed(false)
+{
+    memset(relayHealth, 0, sizeof(relayHealth));
+    memset(names, 0, sizeof(names));
+    memset(pending, 0, sizeof(pending));
+    memset(samples, 0, sizeof(samples));
+    memset(touchedAt, 0, sizeof(touchedAt));
+    memset(downSince, 0, sizeof(downSince));
+    memset(up, 0, sizeof(up));
+}
+
+void RelayScheduler::setNames(const char *const *relayNames, size_t count)
+{
+    for (size_t i = 0; i < count && i < ACK_MAX_RELAYS; i++) {
+        names[i] = nameHash(relayNames[i]);
+    }
+}
+
+bool RelayScheduler::begin(OutboxStore *store)
+{
+    file = store;
+    unsigned long now = clock.millis();
+    savedAt = now;
+    for (size_t r = 0; r < ACK_MAX_RELAYS; r++) {
+        downSince[r] = now;
+        touchedAt[r] = now;
+    }
+    if (file == NULL) {
+        return false;
+    }
+    uint8_t header[8];
+    if (file->read(0, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, healthMagic, sizeof(healthMagic)) != 0 || header[4] != SCHED_VERSION ||
+        header[5] > ACK_MAX_RELAYS) {
+        return false;
+    }
+    size_t count = header[5];
+    const size_t recordSize = 4 + sizeof(RelayHealth);
+    uint8_t record[4 + sizeof(RelayHealth)];
+    uint32_t crc = logCrc32(header, sizeof(header));
+    for (size_t i = 0; i < count; i++) {
+        if (file->read(sizeof(header) + i * recordSize, record, recordSize) != recordSize) {
+            return false;
+        }
+        crc = logCrc32(record, recordSize, crc);
+    }
+    uint8_t stored[4];
+    if (file->read(sizeof(header) + count * recordSize, stored, sizeof(stored)) != sizeof(stored) ||
+        (stored[0] | (uint32_t)stored[1] << 8 | (uint32_t)stored[2] << 16 | (uint32_t)stored[3] << 24) != crc) {
+        return false;
+    }
+
+    bool found = false;
+    for (size_t i = 0; i < count; i++) {
+        file->read(sizeof(header) + i * recordSize, record, recordSize);
+        uint32_t hash = record[0] | (uint32_t)record[1] << 8 | (uint32_t)record[2] << 16 | (uint32_t)record[3] << 24;
+        for (size_t r = 0; r < ACK_MAX_RELAYS; r++) {
+            if (names[r] != hash || hash == 0) {
+                continue;
+            }
+            memcpy(&relayHealth[r], record + 4, sizeof(RelayHealth));
+            samples[r] = 0;
+            for (size_t b = 0; b < SCHED_BUCKETS; b++) {
+                samples[r] += relayHealth[r].histogram[b];
+            }
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool RelayScheduler::save()
+{
+    if (file == NULL) {
+        return false;
+    }
+    size_t count = relays.count() < ACK_MAX_RELAYS ? relays.count() : ACK_MAX_RELAYS;
+    uint8_t header[8] = { 0 };
+    memcpy(header, healthMagic, sizeof(healthMagic));
+    header[4] = SCHED_VERSION;
+    header[5] = (uint8_t)count;
+    if (!file->clear() || file->append(header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    uint32_t crc = logCrc32(header, sizeof(header));
+    for (size_t r = 0; r < count; r++) {
+        uint8_t record[4 + sizeof(RelayHealth)];
+        for (int i = 0; i < 4; i++) {
+            record[i] = (uint8_t)(names[r] >> (8 * i));
+        }
+        memcpy(record + 4, &relayHealth[r], sizeof(RelayHealth));
+        if (file->append(record, sizeof(record)) != sizeof(record)) {
+            return false;
+        }
+        crc = logCrc32(record, sizeof(record), crc);
+    }
+    uint8_t trailer[4];
+    for (int i = 0; i < 4; i++) {
+        trailer[i] = (uint8_t)(crc >> (8 * i));
+    }
+    if (file->append(trailer, sizeof(trailer)) != sizeof(trailer)) {
+        return false;
+    }
+    changed = false;
+    savedAt = clock.millis();
+    return true;
+}
+
+void RelayScheduler::loop()
+{
+    unsigned long now = clock.millis();
+    for (size_t r = 0; r < relays.count() && r < ACK_MAX_RELAYS; r++) {
+        bool connected = relays.connected(r);
+        if (connected == up[r]) {
+            continue;
+        }
+        up[r] = connected;
+        if (!connected) {
+            downSince[r] = now;
+            continue;
+        }
+        RelayHealth &h = relayHealth[r];
+        float ms = (float)(now - downSince[r]);
+        h.connectMs = h.connectMs > 0 ? h.connectMs + LATENCY_ALPHA * (ms - h.connectMs) : ms;
+        changed = true;
+    }
+    if (changed && now - savedAt >= SCHED_SAVE_MS) {
+        save();
+    }
+}
+
+unsigned long RelayScheduler::p99(size_t relay) const
+{
+    if (samples[relay] == 0) {
+        return 0;
+    }
+    const uint16_t *histogram = relayHealth[relay].histogram;
+    unsigned long threshold = (samples[relay] * 99UL + 99) / 100;
+    unsigned long sum = 0;
+    for (size_t b = 0; b < SCHED_BUCKETS; b++) {
+        sum += histogram[b];
+        if (sum >= threshold) {
+            return bucketEnd(b);
+        }
+    }
+    return bucketEnd(SCHED_BUCKETS - 1);
+}
+
+float RelayScheduler::score(size_t relay) const
+{
+    const RelayHealth &h = relayHealth[relay];
+    float latency = h.latency > 0 ? h.latency : SCHED_DEFAULT_MS;
+    float errors = h.errors < 0.9f ? h.errors : 0.9f;
+    // a relay that refuses one in two takes twice as long to say yes
+    return (latency + pending[relay] * SCHED_BACKLOG_MS) / (1.0f - errors);
+}
+
+size_t RelayScheduler::rank(uint8_t *order)
+{
+    size_t n = 0;
+    for (size_t r = 0; r < relays.count() && r < ACK_MAX_RELAYS; r++) {
+        if (!relays.connected(r)) {
+            continue;
+        }
+        // insertion sort, a handful of relays
+        float s = score(r);
+        size_t i = n++;
+        while (i > 0 && score(order[i - 1]) > s) {
+            order[i] = order[i - 1];
+            i--;
+        }
+        order[i] = (uint8_t)r;
+    }
+    return n;
+}
+
+unsigned long RelayScheduler::hedgeAfter(size_t relay) const
+{
+    unsigned long ms = samples[relay] ? p99(relay) : 2 * SCHED_DEFAULT_MS;
+    ms += ms / 2;
+    if (ms < SCHED_HEDGE_MIN_MS) {
+        ms = SCHED_HEDGE_MIN_MS;
+    }
+    return ms < ACK_DEADLINE_MS ? ms : ACK_DEADLINE_MS;
+}
+
+bool RelayScheduler::wantsProbe(size_t relay) const
+{
+    return clock.millis() - touchedAt[relay] >= SCHED_PROBE_MS;
+}
+
+void RelayScheduler::sample(size_t relay, unsigned long ms)
+{
+    RelayHealth &h = relayHealth[relay];
+    h.latency = h.latency > 0 ? h.latency + LATENCY_ALPHA * ((float)ms - h.latency) : (float)ms;
+    h.histogram[bucket(ms)]++;
+    if (++samples[relay] > SCHED_HISTORY) {
+        samples[relay] = 0;
+        for (size_t b = 0; b < SCHED_BUCKETS; b++) {
+            h.histogram[b] /= 2;
+            samples[relay] += h.histogram[b];
+        }
+    }
+    touchedAt[relay] = clock.millis();
+    changed = true;
+}
+
+void RelayScheduler::sent(size_t relay)
+{
+    pending[relay]++;
+    touchedAt[relay] = clock.millis();
+    relayHealth[relay].sent++;
+}
+
+void RelayScheduler::acked(size_t relay, unsigned long ms, bool sampled)
+{
+    if (pending[relay]) {
+        pending[relay]--;
+    }
+    RelayHealth &h = relayHealth[relay];
+    h.acked++;
+    h.errors -= ERROR_ALPHA * h.errors;
+    if (sampled) {
+        changed = true;
+    } else {
+        sample(relay, ms);
+    }
+}
+
+void RelayScheduler::failed(size_t relay)
+{
+    if (pending[relay]) {
+        pending[relay]--;
+    }
+    RelayHealth &h = relayHealth[relay];
+    h.failed++;
+    h.errors += ERROR_ALPHA * (1.0f - h.errors);
+    changed = true;
+}
+
+void RelayScheduler::late(size_t relay, unsigned long ms)
+{
+    sample(relay, ms);
+}
+
+void RelayScheduler::dropped(size_t relay)
+{
+    if (pending[relay]) {
+        pending[relay]--;
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef GATEWAY_SCHEDULER_H
+#define GATEWAY_SCHEDULER_H
+
+// Relay scheduler: keeps per relay send-to-OK latency (EWMA and p99 from a
+// decaying histogram), error rate, backlog of unanswered sends and the time
+// a lost connection takes to come back, and ranks the connected relays by
+// expected time to OK. The outbox sends an event to the best relays that
+// make the quorum, a relay past its p99 gets company from the next one
+// (hedge), and a relay without a recent sample gets an event now and then
+// so its numbers don't go stale. The health survives reboots in a small
+// file written every SCHED_SAVE_MS.
+//
+// Health file: "LRLY" <version 1> <count> <2 reserved>, then per relay
+// <uint32 name hash> <RelayHealth fields>, then <uint32 crc32 of it all>.
+
+#include "hal.h"
+#include "acktable.h"
+#include "outbox.h"
+
+// latency buckets, two per octave from SCHED_BUCKET_MS up
+#define SCHED_BUCKETS 32
+#define SCHED_BUCKET_MS 4
+// a histogram with more samples is halved, older samples count less
+#ifndef SCHED_HISTORY
+#define SCHED_HISTORY 512
+#endif
+// assumed latency of a relay without samples
+#ifndef SCHED_DEFAULT_MS
+#define SCHED_DEFAULT_MS 500
+#endif
+// added to the expected latency per unanswered send
+#ifndef SCHED_BACKLOG_MS
+#define SCHED_BACKLOG_MS 50
+#endif
+// a hedge never goes out sooner than this after the send
+#ifndef SCHED_HEDGE_MIN_MS
+#define SCHED_HEDGE_MIN_MS 500
+#endif
+// a relay without a sample this long gets the next event as well
+#ifndef SCHED_PROBE_MS
+#define SCHED_PROBE_MS 60000
+#endif
+#ifndef SCHED_SAVE_MS
+#define SCHED_SAVE_MS 600000UL
+#endif
+
+#define SCHED_VERSION 1
+
+typedef struct {
+    float latency;              // EWMA of send-to-OK, ms
+    float errors;               // EWMA of refused or lost sends, 0..1
+    float connectMs;            // EWMA of the time a lost connection took to come back
+    uint32_t sent;
+    uint32_t acked;
+    uint32_t failed;
+    uint16_t histogram[SCHED_BUCKETS];
+} RelayHealth;
+
+class RelayScheduler {
+public:
+    RelayScheduler(RelayLink &relays, SystemClock &clock);
+
+    // names tie the saved health to the relays, the order may change
+    void setNames(const char *const *names, size_t count);
+    // reads the saved health, false if there is none for these relays
+    bool begin(OutboxStore *file);
+    // connection tracking and the periodic save, call from loop()
+    void loop();
+    bool save();
+
+    // connected relays, best first, returns how many
+    size_t rank(uint8_t *order);
+    // a relay without an OK past this is late, the next one gets the event
+    unsigned long hedgeAfter(size_t relay) const;
+    // the relay should see the next event to keep its numbers fresh
+    bool wantsProbe(size_t relay) const;
+    // expected time to OK in ms, lower is better
+    float score(size_t relay) const;
+
+    void sent(size_t relay);
+    // sampled: late() already took a sample for this send, count it once
+    void acked(size_t relay, unsigned long ms, bool sampled = false);
+    // refused, or no OK before the ACK_DEADLINE_MS resend
+    void failed(size_t relay);
+    // no OK after ms yet, counted as a sample since the real one may never come.
+    // The caller marks the send and passes sampled to acked() when it does come
+    void late(size_t relay, unsigned long ms);
+    // the event is done, an answer from the relay isn't waited for any more
+    void dropped(size_t relay);
+
+    const RelayHealth &health(size_t relay) const { return relayHealth[relay]; }
+    uint16_t backlog(size_t relay) const { return pending[relay]; }
+    unsigned long p99(size_t relay) const;
+
+private:
+    void sample(size_t relay, unsigned long ms);
+
+    RelayLink &relays;
+    SystemClock &clock;
+    OutboxStore *file;
+    RelayHealth relayHealth[ACK_MAX_RELAYS];
+    uint32_t names[ACK_MAX_RELAYS];
+    uint16_t pending[ACK_MAX_RELAYS];
+    uint16_t samples[ACK_MAX_RELAYS];       // in the histogram
+    unsigned long touchedAt[ACK_MAX_RELAYS];    // last send or sample
+    unsigned long downSince[ACK_MAX_RELAYS];
+    bool up[ACK_MAX_RELAYS];
+    unsigned long savedAt;
+    bool changed;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "textcodec.h"
+#include <string.h>
+#include "textdict.h"
+
+#if TEXT_DICTIONARY_SIZE > TEXT_MAX_DICTIONARY
+#error the dictionary is out of reach of the offsets
+#endif
+
+const uint8_t *textDictionary(size_t &length)
+{
+    length = sizeof(textDict);
+    return textDict;
+}
+
+size_t textCompress(const uint8_t *text, size_t len, uint8_t *out, size_t size)
+{
+    return textCompress(text, len, out, size, textDict, sizeof(textDict));
+}
+
+size_t textDecompress(const uint8_t *data, size_t len, uint8_t *out, size_t size)
+{
+    return textDecompress(data, len, out, size, textDict, sizeof(textDict));
+}
+
+// byte at pos of the dictionary followed by the text, pos < 0 is in the dictionary
+static inline uint8_t historyAt(const uint8_t *dict, size_t dictLen, const uint8_t *text, long pos)
+{
+    return pos < 0 ? dict[dictLen + pos] : text[pos];
+}
+
+// longest match for text at i, nearest first. Returns its length, 0 below TEXT_MIN_MATCH
+static size_t longestMatch(const uint8_t *dict, size_t dictLen, const uint8_t *text, size_t len, size_t i,
+                           size_t &bestOffset)
+{
+    if (len - i < TEXT_MIN_MATCH) {
+        return 0;
+    }
+    size_t bestLen = 0;
+    size_t maxLen = len - i < TEXT_MAX_MATCH ? len - i : TEXT_MAX_MATCH;
+    size_t reach = i + dictLen < TEXT_WINDOW ? i + dictLen : TEXT_WINDOW;
+    for (size_t offset = 1; offset <= reach; offset++) {
+        long start = (long)i - (long)offset;
+        if (historyAt(dict, dictLen, text, start) != text[i]) {
+            continue;
+        }
+        size_t m = 1;
+        while (m < maxLen && historyAt(dict, dictLen, text, start + (long)m) == text[i + m]) {
+            m++;
+        }
+        // a farther match has to be strictly longer
+        if (m > bestLen) {
+            bestLen = m;
+            bestOffset = offset;
+            if (m == maxLen) {
+                break;
+            }
+        }
+    }
+    return bestLen >= TEXT_MIN_MATCH ? bestLen : 0;
+}
+
+size_t textCompress(const uint8_t *text, size_t len, uint8_t *out, size_t size,
+                    const uint8_t *dict, size_t dictLen)
+{
+    if (dictLen > TEXT_MAX_DICTIONARY) {
+        return 0;
+    }
+    size_t o = 0;
+    // bytes of 0x80 and above wait here until a run token can take them
+    size_t runStart = 0, run = 0;
+    size_t i = 0;
+    while (i <= len) {
+        // greedy, looking one byte ahead for a longer match gains less than 1%
+        size_t bestOffset = 0;
+        size_t bestLen = i < len ? longestMatch(dict, dictLen, text, len, i, bestOffset) : 0;
+        bool raw = i < len && !bestLen && text[i] >= 0x80;
+        if (raw && run == 0) {
+            runStart = i;
+        }
+        if (raw && run < 64) {
+            run++;
+            i++;
+            continue;
+        }
+        if (run) {
+            if (1 + run > size - o) {
+                return 0;
+            }
+            out[o++] = (uint8_t)(0xC0 | (run - 1));
+            memcpy(out + o, text + runStart, run);
+            o += run;
+            run = 0;
+            // a full run, look at this byte again
+            if (raw) {
+                continue;
+            }
+        }
+        if (i == len) {
+            break;
+        }
+        if (bestLen) {
+            if (2 > size - o) {
+                return 0;
+            }
+            size_t code = bestOffset - 1;
+            out[o++] = (uint8_t)(0x80 | (bestLen - TEXT_MIN_MATCH) << 2 | code >> 8);
+            out[o++] = (uint8_t)code;
+            i += bestLen;
+        } else {
+            if (o >= size) {
+                return 0;
+            }
+            out[o++] = text[i++];
+        }
+    }
+    return o;
+}
+
+size_t textDecompress(const uint8_t *data, size_t len, uint8_t *out, size_t size,
+                      const uint8_t *dict, size_t dictLen)
+{
+    size_t o = 0;
+    size_t i = 0;
+    while (i < len) {
+        uint8_t token = data[i++];
+        if (token < 0x80) {
+            if (o >= size) {
+                return 0;
+            }
+            out[o++] = token;
+        } else if (token < 0xC0) {
+            if (i >= len) {
+                return 0;
+            }
+            size_t n = ((token >> 2) & 0x0F) + TEXT_MIN_MATCH;
+            size_t offset = ((size_t)(token & 0x03) << 8 | data[i++]) + 1;
+            if (offset > o + dictLen || n > size - o) {
+                return 0;
+            }
+            // byte by byte, a match may run into the bytes it writes
+            for (size_t k = 0; k < n; k++, o++) {
+                out[o] = historyAt(dict, dictLen, out, (long)o - (long)offset);
+            }
+        } else {
+            size_t n = (token & 0x3F) + 1;
+            if (n > len - i || n > size - o) {
+                return 0;
+            }
+            memcpy(out + o, data + i, n);
+            i += n;
+            o += n;
+        }
+    }
+    return o;
+}
@@ -0,0 +1,40 @@
+#ifndef GATEWAY_TEXTCODEC_H
+#define GATEWAY_TEXTCODEC_H
+
+// Compression of short note text for air frames (AIRFRAME_COMPRESSED).
+// LZ77 where matches may also point into a preset dictionary of common
+// note text (textdict.h), so a 20 byte note finds something to refer to.
+// Shared with Lora32Sender, nothing here depends on the board.
+//
+// Token stream:
+//   0xxxxxxx                 the ASCII byte x
+//   10LLLLOO OOOOOOOO        copy L + TEXT_MIN_MATCH bytes from O + 1 bytes
+//                            back, the dictionary sits in front of the text
+//   11NNNNNN <N + 1 bytes>   bytes of 0x80 and above as they are (UTF-8)
+// Neither side keeps any state besides the output: the decoder copies
+// from it, the encoder searches the dictionary and the text before the
+// current byte. Text of up to 255 bytes reaches the whole dictionary.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TEXT_MIN_MATCH 3
+#define TEXT_MAX_MATCH (TEXT_MIN_MATCH + 15)
+// farthest match, 10 offset bits
+#define TEXT_WINDOW 1024
+#define TEXT_MAX_DICTIONARY (TEXT_WINDOW - 256)
+
+// compresses len bytes of text into out, returns the size or 0 if it doesn't fit size
+size_t textCompress(const uint8_t *text, size_t len, uint8_t *out, size_t size);
+// returns the size of the text or 0 if data is malformed or unpacks to more than size
+size_t textDecompress(const uint8_t *data, size_t len, uint8_t *out, size_t size);
+
+// the same with another dictionary, both sides need the same one
+size_t textCompress(const uint8_t *text, size_t len, uint8_t *out, size_t size,
+                    const uint8_t *dictionary, size_t dictionaryLength);
+size_t textDecompress(const uint8_t *data, size_t len, uint8_t *out, size_t size,
+                      const uint8_t *dictionary, size_t dictionaryLength);
+// the built in dictionary
+const uint8_t *textDictionary(size_t &length);
+
+#endif
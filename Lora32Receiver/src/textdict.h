@@ -0,0 +1,133 @@
+#ifndef GATEWAY_TEXTDICT_H
+#define GATEWAY_TEXTDICT_H
+
+// Preset dictionary of textcodec.cpp, made from every other line of
+// host/corpus/notes.txt (102 notes) with
+//   host/build/texttool train host/corpus/notes.txt > src/textdict.h
+// Senders and receivers need the same one, a new dictionary needs a
+// new air frame version.
+
+#define TEXT_DICTIONARY_SIZE 768
+
+static const uint8_t textDict[TEXT_DICTIONARY_SIZE] = {
+    // " relays"
+    0x20, 0x72, 0x65, 0x6c, 0x61, 0x79, 0x73,
+    // " good t"
+    0x20, 0x67, 0x6f, 0x6f, 0x64, 0x20, 0x74,
+    // " sats"
+    0x20, 0x73, 0x61, 0x74, 0x73,
+    // " on the "
+    0x20, 0x6f, 0x6e, 0x20, 0x74, 0x68, 0x65, 0x20,
+    // " of the "
+    0x20, 0x6f, 0x66, 0x20, 0x74, 0x68, 0x65, 0x20,
+    // " now, "
+    0x20, 0x6e, 0x6f, 0x77, 0x2c, 0x20,
+    // " communi"
+    0x20, 0x63, 0x6f, 0x6d, 0x6d, 0x75, 0x6e, 0x69,
+    // " anyone "
+    0x20, 0x61, 0x6e, 0x79, 0x6f, 0x6e, 0x65, 0x20,
+    // " LoRa "
+    0x20, 0x4c, 0x6f, 0x52, 0x61, 0x20,
+    // " tomorrow"
+    0x20, 0x74, 0x6f, 0x6d, 0x6f, 0x72, 0x72, 0x6f, 0x77,
+    // " to nostr"
+    0x20, 0x74, 0x6f, 0x20, 0x6e, 0x6f, 0x73, 0x74, 0x72,
+    // " is slow "
+    0x20, 0x69, 0x73, 0x20, 0x73, 0x6c, 0x6f, 0x77, 0x20,
+    // " https://"
+    0x20, 0x68, 0x74, 0x74, 0x70, 0x73, 0x3a, 0x2f, 0x2f,
+    // " for the "
+    0x20, 0x66, 0x6f, 0x72, 0x20, 0x74, 0x68, 0x65, 0x20,
+    // " battery "
+    0x20, 0x62, 0x61, 0x74, 0x74, 0x65, 0x72, 0x79, 0x20,
+    // " at the s"
+    0x20, 0x61, 0x74, 0x20, 0x74, 0x68, 0x65, 0x20, 0x73,
+    // "e to "
+    0x65, 0x20, 0x74, 0x6f, 0x20,
+    // "s are "
+    0x73, 0x20, 0x61, 0x72, 0x65, 0x20,
+    // "lear skies"
+    0x6c, 0x65, 0x61, 0x72, 0x20, 0x73, 0x6b, 0x69, 0x65, 0x73,
+    // "his note t"
+    0x68, 0x69, 0x73, 0x20, 0x6e, 0x6f, 0x74, 0x65, 0x20, 0x74,
+    // " over LoRa"
+    0x20, 0x6f, 0x76, 0x65, 0x72, 0x20, 0x4c, 0x6f, 0x52, 0x61,
+    // " from the "
+    0x20, 0x66, 0x72, 0x6f, 0x6d, 0x20, 0x74, 0x68, 0x65, 0x20,
+    // " everyone "
+    0x20, 0x65, 0x76, 0x65, 0x72, 0x79, 0x6f, 0x6e, 0x65, 0x20,
+    // "ing at the "
+    0x69, 0x6e, 0x67, 0x20, 0x61, 0x74, 0x20, 0x74, 0x68, 0x65, 0x20,
+    // "Hello from "
+    0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x66, 0x72, 0x6f, 0x6d, 0x20,
+    // " this note "
+    0x20, 0x74, 0x68, 0x69, 0x73, 0x20, 0x6e, 0x6f, 0x74, 0x65, 0x20,
+    // " lightning "
+    0x20, 0x6c, 0x69, 0x67, 0x68, 0x74, 0x6e, 0x69, 0x6e, 0x67, 0x20,
+    // " is the "
+    0x20, 0x69, 0x73, 0x20, 0x74, 0x68, 0x65, 0x20,
+    // "Temperature "
+    0x54, 0x65, 0x6d, 0x70, 0x65, 0x72, 0x61, 0x74, 0x75, 0x72, 0x65, 0x20,
+    // "%, pressure "
+    0x25, 0x2c, 0x20, 0x70, 0x72, 0x65, 0x73, 0x73, 0x75, 0x72, 0x65, 0x20,
+    // " today"
+    0x20, 0x74, 0x6f, 0x64, 0x61, 0x79,
+    // " C, humidity "
+    0x20, 0x43, 0x2c, 0x20, 0x68, 0x75, 0x6d, 0x69, 0x64, 0x69, 0x74, 0x79, 0x20,
+    // "trLoraMesh! This i"
+    0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69,
+    // "strLoraMesh! This "
+    0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20,
+    // "sh! This is messag"
+    0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67,
+    // "s is message numbe"
+    0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x6e, 0x75, 0x6d, 0x62, 0x65,
+    // "raMesh! This is me"
+    0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65,
+    // "rLoraMesh! This is"
+    0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73,
+    // "ostrLoraMesh! This"
+    0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73,
+    // "oraMesh! This is m"
+    0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d,
+    // "o NostrLoraMesh! T"
+    0x6f, 0x20, 0x4e, 0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54,
+    // "lo NostrLoraMesh! "
+    0x6c, 0x6f, 0x20, 0x4e, 0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20,
+    // "llo NostrLoraMesh!"
+    0x6c, 0x6c, 0x6f, 0x20, 0x4e, 0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21,
+    // "is message number "
+    0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x6e, 0x75, 0x6d, 0x62, 0x65, 0x72, 0x20,
+    // "is is message numb"
+    0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x6e, 0x75, 0x6d, 0x62,
+    // "his is message num"
+    0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x6e, 0x75, 0x6d,
+    // "h! This is message"
+    0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65,
+    // "esh! This is messa"
+    0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61,
+    // "ello NostrLoraMesh"
+    0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x4e, 0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68,
+    // "aMesh! This is mes"
+    0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73,
+    // "This is message nu"
+    0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x6e, 0x75,
+    // "NostrLoraMesh! Thi"
+    0x4e, 0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69,
+    // "Mesh! This is mess"
+    0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73,
+    // "LoraMesh! This is "
+    0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20,
+    // "Hello NostrLoraMes"
+    0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x4e, 0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73,
+    // "! This is message "
+    0x21, 0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20,
+    // " is message number"
+    0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x6e, 0x75, 0x6d, 0x62, 0x65, 0x72,
+    // " This is message n"
+    0x20, 0x54, 0x68, 0x69, 0x73, 0x20, 0x69, 0x73, 0x20, 0x6d, 0x65, 0x73, 0x73, 0x61, 0x67, 0x65, 0x20, 0x6e,
+    // " NostrLoraMesh! Th"
+    0x20, 0x4e, 0x6f, 0x73, 0x74, 0x72, 0x4c, 0x6f, 0x72, 0x61, 0x4d, 0x65, 0x73, 0x68, 0x21, 0x20, 0x54, 0x68,
+};
+
+#endif
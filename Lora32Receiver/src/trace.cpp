@@ -0,0 +1,183 @@
+#include "trace.h"
+#include <string.h>
+
+static const uint8_t traceMagic[4] = { 'L', 'T', 'R', 'C' };
+
+static size_t writeVarint(uint32_t v, uint8_t *out)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool readVarint(TraceSource &source, uint32_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t b;
+        if (source.read(&b, 1) != 1) {
+            return false;
+        }
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// record fields from a stream, time is the delta
+static bool readRecord(TraceSource &source, TraceRecord &record)
+{
+    uint32_t delta, rssi, length;
+    int8_t snr;
+    if (!readVarint(source, delta) || !readVarint(source, rssi) ||
+        source.read((uint8_t *)&snr, 1) != 1 || !readVarint(source, length) ||
+        length > TRACE_MAX_PAYLOAD) {
+        return false;
+    }
+    if (source.read(record.payload, length) != length) {
+        return false;
+    }
+    record.time = delta;
+    record.rssi = (int16_t)((rssi >> 1) ^ -(int32_t)(rssi & 1));
+    record.snr = snr / 4.0f;
+    record.length = (uint16_t)length;
+    return true;
+}
+
+class BufferSource : public TraceSource {
+public:
+    BufferSource(const uint8_t *data, size_t len) : data(data), len(len), position(0) {}
+    size_t read(uint8_t *out, size_t n)
+    {
+        if (n > len - position) {
+            n = len - position;
+        }
+        memcpy(out, data + position, n);
+        position += n;
+        return n;
+    }
+    size_t used() const { return position; }
+
+private:
+    const uint8_t *data;
+    size_t len;
+    size_t position;
+};
+
+size_t traceEncodeHeader(uint8_t out[TRACE_HEADER_SIZE])
+{
+    memcpy(out, traceMagic, sizeof(traceMagic));
+    out[4] = TRACE_VERSION;
+    out[5] = out[6] = out[7] = 0;
+    return TRACE_HEADER_SIZE;
+}
+
+bool traceDecodeHeader(const uint8_t header[TRACE_HEADER_SIZE])
+{
+    return memcmp(header, traceMagic, sizeof(traceMagic)) == 0 && header[4] == TRACE_VERSION;
+}
+
+size_t traceEncodeRecord(uint32_t delta, int rssi, float snr, const uint8_t *payload, size_t len,
+                         uint8_t *out, size_t size)
+{
+    if (len > TRACE_MAX_PAYLOAD || size < TRACE_MAX_RECORD - TRACE_MAX_PAYLOAD + len) {
+        return 0;
+    }
+    // quarter dB like the SX127x register
+    float quarters = snr * 4.0f;
+    int8_t q = quarters > 127 ? 127 : quarters < -128 ? -128 : (int8_t)(quarters + (quarters < 0 ? -0.5f : 0.5f));
+    size_t n = writeVarint(delta, out);
+    n += writeVarint(((uint32_t)rssi << 1) ^ (uint32_t)(rssi >> 31), out + n);
+    out[n++] = (uint8_t)q;
+    n += writeVarint((uint32_t)len, out + n);
+    memcpy(out + n, payload, len);
+    return n + len;
+}
+
+size_t traceDecodeRecord(const uint8_t *data, size_t len, TraceRecord &record)
+{
+    BufferSource source(data, len);
+    if (!readRecord(source, record)) {
+        return 0;
+    }
+    return source.used();
+}
+
+bool TraceWriter::begin()
+{
+    uint8_t header[TRACE_HEADER_SIZE];
+    traceEncodeHeader(header);
+    return sink.write(header, sizeof(header)) == sizeof(header);
+}
+
+bool TraceWriter::record(unsigned long time, int rssi, float snr, const uint8_t *payload, size_t len)
+{
+    uint8_t buf[TRACE_MAX_RECORD];
+    uint32_t delta = started ? (uint32_t)(time - last) : 0;
+    size_t n = traceEncodeRecord(delta, rssi, snr, payload, len, buf, sizeof(buf));
+    if (n == 0) {
+        return false;
+    }
+    started = true;
+    last = time;
+    return sink.write(buf, n) == n;
+}
+
+bool TraceReader::begin()
+{
+    uint8_t header[TRACE_HEADER_SIZE];
+    time = 0;
+    return source.read(header, sizeof(header)) == sizeof(header) && traceDecodeHeader(header);
+}
+
+bool TraceReader::next(TraceRecord &record)
+{
+    if (!readRecord(source, record)) {
+        return false;
+    }
+    time += record.time;
+    record.time = time;
+    return true;
+}
+
+TraceRadio::TraceRadio(TraceReader &reader, SystemClock &clock, float speed)
+    : reader(reader), clock(clock), speed(speed), start(0), started(false),
+      pending(false), done(false)
+{
+    current.length = 0;
+}
+
+int TraceRadio::parsePacket()
+{
+    if (!pending && !done) {
+        pending = reader.next(next);
+        done = !pending;
+    }
+    if (!pending) {
+        return 0;
+    }
+    if (!started) {
+        // the first record plays right away
+        start = clock.millis() - (unsigned long)(speed > 0 ? next.time / speed : 0);
+        started = true;
+    }
+    if (speed > 0 && clock.millis() - start < (unsigned long)(next.time / speed)) {
+        return 0;
+    }
+    memcpy(&current, &next, sizeof(current));
+    pending = false;
+    return current.length;
+}
+
+size_t TraceRadio::readPacket(uint8_t *buf, size_t size)
+{
+    size_t n = current.length < size ? current.length : size;
+    memcpy(buf, current.payload, n);
+    return n;
+}
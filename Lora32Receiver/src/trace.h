@@ -0,0 +1,107 @@
+#ifndef GATEWAY_TRACE_H
+#define GATEWAY_TRACE_H
+
+// Packet traces: received LoRa frames recorded on the board (SD card or
+// serial) and replayed through the gateway on the board or on the host.
+//
+// File format, all varints are LEB128:
+//   header  "LTRC" <version 1> <3 reserved bytes>
+//   record  <varint ms since the previous record, 0 for the first>
+//           <varint zigzag rssi dBm>
+//           <int8 snr in 0.25 dB>
+//           <varint payload length> <payload>
+// On serial every record is a line "TRACE:<record in hex>".
+
+#include "hal.h"
+
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 8
+#define TRACE_MAX_PAYLOAD GATEWAY_MAX_FRAME
+// largest encoded record
+#define TRACE_MAX_RECORD (5 + 5 + 1 + 2 + TRACE_MAX_PAYLOAD)
+
+typedef struct {
+    uint32_t time;        // ms since the first record
+    int16_t rssi;
+    float snr;
+    uint16_t length;
+    uint8_t payload[TRACE_MAX_PAYLOAD];
+} TraceRecord;
+
+// where the records go: a file, serial...
+class TraceSink {
+public:
+    virtual ~TraceSink() {}
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+};
+
+// where the records come from, read returns the number of bytes read
+class TraceSource {
+public:
+    virtual ~TraceSource() {}
+    virtual size_t read(uint8_t *data, size_t len) = 0;
+};
+
+// writes the file header
+size_t traceEncodeHeader(uint8_t out[TRACE_HEADER_SIZE]);
+// false if the header is not a trace of a known version
+bool traceDecodeHeader(const uint8_t header[TRACE_HEADER_SIZE]);
+// encodes one record with the time delta to the previous one, returns its size
+size_t traceEncodeRecord(uint32_t delta, int rssi, float snr, const uint8_t *payload, size_t len,
+                         uint8_t *out, size_t size);
+// decodes one record from a buffer, returns the bytes used or 0 if incomplete or invalid.
+// record.time is the delta to the previous record
+size_t traceDecodeRecord(const uint8_t *data, size_t len, TraceRecord &record);
+
+class TraceWriter {
+public:
+    explicit TraceWriter(TraceSink &sink) : sink(sink), started(false), last(0) {}
+    // writes the file header, not used on serial
+    bool begin();
+    // time in ms from any clock, only differences are stored
+    bool record(unsigned long time, int rssi, float snr, const uint8_t *payload, size_t len);
+
+private:
+    TraceSink &sink;
+    bool started;
+    unsigned long last;
+};
+
+class TraceReader {
+public:
+    explicit TraceReader(TraceSource &source) : source(source), time(0) {}
+    // reads and checks the file header
+    bool begin();
+    // false at the end of the trace or on a broken record
+    bool next(TraceRecord &record);
+
+private:
+    TraceSource &source;
+    uint32_t time;
+};
+
+// radio that replays a trace. speed 1 keeps the original timing,
+// 10 plays ten times faster, 0 hands out packets as fast as they are read
+class TraceRadio : public RadioLink {
+public:
+    TraceRadio(TraceReader &reader, SystemClock &clock, float speed);
+    int parsePacket();
+    size_t readPacket(uint8_t *buf, size_t size);
+    int packetRssi() { return current.rssi; }
+    float packetSnr() { return current.snr; }
+    // all records handed out
+    bool finished() const { return done; }
+
+private:
+    TraceReader &reader;
+    SystemClock &clock;
+    float speed;
+    unsigned long start;
+    bool started;
+    bool pending;
+    bool done;
+    TraceRecord next;
+    TraceRecord current;
+};
+
+#endif
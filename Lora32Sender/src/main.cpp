@@ -1,7 +1,41 @@
 #include <LoRa.h>
+#include <Preferences.h>
 #include "boards.h"
+#include "airframe.h"
+#include "textcodec.h"
+
+// Frames go out as air frames (airframe.h): the message number travels in
+// the header instead of the text. AIR_FRAME 0 sends the old plain text.
+#ifndef AIR_FRAME
+#define AIR_FRAME 1
+#endif
+// the text goes out compressed (textcodec.h) when that is shorter
+#ifndef COMPRESS
+#define COMPRESS 1
+#endif
+// short id of this sender, 0 takes 21 bits of the MAC (3 varint bytes)
+#ifndef SENDER_ID
+#define SENDER_ID 0
+#endif
+
+// message numbers go on after a reboot, the receiver drops a repeated
+// sender and number as a duplicate. The next SEQ_RESERVE numbers are
+// reserved in NVS up front, one flash write per SEQ_RESERVE messages,
+// and a reboot skips what was left of them.
+#ifndef SEQ_RESERVE
+#define SEQ_RESERVE 64
+#endif
 
 int counter = 0;
+uint32_t senderId = SENDER_ID;
+Preferences prefs;
+int reserved = 0;
+
+void reserveSeq()
+{
+    reserved = counter + SEQ_RESERVE;
+    prefs.putInt("seq", reserved);
+}
 
 void setup()
 {
@@ -10,11 +44,22 @@ void setup()
     delay(1500);
 
     Serial.println("LoRa Sender");
+    prefs.begin("sender", false);
+    counter = prefs.getInt("seq", 0);
+    reserveSeq();
     LoRa.setPins(RADIO_CS_PIN, RADIO_RST_PIN, RADIO_DIO0_PIN);
     if (!LoRa.begin(LoRa_frequency)) {
         Serial.println("Starting LoRa failed!");
         while (1);
     }
+#if AIR_FRAME
+    if (senderId == 0) {
+        // the device specific half of the MAC, bytes 3..5
+        senderId = (uint32_t)(ESP.getEfuseMac() >> 24) & 0x1FFFFF;
+    }
+    Serial.print("Sender id: ");
+    Serial.println(senderId, HEX);
+#endif
 }
 
 void loop()
@@ -24,8 +69,27 @@ void loop()
 
     // send packet
     LoRa.beginPacket();
+#if AIR_FRAME
+    static const char text[] = "Hello NostrLoraMesh!";
+    const uint8_t *payload = (const uint8_t *)text;
+    size_t len = sizeof(text) - 1;
+    uint8_t flags = 0;
+#if COMPRESS
+    uint8_t packed[sizeof(text)];
+    size_t packedLen = textCompress(payload, len, packed, sizeof(packed));
+    if (packedLen > 0 && packedLen < len) {
+        payload = packed;
+        len = packedLen;
+        flags |= AIRFRAME_COMPRESSED;
+    }
+#endif
+    uint8_t frame[AIRFRAME_MAX_HEADER + sizeof(text)];
+    size_t n = airFrameEncode(AIRFRAME_TEXT, flags, senderId, (uint32_t)counter, payload, len, frame, sizeof(frame));
+    LoRa.write(frame, n);
+#else
     LoRa.print("Hello NostrLoraMesh! This is message number ");
     LoRa.print(counter);
+#endif
     LoRa.endPacket();
 
 #ifdef HAS_DISPLAY
@@ -39,5 +103,8 @@ void loop()
     }
 #endif
     counter++;
+    if (counter >= reserved) {
+        reserveSeq();
+    }
     delay(60000);
 }